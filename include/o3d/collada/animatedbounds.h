@@ -0,0 +1,108 @@
+/**
+ * @file animatedbounds.h
+ * @brief O3DCollada bounds of the skinned meshes along the imported animations.
+ * @author Frederic SCHERMA (frederic.scherma@dreamoverflow.org)
+ * @date 2026-10-18
+ * @copyright Copyright (c) 2001-2026 Dream Overflow. All rights reserved.
+ * @details
+ */
+
+#ifndef _O3D_COLLADA_ANIMATEDBOUNDS_H
+#define _O3D_COLLADA_ANIMATEDBOUNDS_H
+
+#include <o3d/core/string.h>
+
+#include <map>
+#include <vector>
+
+namespace o3d {
+
+class BaseNode;
+class Skinning;
+class AnimationNode;
+
+namespace collada {
+
+//---------------------------------------------------------------------------------------
+//! @class AnimatedBounds
+//-------------------------------------------------------------------------------------
+//! Conservative bounds of a skinned mesh. The bone bounds contain the vertices
+//! influenced by each bone, in the space of the bone at the bind pose, so the mesh
+//! is contained by the union of the bone bounds transformed by the current bones
+//! matrices. The frame bounds are this union for each sample of the animation of the
+//! skeleton, in world space, padded by half of the motion of the bone bounds to the
+//! neighbour frames. The samples follow the interpolation of the tracks (see
+//! AnimationSampler), the padding covering the bones turning of less than half a turn
+//! between two frames.
+//---------------------------------------------------------------------------------------
+struct AnimatedBounds
+{
+	o3d::Skinning *skinning;
+	String animation;                 //!< resource name of the animation, or empty
+	Float duration;                   //!< of the animation, in seconds
+	Float sampleRate;                 //!< frames per second
+
+	std::vector<Float> boneBounds;    //!< 6 floats per bone, minimum then maximum
+	std::vector<Float> frames;        //!< 6 floats per frame, minimum then maximum
+
+	//! Get the number of sampled frames.
+	inline UInt32 getNumFrames() const { return static_cast<UInt32>(frames.size() / 6); }
+
+	//! Get the bounds at a time (in seconds, looped over the duration), as the union
+	//! of the two padded frames around it. Returns False if there is no frame.
+	Bool getBounds(Float time, Float *bmin, Float *bmax) const;
+};
+
+//---------------------------------------------------------------------------------------
+//! @class AnimatedBoundsLibrary
+//-------------------------------------------------------------------------------------
+//! The animated bounds of the skinned meshes of the imports of a Collada instance, per
+//! animation. The skinnings are added during the import, and the frames are sampled
+//! once the skeletons are set.
+//---------------------------------------------------------------------------------------
+class AnimatedBoundsLibrary
+{
+public:
+
+	//! Add a skinning, with the bounds of its bones (6 floats per bone, in bone space).
+	void addSkinning(o3d::Skinning *skinning, std::vector<Float> &boneBounds);
+
+	//! Sample the bounds of the added skinnings along the animations of their bones. The
+	//! skinnings having bounds no longer compute their bounding at each update, the union
+	//! of their frames being set as the static bounding of their geometry.
+	//! @param animNodes Animation node of each animated scene node.
+	//! @param animations Resource name of the animation of each root animation node.
+	//! @param duration Duration of the animations in seconds.
+	//! @param sampleRate Frames per second.
+	void build(
+			const std::map<const o3d::BaseNode*, o3d::AnimationNode*> &animNodes,
+			const std::map<const o3d::AnimationNode*, String> &animations,
+			Float duration,
+			Float sampleRate);
+
+	//! Get the bounds of a skinning, or null.
+	const AnimatedBounds* find(const o3d::Skinning *skinning) const;
+
+	//! Get the bounds of the skinnings animated by an animation.
+	void findAnimation(const String &resourceName, std::vector<const AnimatedBounds*> &bounds) const;
+
+	//! Get the number of skinnings having bounds.
+	inline UInt32 getNumSkinnings() const { return static_cast<UInt32>(m_bounds.size()); }
+
+	//! Remove every bounds.
+	void clear();
+
+private:
+
+	std::map<const o3d::Skinning*, AnimatedBounds> m_bounds;
+	std::vector<const o3d::Skinning*> m_pending;   //!< added since the last build
+
+	//! Set the union of the frames, and of the bind pose, as the static bounding of a
+	//! skinning.
+	static void setStaticBounding(const AnimatedBounds &bounds);
+};
+
+} // namespace collada
+} // namespace o3d
+
+#endif // _O3D_COLLADA_ANIMATEDBOUNDS_H
@@ -50,6 +50,9 @@ public:
 	//! Set pre-export values from the scene
 	virtual Bool fromScene();
 
+	//! Release any reference to the COLLADA-DOM
+	virtual void releaseDom();
+
 	//! Get the node target id
 	inline const String& getNodeTargetId() const { return m_targetObjectID; }
 
@@ -63,6 +66,10 @@ protected:
 
     /*const*/ domAnimationRef m_animation;
 
+	typedef std::vector<CAnimation*> T_AnimationList;
+	typedef T_AnimationList::iterator IT_AnimationList;
+	T_AnimationList m_subAnimations;   //!< owned sub-animations
+
 	Bool m_hasTranslate;
 	Bool m_hasRotate;
 	Bool m_hasScale;
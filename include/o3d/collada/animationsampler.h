@@ -0,0 +1,110 @@
+/**
+ * @file animationsampler.h
+ * @brief O3DCollada sampling of the imported animation tracks.
+ * @author Frederic SCHERMA (frederic.scherma@dreamoverflow.org)
+ * @date 2026-10-18
+ * @copyright Copyright (c) 2001-2026 Dream Overflow. All rights reserved.
+ * @details
+ */
+
+#ifndef _O3D_COLLADA_ANIMATIONSAMPLER_H
+#define _O3D_COLLADA_ANIMATIONSAMPLER_H
+
+#include <o3d/core/matrix4.h>
+#include <o3d/core/string.h>
+
+#include <map>
+#include <vector>
+
+namespace o3d {
+
+class BaseNode;
+class AnimationNode;
+class Skinning;
+
+namespace collada {
+
+//---------------------------------------------------------------------------------------
+//! @class AnimationSampler
+//-------------------------------------------------------------------------------------
+//! Evaluate the position, rotation and scale tracks of an animation node, as they are
+//! generated by the importer, to a transform matrix. The vector and angle keys are
+//! interpolated linearly, the quaternion keys spherically, and the Bezier angle keys
+//! along their curve. The key times are relative to the duration of the animation.
+//! The matrices are row major, as written by COLLADA.
+//---------------------------------------------------------------------------------------
+class AnimationSampler
+{
+public:
+
+	//! Get the sorted and unique times of the keys of an animation node.
+	static void getKeyTimes(o3d::AnimationNode *animNode, std::vector<Float> &times);
+
+	//! Sample the tracks of an animation node at a relative time. The matrix is
+	//! relative to the transform of the node. Returns False if there is no key.
+	static Bool sample(o3d::AnimationNode *animNode, Float time, Float *matrix);
+
+	//! Matrix4 stores its elements by column, get them by row.
+	static void toRowMajor(const Matrix4 &m, Float *out);
+
+	//! Product of two row major matrices.
+	static void mulRowMajor(const Float *a, const Float *b, Float *out);
+};
+
+//---------------------------------------------------------------------------------------
+//! @class AnimationPose
+//-------------------------------------------------------------------------------------
+//! World matrices of the scene nodes at a relative time of their animation nodes,
+//! evaluated on demand from the nodes transforms and computed once per node.
+//---------------------------------------------------------------------------------------
+class AnimationPose
+{
+public:
+
+	//! Animation node of each animated scene node.
+	typedef std::map<const o3d::BaseNode*, o3d::AnimationNode*> T_AnimationNodeMap;
+
+	//! Resource name of the animation of each root animation node.
+	typedef std::map<const o3d::AnimationNode*, String> T_AnimationNameMap;
+
+	AnimationPose(const T_AnimationNodeMap &animNodes, Float time) :
+		m_animNodes(&animNodes),
+		m_time(time) {}
+
+	//! Get the row major world matrix of a node.
+	const Float* getWorld(o3d::BaseNode *node);
+
+	//! Get the poses of the frames sampling the animations, shared by the animations of
+	//! an import. A single frame at the start if the duration or the rate is null.
+	//! @param duration Duration of the animations in seconds.
+	//! @param sampleRate Frames per second.
+	static void buildFrames(
+			const T_AnimationNodeMap &animNodes,
+			Float duration,
+			Float sampleRate,
+			std::vector<AnimationPose> &poses);
+
+	//! Get the animation of the skeleton of a skinning, from the root of the animation
+	//! nodes of its bones. Returns an empty string if its bones are not animated.
+	static String findAnimation(
+			const o3d::Skinning *skinning,
+			const T_AnimationNodeMap &animNodes,
+			const T_AnimationNameMap &animations);
+
+private:
+
+	struct Matrix
+	{
+		Float m[16];
+	};
+
+	const T_AnimationNodeMap *m_animNodes;
+	Float m_time;
+
+	std::map<const o3d::BaseNode*, Matrix> m_worlds;
+};
+
+} // namespace collada
+} // namespace o3d
+
+#endif // _O3D_COLLADA_ANIMATIONSAMPLER_H
@@ -0,0 +1,105 @@
+/**
+ * @file archive.h
+ * @brief O3DCollada compressed documents, gzip streams and zae archives.
+ * @author Frederic SCHERMA (frederic.scherma@dreamoverflow.org)
+ * @date 2026-10-18
+ * @copyright Copyright (c) 2001-2026 Dream Overflow. All rights reserved.
+ * @details
+ */
+
+#ifndef _O3D_COLLADA_ARCHIVE_H
+#define _O3D_COLLADA_ARCHIVE_H
+
+#include "mappedfile.h"
+
+#include <map>
+#include <string>
+
+namespace o3d {
+namespace collada {
+
+//! Is a file name a gzip compressed document (.dae.gz or .gz).
+Bool isGzipFile(const String &filename);
+
+//! Is a file name a zae archive.
+Bool isZaeFile(const String &filename);
+
+//! Decompress a whole gzip stream, chunk by chunk, and append it to out.
+//! Returns False if the stream is not valid.
+Bool inflateGzip(const Char *data, UInt64 size, std::string &out);
+
+//! Mount an archive into the file manager, shared by the importers of every thread:
+//! it is mounted by the first one and counted. Returns False if it cannot be mounted.
+Bool mountArchive(const String &filename);
+
+//! Release an archive mounted by mountArchive, unmounted by the last one.
+void umountArchive(const String &filename);
+
+//---------------------------------------------------------------------------------------
+//! @class ZaeArchive
+//-------------------------------------------------------------------------------------
+//! A zae archive, a zip bundling a COLLADA document and its resources. The archive is
+//! memory mapped and an entry is decompressed only when it is read. The root document is
+//! given by the manifest.xml entry, or is the first .dae entry.
+//! Only the stored and deflated entries of a zip without zip64 extension are supported,
+//! open() fails on a zip64 archive, getError() telling why. An entry is inflated at
+//! once into memory.
+//---------------------------------------------------------------------------------------
+class ZaeArchive
+{
+public:
+
+	//! Default ctor.
+	ZaeArchive();
+
+	//! Open an archive and read its central directory.
+	Bool open(const String &filename);
+
+	//! Close the archive.
+	void close();
+
+	//! Is an archive opened.
+	inline Bool isOpen() const { return m_file.isOpen(); }
+
+	//! Get the number of entries.
+	inline UInt32 getNumEntries() const { return static_cast<UInt32>(m_entries.size()); }
+
+	//! Is there an entry, given its path into the archive.
+	Bool hasEntry(const String &name) const;
+
+	//! Decompress an entry. Returns False if it does not exist or is not valid.
+	Bool read(const String &name, std::string &out) const;
+
+	//! Get the path of the root document into the archive, or an empty string.
+	String getRootDocument() const;
+
+	//! Get the reason of the last failure of open() or read(), or an empty string.
+	inline const String& getError() const { return m_error; }
+
+private:
+
+	//! An entry of the central directory.
+	struct Entry
+	{
+		UInt64 headerOffset;    //!< offset of the local header
+		UInt32 method;          //!< 0 stored, 8 deflated
+		UInt32 compressedSize;
+		UInt32 size;
+	};
+
+	MappedFile m_file;
+
+	typedef std::map<std::string, Entry> T_EntryMap;
+	typedef T_EntryMap::const_iterator CIT_EntryMap;
+	T_EntryMap m_entries;
+
+	mutable String m_error;
+
+	//! Set the reason of a failure, and return False.
+	Bool fail(const String &error) const;
+};
+
+} // namespace collada
+} // namespace o3d
+
+#endif // _O3D_COLLADA_ARCHIVE_H
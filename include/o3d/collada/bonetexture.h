@@ -0,0 +1,147 @@
+/**
+ * @file bonetexture.h
+ * @brief O3DCollada skinning matrices of the imported animations baked into textures.
+ * @author Frederic SCHERMA (frederic.scherma@dreamoverflow.org)
+ * @date 2026-10-18
+ * @copyright Copyright (c) 2001-2026 Dream Overflow. All rights reserved.
+ * @details
+ */
+
+#ifndef _O3D_COLLADA_BONETEXTURE_H
+#define _O3D_COLLADA_BONETEXTURE_H
+
+#include <o3d/core/instream.h>
+#include <o3d/core/outstream.h>
+#include <o3d/core/string.h>
+
+#include <map>
+#include <vector>
+
+namespace o3d {
+
+class Skinning;
+
+namespace collada {
+
+//---------------------------------------------------------------------------------------
+//! @class BoneTexture
+//-------------------------------------------------------------------------------------
+//! The skinning matrices of the bones of a skinned mesh, sampled along its animation
+//! clips at a fixed rate, laid out as a RGBA 32 bits float texture for the skinning on
+//! the GPU of many instances. A row of the texture is a frame of a clip, the clips
+//! following each other, and each bone takes a few texels of a row:
+//! - as matrices, 3 texels being the rows of the 3x4 skinning matrix,
+//! - as dual quaternions, 2 texels being the real and the dual parts (x y z w), for
+//!   rigid transforms only (the scale is dropped), the consecutive frames of a bone
+//!   being on the same hemisphere to be linearly interpolated.
+//! The skinning matrix of a bone is its world matrix times its inverse bind matrix,
+//! so the mesh vertices are transformed as they are into the mesh data.
+//---------------------------------------------------------------------------------------
+class BoneTexture
+{
+public:
+
+	enum Format
+	{
+		MATRICES = 0,           //!< 3 texels per bone
+		DUAL_QUATERNIONS = 1    //!< 2 texels per bone
+	};
+
+	//! A clip, as the range of rows of its frames.
+	struct Clip
+	{
+		String name;            //!< resource name of the animation
+		UInt32 firstRow;
+		UInt32 numFrames;
+		Float duration;         //!< in seconds
+		Float sampleRate;       //!< frames per second
+	};
+
+	//! Default ctor.
+	BoneTexture(Format format = MATRICES);
+
+	//! Get the name of the skinned mesh.
+	inline const String& getName() const { return m_name; }
+	//! Set the name of the skinned mesh.
+	inline void setName(const String &name) { m_name = name; }
+
+	//! Set the names of the bones, which defines their number. Clear the clips.
+	void setBones(const std::vector<String> &names);
+
+	//! Get the number of bones.
+	inline UInt32 getNumBones() const { return static_cast<UInt32>(m_bones.size()); }
+	//! Get the names of the bones.
+	inline const std::vector<String>& getBones() const { return m_bones; }
+
+	//! Get the format of the texels.
+	inline Format getFormat() const { return m_format; }
+	//! Get the number of texels of a bone.
+	inline UInt32 getTexelsPerBone() const { return m_format == MATRICES ? 3 : 2; }
+
+	//! Get the width of the texture in texels.
+	inline UInt32 getWidth() const { return getNumBones() * getTexelsPerBone(); }
+	//! Get the height of the texture, the number of frames of every clip.
+	inline UInt32 getHeight() const { return m_height; }
+
+	//! Get the texels, 4 floats each, row by row.
+	inline const std::vector<Float>& getTexels() const { return m_texels; }
+
+	//! Get the clips.
+	inline const std::vector<Clip>& getClips() const { return m_clips; }
+
+	//! Append a clip from the skinning matrices of each bone at each frame (row major
+	//! 3x4 matrices, 12 floats each, frame by frame).
+	void addClip(const String &name, Float duration, Float sampleRate, UInt32 numFrames, const Float *matrices);
+
+	//! Write the metadata table followed by the texels.
+	Bool writeToStream(OutStream &os) const;
+
+	//! Read a texture written by writeToStream.
+	Bool readFromStream(InStream &is);
+
+private:
+
+	String m_name;
+	Format m_format;
+
+	std::vector<String> m_bones;
+	std::vector<Clip> m_clips;
+
+	UInt32 m_height;
+	std::vector<Float> m_texels;
+};
+
+//---------------------------------------------------------------------------------------
+//! @class BoneTextureLibrary
+//-------------------------------------------------------------------------------------
+//! The bone textures baked by the imports of a Collada instance, per skinned mesh.
+//---------------------------------------------------------------------------------------
+class BoneTextureLibrary
+{
+public:
+
+	//! Get the texture of a skinning, created with a format if it does not exist.
+	BoneTexture& get(const o3d::Skinning *skinning, BoneTexture::Format format);
+
+	//! Get the texture of a skinning, or null.
+	const BoneTexture* find(const o3d::Skinning *skinning) const;
+
+	//! Get the number of textures.
+	inline UInt32 getNumTextures() const { return static_cast<UInt32>(m_textures.size()); }
+
+	//! Write every texture, in the order of their creation.
+	Bool writeToStream(OutStream &os) const;
+
+	//! Remove every texture.
+	void clear();
+
+private:
+
+	std::map<const o3d::Skinning*, BoneTexture> m_textures;
+	std::vector<const o3d::Skinning*> m_order;   //!< in order of creation
+};
+
+} // namespace collada
+} // namespace o3d
+
+#endif // _O3D_COLLADA_BONETEXTURE_H
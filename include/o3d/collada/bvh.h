@@ -0,0 +1,179 @@
+/**
+ * @file bvh.h
+ * @brief O3DCollada bounding volume hierarchies of the imported scene and meshes.
+ * @author Frederic SCHERMA (frederic.scherma@dreamoverflow.org)
+ * @date 2026-10-18
+ * @copyright Copyright (c) 2001-2026 Dream Overflow. All rights reserved.
+ * @details
+ */
+
+#ifndef _O3D_COLLADA_BVH_H
+#define _O3D_COLLADA_BVH_H
+
+#include <o3d/core/instream.h>
+#include <o3d/core/outstream.h>
+#include <o3d/core/string.h>
+
+#include <map>
+#include <utility>
+#include <vector>
+
+namespace o3d {
+
+class BaseNode;
+class Node;
+
+namespace collada {
+
+//---------------------------------------------------------------------------------------
+//! @class Bvh
+//-------------------------------------------------------------------------------------
+//! Bounding volume hierarchy over axis aligned boxes, built top-down with a binned
+//! surface area heuristic, the large sub-trees on their own thread. The nodes are
+//! stored in a flat array: the root is the first node, the children of an internal
+//! node are consecutive, and a leaf refers to a range of the primitive array, whose
+//! boxes are kept in the same order to be tested by the queries. This layout is
+//! written and read as is.
+//---------------------------------------------------------------------------------------
+class Bvh
+{
+public:
+
+	//! A node of the hierarchy (32 bytes).
+	struct Node
+	{
+		Float bmin[3];
+		UInt32 leftFirst;   //!< first child if internal, else first primitive
+		Float bmax[3];
+		UInt32 count;       //!< number of primitives of a leaf, 0 if internal
+
+		inline Bool isLeaf() const { return count > 0; }
+	};
+
+	//! Build the hierarchy of primitives given by their boxes (minimum x y z then
+	//! maximum x y z, 6 floats each).
+	void build(const Float *boxes, UInt32 numPrimitives, UInt32 numThreads = 1);
+
+	//! Remove every node.
+	void clear();
+
+	//! Is the hierarchy empty.
+	inline Bool isEmpty() const { return m_nodes.empty(); }
+
+	//! Get the nodes, the root first.
+	inline const std::vector<Node>& getNodes() const { return m_nodes; }
+	//! Get the primitives indices referenced by the leaves.
+	inline const std::vector<UInt32>& getPrimitives() const { return m_primitives; }
+
+	//! Collect the primitives whose box is hit by a ray, with their entry distance,
+	//! sorted from the nearest. The direction does not need to be normalized, the
+	//! distances are then in units of its length.
+	void raycast(
+			const Float *origin,
+			const Float *direction,
+			Float maxDistance,
+			std::vector<std::pair<Float, UInt32> > &hits) const;
+
+	//! Collect the primitives whose box overlaps a box.
+	void overlap(const Float *bmin, const Float *bmax, std::vector<UInt32> &primitives) const;
+
+	//! Write the hierarchy.
+	Bool writeToStream(OutStream &os) const;
+
+	//! Read a hierarchy written by writeToStream.
+	Bool readFromStream(InStream &is);
+
+private:
+
+	std::vector<Node> m_nodes;
+	std::vector<UInt32> m_primitives;
+	std::vector<Float> m_boxes;        //!< 6 floats per primitive, in the leaves order
+};
+
+//---------------------------------------------------------------------------------------
+//! @class SceneBvh
+//-------------------------------------------------------------------------------------
+//! Hierarchy over the world space bounds of the mesh and skinning objects created by
+//! the imports of a Collada instance, for picking and culling, and optionally a
+//! hierarchy over the triangles of each mesh data, in its local space. The triangles
+//! of a mesh data are numbered across its face arrays, in their order.
+//! The objects are referenced, not owned, so the hierarchy must be cleared with the
+//! scene. Skinned objects are bounded by their bind pose.
+//---------------------------------------------------------------------------------------
+class SceneBvh
+{
+public:
+
+	//! An object of the scene.
+	struct Instance
+	{
+		o3d::BaseNode *object;   //!< mesh or skinning
+		o3d::Node *node;         //!< parent node, giving its world transform
+		String meshData;         //!< resource name of its mesh data
+		Float bmin[3];           //!< world space bounds, once built
+		Float bmax[3];
+	};
+
+	//! Set the local bounds of a mesh data.
+	void setMeshBounds(const String &resourceName, const Float *bmin, const Float *bmax);
+
+	//! Is there the local bounds of a mesh data.
+	inline Bool hasMeshBounds(const String &resourceName) const { return m_meshBounds.count(resourceName) > 0; }
+
+	//! Build the hierarchy over the triangles of a mesh data, for a list of face arrays
+	//! of 16 or 32 bits indices (one of them null).
+	void buildMeshBvh(
+			const String &resourceName,
+			const Float *vertices,
+			const std::vector<const UInt16*> &faces16,
+			const std::vector<const UInt32*> &faces32,
+			const std::vector<UInt32> &numIndices,
+			UInt32 numThreads);
+
+	//! Add an object using a mesh data.
+	void addInstance(o3d::BaseNode *object, o3d::Node *node, const String &resourceName);
+
+	//! Compute the world bounds of the objects and build the hierarchy over them.
+	void build(UInt32 numThreads = 1);
+
+	//! Remove every object and hierarchy.
+	void clear();
+
+	//! Get the hierarchy over the objects.
+	inline const Bvh& getBvh() const { return m_bvh; }
+
+	//! Get the number of objects into the hierarchy.
+	inline UInt32 getNumInstances() const { return static_cast<UInt32>(m_instances.size()); }
+	//! Get an object into the hierarchy, its index being a primitive of the hierarchy.
+	inline const Instance& getInstance(UInt32 i) const { return m_instances[i]; }
+
+	//! Get the hierarchy over the triangles of a mesh data, or null.
+	const Bvh* getMeshBvh(const String &resourceName) const;
+
+	//! Collect the objects whose world bounds are hit by a ray, from the nearest.
+	void pick(
+			const Float *origin,
+			const Float *direction,
+			std::vector<const Instance*> &instances) const;
+
+private:
+
+	struct MeshBounds
+	{
+		Float bmin[3];
+		Float bmax[3];
+	};
+
+	std::map<String, MeshBounds> m_meshBounds;
+	std::map<String, Bvh> m_meshBvhs;
+
+	std::vector<Instance> m_pending;     //!< added since the last build
+	std::vector<Instance> m_instances;   //!< into the hierarchy
+
+	Bvh m_bvh;
+};
+
+} // namespace collada
+} // namespace o3d
+
+#endif // _O3D_COLLADA_BVH_H
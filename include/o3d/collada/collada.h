@@ -10,6 +10,7 @@
 #ifndef _O3D_COLLADA_H
 #define _O3D_COLLADA_H
 
+#include <o3d/core/instream.h>
 #include <o3d/engine/hierarchy/node.h>
 
 #include <dae.h>
@@ -19,6 +20,18 @@
 #include "material.h"
 #include "geometry.h"
 #include "animation.h"
+#include "session.h"
+#include "numericarrays.h"
+#include "uriresolver.h"
+#include "exporter.h"
+#include "meshlets.h"
+#include "bvh.h"
+#include "animatedbounds.h"
+#include "animationsampler.h"
+#include "bonetexture.h"
+
+#include <atomic>
+#include <thread>
 
 namespace o3d {
 namespace collada {
@@ -29,11 +42,51 @@ class CNode;
 //! @class Collada
 //-------------------------------------------------------------------------------------
 //! Import/export COLLADA format to/from objective-3d native scene.
+//! Many instances can import concurrently from different threads, as long as each
+//! one targets its own scene and session (if any). An instance itself must not be
+//! used by several threads at once. The COLLADA-DOM global states being shared, the
+//! parsing of the documents by the COLLADA-DOM and the stages from IMPORT_GLOBAL to
+//! IMPORT_RELEASE are serialized by the DaeLock, except the conversion of the
+//! geometries and of the skin weights once their arrays are resolved. The reading,
+//! the decompression and the float arrays extraction of the documents, and the stages
+//! building the scene, run concurrently.
+//! The import can be processed at once, or stepped by units of work (a geometry to
+//! triangulate, a root node to import or to set to the scene...) for a given time
+//! budget, for example from the update loop of an interactive application.
+//! The stages before IMPORT_TO_SCENE do not modify the scene, so they can run on a
+//! worker thread (see processImportAsync), the following ones must run on the thread
+//! owning the scene.
 //---------------------------------------------------------------------------------------
 class Collada
 {
 public:
 
+	//! Stages of an import, in their processing order.
+	enum ImportStage
+	{
+		IMPORT_IDLE,          //!< no import is running
+		IMPORT_OPEN,          //!< parse the document
+		IMPORT_GLOBAL,        //!< import the asset
+		IMPORT_TRIANGULATE,   //!< triangulate the polygons, one geometry per unit
+		IMPORT_NODES,         //!< import the geometries and controllers, one root node per unit
+		IMPORT_ANIMATIONS,    //!< import the animations, one per unit
+		IMPORT_RELEASE,       //!< release the document
+		IMPORT_TO_SCENE,      //!< set to the scene, the asset then one root node per unit
+		IMPORT_POST_PASS,     //!< apply the skeletons and animations, one root node per unit
+		IMPORT_DONE,          //!< the import is done
+		IMPORT_FAILED         //!< the document cannot be opened
+	};
+
+	//! Resident memory of the process sampled at the main steps of the last import.
+	struct MemoryUsage
+	{
+		UInt64 parsed;     //!< once the document is parsed
+		UInt64 imported;   //!< once the document content is imported
+		UInt64 released;   //!< once the document is closed and released
+
+		MemoryUsage() : parsed(0), imported(0), released(0) {}
+	};
+
 	//! Default ctor.
 	Collada();
 
@@ -43,12 +96,112 @@ public:
 	//! Define the O3D scene.
 	void setScene(o3d::Scene *scene);
 
-	//! Run the import processing.
+	//! Define an import session, to share the COLLADA-DOM database and the caches
+	//! with the other imports into the same scene (not owned, can be null).
+	//! The scene of the session is used.
+	void setSession(ColladaSession *session);
+
+	//! Set the import options, to skip whole categories (animations, skins, materials
+	//! or textures) or import only some node sub-trees.
+	inline void setImportOptions(const ImportOptions &options) { m_info.setOptions(options); }
+	//! Get the import options.
+	inline const ImportOptions& getImportOptions() const { return m_info.getOptions(); }
+
+	//! Get the import informations and settings.
+	inline ColladaInfo& getInfo() { return m_info; }
+	//! Get the import informations and settings (read only).
+	inline const ColladaInfo& getInfo() const { return m_info; }
+
+	//! Run the import processing at once.
 	Bool processImport(const String &filename);
 
-	//! Run the export processing.
+	//! Run the import processing at once, of a document in memory.
+	//! @param data Content of the document, plain text or gzip compressed if the name
+	//!        ends with .gz (a zae archive can only be imported from a file). It is not
+	//!        copied.
+	//! @param name Name of the document, as a file name. It gives the base path of the
+	//!        relative references and of the textures (see UriResolver).
+	Bool processImport(const Char *data, UInt64 size, const String &name);
+
+	//! Run the import processing at once, of a document read from a stream until its end.
+	Bool processImport(InStream &is, const String &name);
+
+	//! Start a stepped import. Returns False if an import is already running.
+	Bool beginImport(const String &filename);
+
+	//! Start a stepped import of a document in memory. The data must stay valid until
+	//! the IMPORT_OPEN stage is processed.
+	Bool beginImport(const Char *data, UInt64 size, const String &name);
+
+	//! Process units of work of the running import until the time budget (in
+	//! milliseconds) is elapsed, at least one unit per call, or until the end if the
+	//! budget is 0. Returns the stage to process next, IMPORT_DONE or IMPORT_FAILED
+	//! at the end.
+	ImportStage step(UInt32 budgetMs = 0);
+
+	//! Abort the running import. The objects already set to the scene are kept.
+	void abortImport();
+
+	//! Get the stage to process next.
+	inline ImportStage getImportStage() const { return m_stage; }
+
+	//! Is an import started and not yet finished.
+	inline Bool isImporting() const { return m_stage > IMPORT_IDLE && m_stage < IMPORT_DONE; }
+
+	//! Get the progression into the current stage, from 0 to 1.
+	Float getStageProgress() const;
+
+	//! Get the name of a stage.
+	static const char* getStageName(ImportStage stage);
+
+	//! Start an import whose document reading and content conversion are done on a
+	//! worker thread, without accessing the scene. The scene is then modified by
+	//! commit(), called by the thread owning the scene. A session must not be used
+	//! elsewhere until the import is committed. Returns False if an import is running.
+	//! The profiler times the worker thread part as "load" and the commit as "commit".
+	Bool processImportAsync(const String &filename);
+
+	//! Is the worker thread part of an asynchronous import finished.
+	inline Bool isReadyToCommit() const { return m_loaded; }
+
+	//! Commit an asynchronous import to the scene, for a time budget like step(). It
+	//! waits for the worker thread if it is not finished. Returns the stage to process
+	//! next, IMPORT_DONE or IMPORT_FAILED at the end.
+	ImportStage commit(UInt32 budgetMs = 0);
+
+	//! Export the scene to a COLLADA 1.4.1 document file.
 	Bool processExport(const String &filename);
 
+	//! Export the scene as a COLLADA 1.4.1 document written to a stream.
+	//! @param name Name of the exported visual scene.
+	Bool processExport(OutStream &os, const String &name);
+
+	//! Get the exporter, to bind the animations to export to their node.
+	inline ColladaExporter& getExporter() { return m_exporter; }
+
+	//! Get the meshlets built by the imports (see ColladaInfo::setMeshletGeneration).
+	inline const MeshletLibrary& getMeshlets() const { return m_meshlets; }
+	//! Get the meshlets built by the imports, to release them.
+	inline MeshletLibrary& getMeshlets() { return m_meshlets; }
+
+	//! Get the hierarchy over the imported meshes (see ColladaInfo::setBvhGeneration).
+	inline const SceneBvh& getSceneBvh() const { return m_sceneBvh; }
+	//! Get the hierarchy over the imported meshes, to clear it with the scene.
+	inline SceneBvh& getSceneBvh() { return m_sceneBvh; }
+
+	//! Get the animated bounds of the skinned meshes (see ColladaInfo::setAnimatedBoundsGeneration).
+	inline const AnimatedBoundsLibrary& getAnimatedBounds() const { return m_animatedBounds; }
+	//! Get the animated bounds of the skinned meshes, to clear them with the scene.
+	inline AnimatedBoundsLibrary& getAnimatedBounds() { return m_animatedBounds; }
+
+	//! Get the bone textures of the skinned meshes (see ColladaInfo::setBoneTextureGeneration).
+	inline const BoneTextureLibrary& getBoneTextures() const { return m_boneTextures; }
+	//! Get the bone textures of the skinned meshes, to clear them with the scene.
+	inline BoneTextureLibrary& getBoneTextures() { return m_boneTextures; }
+
+	//! Get the memory usage sampled during the last import.
+	inline const MemoryUsage& getMemoryUsage() const { return m_memoryUsage; }
+
 protected:
 
 	o3d::Scene *m_scene;
@@ -59,13 +212,82 @@ protected:
 	CGlobal *m_global;
 	ColladaInfo m_info;
 
-	typedef std::list<CNode*> T_RootNodeList;
+	NumericArrays *m_numericArrays;   //!< float arrays extracted from the opened document
+
+	ColladaExporter m_exporter;
+	MeshletLibrary m_meshlets;
+	SceneBvh m_sceneBvh;
+	AnimatedBoundsLibrary m_animatedBounds;
+	BoneTextureLibrary m_boneTextures;
+
+	typedef std::vector<CNode*> T_RootNodeList;
 	typedef T_RootNodeList::iterator IT_RootNodeList;
 	T_RootNodeList m_rootNodes;
 
-	typedef std::list<CAnimation*> T_AnimationList;
+	typedef std::vector<CAnimation*> T_AnimationList;
 	typedef T_AnimationList::iterator IT_AnimationList;
 	T_AnimationList m_animationList;
+
+	//! Resource name of the animation of each root animation node, during IMPORT_POST_PASS.
+	AnimationPose::T_AnimationNameMap m_animationNames;
+
+	MemoryUsage m_memoryUsage;
+
+	ImportStage m_stage;
+	size_t m_stageIndex;            //!< next unit of work of the stage
+	size_t m_stageCount;            //!< number of units of work of the stage
+	String m_importFileName;        //!< imported file name, with '/' separators
+	String m_documentUri;           //!< name of the document into the COLLADA-DOM database
+	String m_mountedArchive;        //!< zae archive mounted to load its textures from
+
+	const Char *m_importData;       //!< document in memory, until IMPORT_OPEN
+	UInt64 m_importSize;
+	std::string m_importBuffer;     //!< document read from a stream
+	UInt32 m_totalEntry;            //!< profiler entry of the import, or of its commit if asynchronous
+	Bool m_totalOpened;             //!< the profiler entry is opened, on the thread finishing the import
+
+	domVisual_sceneRef m_visualScene;         //!< imported visual scene, during IMPORT_NODES
+	std::vector<domAnimationRef> m_animations;   //!< animations to import, during IMPORT_ANIMATIONS
+	String m_sceneName;                        //!< name of the visual scene, set during IMPORT_TO_SCENE
+
+	std::thread m_worker;          //!< worker thread of an asynchronous import
+	std::atomic<bool> m_loaded;    //!< the worker thread part is finished
+	Bool m_loadFailed;             //!< an error occurred on the worker thread
+
+	//! Worker thread part of an asynchronous import.
+	void loadAsync();
+
+	//! Open the profiler entry ended by finishImport, on the calling thread.
+	void beginTotalEntry(const char *category);
+
+	//! Enter a stage and count its units of work.
+	void setStage(ImportStage stage);
+
+	//! Process the next unit of work of the current stage.
+	void processUnit();
+
+	//! Delete the temporary imported objects and finish the import.
+	void finishImport(ImportStage stage);
+
+	//! Create the animation and its player for an animation root node.
+	void createAnimationPlayer(CNode *rootAnimNode);
+
+	//! Get the animation node of each animated scene node of the import.
+	void getAnimationNodes(AnimationPose::T_AnimationNodeMap &animNodes) const;
+
+	//! Sample the animated bounds of the skinned meshes of the import.
+	void buildAnimatedBounds();
+
+	//! Bake the skinning matrices of the skinned meshes of the import into textures.
+	void buildBoneTextures();
+
+	//! Open the imported document, its float arrays being extracted first if fast
+	//! parsing is enabled. Returns null on failure.
+	domCOLLADA* openDocument();
+
+	//! Release any reference to the document, close it and delete the database if
+	//! it is not shared by a session.
+	void releaseDocument(const String &filename);
 };
 
 } // namespace collada
@@ -18,6 +18,7 @@
 namespace o3d {
 
 class Skeleton;
+class Bones;
 
 namespace collada {
 
@@ -55,6 +56,9 @@ public:
 	//! Set pre-export values from the scene
 	virtual Bool fromScene();
 
+	//! Release any reference to the COLLADA-DOM
+	virtual void releaseDom();
+
 	//! Apply skeleton to skinning
 	Bool postImportPass();
 
@@ -67,10 +71,17 @@ public:
     //! Get the skeleton object
     inline Skeleton* getSkeleton() { return m_skeleton; }
 
+	//! Get the controller whose skeleton is shared, or null if it owns its skeleton.
+	inline CController* getSkeletonOwner() const { return m_skeletonOwner; }
+
+	//! Get the index of each joint into the joints of the skeleton owner, if any. The
+	//! skinning binds the bones and the bind matrices of these joints of the owner.
+	inline const std::vector<UInt32>& getSkeletonJoints() const { return m_skeletonJoints; }
+
 protected:
 
-	const domControllerRef m_controller;
-	const domBind_materialRef m_Material;
+	domControllerRef m_controller;
+	domBind_materialRef m_Material;
 
 	Int32 m_upAxis;
 	String m_filePath;
@@ -81,6 +92,9 @@ protected:
 
     T_StringList m_skeletonId;
     Skeleton *m_skeleton;
+	CController *m_skeletonOwner;   //!< controller whose skeleton is shared, or null
+	std::vector<UInt32> m_skeletonJoints;   //!< index of each joint into the joints of the owner
+	std::vector<Bones*> m_jointBones;       //!< bones of each joint, once resolved
 
 	Matrix4 m_shapeMatrix;
 
@@ -104,6 +118,19 @@ protected:
 	};
 
 	std::vector<std::vector<Influence> > m_influences; //!< influence on each vertex
+
+	//! Find the controller binding the most joints, including every joint of this one
+	//! with the same inverse bind matrix, the first one set to the scene among the
+	//! largest, once every controller is set to the scene. Returns null if it is this one.
+	CController* findSkeletonOwner();
+
+	//! Is every joint of this controller bound by another one with the same inverse bind
+	//! matrix, getting the index of each joint into the joints of the other one.
+	Bool isJointSubset(const CController *other, std::vector<UInt32> &remap) const;
+
+	//! Get the bones of a joint, found by its id or by its name (or sid) once and shared
+	//! by the controllers binding this skeleton. Returns null if not found.
+	Bones* getJointBones(UInt32 joint);
 };
 
 } // namespace collada
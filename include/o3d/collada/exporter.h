@@ -0,0 +1,204 @@
+/**
+ * @file exporter.h
+ * @brief O3DCollada streaming exporter of a scene.
+ * @author Frederic SCHERMA (frederic.scherma@dreamoverflow.org)
+ * @date 2026-10-18
+ * @copyright Copyright (c) 2001-2026 Dream Overflow. All rights reserved.
+ * @details
+ */
+
+#ifndef _O3D_COLLADA_EXPORTER_H
+#define _O3D_COLLADA_EXPORTER_H
+
+#include <o3d/core/outstream.h>
+#include <o3d/core/string.h>
+
+#include "xmlwriter.h"
+
+#include <map>
+#include <set>
+#include <vector>
+
+namespace o3d {
+
+class Scene;
+class Node;
+class BaseNode;
+class Mesh;
+class MeshData;
+class Skinning;
+class MaterialPass;
+class AnimationNode;
+
+namespace collada {
+
+//---------------------------------------------------------------------------------------
+//! @class ColladaExporter
+//-------------------------------------------------------------------------------------
+//! Export the nodes of a scene with their meshes, skinnings and materials, and the
+//! animations bound to them, as a COLLADA 1.4.1 document. The document is written
+//! to the stream while the scene is walked, library by library, without building a
+//! COLLADA-DOM tree, so the memory used does not depend on the size of the scene.
+//! The geometries are written as indexed triangles sharing a single index per vertex,
+//! as they are into the mesh data, which must have kept its local data.
+//! The animations are baked to a transform matrix per key, the form read back by the
+//! importer.
+//---------------------------------------------------------------------------------------
+class ColladaExporter
+{
+public:
+
+	//! Default ctor.
+	ColladaExporter(o3d::Scene *scene = nullptr);
+
+	//! Define the exported scene.
+	inline void setScene(o3d::Scene *scene) { m_scene = scene; }
+
+	//! Bind the tracks of an animation node to a scene node. Its key times are
+	//! relative to the duration (in seconds) of the animation.
+	void addAnimation(o3d::Node *node, o3d::AnimationNode *animNode, Float duration);
+
+	//! Get the maximal number of significant digits of the exported floats.
+	inline UInt32 getFloatDigits() const { return m_floatDigits; }
+	//! Set the maximal number of significant digits of the exported floats, to reduce
+	//! the size of the document at the cost of the precision, or 0 (default) for the
+	//! shortest text re-imported as the same float.
+	inline void setFloatDigits(UInt32 digits) { m_floatDigits = digits; }
+
+	//! Get the number of threads formatting the float and index arrays.
+	inline UInt32 getNumThreads() const { return m_numThreads; }
+	//! Set the number of threads formatting the large float and index arrays in chunks
+	//! (default 1). The document is the same whatever the number of threads.
+	inline void setNumThreads(UInt32 numThreads) { m_numThreads = numThreads; }
+
+	//! Export the sons of the root node of the scene as a visual scene.
+	Bool exportScene(OutStream &os, const String &name);
+
+	//! Export a node and its sub-tree as a visual scene.
+	Bool exportNode(OutStream &os, o3d::Node *root, const String &name);
+
+	//! Get the number of nodes written by the last export.
+	inline UInt32 getNumNodes() const { return m_numNodes; }
+	//! Get the number of geometries written by the last export.
+	inline UInt32 getNumGeometries() const { return static_cast<UInt32>(m_geometries.size()); }
+	//! Get the number of skin controllers written by the last export.
+	inline UInt32 getNumControllers() const { return static_cast<UInt32>(m_controllers.size()); }
+	//! Get the number of materials written by the last export.
+	inline UInt32 getNumMaterials() const { return static_cast<UInt32>(m_materials.size()); }
+	//! Get the number of animations written by the last export.
+	inline UInt32 getNumAnimations() const { return m_numAnimations; }
+	//! Get the size in bytes of the last exported document.
+	inline UInt64 getNumBytes() const { return m_numBytes; }
+
+private:
+
+	//! An exported material, an effect per material.
+	struct MaterialEntry
+	{
+		String id;
+		const MaterialPass *pass;
+		String imageId;              //!< image of the diffuse map, or empty
+	};
+
+	//! An exported mesh data, shared by its instances.
+	struct GeometryEntry
+	{
+		String id;
+		o3d::MeshData *meshData;
+		UInt32 numVertices;
+	};
+
+	//! An exported skinning, a skin controller per object.
+	struct ControllerEntry
+	{
+		String id;
+		o3d::Skinning *skinning;
+		String geometryId;
+		String skeletonId;           //!< root bones of the skeleton
+	};
+
+	//! An animation node bound to a scene node.
+	struct AnimationEntry
+	{
+		o3d::AnimationNode *animNode;
+		Float duration;
+	};
+
+	o3d::Scene *m_scene;
+
+	std::map<const o3d::BaseNode*, String> m_nodeIds;
+	std::vector<const o3d::Node*> m_nodeOrder;            //!< in order of discovery
+	std::set<const o3d::BaseNode*> m_joints;
+	std::set<String> m_ids;
+
+	std::map<String, MaterialEntry> m_materials;          //!< per material name
+	std::map<String, String> m_images;                    //!< image id per file name
+	std::map<const o3d::MeshData*, GeometryEntry> m_geometries;
+	std::map<const o3d::Skinning*, ControllerEntry> m_controllers;
+	std::map<const o3d::Node*, AnimationEntry> m_animations;
+
+	std::vector<const o3d::MeshData*> m_geometryOrder;    //!< in order of discovery
+	std::vector<const o3d::Skinning*> m_controllerOrder;
+	std::vector<String> m_materialOrder;
+
+	UInt32 m_floatDigits;
+	UInt32 m_numThreads;
+
+	UInt32 m_numNodes;
+	UInt32 m_numAnimations;
+	UInt64 m_numBytes;
+
+	//! Export nodes and their sub-trees as a visual scene.
+	Bool exportNodes(OutStream &os, const std::vector<o3d::Node*> &roots, const String &name);
+
+	//! Clear the state of the previous export.
+	void clear();
+
+	//! Get a unique and valid id from a name.
+	String makeId(const String &name, const Char *suffix);
+
+	//! Collect the ids, geometries, controllers and materials of a node sub-tree.
+	void collect(o3d::Node *node);
+
+	//! Collect the materials of a mesh.
+	void collectMaterials(o3d::Mesh *mesh);
+
+	//! Get the material name of a profile of a mesh.
+	String getMaterialName(o3d::Mesh *mesh, UInt32 profile) const;
+
+	void writeAsset(XmlWriter &writer);
+	void writeImages(XmlWriter &writer);
+	void writeEffects(XmlWriter &writer);
+	void writeMaterials(XmlWriter &writer);
+	void writeGeometries(XmlWriter &writer);
+	void writeControllers(XmlWriter &writer);
+	void writeAnimations(XmlWriter &writer);
+	void writeNode(XmlWriter &writer, o3d::Node *node);
+	void writeBindMaterial(XmlWriter &writer, o3d::Mesh *mesh);
+
+	//! Bake and write the animation of a node. Returns False if it has no supported track.
+	Bool writeAnimation(XmlWriter &writer, const o3d::Node *node, const AnimationEntry &entry);
+
+	//! Write a source of floats with its accessor.
+	static void writeSource(
+			XmlWriter &writer,
+			const String &id,
+			const Float *values,
+			size_t count,
+			UInt32 stride,
+			const Char *const *params,
+			UInt32 numParams,
+			const Char *type = "float");
+
+	//! Write a source of names with its accessor.
+	static void writeNameSource(
+			XmlWriter &writer,
+			const String &id,
+			const std::vector<String> &names,
+			const Char *param);
+};
+
+} // namespace collada
+} // namespace o3d
+
+#endif // _O3D_COLLADA_EXPORTER_H
@@ -11,10 +11,16 @@
 #define _O3D_COLLADA_GEOMETRY_H
 
 #include "global.h"
+#include "numericarrays.h"
 #include <dom/domElements.h>
 #include <o3d/engine/hierarchy/node.h>
 
+#include <unordered_map>
+
 namespace o3d {
+
+class Mesh;
+
 namespace collada {
 
 class MeshData;
@@ -52,6 +58,9 @@ public:
 	//! Set pre-export values from the scene.
 	virtual Bool fromScene();
 
+	//! Release any reference to the COLLADA-DOM.
+	virtual void releaseDom();
+
 	//! Set the scene node.
 	inline void setNode(o3d::Node *pNode) { m_node = pNode; }
 
@@ -67,75 +76,70 @@ public:
 	//! Get the lookup table.
 	inline std::vector<std::vector<UInt32> >& getLookup() { return m_lookupTable; }
 
+	//! Get the bounds of the vertices influenced by each bone (6 floats per bone), after
+	//! the shape matrix, computed by toScene if the animated bounds are enabled.
+	inline std::vector<Float>& getBoneBounds() { return m_boneBounds; }
+
 	//! Get the number of vertices after they are duplicated.
-	inline UInt32 getNumVerticesDup() const { return m_vertices.getSize()/3; }
+	inline UInt32 getNumVerticesDup() const { return m_numVertices; }
+
+	//! Allow or not the reuse of a mesh data built by a previous import of the session.
+	//! A skinned geometry needs its vertices lookup table, so it is always imported.
+	inline void setReusable(Bool reusable) { m_reusable = reusable; }
 
 protected:
 
 	friend class FaceList;
 
 	Bool m_asSkinning;
+	Bool m_reusable;   //!< can reuse a mesh data of the session
+
+	String m_sessionKey;   //!< key of the geometry into the session caches
 
 	o3d::Node *m_node;
 
-	const domGeometryRef m_geometry;
-	const domBind_materialRef m_material;
+	domGeometryRef m_geometry;
+	domBind_materialRef m_material;
 
 	CMaterial m_CMaterial;
 
-	ArrayFloat m_vertices;
-	ArrayFloat m_normals;
-	ArrayFloat m_texCoords;
+	UInt32 m_numVertices;   //!< number of vertices after they are duplicated
+	Bool m_indices16;       //!< true if faces are built with 16 bits indices
+
+	SmartArrayFloat m_vertices;
+	SmartArrayFloat m_normals;
+	SmartArrayFloat m_texCoords;
+	SmartArrayFloat m_tangents;
+	SmartArrayFloat m_bitangents;
 
 	Matrix4 m_shapeMatrix;
 
 	SmartArrayFloat m_skinning;
 	SmartArrayFloat m_weighting;
 
-	std::vector<std::vector<UInt32> > m_lookupTable;
-
-	class FaceList
-	{
-	public:
+	std::vector<Float> m_boneBounds;   //!< 6 floats per bone, minimum then maximum
 
-		ArrayUInt32 faces;
-		String material;
-
-		void triangulate();
-		void exploid();
-	};
-
-	std::vector<FaceList> m_facesList;
-
-	void buildLines(const domLines_Array &LinesArray);
-	void buildLineStrip(const domLinestrips_Array &lineStripArray);
-	void buildTriangles(const domTriangles_Array &triangleArray);
-	void buildTriangleStrip(const domTristrips_Array &triangleArray);
-	void buildPolygonList(const domPolylist_Array &polysArray);
-
-	UInt32 getTriIndexList(UInt32 *pIndices, domTriangles *pTris, UInt32 triNum);
-	UInt32 countPotentialTris(domPolygons *pPolygons);
-	UInt32 countPotentialTris(domPolylist *pPolylist);
-	UInt32 getMaxOffsetFromInputs(domInputLocalOffset_Array &inputs);
+	std::vector<std::vector<UInt32> > m_lookupTable;
 
 	class Offsets
 	{
 	public:
 
-		Offsets(domInputLocalOffset_Array &inputs)
+		Offsets(domInputLocalOffset_Array &inputs, const NumericArrays *arrays)
 		{
 			maxOffset = 0;
 			positionOffset = -1;
 			normalOffset = -1;
 			texture1Offset = -1;
-            positionFloats = nullptr;
-            normalFloats = nullptr;
-            texture1Floats = nullptr;
+			tangentOffset = -1;
+			bitangentOffset = -1;
 			positionStride = 3;
 			normalStride = 3;
 			texture1Stride = 2;
+			tangentStride = 3;
+			bitangentStride = 3;
 			positionNum = 0;
-			setInputs(inputs);
+			setInputs(inputs, arrays);
 		};
 
 		Int32 maxOffset;
@@ -143,21 +147,219 @@ protected:
 		Int32 positionOffset;
 		Int32 normalOffset;
 		Int32 texture1Offset;
+		Int32 tangentOffset;
+		Int32 bitangentOffset;
 		Int32 positionStride;
 		Int32 normalStride;
 		Int32 texture1Stride;
+		Int32 tangentStride;
+		Int32 bitangentStride;
 		Int32 positionNum;
 
-		domListOfFloats *positionFloats;
-		domListOfFloats *normalFloats;
-		domListOfFloats *texture1Floats;
+		FloatArrayView positionFloats;
+		FloatArrayView normalFloats;
+		FloatArrayView texture1Floats;
+		FloatArrayView tangentFloats;
+		FloatArrayView bitangentFloats;
 
 	private:
 
-		void setInputs(domInputLocalOffset_Array &inputs);
+		void setInputs(domInputLocalOffset_Array &inputs, const NumericArrays *arrays);
 	};
 
-	UInt32 setVertexData(Offsets& offset, const domListOfUInts &values, UInt32 i);
+	class FaceList
+	{
+	public:
+
+		FaceList(const String &_material, const Offsets &_offsets, const domListOfUInts *_values) :
+			numIndices(0),
+			maxIndices(0),
+			material(_material),
+			offsets(_offsets),
+			values(_values)
+		{}
+
+		SmartArrayUInt16 faces16;   //!< used when m_indices16
+		SmartArrayUInt32 faces32;   //!< used otherwise
+		UInt32 numIndices;          //!< number of written indices
+		UInt32 maxIndices;          //!< number of allocated indices
+
+		String material;
+
+		Offsets offsets;                  //!< inputs of the primitive, valid during import only
+		const domListOfUInts *values;     //!< indices of the primitive, valid during import only
+
+		std::vector<UInt32> corners;      //!< primitive vertex of each triangle corner, until welded
+		std::vector<Float> normals;       //!< generated normal per primitive vertex, if no input
+		std::vector<Float> tangents;      //!< generated tangent per primitive vertex, if no input
+		std::vector<Float> bitangents;    //!< generated bitangent per primitive vertex, if no input
+
+		//! Has the primitive a normal input or generated normals.
+		inline Bool hasNormals() const { return offsets.normalOffset != -1 || !normals.empty(); }
+
+		//! Has the primitive a tangent input or generated tangents.
+		inline Bool hasTangents() const { return offsets.tangentOffset != -1 || !tangents.empty(); }
+
+		//! Has the primitive a bitangent input or generated bitangents.
+		inline Bool hasBitangents() const { return offsets.bitangentOffset != -1 || !bitangents.empty(); }
+
+		//! Bit set of the attributes of the vertices, only welded with the same ones.
+		inline UInt32 attributeFlags() const
+		{
+			return (hasNormals() ? 1 : 0) |
+					(offsets.texture1Offset != -1 ? 2 : 0) |
+					(hasTangents() ? 4 : 0) |
+					(hasBitangents() ? 8 : 0);
+		}
+
+		void triangulate();
+		void exploid();
+	};
+
+	std::vector<FaceList> m_facesList;
+
+	//! A welded vertex, referenced by its first occurrence into a face list.
+	struct VertexRef
+	{
+		UInt32 list;
+		UInt32 index;
+	};
+
+	std::vector<VertexRef> m_vertexRefs;
+
+	//! Welded vertices indexed by a hash of their attributes, or of their position cell
+	//! when welded with tolerances.
+	std::unordered_multimap<UInt32, UInt32> m_vertexHash;
+
+	//! Bounds (minimum then maximum) of the attributes of the vertices welded together,
+	//! when welded with tolerances.
+	std::vector<Float> m_weldBounds;
+
+	UInt32 m_numCorners;           //!< number of welded triangle corners
+	UInt32 m_numToleranceMerges;   //!< corners welded to a different vertex within the tolerances
+
+	//! A spatially coherent part of the geometry, indexable with 16 bits.
+	struct Chunk
+	{
+		std::vector<UInt32> vertices;          //!< global index of each local vertex
+		std::vector<SmartArrayUInt16> faces;   //!< local faces for each face list
+		std::vector<UInt32> numIndices;        //!< number of local indices for each face list
+	};
+
+	//! Partition the faces into chunks of less than 65536 vertices.
+	void splitFaces(std::vector<Chunk> &chunks);
+
+	//! Set post-import values to the scene, one mesh per chunk.
+	Bool toSceneChunks();
+
+	//! Gather the attributes (of a number of floats each) of the vertices of a chunk.
+	static void gatherChunk(const SmartArrayFloat &array, const Chunk &chunk, UInt32 size, SmartArrayFloat &out);
+
+	//! Build the meshlets of the face arrays of a mesh data, if enabled and not
+	//! already built for it.
+	void buildMeshlets(
+			const String &resourceName,
+			const Float *vertices,
+			UInt32 numVertices,
+			const std::vector<const UInt16*> &faces16,
+			const std::vector<const UInt32*> &faces32,
+			const std::vector<UInt32> &numIndices);
+
+	//! Set the local bounds of a mesh data into the scene hierarchy, and build the
+	//! hierarchy over its triangles, if enabled and not already set for it.
+	void buildBvh(
+			const String &resourceName,
+			const Float *vertices,
+			UInt32 numVertices,
+			const std::vector<const UInt16*> &faces16,
+			const std::vector<const UInt32*> &faces32,
+			const std::vector<UInt32> &numIndices);
+
+	//! Build the meshlets and the hierarchy of a mesh data from the imported arrays,
+	//! those not already built for it.
+	void buildMeshletsAndBvh(const String &resourceName);
+
+	//! Build the meshlets and the hierarchy of the mesh data of a chunk, those not
+	//! already built for it.
+	void buildChunkMeshletsAndBvh(const String &resourceName, const Chunk &chunk, const SmartArrayFloat &vertices);
+
+	//! Set the local bounds of a mesh data from its bounding box, if they are not built
+	//! from the imported arrays (mesh data converted by a previous import of the session).
+	void setBvhBounds(o3d::MeshData *meshData);
+
+	//! Add a mesh or skinning object into the scene hierarchy, if enabled.
+	void addToBvh(o3d::BaseNode *object, o3d::MeshData *meshData);
+
+	//! Compute the bounds of the vertices influenced by each bone.
+	void computeBoneBounds();
+
+	//! Register the built mesh data into the session, if any.
+	void addToSession(const String &resourceName);
+
+	//! Create a mesh object into the node and set its material profiles.
+	o3d::Mesh* createMesh(o3d::MeshData *meshData, const String &name);
+
+	void buildLines(const domLines_Array &LinesArray);
+	void buildLineStrip(const domLinestrips_Array &lineStripArray);
+	void buildTriangles(const domTriangles_Array &triangleArray);
+	void buildTriangleStrip(const domTristrips_Array &triangleArray);
+	void buildPolygonList(const domPolylist_Array &polysArray);
+
+	UInt32 getTriIndexList(UInt32 *pIndices, domTriangles *pTris, UInt32 triNum);
+	UInt32 countPotentialTris(domPolygons *pPolygons);
+	UInt32 countPotentialTris(domPolylist *pPolylist);
+	UInt32 getMaxOffsetFromInputs(domInputLocalOffset_Array &inputs);
+
+	//! Choose the face index width from an estimation of the number of vertices.
+	void chooseIndexWidth(UInt32 numIndices, UInt32 numPositions);
+
+	//! Add a face list and allocate its exact number of indices.
+	FaceList& addFaceList(const String &material, const Offsets &offsets, const domListOfUInts *values, UInt32 numIndices);
+
+	//! Convert the faces to 32 bits indices, when the estimation was too low.
+	void widenIndices();
+
+	//! Read the attributes of the i-th vertex of a face list.
+	void readVertex(
+			const FaceList &faceList,
+			UInt32 i,
+			Float *vertex,
+			Float *normal,
+			Float *texCoord,
+			Float *tangent,
+			Float *bitangent) const;
+
+	//! Read the position of the i-th vertex of a face list.
+	void readPosition(const FaceList &faceList, UInt32 i, Float *vertex) const;
+
+	//! Generate smooth normals for the face lists without a normal input. The faces
+	//! sharing a position and within the smoothing angle are smoothed together, weighted
+	//! by their area and their angle at the vertex.
+	void generateNormals();
+
+	//! Generate the tangent frames of the face lists without a tangent input, if a
+	//! material is normal mapped. They are computed per corner before the welding, the
+	//! faces sharing a position, a normal, a texture coordinate and the handedness of
+	//! their mapping being smoothed together, so that the mirrored and the differently
+	//! mapped corners are welded apart.
+	void generateTangents();
+
+	//! Weld the triangulated vertices of every face list, in order.
+	void weldVertices();
+
+	//! Weld the i-th vertex of a face list and store its index as the next face index.
+	UInt32 setVertexData(FaceList &faceList, UInt32 i);
+
+	//! Find a welded vertex whose group stays within the tolerances once extended with
+	//! the attributes, or return False.
+	Bool findWithinTolerances(const FaceList &faceList, const Float *attributes, UInt32 flags, UInt32 &index) const;
+
+	//! Allocate the final vertex arrays and fill them from the welded vertices.
+	void buildVertexArrays();
+
+	//! Complete the bitangents missing from the tangent frames, or release the frames
+	//! if no material is normal mapped.
+	void buildTangentSpace();
 };
 
 } // namespace collada
@@ -18,12 +18,82 @@
 #include <dae.h>
 #include <dom/domCOLLADA.h>
 
+#include "profiler.h"
+
 namespace o3d {
 namespace collada {
 
 using namespace ColladaDOM141;
 
+class Collada;
 class CBaseObject;
+class CController;
+class ColladaSession;
+class NumericArrays;
+class UriResolver;
+class MeshletLibrary;
+class SceneBvh;
+class AnimatedBoundsLibrary;
+class BoneTextureLibrary;
+
+//---------------------------------------------------------------------------------------
+//! @class ImportOptions
+//-------------------------------------------------------------------------------------
+//! Selects which part of a document is imported. The geometry is always imported.
+//! Nodes are filtered by patterns on their id or name, where '*' matches any sequence
+//! of characters and '?' a single one. A matching node is imported with all its
+//! sub-tree, and its ancestors are kept for their transforms only.
+//---------------------------------------------------------------------------------------
+struct ImportOptions
+{
+	Bool animations;     //!< import the animations
+	Bool skins;          //!< import the controllers, otherwise skinned nodes are skipped
+	Bool materials;      //!< import the effects, otherwise default materials are used
+	Bool textures;       //!< resolve and load the textures of the effects
+
+	std::vector<String> nodeFilters;  //!< nodes patterns, empty to import any node
+
+	ImportOptions() :
+		animations(True),
+		skins(True),
+		materials(True),
+		textures(True) {}
+
+	//! Import only the static geometry, without any animation, skin or material.
+	static ImportOptions staticGeometry();
+
+	//! Is there any node filter.
+	inline Bool hasNodeFilters() const { return !nodeFilters.empty(); }
+
+	//! Does a node match one of the filters, given its id and name. True if no filter.
+	Bool matchNode(const String &id, const String &name) const;
+
+	//! Match a string against a pattern with '*' and '?' wildcards.
+	static Bool matchPattern(const String &pattern, const String &str);
+};
+
+//---------------------------------------------------------------------------------------
+//! @class WeldTolerances
+//-------------------------------------------------------------------------------------
+//! Per attribute tolerances of the vertex welding, as a maximal difference of each
+//! component. Zero means an exact equality. Vertices are welded only if all of them
+//! stay within the tolerances of each other, so a seam whose sides differ by more
+//! than the tolerance is always kept. The tangents use the normal tolerance.
+//---------------------------------------------------------------------------------------
+struct WeldTolerances
+{
+	Float position;      //!< in document units
+	Float normal;
+	Float texCoord;
+
+	WeldTolerances(Float _position = 0.f, Float _normal = 0.f, Float _texCoord = 0.f) :
+		position(_position),
+		normal(_normal),
+		texCoord(_texCoord) {}
+
+	//! Are the vertices welded only if they are strictly equal.
+	inline Bool isExact() const { return position <= 0.f && normal <= 0.f && texCoord <= 0.f; }
+};
 
 //---------------------------------------------------------------------------------------
 //! @class ColladaInfo
@@ -37,6 +107,26 @@ public:
 	ColladaInfo() :
 		m_upAxis(Y),
 		m_boundingMode(GeometryData::BOUNDING_AUTO),
+		m_meshSplitting(False),
+		m_headless(False),
+		m_profiler(nullptr),
+		m_session(nullptr),
+		m_async(False),
+		m_fastParsing(True),
+		m_parseThreads(1),
+		m_tangentSpace(True),
+		m_normalGeneration(True),
+		m_smoothingAngle(60.f),
+		m_skeletonSharing(True),
+		m_meshletMaxVertices(0),
+		m_meshletMaxTriangles(0),
+		m_sceneBvhGeneration(False),
+		m_meshBvhGeneration(False),
+		m_animatedBoundsRate(0.f),
+		m_boneTextureRate(0.f),
+		m_boneTextureDualQuaternions(False),
+		m_numericArrays(nullptr),
+		m_uriResolver(nullptr),
 		m_AnimDuration(0.f) {}
 
 	//! Get the up axis
@@ -59,9 +149,177 @@ public:
 	//! Get the up axis
 	inline void setBoundingMode(GeometryData::BoundingMode mode) { m_boundingMode = mode; }
 
+	//! Is large static geometry split into 16 bits indexed chunks.
+	inline Bool getMeshSplitting() const { return m_meshSplitting; }
+	//! Split static geometry having more than 65535 vertices into spatially coherent
+	//! chunks, each one indexed with 16 bits and having its own bounding volume.
+	inline void setMeshSplitting(Bool split) { m_meshSplitting = split; }
+
+	//! Is the import done without any GPU resource.
+	inline Bool isHeadless() const { return m_headless; }
+	//! Import without creating any GPU resource (no geometry buffers and no textures
+	//! loading), for offline conversion where there is no rendering context.
+	inline void setHeadless(Bool headless) { m_headless = headless; }
+
+	//! Get the import profiler, or null if not profiled.
+	inline ImportProfiler* getProfiler() const { return m_profiler; }
+	//! Set an import profiler to time each phase and object (not owned, can be null).
+	inline void setProfiler(ImportProfiler *profiler) { m_profiler = profiler; }
+
+	//! Get the import session, or null if the import is standalone.
+	inline ColladaSession* getSession() const { return m_session; }
+	//! Set an import session whose database and caches are shared with the other
+	//! imports into the same scene (not owned, can be null).
+	inline void setSession(ColladaSession *session) { m_session = session; }
+
+	//! Are the float arrays extracted from the mapped file and parsed before the document.
+	inline Bool getFastParsing() const { return m_fastParsing; }
+	//! Extract the float arrays from the memory mapped file and parse them directly as
+	//! floats, before giving the remaining text to COLLADA-DOM (default true).
+	inline void setFastParsing(Bool fast) { m_fastParsing = fast; }
+
+	//! Get the number of threads parsing the float arrays and processing the geometries.
+	inline UInt32 getParseThreads() const { return m_parseThreads; }
+	//! Set the number of threads parsing the large float arrays in chunks, and computing
+	//! the vertex attributes of the large geometries (default 1).
+	inline void setParseThreads(UInt32 numThreads) { m_parseThreads = numThreads; }
+
+	//! Are the tangent frames computed for the normal mapped geometries.
+	inline Bool getTangentSpace() const { return m_tangentSpace; }
+	//! Compute a tangent and a bitangent per vertex for the geometries having a normal
+	//! map and no TEXTANGENT input, to use a bump material (default true).
+	inline void setTangentSpace(Bool tangentSpace) { m_tangentSpace = tangentSpace; }
+
+	//! Are the normals generated for the primitives without a NORMAL input.
+	inline Bool getNormalGeneration() const { return m_normalGeneration; }
+	//! Generate smooth normals for the primitives without a NORMAL input (default true).
+	inline void setNormalGeneration(Bool generate) { m_normalGeneration = generate; }
+
+	//! Are the skeletons shared by the controllers binding the same joints.
+	inline Bool getSkeletonSharing() const { return m_skeletonSharing; }
+	//! Bind a controller whose joints are all bound by another one, with the same
+	//! inverse bind matrices, to the skeleton of the one binding the most joints. Each
+	//! skinning keeps its own joints (default true).
+	inline void setSkeletonSharing(Bool share) { m_skeletonSharing = share; }
+
+	//! Get the maximal angle in degrees between two smoothed faces.
+	inline Float getSmoothingAngle() const { return m_smoothingAngle; }
+	//! Set the maximal angle in degrees between two faces whose generated normals are
+	//! smoothed together, a sharper edge stays hard (default 60).
+	inline void setSmoothingAngle(Float degrees) { m_smoothingAngle = degrees; }
+
+	//! Get the tolerances of the vertex welding.
+	inline const WeldTolerances& getWeldTolerances() const { return m_weldTolerances; }
+	//! Set the tolerances of the vertex welding, to merge the nearly identical vertices
+	//! written by some exporters (default exact).
+	inline void setWeldTolerances(const WeldTolerances &tolerances) { m_weldTolerances = tolerances; }
+
+	//! Are the meshlets of the meshes built.
+	inline Bool getMeshletGeneration() const { return m_meshletMaxVertices > 0; }
+	//! Get the maximal number of vertices of a meshlet, 0 if they are not built.
+	inline UInt32 getMeshletMaxVertices() const { return m_meshletMaxVertices; }
+	//! Get the maximal number of triangles of a meshlet.
+	inline UInt32 getMeshletMaxTriangles() const { return m_meshletMaxTriangles; }
+	//! Build the meshlets of every imported mesh, with at most maxVertices (up to 256)
+	//! and maxTriangles each, into the meshlet library. 0 vertices disables them (default).
+	inline void setMeshletGeneration(UInt32 maxVertices, UInt32 maxTriangles)
+	{
+		m_meshletMaxVertices = maxVertices;
+		m_meshletMaxTriangles = maxTriangles;
+	}
+
+	//! Get the library receiving the built meshlets, or null.
+	inline MeshletLibrary* getMeshletLibrary() const { return m_libraries.meshlets; }
+
+	//! Is the hierarchy over the imported meshes built.
+	inline Bool getSceneBvhGeneration() const { return m_sceneBvhGeneration; }
+	//! Is the hierarchy over the triangles of each imported mesh built.
+	inline Bool getMeshBvhGeneration() const { return m_meshBvhGeneration; }
+	//! Build the hierarchy over the world bounds of the imported meshes at the end of
+	//! each import, and optionally the hierarchy over the triangles of each of them,
+	//! into the scene hierarchy (default none).
+	inline void setBvhGeneration(Bool scene, Bool meshes)
+	{
+		m_sceneBvhGeneration = scene;
+		m_meshBvhGeneration = scene && meshes;
+	}
+
+	//! Get the scene hierarchy receiving the imported meshes, or null.
+	inline SceneBvh* getSceneBvh() const { return m_libraries.sceneBvh; }
+
+	//! Are the animated bounds of the skinned meshes computed.
+	inline Bool getAnimatedBoundsGeneration() const { return m_animatedBoundsRate > 0.f; }
+	//! Get the number of frames per second of the animated bounds.
+	inline Float getAnimatedBoundsRate() const { return m_animatedBoundsRate; }
+	//! Compute the bounds of each skinned mesh along the imported animation, sampled
+	//! at a number of frames per second, into the animated bounds library. 0 disables
+	//! them (default).
+	inline void setAnimatedBoundsGeneration(Float sampleRate) { m_animatedBoundsRate = max<Float>(0.f, sampleRate); }
+
+	//! Get the library receiving the animated bounds, or null.
+	inline AnimatedBoundsLibrary* getAnimatedBoundsLibrary() const { return m_libraries.animatedBounds; }
+
+	//! Are the skinning matrices of the imported animation baked into bone textures.
+	inline Bool getBoneTextureGeneration() const { return m_boneTextureRate > 0.f; }
+	//! Get the number of frames per second of the bone textures.
+	inline Float getBoneTextureRate() const { return m_boneTextureRate; }
+	//! Are the bones baked as dual quaternions rather than as 3x4 matrices.
+	inline Bool getBoneTextureDualQuaternions() const { return m_boneTextureDualQuaternions; }
+	//! Bake the skinning matrices of each skinned mesh along the imported animation,
+	//! sampled at a number of frames per second, into the bone texture library, as 3x4
+	//! matrices or as dual quaternions. 0 disables them (default).
+	inline void setBoneTextureGeneration(Float sampleRate, Bool dualQuaternions = False)
+	{
+		m_boneTextureRate = max<Float>(0.f, sampleRate);
+		m_boneTextureDualQuaternions = dualQuaternions;
+	}
+
+	//! Get the library receiving the bone textures, or null.
+	inline BoneTextureLibrary* getBoneTextureLibrary() const { return m_libraries.boneTextures; }
+
+	//! Get the float arrays extracted from the imported document, or null.
+	inline const NumericArrays* getNumericArrays() const { return m_numericArrays; }
+	//! Set by the importer while the document is opened (not owned, can be null).
+	inline void setNumericArrays(const NumericArrays *arrays) { m_numericArrays = arrays; }
+
+	//! Get the resolver of the URI referenced by the document, or null for the default.
+	inline const UriResolver* getUriResolver() const { return m_uriResolver; }
+	//! Set the resolver of the URI referenced by the document, as the textures
+	//! images (not owned, null for the default paths relative to the document).
+	inline void setUriResolver(const UriResolver *resolver) { m_uriResolver = resolver; }
+
+	//! Get the import options.
+	inline const ImportOptions& getOptions() const { return m_options; }
+	//! Set the import options, to skip whole categories or filter the nodes.
+	inline void setOptions(const ImportOptions &options) { m_options = options; }
+
+	//! Is the import running on a worker thread, where the scene must not be accessed.
+	inline Bool isAsync() const { return m_async; }
+	//! Set by the importer when running on a worker thread.
+	inline void setAsync(Bool async) { m_async = async; }
+
 	//! Add a new imported node
 	inline void addNode(CBaseObject *pObject) { m_nodeList.push_back(pObject); }
 
+	//! Clear the imported nodes list, before a new import.
+	inline void clearNodes() { m_nodeList.clear(); }
+
+	//! Get the number of imported nodes.
+	inline UInt32 getNumNodes() const { return static_cast<UInt32>(m_nodeList.size()); }
+	//! Get an imported node.
+	inline CBaseObject* getNode(UInt32 index) const { return m_nodeList[index]; }
+
+	//! Add a controller set to the scene, whose skeleton can be shared.
+	inline void addController(CController *controller) { m_controllers.push_back(controller); }
+
+	//! Clear the controllers list, before a new import.
+	inline void clearControllers() { m_controllers.clear(); }
+
+	//! Get the number of controllers set to the scene.
+	inline UInt32 getNumControllers() const { return static_cast<UInt32>(m_controllers.size()); }
+	//! Get a controller set to the scene, in their order.
+	inline CController* getController(UInt32 index) const { return m_controllers[index]; }
+
 	//! Find a node using its name
 	CBaseObject* findNodeUsingName(const String &name) const;
 	//! Find a node using its sid
@@ -79,8 +337,49 @@ public:
 	//! Set the animation duration
 	inline void maxAnimationDuration(Float f) { m_AnimDuration = max<Float>(m_AnimDuration,f); }
 
+	//! Reset the states read from the previous document, before a new import: the up
+	//! axis, the imported nodes and controllers, the current name and the animation
+	//! duration. The settings are kept.
+	inline void resetDocument()
+	{
+		m_upAxis = Y;
+		m_currentName = String();
+		m_nodeList.clear();
+		m_controllers.clear();
+		m_AnimDuration = 0.f;
+	}
+
 private:
 
+	friend class Collada;
+
+	//! Libraries receiving the results of an import, owned by its Collada instance.
+	//! Copying the settings to another instance keeps the libraries of the latter.
+	struct Libraries
+	{
+		MeshletLibrary *meshlets;
+		SceneBvh *sceneBvh;
+		AnimatedBoundsLibrary *animatedBounds;
+		BoneTextureLibrary *boneTextures;
+
+		Libraries() : meshlets(nullptr), sceneBvh(nullptr), animatedBounds(nullptr), boneTextures(nullptr) {}
+		Libraries(const Libraries &) : Libraries() {}
+		Libraries& operator= (const Libraries &) { return *this; }
+	};
+
+	//! Set by the Collada instance owning the libraries.
+	inline void setLibraries(
+		MeshletLibrary *meshlets,
+		SceneBvh *sceneBvh,
+		AnimatedBoundsLibrary *animatedBounds,
+		BoneTextureLibrary *boneTextures)
+	{
+		m_libraries.meshlets = meshlets;
+		m_libraries.sceneBvh = sceneBvh;
+		m_libraries.animatedBounds = animatedBounds;
+		m_libraries.boneTextures = boneTextures;
+	}
+
 	UInt32 m_upAxis;
 
 	String m_filePath;
@@ -88,8 +387,35 @@ private:
 	String m_currentName;
 
 	GeometryData::BoundingMode m_boundingMode;
+	Bool m_meshSplitting;
+	Bool m_headless;
+
+	ImportProfiler *m_profiler;
+	ColladaSession *m_session;
+	Bool m_async;
+
+	ImportOptions m_options;
+
+	Bool m_fastParsing;
+	UInt32 m_parseThreads;
+	Bool m_tangentSpace;
+	Bool m_normalGeneration;
+	Float m_smoothingAngle;
+	Bool m_skeletonSharing;
+	WeldTolerances m_weldTolerances;
+	UInt32 m_meshletMaxVertices;
+	UInt32 m_meshletMaxTriangles;
+	Bool m_sceneBvhGeneration;
+	Bool m_meshBvhGeneration;
+	Float m_animatedBoundsRate;
+	Float m_boneTextureRate;
+	Bool m_boneTextureDualQuaternions;
+	Libraries m_libraries;
+	const NumericArrays *m_numericArrays;
+	const UriResolver *m_uriResolver;
 
 	std::vector<CBaseObject*> m_nodeList;
+	std::vector<CController*> m_controllers;
 
 	Float m_AnimDuration;
 };
@@ -130,6 +456,10 @@ public:
 	//! Set pre-export values from the scene
 	virtual Bool fromScene() = 0;
 
+	//! Release any reference to the COLLADA-DOM. Called once imported, all the needed
+	//! data must have been copied, because the document is closed just after.
+	virtual void releaseDom() { m_dom = nullptr; }
+
 	//! Get the id
 	inline const String& getId() const { return m_id; }
 
@@ -145,7 +475,7 @@ protected:
 	String m_name;
 
 	o3d::Scene *m_scene;
-	domCOLLADA &m_dom;
+	domCOLLADA *m_dom;
 
 	String m_StrId;
 
@@ -228,6 +558,67 @@ protected:
 	String m_unitName;
 };
 
+//! Get the resident memory size of the process in bytes, or 0 if unsupported.
+UInt64 getResidentMemory();
+
+//---------------------------------------------------------------------------------------
+//! @class DaeLock
+//-------------------------------------------------------------------------------------
+//! Hold the lock of the COLLADA-DOM global states for its life time. The COLLADA-DOM
+//! shares its string table and its XML parser between every database, and modifies
+//! them when a document is opened, resolved, modified or closed, so any use of a
+//! database must hold this lock when importing from many threads. Recursive.
+//---------------------------------------------------------------------------------------
+class DaeLock
+{
+public:
+
+	//! Lock, unless lock is false.
+	DaeLock(Bool lock = True);
+
+	//! Unlock if locked.
+	~DaeLock();
+
+private:
+
+	Bool m_locked;
+
+	DaeLock(const DaeLock&);
+	void operator=(const DaeLock&);
+};
+
+//---------------------------------------------------------------------------------------
+//! @class DaeUnlock
+//-------------------------------------------------------------------------------------
+//! Release the DaeLock held by the current thread for its life time, and take it back
+//! as many times as it was held. Once the arrays of a document are resolved, their
+//! conversion does not use the COLLADA-DOM and can run concurrently with the other
+//! imports. No element of the database must be resolved meanwhile.
+//---------------------------------------------------------------------------------------
+class DaeUnlock
+{
+public:
+
+	//! Unlock, if held by the current thread.
+	DaeUnlock();
+
+	//! Lock back.
+	~DaeUnlock();
+
+private:
+
+	UInt32 m_depth;
+
+	DaeUnlock(const DaeUnlock&);
+	void operator=(const DaeUnlock&);
+};
+
+//! Create a COLLADA-DOM database, under the DaeLock.
+DAE* createDAE();
+
+//! Delete a database created by createDAE() and set it to null, under the DaeLock.
+void deleteDAE(DAE *&dae);
+
 } // namespace collada
 } // namespace o3d
 
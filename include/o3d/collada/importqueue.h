@@ -0,0 +1,89 @@
+/**
+ * @file importqueue.h
+ * @brief O3DCollada asynchronous imports and their commit queue.
+ * @author Frederic SCHERMA (frederic.scherma@dreamoverflow.org)
+ * @date 2026-10-18
+ * @copyright Copyright (c) 2001-2026 Dream Overflow. All rights reserved.
+ * @details
+ */
+
+#ifndef _O3D_COLLADA_IMPORTQUEUE_H
+#define _O3D_COLLADA_IMPORTQUEUE_H
+
+#include "collada.h"
+
+#include <deque>
+#include <vector>
+
+namespace o3d {
+namespace collada {
+
+//---------------------------------------------------------------------------------------
+//! @class ImportQueue
+//-------------------------------------------------------------------------------------
+//! Run many imports into the same scene, each one reading its document and converting
+//! its content on its own worker thread. The loaded imports are then committed to the
+//! scene in their order by the thread owning the scene, for a time budget per call,
+//! so the application keeps running while the assets are loaded.
+//---------------------------------------------------------------------------------------
+class ImportQueue
+{
+public:
+
+	//! Default ctor.
+	ImportQueue(o3d::Scene *scene);
+
+	//! Destructor. Wait for the worker threads, abort the imports not committed and
+	//! delete the kept importers not taken.
+	~ImportQueue();
+
+	//! Get the settings copied to each import (headless, bounding mode, profiler...).
+	//! An import session cannot be used, its database is not thread safe.
+	inline ColladaInfo& getInfo() { return m_info; }
+
+	//! Start to import a file on a worker thread. Returns False if it cannot be started.
+	Bool push(const String &filename);
+
+	//! Commit the loaded imports to the scene, in their order, until the time budget
+	//! (in milliseconds) is elapsed, or all the loaded ones if the budget is 0. It never
+	//! waits for a worker thread. Must be called by the thread owning the scene.
+	//! Returns the number of finished imports during this call.
+	UInt32 commit(UInt32 budgetMs = 0);
+
+	//! Wait for all the worker threads and commit all the imports.
+	UInt32 flush();
+
+	//! Get the number of imports not yet committed.
+	inline size_t getNumPending() const { return m_pending.size(); }
+
+	//! Get the number of failed imports since the creation of the queue.
+	inline UInt32 getNumFailed() const { return m_numFailed; }
+
+	//! Keep the successfully committed importers rather than deleting them, to get
+	//! the libraries built by their import (meshlets, hierarchy, animated bounds, bone
+	//! textures). Default False.
+	inline void setKeepFinished(Bool keep) { m_keepFinished = keep; }
+
+	//! Move the kept importers, in their commit order, to a list. The caller owns and
+	//! deletes them.
+	void takeFinished(std::vector<Collada*> &finished);
+
+private:
+
+	o3d::Scene *m_scene;
+	ColladaInfo m_info;
+
+	std::deque<Collada*> m_pending;
+	std::vector<Collada*> m_finished;
+
+	UInt32 m_numFailed;
+	Bool m_keepFinished;
+
+	//! Delete or keep a committed importer.
+	void release(Collada *collada, Collada::ImportStage stage);
+};
+
+} // namespace collada
+} // namespace o3d
+
+#endif // _O3D_COLLADA_IMPORTQUEUE_H
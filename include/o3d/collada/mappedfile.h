@@ -0,0 +1,66 @@
+/**
+ * @file mappedfile.h
+ * @brief O3DCollada read-only memory mapped file.
+ * @author Frederic SCHERMA (frederic.scherma@dreamoverflow.org)
+ * @date 2026-10-18
+ * @copyright Copyright (c) 2001-2026 Dream Overflow. All rights reserved.
+ * @details
+ */
+
+#ifndef _O3D_COLLADA_MAPPEDFILE_H
+#define _O3D_COLLADA_MAPPEDFILE_H
+
+#include <o3d/core/string.h>
+
+namespace o3d {
+namespace collada {
+
+//---------------------------------------------------------------------------------------
+//! @class MappedFile
+//-------------------------------------------------------------------------------------
+//! A whole file mapped read-only into memory, the pages are loaded by the system when
+//! they are accessed and shared with its file cache.
+//---------------------------------------------------------------------------------------
+class MappedFile
+{
+public:
+
+	//! Default ctor.
+	MappedFile();
+
+	//! Destructor. Unmap the file.
+	~MappedFile();
+
+	//! Map a file. Returns False if it cannot be opened or mapped.
+	Bool open(const String &filename);
+
+	//! Unmap the file.
+	void close();
+
+	//! Is a file mapped.
+	inline Bool isOpen() const { return m_data != nullptr; }
+
+	//! Get the mapped content.
+	inline const Char* getData() const { return m_data; }
+
+	//! Get the size of the mapped content in bytes.
+	inline UInt64 getSize() const { return m_size; }
+
+private:
+
+	const Char *m_data;
+	UInt64 m_size;
+
+#ifdef _WIN32
+	void *m_file;
+	void *m_mapping;
+#endif
+
+	MappedFile(const MappedFile&) = delete;
+	void operator=(const MappedFile&) = delete;
+};
+
+} // namespace collada
+} // namespace o3d
+
+#endif // _O3D_COLLADA_MAPPEDFILE_H
@@ -131,20 +131,33 @@ public:
 	//! Set pre-export values from the scene
 	virtual Bool fromScene();
 
+	//! Release any reference to the COLLADA-DOM
+	virtual void releaseDom();
+
 	//! Define an MaterialProfile for a given material (effect) id.
 	void getMaterial(o3d::MaterialProfile &profile, UInt32 id) const;
 
 	//! Get the number of materials.
 	UInt32 getNumMaterials() const { return static_cast<UInt32>(m_effectList.size()); }
 
+	//! Is one of the effects normal mapped with its maps loaded, and then uses a bump
+	//! material needing a tangent space. A bump (height) map alone uses a lambert material.
+	Bool needTangentSpace() const;
+
+	//! Define if the geometry using the materials has tangents and bitangents, needed
+	//! by the bump material. Without them a lambert material is used.
+	inline void setTangentSpace(Bool tangentSpace) { m_tangentSpace = tangentSpace; }
+
 protected:
 
-	const domInstance_material_Array m_materialArray;
+	domInstance_material_Array m_materialArray;
 
 	typedef std::vector<Effect> T_EffectVector;
 	typedef T_EffectVector::iterator IT_EffectVector;
 	T_EffectVector m_effectList;
 
+	Bool m_tangentSpace;
+
 	void setEffect(CMaterial::Effect &effect, domInstance_effectRef effectRef);
 	void loadSamplers(Effect &effect);
 };
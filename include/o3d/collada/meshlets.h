@@ -0,0 +1,129 @@
+/**
+ * @file meshlets.h
+ * @brief O3DCollada meshlets (small clusters of triangles) of the imported meshes.
+ * @author Frederic SCHERMA (frederic.scherma@dreamoverflow.org)
+ * @date 2026-10-18
+ * @copyright Copyright (c) 2001-2026 Dream Overflow. All rights reserved.
+ * @details
+ */
+
+#ifndef _O3D_COLLADA_MESHLETS_H
+#define _O3D_COLLADA_MESHLETS_H
+
+#include <o3d/core/string.h>
+
+#include <map>
+#include <vector>
+
+namespace o3d {
+namespace collada {
+
+//! A cluster of triangles of a single face array, with its culling bounds.
+//! The cluster can be culled if it is outside of the frustum by its bounding sphere,
+//! or if it is back facing, when:
+//! dot(normalize(coneApex - cameraPosition), coneAxis) >= coneCutoff
+struct Meshlet
+{
+	UInt32 faceArray;        //!< face array (material) of the triangles
+	UInt32 vertexOffset;     //!< first vertex into the vertex table
+	UInt32 triangleOffset;   //!< first triangle into the triangle table
+	UInt32 vertexCount;
+	UInt32 triangleCount;
+
+	Float center[3];         //!< bounding sphere
+	Float radius;
+
+	Float coneApex[3];       //!< normal cone
+	Float coneAxis[3];
+	Float coneCutoff;        //!< sine of the cone angle, 1 if it cannot be back face culled
+};
+
+//---------------------------------------------------------------------------------------
+//! @class MeshletData
+//-------------------------------------------------------------------------------------
+//! The meshlets of a mesh data. The vertex table gives the mesh data vertex index of
+//! each local vertex of a meshlet, the triangle table gives the local vertices (8 bits)
+//! of each triangle of a meshlet.
+//---------------------------------------------------------------------------------------
+struct MeshletData
+{
+	std::vector<Meshlet> meshlets;
+	std::vector<UInt32> vertices;      //!< vertex table
+	std::vector<UInt8> triangles;      //!< triangle table, 3 local vertices per triangle
+
+	//! Clear the meshlets.
+	void clear();
+};
+
+//---------------------------------------------------------------------------------------
+//! @class MeshletBuilder
+//-------------------------------------------------------------------------------------
+//! Build the meshlets of the face arrays of a mesh. Triangles are taken in the Morton
+//! order of their center to seed each meshlet, which then grows by the adjacent
+//! triangles adding the fewest vertices, and the nearest ones, until a limit is
+//! reached. The meshlets are then spatially coherent and their bounds are tight.
+//---------------------------------------------------------------------------------------
+class MeshletBuilder
+{
+public:
+
+	//! Default ctor. The vertices limit cannot exceed 256 (8 bits local indices).
+	MeshletBuilder(UInt32 maxVertices = 64, UInt32 maxTriangles = 124);
+
+	//! Build the meshlets of a face array and append them.
+	void build(
+			const Float *positions,
+			UInt32 numVertices,
+			const UInt32 *indices,
+			UInt32 numIndices,
+			UInt32 faceArray,
+			MeshletData &meshlets) const;
+
+	//! Build the meshlets of a face array of 16 bits indices and append them.
+	void build(
+			const Float *positions,
+			UInt32 numVertices,
+			const UInt16 *indices,
+			UInt32 numIndices,
+			UInt32 faceArray,
+			MeshletData &meshlets) const;
+
+private:
+
+	UInt32 m_maxVertices;
+	UInt32 m_maxTriangles;
+
+	//! Compute the bounding sphere and the normal cone of a built meshlet.
+	static void computeBounds(const Float *positions, MeshletData &meshlets, Meshlet &meshlet);
+};
+
+//---------------------------------------------------------------------------------------
+//! @class MeshletLibrary
+//-------------------------------------------------------------------------------------
+//! The meshlets built by the imports of a Collada instance, per mesh data resource name.
+//---------------------------------------------------------------------------------------
+class MeshletLibrary
+{
+public:
+
+	//! Add or replace the meshlets of a mesh data.
+	void add(const String &resourceName, MeshletData &meshlets);
+
+	//! Get the meshlets of a mesh data, or null.
+	const MeshletData* find(const String &resourceName) const;
+
+	//! Get the number of mesh data having meshlets.
+	inline UInt32 getNumMeshData() const { return static_cast<UInt32>(m_meshlets.size()); }
+
+	//! Remove every meshlet.
+	inline void clear() { m_meshlets.clear(); }
+
+private:
+
+	std::map<String, MeshletData> m_meshlets;
+};
+
+} // namespace collada
+} // namespace o3d
+
+#endif // _O3D_COLLADA_MESHLETS_H
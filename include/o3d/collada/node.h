@@ -60,6 +60,9 @@ public:
 	//! Set pre-export values from the scene
 	virtual Bool fromScene();
 
+	//! Release any reference to the COLLADA-DOM, recursively
+	virtual void releaseDom();
+
 	//! Apply skeleton to skinning
 	Bool postImportPass();
 
@@ -84,6 +87,12 @@ public:
 	//! Get the animation node or null
 	o3d::AnimationNode* getAnimationNode() const { return m_animNode; }
 
+	//! Is the node imported with its instances, or only kept for its transform.
+	inline Bool isSelected() const { return m_selected; }
+
+	//! Does a node or one of its sons match the node filters of the import options.
+	static Bool hasSelectedNode(const ImportOptions &options, domNode *node);
+
 protected:
 
 	o3d::Node *m_parentNode;
@@ -92,7 +101,11 @@ protected:
     o3d::Bones *m_join;
     o3d::Skeleton *m_skeleton;
 
-	const domNodeRef m_domNode;
+	domNodeRef m_domNode;
+
+	Bool m_isJoin;          //!< node type is joint
+	Bool m_hasTransform;    //!< node has at least one transformation
+	Bool m_selected;        //!< node or one of its ancestors matches the node filters
 
 	Matrix4 m_matrix;
 
@@ -0,0 +1,124 @@
+/**
+ * @file numericarrays.h
+ * @brief O3DCollada numeric arrays extracted from the document text.
+ * @author Frederic SCHERMA (frederic.scherma@dreamoverflow.org)
+ * @date 2026-10-18
+ * @copyright Copyright (c) 2001-2026 Dream Overflow. All rights reserved.
+ * @details
+ */
+
+#ifndef _O3D_COLLADA_NUMERICARRAYS_H
+#define _O3D_COLLADA_NUMERICARRAYS_H
+
+#include "global.h"
+
+#include <map>
+#include <string>
+
+namespace o3d {
+namespace collada {
+
+//! Parse a xs:double from [str, end), independently of the locale. Returns the first
+//! character after the number, or null if there is no valid number.
+const Char* parseFloat(const Char *str, const Char *end, Float &value);
+
+//! Parse a list of whitespace separated xs:double from [begin, end) and append them.
+//! Returns False if a value is not a valid number.
+Bool parseFloats(const Char *begin, const Char *end, std::vector<Float> &values);
+
+//---------------------------------------------------------------------------------------
+//! @class FloatArrayView
+//-------------------------------------------------------------------------------------
+//! Read access to the values of a float_array, either extracted as floats before the
+//! document is parsed, or kept as doubles by COLLADA-DOM.
+//---------------------------------------------------------------------------------------
+class FloatArrayView
+{
+public:
+
+	//! An invalid view.
+	FloatArrayView() : m_floats(nullptr), m_doubles(nullptr), m_count(0) {}
+
+	//! A view onto extracted values.
+	explicit FloatArrayView(const std::vector<Float> &floats) :
+		m_floats(floats.data()),
+		m_doubles(nullptr),
+		m_count(floats.size()) {}
+
+	//! A view onto the values of the COLLADA-DOM.
+	explicit FloatArrayView(const domListOfFloats &doubles) :
+		m_floats(nullptr),
+		m_doubles(&doubles),
+		m_count(doubles.getCount()) {}
+
+	//! Is the view set.
+	inline Bool isValid() const { return m_floats || m_doubles; }
+
+	//! Get the number of values.
+	inline size_t getCount() const { return m_count; }
+
+	//! Get a value.
+	inline Float operator[](size_t i) const { return m_floats ? m_floats[i] : (Float)(*m_doubles)[i]; }
+
+private:
+
+	const Float *m_floats;
+	const domListOfFloats *m_doubles;
+	size_t m_count;
+};
+
+//---------------------------------------------------------------------------------------
+//! @class NumericArrays
+//-------------------------------------------------------------------------------------
+//! The float_array of a document are the most part of a large document. They are
+//! extracted from the text and parsed directly as floats, possibly in parallel, and
+//! only the remaining (much smaller) text is given to COLLADA-DOM. An array is kept into
+//! the text when it has no id, is not valid or does not match its count attribute, and
+//! it is then read from the COLLADA-DOM as usual.
+//---------------------------------------------------------------------------------------
+class NumericArrays
+{
+public:
+
+	//! Default ctor.
+	NumericArrays();
+
+	//! Extract and parse the float_array of a document text, and write the remaining
+	//! text into document. A large array is split into chunks parsed by numThreads
+	//! threads. Returns False if nothing has been extracted.
+	Bool extract(const Char *data, UInt64 size, UInt32 numThreads, std::string &document);
+
+	//! Define the COLLADA-DOM document, once the remaining text is opened. Only the
+	//! arrays of this document are looked up.
+	inline void setDocument(daeDocument *document) { m_document = document; }
+
+	//! Get the values of a float_array, the extracted ones if any.
+	FloatArrayView getFloats(domFloat_array *array) const;
+
+	//! Get the values of a float_array, using the extracted arrays if not null.
+	static FloatArrayView getFloats(const NumericArrays *arrays, domFloat_array *array);
+
+	//! Get the number of extracted arrays.
+	inline UInt32 getNumArrays() const { return static_cast<UInt32>(m_arrays.size()); }
+
+	//! Get the number of extracted values.
+	inline UInt64 getNumValues() const { return m_numValues; }
+
+	//! Release the extracted arrays.
+	void clear();
+
+private:
+
+	daeDocument *m_document;
+
+	typedef std::map<std::string, std::vector<Float> > T_FloatArrayMap;
+	typedef T_FloatArrayMap::const_iterator CIT_FloatArrayMap;
+	T_FloatArrayMap m_arrays;
+
+	UInt64 m_numValues;
+};
+
+} // namespace collada
+} // namespace o3d
+
+#endif // _O3D_COLLADA_NUMERICARRAYS_H
@@ -0,0 +1,155 @@
+/**
+ * @file profiler.h
+ * @brief O3DCollada import profiling.
+ * @author Frederic SCHERMA (frederic.scherma@dreamoverflow.org)
+ * @date 2026-10-18
+ * @copyright Copyright (c) 2001-2026 Dream Overflow. All rights reserved.
+ * @details
+ */
+
+#ifndef _O3D_COLLADA_PROFILER_H
+#define _O3D_COLLADA_PROFILER_H
+
+#include <o3d/core/string.h>
+
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace o3d {
+namespace collada {
+
+//---------------------------------------------------------------------------------------
+//! @class ImportProfiler
+//-------------------------------------------------------------------------------------
+//! Collect the timings of the import phases, and of each imported object.
+//! Entries are grouped by category (the phase), and named by object when relevant.
+//! A profiler can be shared by many imports, even concurrent ones.
+//---------------------------------------------------------------------------------------
+class ImportProfiler
+{
+public:
+
+	//! A timed scope.
+	struct Entry
+	{
+		String category;    //!< phase name
+		String name;        //!< object name, or empty for the whole phase
+		Int64 start;        //!< start time in microseconds since the profiler creation
+		Int64 duration;     //!< duration in microseconds
+		UInt32 depth;       //!< nesting depth into its thread
+		UInt32 thread;      //!< thread index, in order of first appearance
+		UInt64 counter;     //!< counter delta during the scope, if a counter is defined
+	};
+
+	//! User counter sampled at the begin and the end of each scope (allocations...).
+	typedef UInt64 (*CounterFunc)();
+
+	typedef std::vector<Entry> T_EntryVector;
+	typedef T_EntryVector::const_iterator CIT_EntryVector;
+
+	//! Cumulated duration in seconds per category, for top level scopes of each category.
+	typedef std::map<String, Double> T_PhaseMap;
+	typedef T_PhaseMap::const_iterator CIT_PhaseMap;
+
+	//! Cumulated counter delta per category, for top level scopes of each category.
+	typedef std::map<String, UInt64> T_PhaseCounterMap;
+	typedef T_PhaseCounterMap::const_iterator CIT_PhaseCounterMap;
+
+	//! Default ctor.
+	ImportProfiler();
+
+	//! Define a counter sampled by each scope, or null to disable.
+	inline void setCounter(CounterFunc counter) { m_counter = counter; }
+
+	//! Open a scope and returns its entry index.
+	UInt32 begin(const String &category, const String &name);
+
+	//! Close a scope given its entry index.
+	void end(UInt32 index);
+
+	//! Get the recorded entries.
+	inline const T_EntryVector& getEntries() const { return m_entries; }
+
+	//! Get the total duration per phase, nested scopes of the same category are counted once.
+	T_PhaseMap getPhases() const;
+
+	//! Get the counter delta per phase, nested scopes of the same category are counted once.
+	T_PhaseCounterMap getPhaseCounters() const;
+
+	//! Clear any recorded entries.
+	void clear();
+
+	//! Log the time spent per phase.
+	void log() const;
+
+	//! Write the entries as Chrome trace-event JSON (chrome://tracing or Perfetto).
+	Bool exportChromeTrace(const String &filename) const;
+
+private:
+
+	Int64 m_origin;
+	CounterFunc m_counter;
+
+	mutable std::mutex m_mutex;
+
+	T_EntryVector m_entries;
+
+	struct ThreadState
+	{
+		UInt32 index;
+		UInt32 depth;
+	};
+
+	std::map<std::thread::id, ThreadState> m_threads;
+
+	Int64 now() const;
+
+	void accumulate(T_PhaseMap *durations, T_PhaseCounterMap *counters) const;
+};
+
+//---------------------------------------------------------------------------------------
+//! @class ProfileScope
+//-------------------------------------------------------------------------------------
+//! Time a scope if a profiler is defined, does nothing otherwise.
+//---------------------------------------------------------------------------------------
+class ProfileScope
+{
+public:
+
+	ProfileScope(ImportProfiler *profiler, const char *category) :
+		m_profiler(profiler),
+		m_index(0)
+	{
+		if (m_profiler)
+			m_index = m_profiler->begin(category, String());
+	}
+
+	ProfileScope(ImportProfiler *profiler, const char *category, const String &name) :
+		m_profiler(profiler),
+		m_index(0)
+	{
+		if (m_profiler)
+			m_index = m_profiler->begin(category, name);
+	}
+
+	~ProfileScope()
+	{
+		if (m_profiler)
+			m_profiler->end(m_index);
+	}
+
+private:
+
+	ImportProfiler *m_profiler;
+	UInt32 m_index;
+
+	ProfileScope(const ProfileScope&);
+	void operator=(const ProfileScope&);
+};
+
+} // namespace collada
+} // namespace o3d
+
+#endif // _O3D_COLLADA_PROFILER_H
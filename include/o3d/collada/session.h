@@ -0,0 +1,120 @@
+/**
+ * @file session.h
+ * @brief O3DCollada import session, shared by many imports into the same scene.
+ * @author Frederic SCHERMA (frederic.scherma@dreamoverflow.org)
+ * @date 2026-10-18
+ * @copyright Copyright (c) 2001-2026 Dream Overflow. All rights reserved.
+ * @details
+ */
+
+#ifndef _O3D_COLLADA_SESSION_H
+#define _O3D_COLLADA_SESSION_H
+
+#include "material.h"
+
+#include <map>
+
+namespace o3d {
+namespace collada {
+
+//---------------------------------------------------------------------------------------
+//! @class ColladaSession
+//-------------------------------------------------------------------------------------
+//! State kept alive across many imports into the same scene, as for a world streamed
+//! as many small documents sharing textures, materials and geometries :
+//! - the COLLADA-DOM database, where the documents referenced by URL (material or
+//!   geometry libraries) stay loaded once an importing document is closed,
+//! - the resolved textures paths,
+//! - the parsed effects, given their document and id,
+//! - the mesh data built for a geometry, given its document and id.
+//! A session is not thread safe, it must be used by a single importer at a time.
+//---------------------------------------------------------------------------------------
+class ColladaSession
+{
+public:
+
+	//! Hits counters of the caches.
+	struct Statistics
+	{
+		UInt32 numImports;     //!< number of imported documents
+		UInt32 textureHits;    //!< textures paths found into the cache
+		UInt32 effectHits;     //!< effects found into the cache
+		UInt32 meshDataHits;   //!< geometries found into the cache
+
+		Statistics() : numImports(0), textureHits(0), effectHits(0), meshDataHits(0) {}
+	};
+
+	//! A geometry previously converted to a mesh data.
+	struct MeshDataEntry
+	{
+		String resourceName;   //!< resource name of the mesh data (or of its first chunk)
+		UInt32 numVertices;    //!< number of vertices after they are duplicated
+		Bool tangentSpace;     //!< has tangent and bitangent arrays
+
+		MeshDataEntry() : numVertices(0), tangentSpace(False) {}
+	};
+
+	//! Default ctor.
+	ColladaSession(o3d::Scene *scene);
+
+	//! Destructor. Delete the COLLADA-DOM database.
+	~ColladaSession();
+
+	//! Get the scene all the imports are done into.
+	inline o3d::Scene* getScene() const { return m_scene; }
+
+	//! Get the COLLADA-DOM database, created at the first call.
+	DAE* getDAE();
+
+	//! Get a key unique for an element of the database, made of its document URI and
+	//! its id, or an empty string if the element has no id.
+	static String getElementKey(daeElement *element);
+
+	//! Find an already resolved texture path.
+	Bool findTexturePath(const String &key, String &path);
+	//! Add a resolved texture path.
+	void addTexturePath(const String &key, const String &path);
+
+	//! Find an already parsed effect, or null.
+	const CMaterial::Effect* findEffect(const String &key);
+	//! Add a parsed effect. Its textures must not be loaded yet.
+	void addEffect(const String &key, const CMaterial::Effect &effect);
+
+	//! Find a geometry already converted to a mesh data.
+	const MeshDataEntry* findMeshData(const String &key);
+	//! Add a geometry converted to a mesh data.
+	void addMeshData(const String &key, const MeshDataEntry &entry);
+
+	//! Count an imported document.
+	inline void addImport() { ++m_statistics.numImports; }
+
+	//! Get the caches statistics.
+	inline const Statistics& getStatistics() const { return m_statistics; }
+
+	//! Clear the caches and unload any document of the database.
+	void clear();
+
+private:
+
+	o3d::Scene *m_scene;
+	DAE *m_dae;
+
+	typedef std::map<String, String> T_TexturePathMap;
+	typedef T_TexturePathMap::iterator IT_TexturePathMap;
+	T_TexturePathMap m_texturePaths;
+
+	typedef std::map<String, CMaterial::Effect> T_EffectMap;
+	typedef T_EffectMap::iterator IT_EffectMap;
+	T_EffectMap m_effects;
+
+	typedef std::map<String, MeshDataEntry> T_MeshDataMap;
+	typedef T_MeshDataMap::iterator IT_MeshDataMap;
+	T_MeshDataMap m_meshDatas;
+
+	Statistics m_statistics;
+};
+
+} // namespace collada
+} // namespace o3d
+
+#endif // _O3D_COLLADA_SESSION_H
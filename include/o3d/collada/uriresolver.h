@@ -0,0 +1,44 @@
+/**
+ * @file uriresolver.h
+ * @brief O3DCollada resolution of the URI referenced by a document.
+ * @author Frederic SCHERMA (frederic.scherma@dreamoverflow.org)
+ * @date 2026-10-18
+ * @copyright Copyright (c) 2001-2026 Dream Overflow. All rights reserved.
+ * @details
+ */
+
+#ifndef _O3D_COLLADA_URIRESOLVER_H
+#define _O3D_COLLADA_URIRESOLVER_H
+
+#include <o3d/core/string.h>
+
+namespace o3d {
+namespace collada {
+
+//---------------------------------------------------------------------------------------
+//! @class UriResolver
+//-------------------------------------------------------------------------------------
+//! Resolve the URI of the resources referenced by an imported document, as the image
+//! files of its textures. The default implementation gives the native path of the URI,
+//! relative to the base path of the document. Override it to map the resources of a
+//! document imported from memory to another storage (a cache, an asset service...).
+//! It can be called from a worker thread during an asynchronous import.
+//---------------------------------------------------------------------------------------
+class UriResolver
+{
+public:
+
+	//! Destructor.
+	virtual ~UriResolver() {}
+
+	//! Resolve the file name of a texture.
+	//! @param uri URI of the image as written into the document, possibly relative.
+	//! @param basePath Base path of the document.
+	//! @return The file name given to the texture manager.
+	virtual String resolveTexture(const String &uri, const String &basePath) const;
+};
+
+} // namespace collada
+} // namespace o3d
+
+#endif // _O3D_COLLADA_URIRESOLVER_H
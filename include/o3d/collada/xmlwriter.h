@@ -0,0 +1,151 @@
+/**
+ * @file xmlwriter.h
+ * @brief O3DCollada streaming XML writer.
+ * @author Frederic SCHERMA (frederic.scherma@dreamoverflow.org)
+ * @date 2026-10-18
+ * @copyright Copyright (c) 2001-2026 Dream Overflow. All rights reserved.
+ * @details
+ */
+
+#ifndef _O3D_COLLADA_XMLWRITER_H
+#define _O3D_COLLADA_XMLWRITER_H
+
+#include <o3d/core/outstream.h>
+#include <o3d/core/string.h>
+
+#include <string>
+#include <vector>
+
+namespace o3d {
+namespace collada {
+
+//! Maximal length of a formatted float, including the terminal zero.
+const UInt32 FLOAT_TEXT_SIZE = 24;
+
+//! Format a float as the shortest xs:double reading back to the same float, even when
+//! parsed as a double then rounded to a float. Returns the end of the written text,
+//! not zero terminated.
+Char* formatFloat(Float value, Char *out);
+
+//! Format a float as a xs:double of at most numDigits (1..9) significant digits. Under
+//! 9 digits the float read back can differ. Returns the end of the written text, not
+//! zero terminated.
+Char* formatFloat(Float value, UInt32 numDigits, Char *out);
+
+//! Format an unsigned integer. Returns the end of the written text, not zero terminated.
+Char* formatUInt(UInt32 value, Char *out);
+
+//---------------------------------------------------------------------------------------
+//! @class XmlWriter
+//-------------------------------------------------------------------------------------
+//! Write a XML document element by element to an output stream, through a buffer
+//! flushed when it is full. Nothing of the document is kept but the stack of the
+//! opened elements, so the size of the written document is not limited by the memory.
+//! Element and attribute names must be literals, they are not escaped nor copied.
+//---------------------------------------------------------------------------------------
+class XmlWriter
+{
+public:
+
+	//! Default ctor. Write the XML declaration.
+	XmlWriter(OutStream &os, UInt32 bufferSize = 1 << 20);
+
+	//! Destructor. Flush the buffer.
+	~XmlWriter();
+
+	//! Open an element. Its attributes can be added until its content is written.
+	void beginElement(const Char *name);
+
+	//! Close the last opened element.
+	void endElement();
+
+	//! Write an element containing only a text.
+	void element(const Char *name, const String &text);
+
+	//! Add an attribute to the last opened element.
+	void attribute(const Char *name, const String &value);
+
+	//! Add an attribute to the last opened element.
+	void attribute(const Char *name, const Char *value);
+
+	//! Add an unsigned integer attribute to the last opened element.
+	void attribute(const Char *name, UInt32 value);
+
+	//! Add an URI fragment attribute (#id) to the last opened element.
+	void reference(const Char *name, const String &id);
+
+	//! Write an escaped text into the last opened element.
+	void text(const String &text);
+
+	//! Define the maximal number of significant digits of the written floats, or 0
+	//! (default) for the shortest text reading back to the same float.
+	inline void setFloatDigits(UInt32 digits) { m_floatDigits = digits; }
+	//! Get the maximal number of significant digits of the written floats.
+	inline UInt32 getFloatDigits() const { return m_floatDigits; }
+
+	//! Define the number of threads formatting the large lists of numbers (default 1).
+	//! The text is the same whatever the number of threads.
+	inline void setNumThreads(UInt32 numThreads) { m_numThreads = numThreads > 0 ? numThreads : 1; }
+	//! Get the number of threads formatting the large lists of numbers.
+	inline UInt32 getNumThreads() const { return m_numThreads; }
+
+	//! Write a list of floats into the last opened element.
+	void floats(const Float *values, size_t count);
+
+	//! Write a list of unsigned integers into the last opened element.
+	void uints(const UInt32 *values, size_t count);
+
+	//! Write a list of unsigned short integers into the last opened element.
+	void uints(const UInt16 *values, size_t count);
+
+	//! Write a raw text (already escaped) into the last opened element.
+	void raw(const Char *data, size_t size);
+
+	//! Flush the buffer to the stream.
+	void flush();
+
+	//! Get the number of written bytes.
+	inline UInt64 getNumBytes() const { return m_numBytes + m_buffer.size(); }
+
+	//! Is an error occurred while writing to the stream.
+	inline Bool hasError() const { return m_error; }
+
+private:
+
+	OutStream &m_os;
+
+	std::string m_buffer;
+	size_t m_bufferSize;
+
+	UInt64 m_numBytes;
+	Bool m_error;
+
+	UInt32 m_floatDigits;                  //!< 0 for the shortest round-trip text
+	UInt32 m_numThreads;
+
+	std::vector<const Char*> m_elements;   //!< stack of the opened elements
+	Bool m_tagOpened;                      //!< attributes can be added to the last element
+	Bool m_hasText;                        //!< the last element contains a text
+
+	//! Close the tag of the last opened element, before adding a content.
+	void closeTag();
+
+	//! Write a new line and the indentation of the current depth.
+	void indent();
+
+	//! Append to the buffer, flushing it when full.
+	inline void append(const Char *data, size_t size)
+	{
+		m_buffer.append(data, size);
+		if (m_buffer.size() >= m_bufferSize)
+			flush();
+	}
+
+	//! Append an escaped string to the buffer.
+	void appendEscaped(const String &str, Bool attribute);
+};
+
+} // namespace collada
+} // namespace o3d
+
+#endif // _O3D_COLLADA_XMLWRITER_H
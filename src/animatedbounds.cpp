@@ -0,0 +1,243 @@
+/**
+ * @file animatedbounds.cpp
+ * @brief Implementation of animatedbounds.h
+ * @author Frederic SCHERMA (frederic.scherma@dreamoverflow.org)
+ * @date 2026-10-18
+ * @copyright Copyright (c) 2001-2026 Dream Overflow. All rights reserved.
+ * @details
+ */
+
+#include "o3d/collada/precompiled.h"
+#include "o3d/collada/animatedbounds.h"
+#include "o3d/collada/animationsampler.h"
+
+#include <o3d/engine/object/bones.h>
+#include <o3d/engine/object/skin.h>
+#include <o3d/engine/object/meshdata.h>
+#include <o3d/engine/object/geometrydata.h>
+#include <o3d/engine/animation/animationnode.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace o3d;
+using namespace o3d::collada;
+
+namespace {
+
+//! Grow bounds by a box transformed by a row major matrix, and get its 8 transformed
+//! corners (24 floats).
+void growTransformed(const Float *matrix, const Float *box, Float *corners, Float *bmin, Float *bmax)
+{
+	for (UInt32 c = 0; c < 8; ++c)
+	{
+		const Float p[3] = {
+			(c & 1) ? box[3] : box[0],
+			(c & 2) ? box[4] : box[1],
+			(c & 4) ? box[5] : box[2] };
+
+		for (UInt32 r = 0; r < 3; ++r)
+		{
+			const Float v = matrix[r*4] * p[0] + matrix[r*4+1] * p[1] + matrix[r*4+2] * p[2] + matrix[r*4+3];
+
+			corners[c*3+r] = v;
+			bmin[r] = o3d::min(bmin[r], v);
+			bmax[r] = o3d::max(bmax[r], v);
+		}
+	}
+}
+
+} // anonymous namespace
+
+// Get the bounds at a time
+Bool AnimatedBounds::getBounds(Float time, Float *bmin, Float *bmax) const
+{
+	const UInt32 numFrames = getNumFrames();
+	if (numFrames == 0)
+		return False;
+
+	UInt32 f0 = 0, f1 = 0;
+
+	if (numFrames > 1 && duration > 0.f)
+	{
+		Float t = std::fmod(time, duration) / duration;
+		if (t < 0.f)
+			t += 1.f;
+
+		const Float pos = t * (numFrames - 1);
+		f0 = o3d::min<UInt32>(numFrames - 1, (UInt32)pos);
+		f1 = o3d::min<UInt32>(numFrames - 1, f0 + 1);
+	}
+
+	for (UInt32 k = 0; k < 3; ++k)
+	{
+		bmin[k] = o3d::min(frames[f0*6+k], frames[f1*6+k]);
+		bmax[k] = o3d::max(frames[f0*6+3+k], frames[f1*6+3+k]);
+	}
+
+	return True;
+}
+
+// Add a skinning with the bounds of its bones
+void AnimatedBoundsLibrary::addSkinning(o3d::Skinning *skinning, std::vector<Float> &boneBounds)
+{
+	AnimatedBounds &bounds = m_bounds[skinning];
+	bounds.skinning = skinning;
+	bounds.animation = String();
+	bounds.duration = 0.f;
+	bounds.sampleRate = 0.f;
+	bounds.boneBounds.swap(boneBounds);
+	bounds.frames.clear();
+
+	m_pending.push_back(skinning);
+}
+
+// Sample the bounds of the added skinnings
+void AnimatedBoundsLibrary::build(
+	const std::map<const o3d::BaseNode*, o3d::AnimationNode*> &animNodes,
+	const std::map<const o3d::AnimationNode*, String> &animations,
+	Float duration,
+	Float sampleRate)
+{
+	if (m_pending.empty())
+		return;
+
+	// a single frame for the skinnings of a static skeleton
+	std::vector<AnimationPose> poses;
+	AnimationPose::buildFrames(animNodes, duration, sampleRate, poses);
+
+	const UInt32 numFrames = (UInt32)poses.size();
+
+	for (const o3d::Skinning *key : m_pending)
+	{
+		AnimatedBounds &bounds = m_bounds[key];
+		o3d::Skinning *skinning = bounds.skinning;
+
+		const UInt32 numBones = o3d::min<UInt32>(skinning->getNumBones(), (UInt32)bounds.boneBounds.size() / 6);
+
+		bounds.animation = AnimationPose::findAnimation(skinning, animNodes, animations);
+
+		const UInt32 numSkinningFrames = bounds.animation.isValid() ? numFrames : 1;
+
+		bounds.duration = numSkinningFrames > 1 ? duration : 0.f;
+		bounds.sampleRate = numSkinningFrames > 1 ? sampleRate : 0.f;
+		bounds.frames.assign(numSkinningFrames * 6, 0.f);
+
+		// largest motion of a corner of the bone boxes from each frame to the next one
+		std::vector<Float> motions(numSkinningFrames, 0.f);
+		std::vector<Float> corners(numBones * 24 * 2);
+
+		Bool valid = False;
+
+		for (UInt32 f = 0; f < numSkinningFrames; ++f)
+		{
+			Float *bmin = &bounds.frames[f*6];
+			Float *bmax = &bounds.frames[f*6+3];
+
+			for (UInt32 k = 0; k < 3; ++k)
+			{
+				bmin[k] = std::numeric_limits<Float>::max();
+				bmax[k] = -std::numeric_limits<Float>::max();
+			}
+
+			Float *frameCorners = &corners[(f & 1) * numBones * 24];
+			const Float *prevCorners = &corners[((f & 1) ^ 1) * numBones * 24];
+
+			for (UInt32 i = 0; i < numBones; ++i)
+			{
+				const Float *box = &bounds.boneBounds[i*6];
+				o3d::Bones *bones = skinning->getBone(i);
+
+				// no vertex influenced by the bone
+				if (!bones || box[0] > box[3])
+					continue;
+
+				growTransformed(poses[f].getWorld(bones), box, &frameCorners[i*24], bmin, bmax);
+				valid = True;
+
+				for (UInt32 c = 0; f > 0 && c < 8; ++c)
+				{
+					const Float *p0 = &prevCorners[i*24+c*3];
+					const Float *p1 = &frameCorners[i*24+c*3];
+
+					const Float dx = p1[0] - p0[0], dy = p1[1] - p0[1], dz = p1[2] - p0[2];
+					motions[f-1] = o3d::max(motions[f-1], std::sqrt(dx*dx + dy*dy + dz*dz));
+				}
+			}
+		}
+
+		if (!valid)
+		{
+			bounds.frames.clear();
+			continue;
+		}
+
+		// a point turning of less than half a turn between two frames stays within half
+		// of its motion from the segment between its two positions, so the union of two
+		// frames padded by half of the motion between them contains the mesh in between
+		for (UInt32 f = 0; f < numSkinningFrames; ++f)
+		{
+			const Float pad = 0.5f * o3d::max(motions[f], f > 0 ? motions[f-1] : 0.f);
+
+			for (UInt32 k = 0; k < 3; ++k)
+			{
+				bounds.frames[f*6+k] -= pad;
+				bounds.frames[f*6+3+k] += pad;
+			}
+		}
+
+		setStaticBounding(bounds);
+	}
+
+	m_pending.clear();
+}
+
+// Set the union of the frames as the static bounding of a skinning
+void AnimatedBoundsLibrary::setStaticBounding(const AnimatedBounds &bounds)
+{
+	o3d::Skinning *skinning = bounds.skinning;
+	if (!skinning->getMeshData() || !skinning->getMeshData()->getGeometry())
+		return;
+
+	GeometryData *geometry = skinning->getMeshData()->getGeometry();
+
+	// the mesh data can be shared, its bind pose box is kept in the union
+	const AABBox &box = geometry->getBoundingBox();
+	Vector3 bmin = box.getMin();
+	Vector3 bmax = box.getMax();
+
+	for (UInt32 f = 0; f < bounds.getNumFrames(); ++f)
+	{
+		for (UInt32 k = 0; k < 3; ++k)
+		{
+			bmin[k] = o3d::min(bmin[k], bounds.frames[f*6+k]);
+			bmax[k] = o3d::max(bmax[k], bounds.frames[f*6+3+k]);
+		}
+	}
+
+	// the bounding is no longer computed from the skinned vertices at each update
+	skinning->setBoundingAutoRegen(False);
+	geometry->setBoundingBox(AABBox((bmin + bmax) * 0.5f, (bmax - bmin) * 0.5f));
+}
+
+const AnimatedBounds* AnimatedBoundsLibrary::find(const o3d::Skinning *skinning) const
+{
+	auto it = m_bounds.find(skinning);
+	return it != m_bounds.end() ? &it->second : nullptr;
+}
+
+void AnimatedBoundsLibrary::findAnimation(const String &resourceName, std::vector<const AnimatedBounds*> &bounds) const
+{
+	for (auto it = m_bounds.begin(); it != m_bounds.end(); ++it)
+	{
+		if (it->second.animation == resourceName)
+			bounds.push_back(&it->second);
+	}
+}
+
+void AnimatedBoundsLibrary::clear()
+{
+	m_bounds.clear();
+	m_pending.clear();
+}
@@ -10,6 +10,7 @@
 #include "o3d/collada/precompiled.h"
 #include "o3d/collada/animation.h"
 #include "o3d/collada/node.h"
+#include "o3d/collada/numericarrays.h"
 
 #include <o3d/engine/scene/scene.h>
 #include <o3d/engine/animation/animationnode.h>
@@ -39,6 +40,8 @@ CAnimation::CAnimation(
 // Destructor
 CAnimation::~CAnimation()
 {
+	for (IT_AnimationList it = m_subAnimations.begin(); it != m_subAnimations.end(); ++it)
+		deletePtr(*it);
 }
 
 // Import method
@@ -46,6 +49,8 @@ Bool CAnimation::import()
 {
 	m_id = m_animation->getId() ? m_animation->getId() : "";
 
+	ProfileScope scope(m_infos.getProfiler(), "animation", m_id);
+
     // sub-animation node, we use it
     if (m_animation->getAnimation_array().getCount() > 0)
         m_animation = m_animation->getAnimation_array().get(0);
@@ -78,12 +83,14 @@ Bool CAnimation::import()
 	domAnimation_Array &animation_array = m_animation->getAnimation_array();
 	for (size_t i = 0; i < animation_array.getCount(); ++i)
 	{
-		CAnimation *animation = new CAnimation(m_scene, &m_dom, m_infos, animation_array[i]);
+		CAnimation *animation = new CAnimation(m_scene, m_dom, m_infos, animation_array[i]);
 		if (!animation->import())
 		{
 			deletePtr(animation);
 			break;
 		}
+
+		m_subAnimations.push_back(animation);
 	}
 
 	return True;
@@ -114,6 +121,18 @@ Bool CAnimation::fromScene()
 	return True;
 }
 
+// Release any reference to the COLLADA-DOM
+void CAnimation::releaseDom()
+{
+	// sources are copied, and the channels targets resolved
+	m_animation = domAnimationRef();
+
+	for (IT_AnimationList it = m_subAnimations.begin(); it != m_subAnimations.end(); ++it)
+		(*it)->releaseDom();
+
+	CBaseObject::releaseDom();
+}
+
 // Define the animation node
 void CAnimation::setAnimationNode(o3d::AnimationNode *animNode)
 {
@@ -137,13 +156,13 @@ void CAnimation::readSource(domSourceRef source)
 	// Copy over the float array data if any
 	if (source->getFloat_array())
 	{
-		daeDoubleArray &floatArray = source->getFloat_array()->getValue();
+		const FloatArrayView floatArray = NumericArrays::getFloats(m_infos.getNumericArrays(), source->getFloat_array());
 		lsrc.data.setSize(floatArray.getCount());
 
 		// copy the array data
 		for (size_t a = 0; a < floatArray.getCount(); ++a)
 		{
-			lsrc.data[a] = (Float)floatArray[a];
+			lsrc.data[a] = floatArray[a];
 		}
 	}
 	else if (source->getName_array())
@@ -384,6 +403,8 @@ void CAnimation::readChannel(domChannelRef channel)
 
 void CAnimation::generateKeys()
 {
+	ProfileScope scope(m_infos.getProfiler(), "animation.keys", m_targetObjectID);
+
 	Float invDuration = 1.f / m_infos.getAnimationDuration();
 	
 	CNode *node = (CNode*)m_infos.findNodeUsingId(m_targetObjectID);
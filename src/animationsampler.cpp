@@ -0,0 +1,352 @@
+/**
+ * @file animationsampler.cpp
+ * @brief Implementation of animationsampler.h
+ * @author Frederic SCHERMA (frederic.scherma@dreamoverflow.org)
+ * @date 2026-10-18
+ * @copyright Copyright (c) 2001-2026 Dream Overflow. All rights reserved.
+ * @details
+ */
+
+#include "o3d/collada/precompiled.h"
+#include "o3d/collada/animationsampler.h"
+
+#include <o3d/engine/hierarchy/node.h>
+#include <o3d/engine/object/bones.h>
+#include <o3d/engine/object/skin.h>
+#include <o3d/engine/animation/animationnode.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace o3d;
+using namespace o3d::collada;
+
+namespace {
+
+const Float IDENTITY[16] = {
+	1.f, 0.f, 0.f, 0.f,
+	0.f, 1.f, 0.f, 0.f,
+	0.f, 0.f, 1.f, 0.f,
+	0.f, 0.f, 0.f, 1.f };
+
+//! A rotation, in double to bake the keys without drift.
+struct Rotation
+{
+	Double x, y, z, w;
+
+	Rotation() : x(0), y(0), z(0), w(1) {}
+	Rotation(Double _x, Double _y, Double _z, Double _w) : x(_x), y(_y), z(_z), w(_w) {}
+
+	//! Rotation of an angle around an axis of the frame.
+	static Rotation axis(UInt32 axis, Double angle)
+	{
+		Rotation r(0, 0, 0, std::cos(angle * 0.5));
+		(&r.x)[axis] = std::sin(angle * 0.5);
+		return r;
+	}
+
+	Rotation operator* (const Rotation &q) const
+	{
+		return Rotation(
+				w*q.x + x*q.w + y*q.z - z*q.y,
+				w*q.y - x*q.z + y*q.w + z*q.x,
+				w*q.z + x*q.y - y*q.x + z*q.w,
+				w*q.w - x*q.x - y*q.y - z*q.z);
+	}
+
+	//! Spherical linear interpolation along the shortest path, as the smooth
+	//! quaternion tracks. Normalized linear for the nearly equal rotations.
+	static Rotation slerp(const Rotation &a, const Rotation &b, Double t)
+	{
+		Double cosAngle = a.x*b.x + a.y*b.y + a.z*b.z + a.w*b.w;
+		const Double sign = cosAngle < 0 ? -1 : 1;
+		cosAngle *= sign;
+
+		Double wa = 1 - t;
+		Double wb = t * sign;
+
+		if (cosAngle < 0.9995)
+		{
+			const Double angle = std::acos(cosAngle);
+			const Double sinAngle = std::sin(angle);
+
+			wa = std::sin((1 - t) * angle) / sinAngle;
+			wb = std::sin(t * angle) / sinAngle * sign;
+		}
+
+		Rotation r(
+				a.x * wa + b.x * wb,
+				a.y * wa + b.y * wb,
+				a.z * wa + b.z * wb,
+				a.w * wa + b.w * wb);
+
+		const Double len = std::sqrt(r.x*r.x + r.y*r.y + r.z*r.z + r.w*r.w);
+		if (len > 0)
+		{
+			r.x /= len; r.y /= len; r.z /= len; r.w /= len;
+		}
+
+		return r;
+	}
+};
+
+//! Find the keys around a time, and the interpolation factor between them.
+template <class T_List>
+Bool findKeys(
+		T_List &keys,
+		Float time,
+		typename T_List::value_type &a,
+		typename T_List::value_type &b,
+		Float &t)
+{
+	if (keys.empty())
+		return False;
+
+	a = b = keys.front();
+
+	for (typename T_List::iterator it = keys.begin(); it != keys.end(); ++it)
+	{
+		if ((*it)->getTime() <= time)
+		{
+			a = b = *it;
+		}
+		else
+		{
+			b = *it;
+			break;
+		}
+	}
+
+	t = (b->getTime() > a->getTime() && time > a->getTime()) ?
+			(time - a->getTime()) / (b->getTime() - a->getTime()) : 0.f;
+
+	return True;
+}
+
+} // anonymous namespace
+
+// Get the times of the keys of every track
+void AnimationSampler::getKeyTimes(o3d::AnimationNode *animNode, std::vector<Float> &times)
+{
+	T_AnimationTrackList &tracks = animNode->getTrackList();
+
+	for (IT_AnimationTrackList it = tracks.begin(); it != tracks.end(); ++it)
+	{
+		T_KeyFrameList &keys = (*it)->getKeyFrameList();
+		for (IT_KeyFrameList kit = keys.begin(); kit != keys.end(); ++kit)
+			times.push_back((*kit)->getTime());
+	}
+
+	std::sort(times.begin(), times.end());
+	times.erase(std::unique(times.begin(), times.end()), times.end());
+}
+
+// Interpolate the tracks and compose them
+Bool AnimationSampler::sample(o3d::AnimationNode *animNode, Float time, Float *matrix)
+{
+	T_AnimationTrackList &tracks = animNode->getTrackList();
+
+	Double position[3] = { 0, 0, 0 };
+	Double scale[3] = { 1, 1, 1 };
+	Double angles[3] = { 0, 0, 0 };
+
+	Rotation rotation;
+	Bool hasAngles = False;
+	Bool hasKeys = False;
+
+	for (IT_AnimationTrackList it = tracks.begin(); it != tracks.end(); ++it)
+	{
+		T_KeyFrameList &keys = (*it)->getKeyFrameList();
+		T_KeyFrameList::value_type a, b;
+		Float t;
+
+		if (!findKeys(keys, time, a, b, t))
+			continue;
+
+		hasKeys = True;
+
+		const AnimationTrack::Target target = (*it)->getTarget();
+
+		if (target == AnimationTrack::TARGET_OBJECT_POS || target == AnimationTrack::TARGET_OBJECT_SCALE)
+		{
+			KeyFrameLinear<Vector3> *va = dynamic_cast<KeyFrameLinear<Vector3>*>(a);
+			KeyFrameLinear<Vector3> *vb = dynamic_cast<KeyFrameLinear<Vector3>*>(b);
+			if (!va || !vb)
+				continue;
+
+			Double *out = target == AnimationTrack::TARGET_OBJECT_POS ? position : scale;
+			for (UInt32 c = 0; c < 3; ++c)
+				out[c] = va->Data[c] + (vb->Data[c] - va->Data[c]) * t;
+		}
+		else if (target == AnimationTrack::TARGET_OBJECT_ROT)
+		{
+			KeyFrameSmooth<Quaternion> *qa = dynamic_cast<KeyFrameSmooth<Quaternion>*>(a);
+			KeyFrameSmooth<Quaternion> *qb = dynamic_cast<KeyFrameSmooth<Quaternion>*>(b);
+			if (!qa || !qb)
+				continue;
+
+			rotation = Rotation::slerp(
+					Rotation(qa->Data[X], qa->Data[Y], qa->Data[Z], qa->Data[W]),
+					Rotation(qb->Data[X], qb->Data[Y], qb->Data[Z], qb->Data[W]),
+					t);
+		}
+		else if (target == AnimationTrack::TARGET_OBJECT_ROT_X ||
+				 target == AnimationTrack::TARGET_OBJECT_ROT_Y ||
+				 target == AnimationTrack::TARGET_OBJECT_ROT_Z)
+		{
+			const UInt32 axis = target == AnimationTrack::TARGET_OBJECT_ROT_X ? 0 :
+					(target == AnimationTrack::TARGET_OBJECT_ROT_Y ? 1 : 2);
+
+			KeyFrameLinear<Float> *fa = dynamic_cast<KeyFrameLinear<Float>*>(a);
+			KeyFrameLinear<Float> *fb = dynamic_cast<KeyFrameLinear<Float>*>(b);
+
+			KeyFrameBezier<Float> *ba = dynamic_cast<KeyFrameBezier<Float>*>(a);
+			KeyFrameBezier<Float> *bb = dynamic_cast<KeyFrameBezier<Float>*>(b);
+
+			if (fa && fb)
+			{
+				angles[axis] = fa->Data + (fb->Data - fa->Data) * t;
+			}
+			else if (ba && bb)
+			{
+				// the out tangent of the first key and the in tangent of the second one
+				// are the inner control values, with a uniform parameter
+				const Double c1 = ba->TangentRight ? (*ba->TangentRight)[1] : ba->Data;
+				const Double c2 = bb->TangentLeft ? (*bb->TangentLeft)[1] : bb->Data;
+				const Double u = 1 - t;
+
+				angles[axis] = ba->Data*u*u*u + 3*c1*u*u*t + 3*c2*u*t*t + bb->Data*t*t*t;
+			}
+			else
+			{
+				continue;
+			}
+
+			hasAngles = True;
+		}
+	}
+
+	if (!hasKeys)
+		return False;
+
+	// the rotations around the axis are applied in z, y, x order
+	if (hasAngles)
+		rotation = Rotation::axis(2, angles[2]) * Rotation::axis(1, angles[1]) * Rotation::axis(0, angles[0]);
+
+	const Rotation &q = rotation;
+
+	matrix[0] = Float((1 - 2*(q.y*q.y + q.z*q.z)) * scale[0]);
+	matrix[1] = Float((2*(q.x*q.y - q.z*q.w)) * scale[1]);
+	matrix[2] = Float((2*(q.x*q.z + q.y*q.w)) * scale[2]);
+	matrix[3] = Float(position[0]);
+
+	matrix[4] = Float((2*(q.x*q.y + q.z*q.w)) * scale[0]);
+	matrix[5] = Float((1 - 2*(q.x*q.x + q.z*q.z)) * scale[1]);
+	matrix[6] = Float((2*(q.y*q.z - q.x*q.w)) * scale[2]);
+	matrix[7] = Float(position[1]);
+
+	matrix[8] = Float((2*(q.x*q.z - q.y*q.w)) * scale[0]);
+	matrix[9] = Float((2*(q.y*q.z + q.x*q.w)) * scale[1]);
+	matrix[10] = Float((1 - 2*(q.x*q.x + q.y*q.y)) * scale[2]);
+	matrix[11] = Float(position[2]);
+
+	matrix[12] = 0.f;
+	matrix[13] = 0.f;
+	matrix[14] = 0.f;
+	matrix[15] = 1.f;
+
+	return True;
+}
+
+void AnimationSampler::toRowMajor(const Matrix4 &m, Float *out)
+{
+	const Float *data = m.getData();
+
+	for (UInt32 r = 0; r < 4; ++r)
+		for (UInt32 c = 0; c < 4; ++c)
+			out[r*4+c] = data[c*4+r];
+}
+
+void AnimationSampler::mulRowMajor(const Float *a, const Float *b, Float *out)
+{
+	for (UInt32 r = 0; r < 4; ++r)
+		for (UInt32 c = 0; c < 4; ++c)
+			out[r*4+c] = a[r*4] * b[c] + a[r*4+1] * b[4+c] + a[r*4+2] * b[8+c] + a[r*4+3] * b[12+c];
+}
+
+// Compose the local matrices from the root
+const Float* AnimationPose::getWorld(o3d::BaseNode *node)
+{
+	auto it = m_worlds.find(node);
+	if (it != m_worlds.end())
+		return it->second.m;
+
+	Float local[16];
+	std::memcpy(local, IDENTITY, sizeof(local));
+
+	o3d::Node *sceneNode = dynamic_cast<o3d::Node*>(node);
+	if (sceneNode && sceneNode->getTransform())
+		AnimationSampler::toRowMajor(sceneNode->getTransform()->getMatrix(), local);
+
+	// the tracks are relative to the transform of the node
+	auto animIt = m_animNodes->find(node);
+	Float trs[16];
+
+	if (animIt != m_animNodes->end() && AnimationSampler::sample(animIt->second, m_time, trs))
+	{
+		Float base[16];
+		std::memcpy(base, local, sizeof(base));
+		AnimationSampler::mulRowMajor(base, trs, local);
+	}
+
+	Matrix world;
+	if (node->getNode())
+		AnimationSampler::mulRowMajor(getWorld(node->getNode()), local, world.m);
+	else
+		std::memcpy(world.m, local, sizeof(world.m));
+
+	return m_worlds.insert(std::make_pair(node, world)).first->second.m;
+}
+
+// Get the poses of the frames sampling the animations
+void AnimationPose::buildFrames(
+	const T_AnimationNodeMap &animNodes,
+	Float duration,
+	Float sampleRate,
+	std::vector<AnimationPose> &poses)
+{
+	UInt32 numFrames = 1;
+	if (duration > 0.f && sampleRate > 0.f)
+		numFrames = o3d::max<UInt32>(2, (UInt32)std::ceil(duration * sampleRate) + 1);
+
+	poses.clear();
+	poses.reserve(numFrames);
+
+	for (UInt32 f = 0; f < numFrames; ++f)
+		poses.push_back(AnimationPose(animNodes, numFrames > 1 ? Float(f) / (numFrames - 1) : 0.f));
+}
+
+// Get the animation of the skeleton of a skinning
+String AnimationPose::findAnimation(
+	const o3d::Skinning *skinning,
+	const T_AnimationNodeMap &animNodes,
+	const T_AnimationNameMap &animations)
+{
+	for (UInt32 i = 0; i < skinning->getNumBones(); ++i)
+	{
+		auto it = animNodes.find(skinning->getBone(i));
+		if (it == animNodes.end())
+			continue;
+
+		o3d::AnimationNode *root = it->second;
+		while (root->getFather())
+			root = root->getFather();
+
+		auto animIt = animations.find(root);
+		if (animIt != animations.end())
+			return animIt->second;
+	}
+
+	return String();
+}
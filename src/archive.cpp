@@ -0,0 +1,389 @@
+/**
+ * @file archive.cpp
+ * @brief Implementation of archive.h
+ * @author Frederic SCHERMA (frederic.scherma@dreamoverflow.org)
+ * @date 2026-10-18
+ * @copyright Copyright (c) 2001-2026 Dream Overflow. All rights reserved.
+ * @details
+ */
+
+#include "o3d/collada/precompiled.h"
+#include "o3d/collada/archive.h"
+
+#include <o3d/core/filemanager.h>
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <zlib.h>
+
+using namespace o3d;
+using namespace o3d::collada;
+
+namespace {
+
+//! Guard the mounted archives of the file manager, shared by every importer.
+std::mutex gArchiveMutex;
+
+//! Number of importers using each mounted archive.
+std::map<std::string, UInt32> gMountedArchives;
+
+//! Size of the output chunks of the decompression.
+const UInt32 INFLATE_CHUNK = 1 << 20;
+
+inline UInt32 readUInt16(const Char *p)
+{
+	const UInt8 *b = (const UInt8*)p;
+	return (UInt32)b[0] | ((UInt32)b[1] << 8);
+}
+
+inline UInt32 readUInt32(const Char *p)
+{
+	const UInt8 *b = (const UInt8*)p;
+	return (UInt32)b[0] | ((UInt32)b[1] << 8) | ((UInt32)b[2] << 16) | ((UInt32)b[3] << 24);
+}
+
+//! Inflate [data, data+size) to out, with the given zlib window bits.
+Bool inflateStream(const Char *data, UInt64 size, Int32 windowBits, std::string &out)
+{
+	z_stream stream;
+	memset(&stream, 0, sizeof(z_stream));
+
+	if (inflateInit2(&stream, windowBits) != Z_OK)
+		return False;
+
+	Int32 ret = Z_OK;
+	UInt64 consumed = 0;
+
+	// the input is given by chunks too, avail_in is only 32 bits
+	while (ret != Z_STREAM_END)
+	{
+		if (stream.avail_in == 0 && consumed < size)
+		{
+			UInt32 chunk = (UInt32)o3d::min<UInt64>(size - consumed, 1u << 30);
+			stream.next_in = (Bytef*)(data + consumed);
+			stream.avail_in = chunk;
+			consumed += chunk;
+		}
+
+		size_t pos = out.size();
+		out.resize(pos + INFLATE_CHUNK);
+
+		stream.next_out = (Bytef*)&out[pos];
+		stream.avail_out = INFLATE_CHUNK;
+
+		ret = inflate(&stream, Z_NO_FLUSH);
+
+		out.resize(pos + INFLATE_CHUNK - stream.avail_out);
+
+		if (ret == Z_STREAM_END)
+		{
+			// concatenated gzip members
+			if (windowBits > MAX_WBITS && (stream.avail_in > 0 || consumed < size))
+			{
+				if (inflateReset(&stream) != Z_OK)
+					break;
+
+				ret = Z_OK;
+			}
+		}
+		else if (ret != Z_OK || (stream.avail_in == 0 && consumed >= size && stream.avail_out != 0))
+		{
+			// error, or truncated stream
+			break;
+		}
+	}
+
+	inflateEnd(&stream);
+
+	return ret == Z_STREAM_END;
+}
+
+//! Does a string end with a suffix, ignoring the case.
+Bool endsWith(const String &str, const String &suffix)
+{
+	if (str.length() < suffix.length())
+		return False;
+
+	String end = str.sub(str.length() - suffix.length());
+	end.toLower();
+
+	return end == suffix;
+}
+
+} // anonymous namespace
+
+// Is a file name a gzip compressed document
+Bool o3d::collada::isGzipFile(const String &filename)
+{
+	return endsWith(filename, ".gz");
+}
+
+// Is a file name a zae archive
+Bool o3d::collada::isZaeFile(const String &filename)
+{
+	return endsWith(filename, ".zae");
+}
+
+// Decompress a whole gzip stream
+Bool o3d::collada::inflateGzip(const Char *data, UInt64 size, std::string &out)
+{
+	// the trailer gives the size modulo 4GB of the last member, a good reservation
+	if (size >= 18)
+		out.reserve(out.size() + readUInt32(data + size - 4));
+
+	// gzip header and trailer
+	return inflateStream(data, size, MAX_WBITS + 16, out);
+}
+
+// Mount an archive, once for every importer
+Bool o3d::collada::mountArchive(const String &filename)
+{
+	std::lock_guard<std::mutex> lock(gArchiveMutex);
+
+	const std::string key = filename.toUtf8().getData();
+	auto it = gMountedArchives.find(key);
+
+	if (it != gMountedArchives.end())
+	{
+		++it->second;
+		return True;
+	}
+
+	if (!FileManager::instance()->mountArchive(filename))
+		return False;
+
+	gMountedArchives[key] = 1;
+	return True;
+}
+
+// Release a mounted archive
+void o3d::collada::umountArchive(const String &filename)
+{
+	std::lock_guard<std::mutex> lock(gArchiveMutex);
+
+	auto it = gMountedArchives.find(filename.toUtf8().getData());
+	if (it == gMountedArchives.end())
+		return;
+
+	if (--it->second == 0)
+	{
+		FileManager::instance()->umountArchive(filename);
+		gMountedArchives.erase(it);
+	}
+}
+
+// Default ctor
+ZaeArchive::ZaeArchive()
+{
+}
+
+// Open an archive and read its central directory
+Bool ZaeArchive::open(const String &filename)
+{
+	close();
+	m_error = String();
+
+	if (!m_file.open(filename))
+		return fail("Unable to open the archive");
+
+	const Char *data = m_file.getData();
+	const UInt64 size = m_file.getSize();
+
+	// the end of central directory record is at the end, before a comment of at most 64KB
+	const UInt64 minPos = size > 65557 ? size - 65557 : 0;
+	const Char *eocd = nullptr;
+
+	for (UInt64 pos = size - 22; size >= 22; --pos)
+	{
+		if (readUInt32(data + pos) == 0x06054b50)
+		{
+			eocd = data + pos;
+			break;
+		}
+
+		if (pos == minPos)
+			break;
+	}
+
+	if (!eocd)
+	{
+		close();
+		return fail("Not a zip archive");
+	}
+
+	const UInt32 numEntries = readUInt16(eocd + 10);
+	const UInt64 cdSize = readUInt32(eocd + 12);
+	const UInt64 cdOffset = readUInt32(eocd + 16);
+
+	// zip64 is not supported, its end of central directory locator is just before
+	if (numEntries == 0xffff || cdSize == 0xffffffff || cdOffset == 0xffffffff ||
+		(eocd - data >= 20 && readUInt32(eocd - 20) == 0x07064b50))
+	{
+		close();
+		return fail("Zip64 archives are not supported");
+	}
+
+	if (cdOffset + cdSize > size)
+	{
+		close();
+		return fail("Invalid central directory");
+	}
+
+	const Char *p = data + cdOffset;
+	const Char *end = p + cdSize;
+
+	for (UInt32 i = 0; i < numEntries; ++i)
+	{
+		if (p + 46 > end || readUInt32(p) != 0x02014b50)
+			break;
+
+		const UInt32 nameLen = readUInt16(p + 28);
+		const UInt32 extraLen = readUInt16(p + 30);
+		const UInt32 commentLen = readUInt16(p + 32);
+
+		if (p + 46 + nameLen > end)
+			break;
+
+		Entry entry;
+		entry.method = readUInt16(p + 10);
+		entry.compressedSize = readUInt32(p + 20);
+		entry.size = readUInt32(p + 24);
+		entry.headerOffset = readUInt32(p + 42);
+
+		// the sizes or the offset of a zip64 entry are in its extra field
+		if (entry.compressedSize == 0xffffffff || entry.size == 0xffffffff || entry.headerOffset == 0xffffffff)
+		{
+			close();
+			return fail("Zip64 archives are not supported");
+		}
+
+		std::string name(p + 46, nameLen);
+
+		// directories have no content
+		if (!name.empty() && name.back() != '/')
+			m_entries[name] = entry;
+
+		p += 46 + nameLen + extraLen + commentLen;
+	}
+
+	return True;
+}
+
+// Close the archive
+void ZaeArchive::close()
+{
+	m_entries.clear();
+	m_file.close();
+}
+
+// Is there an entry
+Bool ZaeArchive::hasEntry(const String &name) const
+{
+	return m_entries.find(name.toUtf8().getData()) != m_entries.end();
+}
+
+// Decompress an entry
+Bool ZaeArchive::read(const String &name, std::string &out) const
+{
+	CIT_EntryMap it = m_entries.find(name.toUtf8().getData());
+	if (it == m_entries.end())
+		return fail(String("No entry ") + name);
+
+	const Entry &entry = it->second;
+
+	const Char *data = m_file.getData();
+	const UInt64 size = m_file.getSize();
+
+	// the local header can have a different extra field than the central directory
+	if (entry.headerOffset + 30 > size || readUInt32(data + entry.headerOffset) != 0x04034b50)
+		return fail(String("Invalid local header of ") + name);
+
+	const UInt64 offset = entry.headerOffset + 30 +
+			readUInt16(data + entry.headerOffset + 26) +
+			readUInt16(data + entry.headerOffset + 28);
+
+	if (offset + entry.compressedSize > size)
+		return fail(String("Truncated entry ") + name);
+
+	out.clear();
+
+	if (entry.method == 0)
+	{
+		out.assign(data + offset, entry.compressedSize);
+		return True;
+	}
+	else if (entry.method == 8)
+	{
+		out.reserve(entry.size);
+
+		// raw deflate, without zlib header
+		if (!inflateStream(data + offset, entry.compressedSize, -MAX_WBITS, out))
+			return fail(String("Unable to inflate the entry ") + name);
+
+		if (out.size() != entry.size)
+			return fail(String("Inflated size of the entry ") + name + " does not match the directory");
+
+		return True;
+	}
+
+	return fail(String("Unsupported compression method of the entry ") + name);
+}
+
+// Set the reason of a failure
+Bool ZaeArchive::fail(const String &error) const
+{
+	m_error = error;
+	return False;
+}
+
+// Get the path of the root document into the archive
+String ZaeArchive::getRootDocument() const
+{
+	std::string manifest;
+	if (read("manifest.xml", manifest))
+	{
+		size_t begin = manifest.find("<dae_root>");
+		size_t end = manifest.find("</dae_root>");
+
+		if (begin != std::string::npos && end != std::string::npos && end > begin)
+		{
+			std::string root = manifest.substr(begin + 10, end - begin - 10);
+
+			// trim, and remove a fragment and a leading ./
+			size_t first = root.find_first_not_of(" \t\r\n");
+			size_t last = root.find_last_not_of(" \t\r\n");
+			root = first == std::string::npos ? std::string() : root.substr(first, last - first + 1);
+
+			size_t fragment = root.find('#');
+			if (fragment != std::string::npos)
+				root.resize(fragment);
+
+			if (root.compare(0, 2, "./") == 0)
+				root.erase(0, 2);
+
+			if (m_entries.find(root) != m_entries.end())
+				return String(root.c_str());
+		}
+	}
+
+	// else the first document at the lowest depth
+	String result;
+	size_t depth = std::string::npos;
+
+	for (CIT_EntryMap it = m_entries.begin(); it != m_entries.end(); ++it)
+	{
+		const std::string &name = it->first;
+		if (name.size() < 4 || name.compare(name.size() - 4, 4, ".dae") != 0)
+			continue;
+
+		size_t d = (size_t)std::count(name.begin(), name.end(), '/');
+		if (d < depth)
+		{
+			depth = d;
+			result = name.c_str();
+		}
+	}
+
+	return result;
+}
@@ -0,0 +1,352 @@
+/**
+ * @file bonetexture.cpp
+ * @brief Implementation of bonetexture.h
+ * @author Frederic SCHERMA (frederic.scherma@dreamoverflow.org)
+ * @date 2026-10-18
+ * @copyright Copyright (c) 2001-2026 Dream Overflow. All rights reserved.
+ * @details
+ */
+
+#include "o3d/collada/precompiled.h"
+#include "o3d/collada/bonetexture.h"
+
+#include <cmath>
+#include <cstring>
+#include <string>
+
+using namespace o3d;
+using namespace o3d::collada;
+
+namespace {
+
+//! Signature and version of a written texture.
+const Char BONE_TEXTURE_MAGIC[8] = { 'O', '3', 'D', 'B', 'T', 'X', '0', '1' };
+//! Signature and version of a written library.
+const Char BONE_LIBRARY_MAGIC[8] = { 'O', '3', 'D', 'B', 'T', 'L', '0', '1' };
+
+//! Longest name read back, against a corrupted stream.
+const UInt32 MAX_NAME_LENGTH = 65536;
+//! Largest width and height read back, those of the largest textures of the GPUs.
+const UInt32 MAX_TEXTURE_SIZE = 16384;
+//! Most clips read back.
+const UInt32 MAX_CLIPS = 65536;
+
+Bool writeUInt32(OutStream &os, UInt32 value)
+{
+	return os.writer(&value, sizeof(UInt32), 1) == 1;
+}
+
+Bool writeFloat(OutStream &os, Float value)
+{
+	return os.writer(&value, sizeof(Float), 1) == 1;
+}
+
+//! Write a name as its UTF-8 length followed by its bytes.
+Bool writeName(OutStream &os, const String &name)
+{
+	const CString utf8 = name.toUtf8();
+	const UInt32 length = utf8.getData() ? (UInt32)std::strlen(utf8.getData()) : 0;
+
+	return writeUInt32(os, length) && (length == 0 || os.writer(utf8.getData(), 1, length) == length);
+}
+
+Bool readUInt32(InStream &is, UInt32 &value)
+{
+	return is.reader(&value, sizeof(UInt32), 1) == 1;
+}
+
+Bool readFloat(InStream &is, Float &value)
+{
+	return is.reader(&value, sizeof(Float), 1) == 1;
+}
+
+Bool readName(InStream &is, String &name)
+{
+	UInt32 length = 0;
+	if (!readUInt32(is, length) || length > MAX_NAME_LENGTH)
+		return False;
+
+	std::string utf8(length, '\0');
+	if (length > 0 && is.reader(&utf8[0], 1, length) != length)
+		return False;
+
+	name = String(utf8.c_str());
+	return True;
+}
+
+//! Unit quaternion (x y z w) of the rotation part of a row major 3x4 matrix, its
+//! axes being normalized to drop the scale.
+void toQuaternion(const Float *m, Float *q)
+{
+	Double r[3][3];
+	for (UInt32 c = 0; c < 3; ++c)
+	{
+		const Double len = std::sqrt(Double(m[c])*m[c] + Double(m[4+c])*m[4+c] + Double(m[8+c])*m[8+c]);
+		const Double inv = len > 0 ? 1.0 / len : 0.0;
+
+		for (UInt32 l = 0; l < 3; ++l)
+			r[l][c] = m[l*4+c] * inv;
+	}
+
+	Double x, y, z, w;
+	const Double trace = r[0][0] + r[1][1] + r[2][2];
+
+	if (trace > 0)
+	{
+		const Double s = 0.5 / std::sqrt(trace + 1.0);
+		w = 0.25 / s;
+		x = (r[2][1] - r[1][2]) * s;
+		y = (r[0][2] - r[2][0]) * s;
+		z = (r[1][0] - r[0][1]) * s;
+	}
+	else if (r[0][0] > r[1][1] && r[0][0] > r[2][2])
+	{
+		const Double s = 2.0 * std::sqrt(1.0 + r[0][0] - r[1][1] - r[2][2]);
+		w = (r[2][1] - r[1][2]) / s;
+		x = 0.25 * s;
+		y = (r[0][1] + r[1][0]) / s;
+		z = (r[0][2] + r[2][0]) / s;
+	}
+	else if (r[1][1] > r[2][2])
+	{
+		const Double s = 2.0 * std::sqrt(1.0 + r[1][1] - r[0][0] - r[2][2]);
+		w = (r[0][2] - r[2][0]) / s;
+		x = (r[0][1] + r[1][0]) / s;
+		y = 0.25 * s;
+		z = (r[1][2] + r[2][1]) / s;
+	}
+	else
+	{
+		const Double s = 2.0 * std::sqrt(1.0 + r[2][2] - r[0][0] - r[1][1]);
+		w = (r[1][0] - r[0][1]) / s;
+		x = (r[0][2] + r[2][0]) / s;
+		y = (r[1][2] + r[2][1]) / s;
+		z = 0.25 * s;
+	}
+
+	const Double len = std::sqrt(x*x + y*y + z*z + w*w);
+	const Double inv = len > 0 ? 1.0 / len : 0.0;
+
+	q[0] = Float(x * inv);
+	q[1] = Float(y * inv);
+	q[2] = Float(z * inv);
+	q[3] = Float(w * inv);
+}
+
+//! Dual quaternion (real then dual part) of a row major 3x4 matrix.
+void toDualQuaternion(const Float *m, Float *dq)
+{
+	Float *q = dq;
+	Float *d = dq + 4;
+
+	toQuaternion(m, q);
+
+	const Float tx = m[3], ty = m[7], tz = m[11];
+
+	// half of the translation quaternion times the rotation
+	d[0] = 0.5f * ( tx*q[3] + ty*q[2] - tz*q[1]);
+	d[1] = 0.5f * (-tx*q[2] + ty*q[3] + tz*q[0]);
+	d[2] = 0.5f * ( tx*q[1] - ty*q[0] + tz*q[3]);
+	d[3] = -0.5f * (tx*q[0] + ty*q[1] + tz*q[2]);
+}
+
+} // anonymous namespace
+
+// Default ctor
+BoneTexture::BoneTexture(Format format) :
+	m_format(format),
+	m_height(0)
+{
+}
+
+// Set the names of the bones
+void BoneTexture::setBones(const std::vector<String> &names)
+{
+	m_bones = names;
+	m_clips.clear();
+	m_texels.clear();
+	m_height = 0;
+}
+
+// Append the frames of a clip as rows
+void BoneTexture::addClip(const String &name, Float duration, Float sampleRate, UInt32 numFrames, const Float *matrices)
+{
+	const UInt32 numBones = getNumBones();
+	const UInt32 width = getWidth();
+
+	Clip clip;
+	clip.name = name;
+	clip.firstRow = m_height;
+	clip.numFrames = numFrames;
+	clip.duration = duration;
+	clip.sampleRate = sampleRate;
+
+	m_clips.push_back(clip);
+
+	m_texels.resize(size_t(m_height + numFrames) * width * 4);
+	Float *texels = &m_texels[size_t(m_height) * width * 4];
+
+	for (UInt32 f = 0; f < numFrames; ++f)
+	{
+		for (UInt32 b = 0; b < numBones; ++b)
+		{
+			const Float *matrix = matrices + (size_t(f) * numBones + b) * 12;
+			Float *texel = texels + (size_t(f) * width + b * getTexelsPerBone()) * 4;
+
+			if (m_format == MATRICES)
+			{
+				std::memcpy(texel, matrix, sizeof(Float) * 12);
+			}
+			else
+			{
+				toDualQuaternion(matrix, texel);
+
+				// on the hemisphere of the previous frame, for the interpolation
+				if (f > 0)
+				{
+					const Float *prev = texel - size_t(width) * 4;
+					if (prev[0]*texel[0] + prev[1]*texel[1] + prev[2]*texel[2] + prev[3]*texel[3] < 0.f)
+					{
+						for (UInt32 k = 0; k < 8; ++k)
+							texel[k] = -texel[k];
+					}
+				}
+			}
+		}
+	}
+
+	m_height += numFrames;
+}
+
+// Write the metadata table then the texels
+Bool BoneTexture::writeToStream(OutStream &os) const
+{
+	if (os.writer(BONE_TEXTURE_MAGIC, 1, sizeof(BONE_TEXTURE_MAGIC)) != sizeof(BONE_TEXTURE_MAGIC))
+		return False;
+
+	if (!writeName(os, m_name) ||
+		!writeUInt32(os, (UInt32)m_format) ||
+		!writeUInt32(os, getNumBones()) ||
+		!writeUInt32(os, getWidth()) ||
+		!writeUInt32(os, m_height) ||
+		!writeUInt32(os, (UInt32)m_clips.size()))
+		return False;
+
+	for (const Clip &clip : m_clips)
+	{
+		if (!writeName(os, clip.name) ||
+			!writeUInt32(os, clip.firstRow) ||
+			!writeUInt32(os, clip.numFrames) ||
+			!writeFloat(os, clip.duration) ||
+			!writeFloat(os, clip.sampleRate))
+			return False;
+	}
+
+	for (const String &bone : m_bones)
+	{
+		if (!writeName(os, bone))
+			return False;
+	}
+
+	const UInt32 count = (UInt32)m_texels.size();
+	return count == 0 || os.writer(m_texels.data(), sizeof(Float), count) == count;
+}
+
+// Read the metadata table and the texels
+Bool BoneTexture::readFromStream(InStream &is)
+{
+	Char magic[sizeof(BONE_TEXTURE_MAGIC)];
+	if (is.reader(magic, 1, sizeof(magic)) != sizeof(magic) ||
+		std::memcmp(magic, BONE_TEXTURE_MAGIC, sizeof(magic)) != 0)
+		return False;
+
+	UInt32 format = 0, numBones = 0, width = 0, height = 0, numClips = 0;
+
+	if (!readName(is, m_name) ||
+		!readUInt32(is, format) ||
+		!readUInt32(is, numBones) ||
+		!readUInt32(is, width) ||
+		!readUInt32(is, height) ||
+		!readUInt32(is, numClips))
+		return False;
+
+	if (format > DUAL_QUATERNIONS)
+		return False;
+
+	m_format = (Format)format;
+
+	// against a corrupted stream, before any allocation
+	if (width > MAX_TEXTURE_SIZE || height > MAX_TEXTURE_SIZE || numClips > MAX_CLIPS)
+		return False;
+
+	if (numBones > width || width != numBones * getTexelsPerBone())
+		return False;
+
+	m_clips.resize(numClips);
+	for (Clip &clip : m_clips)
+	{
+		if (!readName(is, clip.name) ||
+			!readUInt32(is, clip.firstRow) ||
+			!readUInt32(is, clip.numFrames) ||
+			!readFloat(is, clip.duration) ||
+			!readFloat(is, clip.sampleRate))
+			return False;
+
+		if ((UInt64)clip.firstRow + clip.numFrames > height)
+			return False;
+	}
+
+	m_bones.resize(numBones);
+	for (String &bone : m_bones)
+	{
+		if (!readName(is, bone))
+			return False;
+	}
+
+	m_height = height;
+	m_texels.resize(size_t(width) * height * 4);
+
+	const UInt32 count = (UInt32)m_texels.size();
+	return count == 0 || is.reader(m_texels.data(), sizeof(Float), count) == count;
+}
+
+// Get or create the texture of a skinning
+BoneTexture& BoneTextureLibrary::get(const o3d::Skinning *skinning, BoneTexture::Format format)
+{
+	auto it = m_textures.find(skinning);
+	if (it != m_textures.end())
+		return it->second;
+
+	m_order.push_back(skinning);
+	return m_textures.insert(std::make_pair(skinning, BoneTexture(format))).first->second;
+}
+
+const BoneTexture* BoneTextureLibrary::find(const o3d::Skinning *skinning) const
+{
+	auto it = m_textures.find(skinning);
+	return it != m_textures.end() ? &it->second : nullptr;
+}
+
+// Write the number of textures followed by each of them
+Bool BoneTextureLibrary::writeToStream(OutStream &os) const
+{
+	if (os.writer(BONE_LIBRARY_MAGIC, 1, sizeof(BONE_LIBRARY_MAGIC)) != sizeof(BONE_LIBRARY_MAGIC))
+		return False;
+
+	if (!writeUInt32(os, (UInt32)m_order.size()))
+		return False;
+
+	for (const o3d::Skinning *skinning : m_order)
+	{
+		if (!m_textures.find(skinning)->second.writeToStream(os))
+			return False;
+	}
+
+	return True;
+}
+
+void BoneTextureLibrary::clear()
+{
+	m_textures.clear();
+	m_order.clear();
+}
@@ -0,0 +1,583 @@
+/**
+ * @file bvh.cpp
+ * @brief Implementation of bvh.h
+ * @author Frederic SCHERMA (frederic.scherma@dreamoverflow.org)
+ * @date 2026-10-18
+ * @copyright Copyright (c) 2001-2026 Dream Overflow. All rights reserved.
+ * @details
+ */
+
+#include "o3d/collada/precompiled.h"
+#include "o3d/collada/bvh.h"
+
+#include <o3d/engine/hierarchy/node.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <thread>
+
+using namespace o3d;
+using namespace o3d::collada;
+
+namespace {
+
+//! Number of bins of the surface area heuristic, per axis.
+const UInt32 NUM_BINS = 12;
+//! Maximal number of primitives of a leaf, even if cheaper to split.
+const UInt32 MAX_LEAF_PRIMITIVES = 4;
+//! Maximal number of primitives of a leaf chosen by the heuristic.
+const UInt32 MAX_SAH_LEAF_PRIMITIVES = 16;
+//! Minimal number of primitives of a sub-tree built on another thread.
+const UInt32 PARALLEL_MIN_PRIMITIVES = 4096;
+
+//! Signature and version of a written hierarchy.
+const Char BVH_MAGIC[8] = { 'O', '3', 'D', 'B', 'V', 'H', '0', '1' };
+
+//! Bounds being accumulated.
+struct Bounds
+{
+	Float bmin[3];
+	Float bmax[3];
+
+	Bounds()
+	{
+		for (UInt32 k = 0; k < 3; ++k)
+		{
+			bmin[k] = std::numeric_limits<Float>::max();
+			bmax[k] = -std::numeric_limits<Float>::max();
+		}
+	}
+
+	inline void grow(const Float *pmin, const Float *pmax)
+	{
+		for (UInt32 k = 0; k < 3; ++k)
+		{
+			bmin[k] = o3d::min(bmin[k], pmin[k]);
+			bmax[k] = o3d::max(bmax[k], pmax[k]);
+		}
+	}
+
+	inline void grow(const Bounds &b) { grow(b.bmin, b.bmax); }
+
+	//! Half of the surface area, 0 if empty.
+	inline Float area() const
+	{
+		const Float x = bmax[0] - bmin[0], y = bmax[1] - bmin[1], z = bmax[2] - bmin[2];
+		return (x < 0.f) ? 0.f : x*y + y*z + z*x;
+	}
+};
+
+//! Top-down builder, with the sub-trees built concurrently.
+struct BvhBuilder
+{
+	const Float *boxes;
+	std::vector<Float> centers;
+	std::vector<Bvh::Node> &nodes;
+	std::vector<UInt32> &primitives;
+	std::atomic<UInt32> numNodes;
+
+	BvhBuilder(const Float *_boxes, UInt32 num, std::vector<Bvh::Node> &_nodes, std::vector<UInt32> &_primitives) :
+		boxes(_boxes),
+		centers(num*3),
+		nodes(_nodes),
+		primitives(_primitives),
+		numNodes(1)
+	{
+		for (UInt32 i = 0; i < num; ++i)
+			for (UInt32 k = 0; k < 3; ++k)
+				centers[i*3+k] = (boxes[i*6+k] + boxes[i*6+3+k]) * 0.5f;
+	}
+
+	//! Set the bounds of a node and split it, recursively.
+	void subdivide(UInt32 nodeIndex, UInt32 first, UInt32 count, UInt32 numThreads)
+	{
+		Bounds bounds, centroids;
+		for (UInt32 i = first; i < first + count; ++i)
+		{
+			const UInt32 p = primitives[i];
+			bounds.grow(boxes + p*6, boxes + p*6 + 3);
+			centroids.grow(&centers[p*3], &centers[p*3]);
+		}
+
+		Bvh::Node &node = nodes[nodeIndex];
+		std::memcpy(node.bmin, bounds.bmin, sizeof(node.bmin));
+		std::memcpy(node.bmax, bounds.bmax, sizeof(node.bmax));
+		node.leftFirst = first;
+		node.count = count;
+
+		if (count <= MAX_LEAF_PRIMITIVES)
+			return;
+
+		// best split plane of the binned heuristic
+		Float bestCost = std::numeric_limits<Float>::max();
+		UInt32 bestAxis = 0, bestBin = 0;
+
+		for (UInt32 axis = 0; axis < 3; ++axis)
+		{
+			const Float extent = centroids.bmax[axis] - centroids.bmin[axis];
+			if (extent <= 0.f)
+				continue;
+
+			const Float scale = NUM_BINS / extent;
+
+			Bounds bins[NUM_BINS];
+			UInt32 counts[NUM_BINS] = { 0 };
+
+			for (UInt32 i = first; i < first + count; ++i)
+			{
+				const UInt32 p = primitives[i];
+				const UInt32 b = o3d::min<UInt32>(NUM_BINS-1, (UInt32)((centers[p*3+axis] - centroids.bmin[axis]) * scale));
+
+				bins[b].grow(boxes + p*6, boxes + p*6 + 3);
+				++counts[b];
+			}
+
+			// costs of the planes after each bin, swept from both sides
+			Float leftArea[NUM_BINS-1], rightArea[NUM_BINS-1];
+			UInt32 leftCount[NUM_BINS-1], rightCount[NUM_BINS-1];
+			Bounds left, right;
+			UInt32 leftSum = 0, rightSum = 0;
+
+			for (UInt32 b = 0; b < NUM_BINS-1; ++b)
+			{
+				left.grow(bins[b]);
+				leftSum += counts[b];
+				leftArea[b] = left.area();
+				leftCount[b] = leftSum;
+
+				right.grow(bins[NUM_BINS-1-b]);
+				rightSum += counts[NUM_BINS-1-b];
+				rightArea[NUM_BINS-2-b] = right.area();
+				rightCount[NUM_BINS-2-b] = rightSum;
+			}
+
+			for (UInt32 b = 0; b < NUM_BINS-1; ++b)
+			{
+				const Float cost = leftArea[b]*leftCount[b] + rightArea[b]*rightCount[b];
+				if (leftCount[b] > 0 && rightCount[b] > 0 && cost < bestCost)
+				{
+					bestCost = cost;
+					bestAxis = axis;
+					bestBin = b;
+				}
+			}
+		}
+
+		UInt32 numLeft = 0;
+
+		if (bestCost < std::numeric_limits<Float>::max())
+		{
+			// a leaf is cheaper for a few primitives
+			if (count <= MAX_SAH_LEAF_PRIMITIVES && bestCost >= bounds.area() * count)
+				return;
+
+			const Float scale = NUM_BINS / (centroids.bmax[bestAxis] - centroids.bmin[bestAxis]);
+			UInt32 *begin = &primitives[first];
+
+			numLeft = (UInt32)(std::partition(begin, begin + count, [&](UInt32 p) {
+				return o3d::min<UInt32>(NUM_BINS-1, (UInt32)((centers[p*3+bestAxis] - centroids.bmin[bestAxis]) * scale)) <= bestBin;
+			}) - begin);
+		}
+
+		// coincident centers, or a rounding making a side empty: split at the median
+		if (numLeft == 0 || numLeft == count)
+		{
+			UInt32 axis = 0;
+			for (UInt32 k = 1; k < 3; ++k)
+				if (bounds.bmax[k] - bounds.bmin[k] > bounds.bmax[axis] - bounds.bmin[axis])
+					axis = k;
+
+			numLeft = count / 2;
+			UInt32 *begin = &primitives[first];
+
+			std::nth_element(begin, begin + numLeft, begin + count, [&](UInt32 a, UInt32 b) {
+				return centers[a*3+axis] < centers[b*3+axis] || (centers[a*3+axis] == centers[b*3+axis] && a < b);
+			});
+		}
+
+		const UInt32 leftIndex = numNodes.fetch_add(2);
+		node.leftFirst = leftIndex;
+		node.count = 0;
+
+		if (numThreads > 1 && count >= PARALLEL_MIN_PRIMITIVES)
+		{
+			const UInt32 leftThreads = numThreads / 2;
+
+			std::thread worker([this, leftIndex, first, numLeft, leftThreads]() {
+				subdivide(leftIndex, first, numLeft, leftThreads);
+			});
+
+			subdivide(leftIndex + 1, first + numLeft, count - numLeft, numThreads - leftThreads);
+			worker.join();
+		}
+		else
+		{
+			subdivide(leftIndex, first, numLeft, 1);
+			subdivide(leftIndex + 1, first + numLeft, count - numLeft, 1);
+		}
+	}
+};
+
+//! Distance of entry of a ray into a box, or a negative value if missed.
+inline Float intersectRay(
+	const Float *bmin,
+	const Float *bmax,
+	const Float *origin,
+	const Float *invDir,
+	Float maxDistance)
+{
+	Float tmin = 0.f, tmax = maxDistance;
+
+	for (UInt32 k = 0; k < 3; ++k)
+	{
+		Float t0 = (bmin[k] - origin[k]) * invDir[k];
+		Float t1 = (bmax[k] - origin[k]) * invDir[k];
+		if (t0 > t1)
+			std::swap(t0, t1);
+
+		// the NaN of an origin on a plane parallel to the ray keeps the previous values
+		tmin = t0 > tmin ? t0 : tmin;
+		tmax = t1 < tmax ? t1 : tmax;
+	}
+
+	return tmin <= tmax ? tmin : -1.f;
+}
+
+inline Bool overlapBox(const Float *amin, const Float *amax, const Float *bmin, const Float *bmax)
+{
+	return amin[0] <= bmax[0] && amax[0] >= bmin[0] &&
+		   amin[1] <= bmax[1] && amax[1] >= bmin[1] &&
+		   amin[2] <= bmax[2] && amax[2] >= bmin[2];
+}
+
+} // anonymous namespace
+
+// Build the hierarchy of the boxes of the primitives
+void Bvh::build(const Float *boxes, UInt32 numPrimitives, UInt32 numThreads)
+{
+	clear();
+
+	if (numPrimitives == 0)
+		return;
+
+	m_primitives.resize(numPrimitives);
+	for (UInt32 i = 0; i < numPrimitives; ++i)
+		m_primitives[i] = i;
+
+	// at most 2n-1 nodes, the root alone in its pair
+	m_nodes.resize(numPrimitives * 2);
+
+	BvhBuilder builder(boxes, numPrimitives, m_nodes, m_primitives);
+	builder.subdivide(0, 0, numPrimitives, o3d::max<UInt32>(1, numThreads));
+
+	m_nodes.resize(builder.numNodes);
+	m_nodes.shrink_to_fit();
+
+	// the boxes in the order of the leaves, tested by the queries
+	m_boxes.resize(numPrimitives * 6);
+	for (UInt32 i = 0; i < numPrimitives; ++i)
+		std::memcpy(&m_boxes[i*6], boxes + m_primitives[i]*6, sizeof(Float)*6);
+}
+
+void Bvh::clear()
+{
+	m_nodes.clear();
+	m_primitives.clear();
+	m_boxes.clear();
+}
+
+// Collect the primitives hit by a ray
+void Bvh::raycast(
+	const Float *origin,
+	const Float *direction,
+	Float maxDistance,
+	std::vector<std::pair<Float, UInt32> > &hits) const
+{
+	if (m_nodes.empty())
+		return;
+
+	const size_t firstHit = hits.size();
+
+	Float invDir[3];
+	for (UInt32 k = 0; k < 3; ++k)
+		invDir[k] = direction[k] != 0.f ? 1.f / direction[k] :
+			(std::signbit(direction[k]) ? -std::numeric_limits<Float>::infinity() : std::numeric_limits<Float>::infinity());
+
+	std::vector<UInt32> stack;
+	stack.push_back(0);
+
+	while (!stack.empty())
+	{
+		const Node &node = m_nodes[stack.back()];
+		stack.pop_back();
+
+		if (intersectRay(node.bmin, node.bmax, origin, invDir, maxDistance) < 0.f)
+			continue;
+
+		if (node.isLeaf())
+		{
+			for (UInt32 i = node.leftFirst; i < node.leftFirst + node.count; ++i)
+			{
+				const Float t = intersectRay(&m_boxes[i*6], &m_boxes[i*6+3], origin, invDir, maxDistance);
+				if (t >= 0.f)
+					hits.push_back(std::make_pair(t, m_primitives[i]));
+			}
+		}
+		else
+		{
+			stack.push_back(node.leftFirst);
+			stack.push_back(node.leftFirst + 1);
+		}
+	}
+
+	std::sort(hits.begin() + firstHit, hits.end());
+}
+
+// Collect the primitives overlapping a box
+void Bvh::overlap(const Float *bmin, const Float *bmax, std::vector<UInt32> &primitives) const
+{
+	if (m_nodes.empty())
+		return;
+
+	std::vector<UInt32> stack;
+	stack.push_back(0);
+
+	while (!stack.empty())
+	{
+		const Node &node = m_nodes[stack.back()];
+		stack.pop_back();
+
+		if (!overlapBox(node.bmin, node.bmax, bmin, bmax))
+			continue;
+
+		if (node.isLeaf())
+		{
+			for (UInt32 i = node.leftFirst; i < node.leftFirst + node.count; ++i)
+			{
+				if (overlapBox(&m_boxes[i*6], &m_boxes[i*6+3], bmin, bmax))
+					primitives.push_back(m_primitives[i]);
+			}
+		}
+		else
+		{
+			stack.push_back(node.leftFirst);
+			stack.push_back(node.leftFirst + 1);
+		}
+	}
+}
+
+// Write the nodes, the primitives and their boxes as they are in memory
+Bool Bvh::writeToStream(OutStream &os) const
+{
+	const UInt32 counts[2] = { (UInt32)m_nodes.size(), (UInt32)m_primitives.size() };
+
+	if (os.writer(BVH_MAGIC, 1, sizeof(BVH_MAGIC)) != sizeof(BVH_MAGIC))
+		return False;
+	if (os.writer(counts, sizeof(UInt32), 2) != 2)
+		return False;
+
+	if (counts[0] > 0 && os.writer(m_nodes.data(), sizeof(Node), counts[0]) != counts[0])
+		return False;
+	if (counts[1] > 0 && os.writer(m_primitives.data(), sizeof(UInt32), counts[1]) != counts[1])
+		return False;
+	if (counts[1] > 0 && os.writer(m_boxes.data(), sizeof(Float), counts[1]*6) != counts[1]*6)
+		return False;
+
+	return True;
+}
+
+// Read the nodes, the primitives and their boxes
+Bool Bvh::readFromStream(InStream &is)
+{
+	clear();
+
+	Char magic[sizeof(BVH_MAGIC)];
+	UInt32 counts[2] = { 0, 0 };
+
+	if (is.reader(magic, 1, sizeof(magic)) != sizeof(magic) ||
+		std::memcmp(magic, BVH_MAGIC, sizeof(magic)) != 0)
+		return False;
+
+	if (is.reader(counts, sizeof(UInt32), 2) != 2)
+		return False;
+
+	m_nodes.resize(counts[0]);
+	m_primitives.resize(counts[1]);
+	m_boxes.resize(counts[1] * 6);
+
+	if ((counts[0] > 0 && is.reader(m_nodes.data(), sizeof(Node), counts[0]) != counts[0]) ||
+		(counts[1] > 0 && is.reader(m_primitives.data(), sizeof(UInt32), counts[1]) != counts[1]) ||
+		(counts[1] > 0 && is.reader(m_boxes.data(), sizeof(Float), counts[1]*6) != counts[1]*6))
+	{
+		clear();
+		return False;
+	}
+
+	// reject the references out of range
+	for (const Node &node : m_nodes)
+	{
+		const Bool valid = node.isLeaf() ?
+			(UInt64)node.leftFirst + node.count <= counts[1] :
+			(UInt64)node.leftFirst + 2 <= counts[0];
+
+		if (!valid)
+		{
+			clear();
+			return False;
+		}
+	}
+
+	return True;
+}
+
+// Set the local bounds of a mesh data
+void SceneBvh::setMeshBounds(const String &resourceName, const Float *bmin, const Float *bmax)
+{
+	MeshBounds &bounds = m_meshBounds[resourceName];
+	std::memcpy(bounds.bmin, bmin, sizeof(bounds.bmin));
+	std::memcpy(bounds.bmax, bmax, sizeof(bounds.bmax));
+}
+
+// Build the hierarchy over the triangles of a mesh data
+void SceneBvh::buildMeshBvh(
+	const String &resourceName,
+	const Float *vertices,
+	const std::vector<const UInt16*> &faces16,
+	const std::vector<const UInt32*> &faces32,
+	const std::vector<UInt32> &numIndices,
+	UInt32 numThreads)
+{
+	UInt32 numTriangles = 0;
+	for (size_t i = 0; i < numIndices.size(); ++i)
+		numTriangles += numIndices[i] / 3;
+
+	std::vector<Float> boxes(numTriangles * 6);
+	Float *box = boxes.data();
+
+	for (size_t i = 0; i < numIndices.size(); ++i)
+	{
+		for (UInt32 t = 0; t + 2 < numIndices[i]; t += 3)
+		{
+			for (UInt32 k = 0; k < 3; ++k)
+			{
+				const Float *p = nullptr;
+
+				if (faces16[i])
+					p = vertices + faces16[i][t+k]*3;
+				else if (faces32[i])
+					p = vertices + faces32[i][t+k]*3;
+				else
+					break;
+
+				for (UInt32 c = 0; c < 3; ++c)
+				{
+					box[c] = k == 0 ? p[c] : o3d::min(box[c], p[c]);
+					box[c+3] = k == 0 ? p[c] : o3d::max(box[c+3], p[c]);
+				}
+			}
+
+			box += 6;
+		}
+	}
+
+	m_meshBvhs[resourceName].build(boxes.data(), numTriangles, numThreads);
+}
+
+// Add an object using a mesh data
+void SceneBvh::addInstance(o3d::BaseNode *object, o3d::Node *node, const String &resourceName)
+{
+	Instance instance;
+	instance.object = object;
+	instance.node = node;
+	instance.meshData = resourceName;
+
+	for (UInt32 k = 0; k < 3; ++k)
+		instance.bmin[k] = instance.bmax[k] = 0.f;
+
+	m_pending.push_back(instance);
+}
+
+// Compute the world bounds of the added objects and build the hierarchy
+void SceneBvh::build(UInt32 numThreads)
+{
+	for (Instance &instance : m_pending)
+	{
+		auto it = m_meshBounds.find(instance.meshData);
+		if (it == m_meshBounds.end())
+			continue;
+
+		// world transform, from the parents transforms
+		Matrix4 world;
+		for (o3d::BaseNode *parent = instance.node; parent; parent = parent->getNode())
+		{
+			o3d::Node *node = dynamic_cast<o3d::Node*>(parent);
+			if (node && node->getTransform())
+				world = node->getTransform()->getMatrix() * world;
+		}
+
+		const MeshBounds &local = it->second;
+		Bounds bounds;
+
+		for (UInt32 c = 0; c < 8; ++c)
+		{
+			const Vector3 corner(
+					(c & 1) ? local.bmax[0] : local.bmin[0],
+					(c & 2) ? local.bmax[1] : local.bmin[1],
+					(c & 4) ? local.bmax[2] : local.bmin[2]);
+
+			const Vector3 p = world * corner;
+			const Float point[3] = { p[X], p[Y], p[Z] };
+
+			bounds.grow(point, point);
+		}
+
+		std::memcpy(instance.bmin, bounds.bmin, sizeof(instance.bmin));
+		std::memcpy(instance.bmax, bounds.bmax, sizeof(instance.bmax));
+
+		m_instances.push_back(instance);
+	}
+
+	m_pending.clear();
+
+	// rebuilt over every object, a few thousands of them at most
+	std::vector<Float> boxes(m_instances.size() * 6);
+	for (size_t i = 0; i < m_instances.size(); ++i)
+	{
+		std::memcpy(&boxes[i*6], m_instances[i].bmin, sizeof(Float)*3);
+		std::memcpy(&boxes[i*6+3], m_instances[i].bmax, sizeof(Float)*3);
+	}
+
+	m_bvh.build(boxes.data(), static_cast<UInt32>(m_instances.size()), numThreads);
+}
+
+void SceneBvh::clear()
+{
+	m_meshBounds.clear();
+	m_meshBvhs.clear();
+	m_pending.clear();
+	m_instances.clear();
+	m_bvh.clear();
+}
+
+// Get the hierarchy over the triangles of a mesh data
+const Bvh* SceneBvh::getMeshBvh(const String &resourceName) const
+{
+	auto it = m_meshBvhs.find(resourceName);
+	return it != m_meshBvhs.end() ? &it->second : nullptr;
+}
+
+// Collect the objects hit by a ray
+void SceneBvh::pick(
+	const Float *origin,
+	const Float *direction,
+	std::vector<const Instance*> &instances) const
+{
+	std::vector<std::pair<Float, UInt32> > hits;
+	m_bvh.raycast(origin, direction, std::numeric_limits<Float>::max(), hits);
+
+	for (const std::pair<Float, UInt32> &hit : hits)
+		instances.push_back(&m_instances[hit.second]);
+}
@@ -11,30 +11,61 @@
 #include "o3d/collada/collada.h"
 #include "o3d/collada/controller.h"
 #include "o3d/collada/node.h"
+#include "o3d/collada/mappedfile.h"
+#include "o3d/collada/archive.h"
+
+#include <o3d/core/error.h>
+#include <o3d/core/filemanager.h>
+#include <o3d/core/fileoutstream.h>
 
 #include <o3d/engine/animation/animation.h>
 #include <o3d/engine/animation/animationmanager.h>
+#include <o3d/engine/animation/animationnode.h>
 #include <o3d/engine/animation/animationplayermanager.h>
 #include <o3d/engine/scene/scene.h>
 #include <o3d/engine/hierarchy/hierarchytree.h>
+#include <o3d/engine/object/bones.h>
+#include <o3d/engine/object/skin.h>
+
+#include <cmath>
+#include <cstring>
+#include <exception>
 
 using namespace o3d;
 using namespace o3d::collada;
 
-Int32 triangulate(DAE *_dae);
+void triangulate(domGeometry *thisGeometry);
 
 // ctor
 Collada::Collada() :
     m_scene(nullptr),
     m_doc(nullptr),
-    m_dom(nullptr)
+    m_dom(nullptr),
+    m_global(nullptr),
+	m_numericArrays(nullptr),
+	m_importData(nullptr),
+	m_importSize(0),
+	m_stage(IMPORT_IDLE),
+	m_stageIndex(0),
+	m_stageCount(0),
+	m_totalEntry(0),
+	m_totalOpened(False),
+	m_loaded(false),
+	m_loadFailed(False)
 {
+	m_info.setLibraries(&m_meshlets, &m_sceneBvh, &m_animatedBounds, &m_boneTextures);
 }
 
 // dtor
 Collada::~Collada()
 {
+	if (m_worker.joinable())
+		m_worker.join();
 
+	abortImport();
+
+	if (m_mountedArchive.isValid())
+		umountArchive(m_mountedArchive);
 }
 
 // Define the o3d scene
@@ -42,147 +73,909 @@ void Collada::setScene(o3d::Scene *scene)
 {
 	m_scene = scene;
 	O3D_ASSERT(m_scene);
+
+	m_exporter.setScene(scene);
 }
 
-// Run the import processing
+// Define an import session
+void Collada::setSession(ColladaSession *session)
+{
+	m_info.setSession(session);
+
+	if (session)
+		setScene(session->getScene());
+}
+
+// Release any reference to the document, close and delete it
+void Collada::releaseDocument(const String &filename)
+{
+	DaeLock lock;
+
+	// the imported objects keep smart references onto DOM elements that
+	// maintain them alive even once the document is closed
+	if (m_global)
+		m_global->releaseDom();
+
+	for (IT_RootNodeList it = m_rootNodes.begin(); it != m_rootNodes.end(); ++it)
+		(*it)->releaseDom();
+
+	for (IT_AnimationList it = m_animationList.begin(); it != m_animationList.end(); ++it)
+		(*it)->releaseDom();
+
+	m_doc->close(filename.toUtf8().getData());
+	m_dom = nullptr;
+
+	m_info.setNumericArrays(nullptr);
+	deletePtr(m_numericArrays);
+
+	// the database of a session is kept with the documents it references
+	if (m_info.getSession())
+		m_doc = nullptr;
+	else
+		deleteDAE(m_doc);
+}
+
+// Open the imported document
+domCOLLADA* Collada::openDocument()
+{
+	MappedFile file;
+	std::string text;           // decompressed document
+	const Char *data = nullptr;
+	UInt64 size = 0;
+
+	if (m_importData)
+	{
+		// a document in memory, possibly compressed
+		if (isGzipFile(m_importFileName))
+		{
+			ProfileScope scope(m_info.getProfiler(), "inflate", m_info.getFileName());
+
+			if (!inflateGzip(m_importData, m_importSize, text))
+				return nullptr;
+		}
+		// COLLADA-DOM needs a null terminated text
+		else if (!m_info.getFastParsing())
+			text.assign(m_importData, (size_t)m_importSize);
+
+		data = text.size() ? text.data() : m_importData;
+		size = text.size() ? text.size() : m_importSize;
+	}
+	else if (isZaeFile(m_importFileName))
+	{
+		ZaeArchive archive;
+		if (!archive.open(m_importFileName))
+		{
+			O3D_WARNING(m_importFileName + ": " + archive.getError());
+			return nullptr;
+		}
+
+		String root = archive.getRootDocument();
+		if (root.isEmpty())
+		{
+			O3D_WARNING(m_importFileName + ": no root document");
+			return nullptr;
+		}
+
+		{
+			ProfileScope scope(m_info.getProfiler(), "inflate", m_info.getFileName());
+			if (!archive.read(root, text))
+			{
+				O3D_WARNING(m_importFileName + ": " + archive.getError());
+				return nullptr;
+			}
+		}
+
+		// the document is named as into the archive, which is mounted to load the textures
+		// from, the base path of the textures is relative to the root document
+		m_documentUri = m_importFileName + '/' + root;
+
+		String archivePath = m_importFileName;
+		archivePath.truncate(archivePath.reverseFind('/') + 1);
+
+		Int32 pos = root.reverseFind('/');
+		m_info.setFilePath(archivePath + (pos >= 0 ? root.sub(0, pos + 1) : String()));
+
+		if (m_mountedArchive != m_importFileName)
+		{
+			if (m_mountedArchive.isValid())
+				umountArchive(m_mountedArchive);
+
+			m_mountedArchive = mountArchive(m_importFileName) ? m_importFileName : String();
+		}
+
+		data = text.data();
+		size = text.size();
+	}
+	else if (isGzipFile(m_importFileName))
+	{
+		if (!file.open(m_importFileName))
+			return nullptr;
+
+		ProfileScope scope(m_info.getProfiler(), "inflate", m_info.getFileName());
+
+		if (!inflateGzip(file.getData(), file.getSize(), text))
+			return nullptr;
+
+		file.close();
+
+		data = text.data();
+		size = text.size();
+	}
+	else if (m_info.getFastParsing() && file.open(m_importFileName))
+	{
+		data = file.getData();
+		size = file.getSize();
+	}
+
+	const std::string uri = m_documentUri.toUtf8().getData();
+
+	if (data && m_info.getFastParsing())
+	{
+		NumericArrays *arrays = new NumericArrays;
+		std::string document;
+
+		Bool extracted;
+		{
+			ProfileScope scope(m_info.getProfiler(), "numbers", m_info.getFileName());
+			extracted = arrays->extract(data, size, m_info.getParseThreads(), document);
+		}
+
+		// COLLADA-DOM only parses the remaining text, with the URI of the document
+		if (extracted)
+		{
+			file.close();
+			std::string().swap(text);
+
+			DaeLock lock;
+
+			domCOLLADA *dom = (domCOLLADA*)m_doc->openFromMemory(uri, document.c_str());
+			if (dom)
+			{
+				arrays->setDocument(dom->getDocument());
+
+				m_numericArrays = arrays;
+				m_info.setNumericArrays(arrays);
+
+				return dom;
+			}
+		}
+
+		deletePtr(arrays);
+	}
+
+	DaeLock lock;
+
+	// a decompressed document is parsed from memory
+	if (text.size())
+		return (domCOLLADA*)m_doc->openFromMemory(uri, text.c_str());
+
+	return (domCOLLADA*)m_doc->open(uri);
+}
+
+// Run the import processing at once
 Bool Collada::processImport(const String &filename)
 {
-	m_doc = new DAE();
+	if (!beginImport(filename))
+		return False;
+
+	return step(0) == IMPORT_DONE;
+}
+
+// Run the import processing at once, of a document in memory
+Bool Collada::processImport(const Char *data, UInt64 size, const String &name)
+{
+	if (!beginImport(data, size, name))
+		return False;
+
+	return step(0) == IMPORT_DONE;
+}
+
+// Run the import processing at once, of a document read from a stream
+Bool Collada::processImport(InStream &is, const String &name)
+{
+	if (isImporting())
+		return False;
+
+	const UInt32 chunk = 1 << 20;
+
+	std::string buffer;
+	UInt32 read = 0;
+
+	do {
+		size_t pos = buffer.size();
+		buffer.resize(pos + chunk);
+
+		read = is.reader(&buffer[pos], 1, chunk);
+		buffer.resize(pos + read);
+	} while (read > 0);
+
+	if (!beginImport(buffer.data(), buffer.size(), name))
+		return False;
+
+	// kept until the document is opened
+	m_importBuffer.swap(buffer);
+	m_importData = m_importBuffer.data();
+
+	return step(0) == IMPORT_DONE;
+}
+
+// Start a stepped import of a document in memory
+Bool Collada::beginImport(const Char *data, UInt64 size, const String &name)
+{
+	if (!data || !beginImport(name))
+		return False;
 
-	String lfilename = filename;
-	lfilename.replace('\\','/');
+	m_importData = data;
+	m_importSize = size;
 
-	String lpathname = lfilename;
+	return True;
+}
+
+// Start a stepped import
+Bool Collada::beginImport(const String &filename)
+{
+	if (isImporting())
+		return False;
+
+	m_importData = nullptr;
+	m_importSize = 0;
+
+	m_memoryUsage = MemoryUsage();
+	m_info.resetDocument();
+
+	m_importFileName = filename;
+	m_importFileName.replace('\\','/');
+
+	// a gzip document is named as its content, for its relative references
+	m_documentUri = m_importFileName;
+	if (isGzipFile(m_documentUri))
+		m_documentUri.truncate(m_documentUri.length() - 3);
+
+	String lpathname = m_importFileName;
 	Int32 pos = lpathname.reverseFind('/');
 	lpathname.truncate(pos+1);
 
 	m_info.setFilePath(lpathname);
-	m_info.setFileName(lfilename.sub(pos+1));
+	m_info.setFileName(m_importFileName.sub(pos+1));
+
+	m_sceneName = String();
 
 	//m_doc->add("simple.dae");
 	//m_doc->writeAll();
 
-    m_dom = (domCOLLADA*)m_doc->open(lfilename.toUtf8().getData());
-	//return false;
+	// an asynchronous import times its worker part and its commit separately, each
+	// entry being opened and closed by the same thread
+	if (!m_info.isAsync())
+		beginTotalEntry("total");
 
-    if (!m_dom)
-    {
-		deletePtr(m_doc);
-		return False;
+	setStage(IMPORT_OPEN);
+
+	return True;
+}
+
+// Process units of work until the time budget is elapsed
+Collada::ImportStage Collada::step(UInt32 budgetMs)
+{
+	const Int64 start = System::getTime();
+	const Int64 budget = (Int64)budgetMs * System::getTimeFrequency() / 1000;
+
+	while (isImporting())
+	{
+		processUnit();
+
+		if (budget > 0 && (System::getTime() - start) >= budget)
+			break;
 	}
 
-	m_global = new CGlobal(m_scene, m_dom, m_info);
-	m_global->import();
-	m_global->toScene();
+	return m_stage;
+}
+
+// Abort the running import
+void Collada::abortImport()
+{
+	if (!isImporting())
+		return;
 
-	triangulate(m_doc);
+	if (m_doc)
+		releaseDocument(m_documentUri);
 
-	// the scene entry
-	const domCOLLADA::domSceneRef sceneRef = m_dom->getScene();
-	if (sceneRef.cast())
+	finishImport(IMPORT_IDLE);
+}
+
+// Get the progression into the current stage
+Float Collada::getStageProgress() const
+{
+	if (m_stageCount == 0)
+		return m_stage == IMPORT_DONE ? 1.f : 0.f;
+
+	return (Float)m_stageIndex / (Float)m_stageCount;
+}
+
+// Get the name of a stage
+const char* Collada::getStageName(ImportStage stage)
+{
+	static const char* names[] = {
+		"idle",
+		"open",
+		"global",
+		"triangulate",
+		"nodes",
+		"animations",
+		"release",
+		"toScene",
+		"postImportPass",
+		"done",
+		"failed" };
+
+	return names[stage];
+}
+
+// Enter a stage and count its units of work
+void Collada::setStage(ImportStage stage)
+{
+	m_stage = stage;
+	m_stageIndex = 0;
+	m_stageCount = 1;
+
+	switch (stage)
 	{
-		const domInstanceWithExtraRef instanceVisualScene = sceneRef->getInstance_visual_scene();
-		if (instanceVisualScene.cast())
+		case IMPORT_TRIANGULATE:
+			m_stageCount = (size_t)m_doc->getDatabase()->getElementCount(
+				nullptr, "geometry", m_documentUri.toUtf8().getData());
+			break;
+
+		case IMPORT_NODES:
 		{
-			daeElementRef elementRef = instanceVisualScene->getUrl().getElement();
-			domVisual_sceneRef visualSceneRef = (domVisual_scene*)elementRef.cast();
+			// the scene entry
+			m_visualScene = domVisual_sceneRef();
+			m_stageCount = 0;
+
+			const domCOLLADA::domSceneRef sceneRef = m_dom->getScene();
+			if (sceneRef.cast())
+			{
+				const domInstanceWithExtraRef instanceVisualScene = sceneRef->getInstance_visual_scene();
+				if (instanceVisualScene.cast())
+				{
+					daeElementRef elementRef = instanceVisualScene->getUrl().getElement();
+					m_visualScene = (domVisual_scene*)elementRef.cast();
+				}
+			}
 
-			// get the scene name
-			m_scene->setSceneName(visualSceneRef->getName());
+			if (m_visualScene.cast())
+			{
+				// get the scene name
+				m_sceneName = m_visualScene->getName();
+				m_stageCount = m_visualScene->getNode_array().getCount();
+			}
+			break;
+		}
+
+		case IMPORT_ANIMATIONS:
+			// Load all the animation libraries, unless they are not wanted
+			m_visualScene = domVisual_sceneRef();
+			m_animations.clear();
 
-			domNode_Array &nodeArray = visualSceneRef->getNode_array();
-			for (size_t i = 0; i < nodeArray.getCount(); ++i)
+			for (size_t i = 0; m_info.getOptions().animations && i < m_dom->getLibrary_animations_array().getCount(); ++i)
 			{
-				CNode *pNode = new CNode(
-					m_scene,
-					m_dom,
-					m_info,
-					nodeArray.get(i));
+				domLibrary_animationsRef animationsRef = m_dom->getLibrary_animations_array()[i];
+				for (size_t j = 0; j < animationsRef->getAnimation_array().getCount(); ++j)
+					m_animations.push_back(animationsRef->getAnimation_array()[j]);
+			}
 
-				if (pNode->import())
+			m_stageCount = m_animations.size();
+			break;
+
+		case IMPORT_TO_SCENE:
+			// the asset and the scene name first
+			m_stageCount = m_rootNodes.size() + 1;
+			break;
+
+		case IMPORT_POST_PASS:
+			m_stageCount = m_rootNodes.size();
+			break;
+
+		case IMPORT_IDLE:
+		case IMPORT_DONE:
+		case IMPORT_FAILED:
+			m_stageCount = 0;
+			break;
+
+		default:
+			break;
+	}
+}
+
+// Process the next unit of work of the current stage
+void Collada::processUnit()
+{
+	ImportProfiler *profiler = m_info.getProfiler();
+
+	// the document is used from its opening to its release, under the lock of the
+	// COLLADA-DOM global states shared with the concurrent imports. The geometries and
+	// the controllers release it while converting their resolved arrays (see DaeUnlock)
+	DaeLock daeLock(m_stage > IMPORT_OPEN && m_stage <= IMPORT_RELEASE);
+
+	// a stage without any more work
+	if (m_stageIndex >= m_stageCount)
+	{
+		switch (m_stage)
+		{
+			case IMPORT_TRIANGULATE: setStage(IMPORT_NODES); break;
+			case IMPORT_NODES: setStage(IMPORT_ANIMATIONS); break;
+			case IMPORT_ANIMATIONS: setStage(IMPORT_RELEASE); break;
+			case IMPORT_TO_SCENE: setStage(IMPORT_POST_PASS); break;
+			case IMPORT_POST_PASS:
+				// the skeletons are now set, and the animations created
+				if (m_info.getAnimatedBoundsGeneration())
 				{
-					m_rootNodes.push_back(pNode);
+					ProfileScope scope(profiler, "animatedBounds");
+					buildAnimatedBounds();
 				}
-				else
+
+				if (m_info.getBoneTextureGeneration())
 				{
-					deletePtr(pNode);
-					break;
+					ProfileScope scope(profiler, "boneTextures");
+					buildBoneTextures();
 				}
-			}
+
+				// the nodes are now placed, the world bounds of the meshes are known
+				if (m_info.getSceneBvhGeneration())
+				{
+					ProfileScope scope(profiler, "bvh");
+					m_sceneBvh.build(m_info.getParseThreads());
+				}
+
+				finishImport(IMPORT_DONE);
+				break;
+			default: break;
 		}
+		return;
 	}
 
-	// import animations
-	// Load all the animation libraries
-	for (size_t i = 0; i < m_dom->getLibrary_animations_array().getCount(); ++i)
+	const size_t index = m_stageIndex++;
+
+	switch (m_stage)
 	{
-		domLibrary_animationsRef animationsRef = m_dom->getLibrary_animations_array()[i];
-		for (size_t i = 0; i < animationsRef->getAnimation_array().getCount(); i++)
+		case IMPORT_OPEN:
+		{
+			ColladaSession *session = m_info.getSession();
+			m_doc = session ? session->getDAE() : createDAE();
+
+			{
+				ProfileScope scope(profiler, "open");
+
+				// already loaded by the session, when referenced by a previous document
+				if (session)
+				{
+					DaeLock lock;
+					m_dom = (domCOLLADA*)m_doc->getRoot(m_documentUri.toUtf8().getData());
+				}
+
+				if (!m_dom)
+					m_dom = openDocument();
+			}
+
+			// the document in memory is no longer needed
+			m_importData = nullptr;
+			m_importSize = 0;
+			std::string().swap(m_importBuffer);
+
+			if (!m_dom)
+			{
+				if (session)
+					m_doc = nullptr;
+				else
+					deleteDAE(m_doc);
+
+				finishImport(IMPORT_FAILED);
+				return;
+			}
+
+			if (session)
+				session->addImport();
+
+			m_memoryUsage.parsed = getResidentMemory();
+
+			DaeLock lock;
+			setStage(IMPORT_GLOBAL);
+			break;
+		}
+
+		case IMPORT_GLOBAL:
+		{
+			ProfileScope scope(profiler, "global");
+
+			// set to the scene during IMPORT_TO_SCENE
+			m_global = new CGlobal(m_scene, m_dom, m_info);
+			m_global->import();
+
+			setStage(IMPORT_TRIANGULATE);
+			break;
+		}
+
+		case IMPORT_TRIANGULATE:
 		{
-			CAnimation *animation = new CAnimation(m_scene, m_dom, m_info, animationsRef->getAnimation_array()[i]);
+			ProfileScope scope(profiler, "triangulate");
+
+			// the database can contain the documents previously loaded by a session
+			domGeometry *geometry = nullptr;
+			m_doc->getDatabase()->getElement(
+				(daeElement**)&geometry,
+				(daeInt)index,
+				nullptr,
+				"geometry",
+				m_documentUri.toUtf8().getData());
+
+			if (geometry)
+				triangulate(geometry);
+			break;
+		}
+
+		case IMPORT_NODES:
+		{
+			ProfileScope scope(profiler, "nodes");
+
+			// skip the root nodes without any node selected by the filters
+			if (!CNode::hasSelectedNode(m_info.getOptions(), m_visualScene->getNode_array().get(index)))
+				break;
+
+			CNode *pNode = new CNode(
+				m_scene,
+				m_dom,
+				m_info,
+				m_visualScene->getNode_array().get(index));
+
+			if (pNode->import())
+			{
+				m_rootNodes.push_back(pNode);
+			}
+			else
+			{
+				deletePtr(pNode);
+				m_stageIndex = m_stageCount;
+			}
+			break;
+		}
+
+		case IMPORT_ANIMATIONS:
+		{
+			ProfileScope scope(profiler, "animations");
+
+			CAnimation *animation = new CAnimation(m_scene, m_dom, m_info, m_animations[index]);
 			if (!animation->import())
 			{
 				deletePtr(animation);
+				m_stageIndex = m_stageCount;
 				break;
 			}
 			m_animationList.push_back(animation);
+			break;
+		}
+
+		case IMPORT_RELEASE:
+		{
+			m_animations.clear();
+			m_memoryUsage.imported = getResidentMemory();
+
+			// clean, the document is no longer needed to build the scene
+			{
+				ProfileScope scope(profiler, "release");
+				releaseDocument(m_documentUri);
+			}
+
+			m_memoryUsage.released = getResidentMemory();
+
+			if (m_memoryUsage.released)
+			{
+				String msg = "Collada DOM released, resident memory ";
+				msg << (UInt32)(m_memoryUsage.imported >> 10);
+				msg = msg + " KB before, ";
+				msg << (UInt32)(m_memoryUsage.released >> 10);
+				O3D_MESSAGE(msg + " KB after");
+			}
+
+			setStage(IMPORT_TO_SCENE);
+			break;
 		}
+
+		case IMPORT_TO_SCENE:
+		{
+			// set imported data to the scene
+			ProfileScope scope(profiler, "toScene");
+
+			if (index == 0)
+			{
+				if (m_global)
+					m_global->toScene();
+
+				if (m_sceneName.isValid())
+					m_scene->setSceneName(m_sceneName);
+
+				break;
+			}
+
+			// root bones are not children of the scene root node
+			CNode *cnode = m_rootNodes[index-1];
+			if (cnode->isJoin())
+				cnode->setParentNode(nullptr);
+			else
+				cnode->setParentNode(m_scene->getHierarchyTree()->getRootNode());
+
+			if (!cnode->toScene())
+				m_stageIndex = m_stageCount;
+			break;
+		}
+
+		case IMPORT_POST_PASS:
+		{
+			// second import pass, mainly used to apply skeleton onto skinning objects
+			ProfileScope scope(profiler, "postImportPass");
+
+			CNode *cnode = m_rootNodes[index];
+			if (!cnode->postImportPass())
+			{
+				m_stageIndex = m_stageCount;
+				break;
+			}
+
+			if (cnode->isAnimationRoot())
+				createAnimationPlayer(cnode);
+			break;
+		}
+
+		default:
+			break;
 	}
+}
+
+// Start an import done on a worker thread
+Bool Collada::processImportAsync(const String &filename)
+{
+	if (m_worker.joinable() || isImporting())
+		return False;
 
-	// clean
-	m_doc->close(lfilename.toUtf8().getData());
-    m_dom = nullptr;
-	deletePtr(m_doc);
+	m_info.setAsync(True);
 
-	// set imported data to the scene
-	for (IT_RootNodeList it = m_rootNodes.begin(); it != m_rootNodes.end(); ++it)
+	if (!beginImport(filename))
 	{
-        // root bones are not children of the scene root node
-        CNode *cnode = *it;
-        if (cnode->isJoin())
-            cnode->setParentNode(nullptr);
-        else
-            cnode->setParentNode(m_scene->getHierarchyTree()->getRootNode());
+		m_info.setAsync(False);
+		return False;
+	}
 
-        if (!cnode->toScene())
-			break;
+	m_loaded = false;
+	m_loadFailed = False;
+
+	m_worker = std::thread(&Collada::loadAsync, this);
+
+	return True;
+}
+
+// Worker thread part of an asynchronous import
+void Collada::loadAsync()
+{
+	// an exception must not escape the thread, it fails the import at commit
+	try
+	{
+		ProfileScope scope(m_info.getProfiler(), "load", m_info.getFileName());
+
+		while (isImporting() && (m_stage < IMPORT_TO_SCENE))
+			processUnit();
+	}
+	catch (E_BaseException &)
+	{
+		m_loadFailed = True;
+	}
+	catch (std::exception &)
+	{
+		// std::bad_alloc on a too large document
+		m_loadFailed = True;
+	}
+	catch (...)
+	{
+		m_loadFailed = True;
 	}
 
-    CNode *rootAnimNode = nullptr;
+	m_loaded = true;
+}
 
-	// second import pass, mainly used to apply skeleton onto skinning objects
-	for (IT_RootNodeList it = m_rootNodes.begin(); it != m_rootNodes.end(); ++it)
+// Commit an asynchronous import to the scene
+Collada::ImportStage Collada::commit(UInt32 budgetMs)
+{
+	if (m_worker.joinable())
 	{
-		if (!(*it)->postImportPass())
-			break;
+		m_worker.join();
+		m_info.setAsync(False);
 
-		if ((*it)->isAnimationRoot())
+		if (isImporting())
+			beginTotalEntry("commit");
+
+		if (m_loadFailed)
 		{
-			rootAnimNode = *it;
+			if (m_doc)
+				releaseDocument(m_documentUri);
+
+			finishImport(IMPORT_FAILED);
+			return m_stage;
+		}
+	}
+
+	return step(budgetMs);
+}
+
+// Create the animation and its player for an animation root node
+void Collada::createAnimationPlayer(CNode *rootAnimNode)
+{
+	o3d::Animation *animation = new o3d::Animation(m_scene);
+	animation->setName(rootAnimNode->getName() + "Anim");
+	animation->setResourceName(rootAnimNode->getName() + "Anim.o3dan");
+	animation->setFatherNode(rootAnimNode->getAnimationNode());
+	animation->setDuration(m_info.getAnimationDuration());
+
+	m_scene->getAnimationManager()->addAnimation(animation);
 
-			if (rootAnimNode)
+	m_animationNames[rootAnimNode->getAnimationNode()] = animation->getResourceName();
+
+	o3d::Animatable *pAnimatable = rootAnimNode->getSceneNode();
+
+	o3d::AnimationPlayer *animationPlayer = m_scene->getAnimationPlayerManager()->createAnimationPlayer(animation);
+	animationPlayer->setFramePerSec(24.f);
+	animationPlayer->setName(rootAnimNode->getName() + "Player");
+	animationPlayer->setAnimatable(pAnimatable);
+	animationPlayer->setPlayerMode(AnimationPlayer::MODE_LOOP);
+	animationPlayer->play();
+
+	m_scene->getAnimationPlayerManager()->add(*animationPlayer);
+}
+
+// Get the animation node of each animated scene node of the import
+void Collada::getAnimationNodes(AnimationPose::T_AnimationNodeMap &animNodes) const
+{
+	for (UInt32 i = 0; i < m_info.getNumNodes(); ++i)
+	{
+		CNode *cnode = static_cast<CNode*>(m_info.getNode(i));
+		if (cnode->getSceneNode() && cnode->getAnimationNode())
+			animNodes[cnode->getSceneNode()] = cnode->getAnimationNode();
+	}
+}
+
+// Sample the bounds of the skinned meshes along the animations of the import
+void Collada::buildAnimatedBounds()
+{
+	AnimationPose::T_AnimationNodeMap animNodes;
+	getAnimationNodes(animNodes);
+
+	m_animatedBounds.build(animNodes, m_animationNames, m_info.getAnimationDuration(), m_info.getAnimatedBoundsRate());
+}
+
+// Bake the skinning matrices of the skinned meshes along the animations of the import
+void Collada::buildBoneTextures()
+{
+	const Float duration = m_info.getAnimationDuration();
+	const Float sampleRate = m_info.getBoneTextureRate();
+
+	if (duration <= 0.f || m_animationNames.empty())
+		return;
+
+	AnimationPose::T_AnimationNodeMap animNodes;
+	getAnimationNodes(animNodes);
+
+	std::vector<AnimationPose> poses;
+	AnimationPose::buildFrames(animNodes, duration, sampleRate, poses);
+
+	const UInt32 numFrames = (UInt32)poses.size();
+
+	const BoneTexture::Format format = m_info.getBoneTextureDualQuaternions() ?
+			BoneTexture::DUAL_QUATERNIONS : BoneTexture::MATRICES;
+
+	// skinning matrices of each bone along the frames, per inverse bind matrix. The
+	// skinnings sharing a skeleton bind the same bones and bind matrices, so their
+	// matrices are computed once.
+	struct BoneTrack
+	{
+		Float invBindMatrix[16];
+		std::vector<Float> matrices;   //!< 12 floats per frame
+	};
+
+	std::map<const o3d::Bones*, std::vector<BoneTrack> > boneTracks;
+
+	std::vector<Float> matrices;
+
+	for (UInt32 n = 0; n < m_info.getNumNodes(); ++n)
+	{
+		o3d::Node *node = static_cast<CNode*>(m_info.getNode(n))->getSceneNode();
+		if (!node)
+			continue;
+
+		for (auto *object : node->getSonList())
+		{
+			o3d::Skinning *skinning = dynamic_cast<o3d::Skinning*>(object);
+			if (!skinning || !skinning->getNumBones())
+				continue;
+
+			const UInt32 numBones = skinning->getNumBones();
+
+			const String animation = AnimationPose::findAnimation(skinning, animNodes, m_animationNames);
+			if (animation.isEmpty())
+				continue;
+
+			BoneTexture &texture = m_boneTextures.get(skinning, format);
+			if (!texture.getNumBones())
+			{
+				std::vector<String> names(numBones);
+				for (UInt32 i = 0; i < numBones; ++i)
+				{
+					if (skinning->getBone(i))
+						names[i] = skinning->getBone(i)->getName();
+				}
+
+				texture.setName(skinning->getName());
+				texture.setBones(names);
+			}
+			else if (texture.getNumBones() != numBones)
 			{
-				o3d::Animation *animation = new o3d::Animation(m_scene);
-				animation->setName(rootAnimNode->getName() + "Anim");
-				animation->setResourceName(rootAnimNode->getName() + "Anim.o3dan");
-				animation->setFatherNode(rootAnimNode->getAnimationNode());
-                animation->setDuration(m_info.getAnimationDuration());
+				O3D_WARNING(String("Bone texture of ") + skinning->getName() + " does not match its bones");
+				continue;
+			}
+
+			// the skinning matrix is the world matrix of the bone times its inverse bind matrix
+			matrices.assign(size_t(numFrames) * numBones * 12, 0.f);
+
+			for (UInt32 i = 0; i < numBones; ++i)
+			{
+				o3d::Bones *bones = skinning->getBone(i);
+
+				Float invBindMatrix[16];
+				AnimationSampler::toRowMajor(skinning->getRefMatrix(i).invertStd(), invBindMatrix);
+
+				std::vector<BoneTrack> &tracks = boneTracks[bones];
+				const BoneTrack *track = nullptr;
 
-				m_scene->getAnimationManager()->addAnimation(animation);
+				for (const BoneTrack &other : tracks)
+				{
+					if (std::memcmp(other.invBindMatrix, invBindMatrix, sizeof(invBindMatrix)) == 0)
+					{
+						track = &other;
+						break;
+					}
+				}
+
+				if (!track)
+				{
+					tracks.push_back(BoneTrack());
+					BoneTrack &newTrack = tracks.back();
+
+					std::memcpy(newTrack.invBindMatrix, invBindMatrix, sizeof(invBindMatrix));
+					newTrack.matrices.resize(size_t(numFrames) * 12);
+
+					for (UInt32 f = 0; f < numFrames; ++f)
+					{
+						Float matrix[16];
 
-				o3d::Animatable *pAnimatable = rootAnimNode->getSceneNode();
+						if (bones)
+							AnimationSampler::mulRowMajor(poses[f].getWorld(bones), invBindMatrix, matrix);
+						else
+							AnimationSampler::toRowMajor(Matrix4(), matrix);
 
-				o3d::AnimationPlayer *animationPlayer = m_scene->getAnimationPlayerManager()->createAnimationPlayer(animation);
-				animationPlayer->setFramePerSec(24.f);
-				animationPlayer->setName(rootAnimNode->getName() + "Player");
-				animationPlayer->setAnimatable(pAnimatable);
-				animationPlayer->setPlayerMode(AnimationPlayer::MODE_LOOP);
-				animationPlayer->play();
+						std::memcpy(&newTrack.matrices[size_t(f) * 12], matrix, sizeof(Float) * 12);
+					}
 
-				m_scene->getAnimationPlayerManager()->add(*animationPlayer);
+					track = &newTrack;
+				}
+
+				for (UInt32 f = 0; f < numFrames; ++f)
+					std::memcpy(&matrices[(size_t(f) * numBones + i) * 12], &track->matrices[size_t(f) * 12], sizeof(Float) * 12);
 			}
+
+			texture.addClip(animation, duration, sampleRate, numFrames, matrices.data());
 		}
 	}
+}
+
+// Delete the temporary imported objects and finish the import
+void Collada::finishImport(ImportStage stage)
+{
+	// the last references onto the document elements are released
+	DaeLock lock;
 
 	// delete temporary imported node hierarchy
 	for (IT_RootNodeList it = m_rootNodes.begin(); it != m_rootNodes.end(); ++it)
@@ -192,16 +985,85 @@ Bool Collada::processImport(const String &filename)
 
 	m_rootNodes.clear();
 
+	// the imported animations
+	for (IT_AnimationList it = m_animationList.begin(); it != m_animationList.end(); ++it)
+	{
+		deletePtr(*it);
+	}
+
+	m_animationList.clear();
+	m_animationNames.clear();
+
 	// and the global asset
 	deletePtr(m_global);
 
-	return True;
+	m_visualScene = domVisual_sceneRef();
+	m_animations.clear();
+
+	if (m_totalOpened)
+	{
+		m_info.getProfiler()->end(m_totalEntry);
+		m_totalOpened = False;
+	}
+
+	setStage(stage);
 }
 
-// Run the export processing
+// Open the profiler entry ended by finishImport
+void Collada::beginTotalEntry(const char *category)
+{
+	if (!m_info.getProfiler())
+		return;
+
+	m_totalEntry = m_info.getProfiler()->begin(category, m_info.getFileName());
+	m_totalOpened = True;
+}
+
+// Export the scene to a file
 Bool Collada::processExport(const String &filename)
 {
-	//setScene(o3d::Scene::getCurrentScene());
+	if (!m_scene)
+	{
+		O3D_WARNING("Undefined scene to export");
+		return False;
+	}
+
+	FileOutStream os(filename, FileOutStream::CREATE);
+
+	String name = filename;
+	name.replace('\\','/');
+
+	Int32 pos = name.reverseFind('/');
+	if (pos >= 0)
+		name = name.sub(pos + 1);
+
+	pos = name.find('.');
+	if (pos > 0)
+		name.truncate(pos);
+
+	return processExport(os, name);
+}
+
+// Export the scene to a stream
+Bool Collada::processExport(OutStream &os, const String &name)
+{
+	if (!m_scene)
+	{
+		O3D_WARNING("Undefined scene to export");
+		return False;
+	}
+
+	if (!m_exporter.exportScene(os, name))
+		return False;
+
+	O3D_MESSAGE(String("Exported ") + name + ": " +
+			String::print("%u nodes, %u geometries, %u skins, %u materials, %u animations, %llu bytes",
+					m_exporter.getNumNodes(),
+					m_exporter.getNumGeometries(),
+					m_exporter.getNumControllers(),
+					m_exporter.getNumMaterials(),
+					m_exporter.getNumAnimations(),
+					(unsigned long long)m_exporter.getNumBytes()));
 
 	return True;
 }
@@ -328,54 +1190,41 @@ void createTrianglesFromPolygons(domMesh *thisMesh, domPolygons *thisPolygons)
 	}
 }
 
-Int32 triangulate(DAE *_dae)
+void triangulate(domGeometry *thisGeometry)
 {
-	Int32 error = 0;
+	// Get the mesh out of the geometry
+	domMesh *thisMesh = thisGeometry->getMesh();
 
-	// How many geometry elements are there?
-    Int32 geometryElementCount = (Int32)(_dae->getDatabase()->getElementCount(nullptr, "geometry" ));
+	if (thisMesh == nullptr)
+		return;
 
-	for (Int32 currentGeometry = 0; currentGeometry < geometryElementCount; currentGeometry++)
+	// Loop over all the polygon elements
+	for (Int32 currentPolygons = 0; currentPolygons < (Int32)(thisMesh->getPolygons_array().getCount()); currentPolygons++)
 	{
-		// Find the next geometry element
-		domGeometry *thisGeometry;
-        error = _dae->getDatabase()->getElement((daeElement**)&thisGeometry,currentGeometry, nullptr, "geometry");
-
-		// Get the mesh out of the geometry
-		domMesh *thisMesh = thisGeometry->getMesh();
-
-        if (thisMesh == nullptr)
-			continue;
-
-		// Loop over all the polygon elements
-		for (Int32 currentPolygons = 0; currentPolygons < (Int32)(thisMesh->getPolygons_array().getCount()); currentPolygons++)
-		{
-			// Get the polygons out of the mesh
-			// Always get index 0 because every pass through this loop deletes the <polygons> element as it finishes with it
-			domPolygons *thisPolygons = thisMesh->getPolygons_array()[currentPolygons];
-			createTrianglesFromPolygons( thisMesh, thisPolygons );
-		}
-		while (thisMesh->getPolygons_array().getCount() > 0)
-		{
-			domPolygons *thisPolygons = thisMesh->getPolygons_array().get(0);
-			// Remove the polygons from the mesh
-			thisMesh->removeChildElement(thisPolygons);
-		}
-		Int32 polylistElementCount = (Int32)(thisMesh->getPolylist_array().getCount());
+		// Get the polygons out of the mesh
+		// Always get index 0 because every pass through this loop deletes the <polygons> element as it finishes with it
+		domPolygons *thisPolygons = thisMesh->getPolygons_array()[currentPolygons];
+		createTrianglesFromPolygons( thisMesh, thisPolygons );
+	}
+	while (thisMesh->getPolygons_array().getCount() > 0)
+	{
+		domPolygons *thisPolygons = thisMesh->getPolygons_array().get(0);
+		// Remove the polygons from the mesh
+		thisMesh->removeChildElement(thisPolygons);
+	}
+	Int32 polylistElementCount = (Int32)(thisMesh->getPolylist_array().getCount());
 
-		for (Int32 currentPolylist = 0; currentPolylist < polylistElementCount; currentPolylist++)
-		{
-			// Get the polylist out of the mesh
-			// Always get index 0 because every pass through this loop deletes the <polygons> element as it finishes with it
-			domPolylist *thisPolylist = thisMesh->getPolylist_array()[currentPolylist];
-			createTrianglesFromPolylist( thisMesh, thisPolylist );
-		}
-		while (thisMesh->getPolylist_array().getCount() > 0)
-		{
-			domPolylist *thisPolylist = thisMesh->getPolylist_array().get(0);
-			// Remove the polylist from the mesh
-			thisMesh->removeChildElement(thisPolylist);
-		}
+	for (Int32 currentPolylist = 0; currentPolylist < polylistElementCount; currentPolylist++)
+	{
+		// Get the polylist out of the mesh
+		// Always get index 0 because every pass through this loop deletes the <polygons> element as it finishes with it
+		domPolylist *thisPolylist = thisMesh->getPolylist_array()[currentPolylist];
+		createTrianglesFromPolylist( thisMesh, thisPolylist );
+	}
+	while (thisMesh->getPolylist_array().getCount() > 0)
+	{
+		domPolylist *thisPolylist = thisMesh->getPolylist_array().get(0);
+		// Remove the polylist from the mesh
+		thisMesh->removeChildElement(thisPolylist);
 	}
-	return 0;
 }
@@ -12,12 +12,17 @@
 #include "o3d/collada/controller.h"
 #include "o3d/collada/geometry.h"
 #include "o3d/collada/node.h"
+#include "o3d/collada/numericarrays.h"
+#include "o3d/collada/animatedbounds.h"
 
 #include <o3d/engine/scene/scene.h>
 #include <o3d/engine/hierarchy/hierarchytree.h>
 #include <o3d/engine/object/skin.h>
 #include <o3d/engine/object/skeleton.h>
 
+#include <cmath>
+#include <limits>
+
 using namespace o3d;
 using namespace o3d::collada;
 
@@ -33,10 +38,12 @@ CController::CController(
 		m_Material(mat),
         m_node(nullptr),
         m_geometry(nullptr),
-        m_skeleton(nullptr)
+        m_skeleton(nullptr),
+        m_skeletonOwner(nullptr)
 {
 	domGeometryRef geo = (domGeometry*)ctrl->getSkin()->getSource().getElement().cast();
 	m_geometry = new CGeometry(scene, dom, infos, geo, mat);
+	m_geometry->setReusable(False);
 }
 
 // Destructor
@@ -48,6 +55,8 @@ CController::~CController()
 // Import method
 Bool CController::import()
 {
+	ProfileScope scope(m_infos.getProfiler(), "controller", m_controller->getId() ? m_controller->getId() : "");
+
 	m_geometry->import();
 
 	// shape matrix
@@ -137,28 +146,30 @@ Bool CController::import()
 	}
 
 	// read inv matrices
-    for (UInt32 m = 0; m < invBindMatsSource->getFloat_array()->getCount(); m += 16)
+	const FloatArrayView invBindMats = NumericArrays::getFloats(m_infos.getNumericArrays(), invBindMatsSource->getFloat_array());
+
+    for (UInt32 m = 0; m + 15 < invBindMats.getCount(); m += 16)
 	{
 		Matrix4 mat(
-			(Float)invBindMatsSource->getFloat_array()->getValue()[m],
-			(Float)invBindMatsSource->getFloat_array()->getValue()[m+1],
-			(Float)invBindMatsSource->getFloat_array()->getValue()[m+2],
-			(Float)invBindMatsSource->getFloat_array()->getValue()[m+3],
-
-			(Float)invBindMatsSource->getFloat_array()->getValue()[m+4],
-			(Float)invBindMatsSource->getFloat_array()->getValue()[m+5],
-			(Float)invBindMatsSource->getFloat_array()->getValue()[m+6],
-			(Float)invBindMatsSource->getFloat_array()->getValue()[m+7],
-
-			(Float)invBindMatsSource->getFloat_array()->getValue()[m+8],
-			(Float)invBindMatsSource->getFloat_array()->getValue()[m+9],
-			(Float)invBindMatsSource->getFloat_array()->getValue()[m+10],
-			(Float)invBindMatsSource->getFloat_array()->getValue()[m+11],
-
-			(Float)invBindMatsSource->getFloat_array()->getValue()[m+12],
-			(Float)invBindMatsSource->getFloat_array()->getValue()[m+13],
-			(Float)invBindMatsSource->getFloat_array()->getValue()[m+14],
-			(Float)invBindMatsSource->getFloat_array()->getValue()[m+15]);
+			invBindMats[m],
+			invBindMats[m+1],
+			invBindMats[m+2],
+			invBindMats[m+3],
+
+			invBindMats[m+4],
+			invBindMats[m+5],
+			invBindMats[m+6],
+			invBindMats[m+7],
+
+			invBindMats[m+8],
+			invBindMats[m+9],
+			invBindMats[m+10],
+			invBindMats[m+11],
+
+			invBindMats[m+12],
+			invBindMats[m+13],
+			invBindMats[m+14],
+			invBindMats[m+15]);
 
 		m_joinList[m>>4].invMatrix = mat;
 	}
@@ -169,25 +180,30 @@ Bool CController::import()
 	// <vcount> tells how many bones are associated with each vertex, this indicates how many
 	// pairs of joint/weight indices to process out of the <v> array for this vertex.
 	// get pointers to the vcount and v arrays
-	domSkin::domVertex_weights::domVcount *vcountElement = vertexWeightsElement->getVcount();
-	domSkin::domVertex_weights::domV *vElement = vertexWeightsElement->getV();
+	const domListOfUInts &vcount = vertexWeightsElement->getVcount()->getValue();
+	const domListOfInts &v = vertexWeightsElement->getV()->getValue();
 	UInt32 vPos = 0;
 
+	const FloatArrayView weights = NumericArrays::getFloats(m_infos.getNumericArrays(), weightsSource->getFloat_array());
+
+	// the arrays are resolved, the influences are read concurrently with the other imports
+	DaeUnlock unlock;
+
 	m_influences.resize(vertexWeightsCount);
 
 	// For each vertex in <vcount>
 	for (UInt32 vertex = 0; vertex < vertexWeightsCount; ++vertex)
 	{
 		// Find number of bones (joints/weights) this vertex influences and allocate space to store them
-		UInt32 numInfluences = (UInt32)vcountElement->getValue()[vertex];
+		UInt32 numInfluences = (UInt32)vcount[vertex];
 
 		// For each bone, copy in the joint number and the actual float value in the weights (indexed by the
 		// second value in the <v> array
 		for (UInt32 inf = 0; inf < numInfluences; ++inf)
 		{
 			Influence influence;
-			influence.joinId = (UInt32)vElement->getValue()[vPos++];
-			influence.weight = (Float)weightsSource->getFloat_array()->getValue()[(size_t)(vElement->getValue()[vPos++])];
+			influence.joinId = (UInt32)v[vPos++];
+			influence.weight = weights[(size_t)v[vPos++]];
 
 			// TODO a way to have more than 4 influences per vertex
 			if (inf < 4)
@@ -225,6 +241,8 @@ Bool CController::doExport()
 // Set post-import values to the scene
 Bool CController::toScene()
 {
+	ProfileScope scope(m_infos.getProfiler(), "controller.toScene", m_geometry->getName());
+
 	UInt32 nbrVertices = m_influences.size();
 
 	// create influences arrays
@@ -317,8 +335,113 @@ Bool CController::toScene()
     Skinning *skinning = (Skinning*)m_node->getSonList().front();
 	skinning->setNumBones(m_joinList.size());
 
-    // take the skinning skeleton for usage in postImportPass
-    m_skeleton = skinning->getSkeleton();
+    // take the skinning skeleton for usage in postImportPass, unless another one is
+	// shared, known once every controller is set to the scene
+	m_skeleton = skinning->getSkeleton();
+
+	if (m_infos.getSkeletonSharing())
+		m_infos.addController(this);
+
+	return True;
+}
+
+// Get the bones of a joint, resolved once
+Bones* CController::getJointBones(UInt32 joint)
+{
+	if (m_jointBones.size() != m_joinList.size())
+		m_jointBones.assign(m_joinList.size(), nullptr);
+
+	if (m_jointBones[joint])
+		return m_jointBones[joint];
+
+	CNode *cNode = nullptr;
+
+	if (m_findJoinByIDRef)
+	{
+		cNode = (CNode*)m_infos.findNodeUsingId(m_joinList[joint].name);
+	}
+	else
+	{
+		cNode = (CNode*)m_infos.findNodeUsingName(m_joinList[joint].name);
+
+		// try with id (apparently there is a metaphysic behavior on some dae files
+		if (!cNode)
+			cNode = (CNode*)m_infos.findNodeUsingSid(m_joinList[joint].name);
+	}
+
+	if (cNode)
+		m_jointBones[joint] = (Bones*)cNode->getSceneNode();
+
+	return m_jointBones[joint];
+}
+
+// Find the controller binding the most joints, those of this one included
+CController* CController::findSkeletonOwner()
+{
+	CController *owner = nullptr;
+	std::vector<UInt32> remap;
+
+	// this one is a candidate, so an equal set registered before it wins
+	for (UInt32 n = 0; n < m_infos.getNumControllers(); ++n)
+	{
+		CController *other = m_infos.getController(n);
+
+		if (owner && other->m_joinList.size() <= owner->m_joinList.size())
+			continue;
+
+		if (other == this || isJointSubset(other, remap))
+		{
+			owner = other;
+
+			if (other != this)
+				m_skeletonJoints = remap;
+		}
+	}
+
+	if (!owner || owner == this)
+	{
+		m_skeletonJoints.clear();
+		return nullptr;
+	}
+
+	return owner;
+}
+
+// Is every joint bound by another controller at the same bind pose
+Bool CController::isJointSubset(const CController *other, std::vector<UInt32> &remap) const
+{
+	const Float epsilon = 1e-5f;
+
+	if (other->m_findJoinByIDRef != m_findJoinByIDRef ||
+		other->m_joinList.size() < m_joinList.size() ||
+		other->m_skeletonId.empty() != m_skeletonId.empty() ||
+		(!m_skeletonId.empty() && other->m_skeletonId.front() != m_skeletonId.front()))
+		return False;
+
+	remap.assign(m_joinList.size(), 0);
+
+	for (size_t i = 0; i < m_joinList.size(); ++i)
+	{
+		Bool match = False;
+		for (size_t j = 0; j < other->m_joinList.size(); ++j)
+		{
+			if (other->m_joinList[j].name != m_joinList[i].name)
+				continue;
+
+			const Float *a = m_joinList[i].invMatrix.getData();
+			const Float *b = other->m_joinList[j].invMatrix.getData();
+
+			match = True;
+			for (UInt32 k = 0; k < 16 && match; ++k)
+				match = std::fabs(a[k] - b[k]) <= epsilon * o3d::max(1.f, std::fabs(b[k]));
+
+			remap[i] = (UInt32)j;
+			break;
+		}
+
+		if (!match)
+			return False;
+	}
 
 	return True;
 }
@@ -327,85 +450,110 @@ Bool CController::toScene()
 Bool CController::postImportPass()
 {
     Skinning *skinning = (Skinning*)m_node->getSonList().front();
-    Bool root = False; // false until root bones is set
 
-    if (!m_findJoinByIDRef)
+	// the skinning binds the skeleton of the controller binding the most joints, keeping
+	// its own joints
+	if (m_infos.getSkeletonSharing())
 	{
-		for (size_t i = 0; i < m_joinList.size(); ++i)
+		m_skeletonOwner = findSkeletonOwner();
+
+		if (m_skeletonOwner)
 		{
-			CNode *cNode = (CNode*)m_infos.findNodeUsingName(m_joinList[i].name);
-			
-			// try with id (apparently there is a metaphysic behavior on some dae files
-			if (!cNode)
-				cNode = (CNode*)m_infos.findNodeUsingSid(m_joinList[i].name);
+			// the skeleton created with the skinning is replaced and no longer referenced
+			Skeleton *ownSkeleton = skinning->getSkeleton();
+
+			m_skeleton = m_skeletonOwner->getSkeleton();
+			skinning->setSkeleton(m_skeleton);
+
+			if (ownSkeleton != m_skeleton)
+				deletePtr(ownSkeleton);
+		}
+	}
 
-			if (cNode)
+	// the joints of a shared skeleton are those of the owner, which attaches their bones
+	// to the skeleton and sets its root, so each skinning binds the very same bones and
+	// bind matrices, and the shared bones are updated once by the skeleton
+	CController *source = m_skeletonOwner ? m_skeletonOwner : this;
+	Bool root = m_skeletonOwner != nullptr;
+
+	for (size_t i = 0; i < m_joinList.size(); ++i)
+	{
+		const UInt32 joint = m_skeletonOwner ? m_skeletonJoints[i] : (UInt32)i;
+
+		Bones *bones = source->getJointBones(joint);
+		if (!bones)
+			O3D_ERROR(E_InvalidParameter(String("Unable to find the bones ") + m_joinList[i].name));
+
+		if (!m_skeletonOwner)
+		{
+			bones->setSkeleton(m_skeleton);
+
+			// the root node of the skeleton have no parent node
+			if (!root)
 			{
-                Bones *bones = (Bones*)cNode->getSceneNode();
-                bones->setSkeleton(m_skeleton);
-
-                // the root node of the skeleton have no parent node
-                if (!root)
-                {
-                    BaseNode *rootBones = bones;
-                    while (rootBones->getNode())
-                    {
-                        rootBones = rootBones->getNode();
-                    }
-
-                    if (rootBones->getType() != ENGINE_BONES)
-                        O3D_ERROR(E_InvalidParameter("Root must be a Bones"));
-
-                    // TODO does we use this as start ? and when there is more than one ?
-                    if (!m_skeletonId.empty())
-                        rootBones = static_cast<CNode*>(m_infos.findNodeUsingId(m_skeletonId.front()))->getSceneNode();
-
-                    m_skeleton->setRoot(static_cast<Bones*>(rootBones));
-                    root = True;
-                }
-
-                skinning->setBone(i, bones);
-                skinning->setRefMatrix(i,m_joinList[i].invMatrix.invert());
+				BaseNode *rootBones = bones;
+				while (rootBones->getNode())
+				{
+					rootBones = rootBones->getNode();
+				}
+
+				if (rootBones->getType() != ENGINE_BONES)
+					O3D_ERROR(E_InvalidParameter("Root must be a Bones"));
+
+				// TODO does we use this as start ? and when there is more than one ?
+				if (!m_skeletonId.empty())
+					rootBones = static_cast<CNode*>(m_infos.findNodeUsingId(m_skeletonId.front()))->getSceneNode();
+
+				m_skeleton->setRoot(static_cast<Bones*>(rootBones));
+				root = True;
 			}
-			else
-				O3D_ERROR(E_InvalidParameter(String("Unable to find the bones ") + m_joinList[i].name));
 		}
+
+		skinning->setBone(i, bones);
+		skinning->setRefMatrix(i, source->m_joinList[joint].invMatrix.invert());
 	}
-	else
+
+	// bounds of the influenced vertices in the space of each bone at the bind pose
+	AnimatedBoundsLibrary *animatedBounds = m_infos.getAnimatedBoundsLibrary();
+	std::vector<Float> &meshBounds = m_geometry->getBoneBounds();
+
+	if (animatedBounds && m_infos.getAnimatedBoundsGeneration() && !meshBounds.empty())
 	{
+		std::vector<Float> boneBounds(m_joinList.size()*6);
+
 		for (size_t i = 0; i < m_joinList.size(); ++i)
 		{
-			CNode *cNode = (CNode*)m_infos.findNodeUsingId(m_joinList[i].name);
-			if (cNode)
+			Float *box = &boneBounds[i*6];
+			for (UInt32 k = 0; k < 3; ++k)
+			{
+				box[k] = std::numeric_limits<Float>::max();
+				box[k+3] = -std::numeric_limits<Float>::max();
+			}
+
+			if ((i+1)*6 > meshBounds.size() || meshBounds[i*6] > meshBounds[i*6+3])
+				continue;
+
+			const Float *meshBox = &meshBounds[i*6];
+
+			for (UInt32 c = 0; c < 8; ++c)
 			{
-                Bones *bones = (Bones*)cNode->getSceneNode();
-                bones->setSkeleton(m_skeleton);
-
-                // the root node of the skeleton have no parent node
-                if (!root)
-                {
-                    BaseNode *rootBones = bones;
-                    while (rootBones->getNode())
-                    {
-                        rootBones = rootBones->getNode();
-                    }
-
-                    if (rootBones->getType() != ENGINE_BONES)
-                        O3D_ERROR(E_InvalidParameter("Root must be a Bones"));
-
-                    if (!m_skeletonId.empty())
-                        rootBones = static_cast<CNode*>(m_infos.findNodeUsingId(m_skeletonId.front()))->getSceneNode();
-
-                    m_skeleton->setRoot(static_cast<Bones*>(rootBones));
-                    root = True;
-                }
-
-                skinning->setBone(i, bones);
-				skinning->setRefMatrix(i,m_joinList[i].invMatrix.invert());
+				const Vector3 corner(
+						(c & 1) ? meshBox[3] : meshBox[0],
+						(c & 2) ? meshBox[4] : meshBox[1],
+						(c & 4) ? meshBox[5] : meshBox[2]);
+
+				const Vector3 p = m_joinList[i].invMatrix * corner;
+
+				for (UInt32 k = 0; k < 3; ++k)
+				{
+					box[k] = o3d::min(box[k], p[k]);
+					box[k+3] = o3d::max(box[k+3], p[k]);
+				}
 			}
-			else
-				O3D_ERROR(E_InvalidParameter(String("Unable to find the bones ") + m_joinList[i].name));
 		}
+
+		animatedBounds->addSkinning(skinning, boneBounds);
+		meshBounds.clear();
 	}
 
 	skinning->initialize();
@@ -421,3 +569,14 @@ Bool CController::fromScene()
 	return True;
 }
 
+// Release any reference to the COLLADA-DOM
+void CController::releaseDom()
+{
+	m_controller = domControllerRef();
+	m_Material = domBind_materialRef();
+
+	m_geometry->releaseDom();
+
+	CBaseObject::releaseDom();
+}
+
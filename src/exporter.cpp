@@ -0,0 +1,1025 @@
+/**
+ * @file exporter.cpp
+ * @brief Implementation of exporter.h
+ * @author Frederic SCHERMA (frederic.scherma@dreamoverflow.org)
+ * @date 2026-10-18
+ * @copyright Copyright (c) 2001-2026 Dream Overflow. All rights reserved.
+ * @details
+ */
+
+#include "o3d/collada/precompiled.h"
+#include "o3d/collada/exporter.h"
+#include "o3d/collada/animationsampler.h"
+
+#include <o3d/engine/scene/scene.h>
+#include <o3d/engine/hierarchy/hierarchytree.h>
+#include <o3d/engine/hierarchy/node.h>
+#include <o3d/engine/object/bones.h>
+#include <o3d/engine/object/mesh.h>
+#include <o3d/engine/object/meshdatamanager.h>
+#include <o3d/engine/object/geometrydata.h>
+#include <o3d/engine/object/skin.h>
+#include <o3d/engine/material/materialpass.h>
+#include <o3d/engine/material/materialprofile.h>
+#include <o3d/engine/texture/texture2d.h>
+#include <o3d/engine/animation/animationnode.h>
+
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+
+using namespace o3d;
+using namespace o3d::collada;
+
+namespace {
+
+const Char* const XYZ_PARAMS[] = { "X", "Y", "Z" };
+const Char* const ST_PARAMS[] = { "S", "T" };
+const Char* const TIME_PARAMS[] = { "TIME" };
+const Char* const TRANSFORM_PARAMS[] = { "TRANSFORM" };
+const Char* const WEIGHT_PARAMS[] = { "WEIGHT" };
+
+const Float IDENTITY[16] = {
+	1.f, 0.f, 0.f, 0.f,
+	0.f, 1.f, 0.f, 0.f,
+	0.f, 0.f, 1.f, 0.f,
+	0.f, 0.f, 0.f, 1.f };
+
+//! Get the local data of a vertex array of a geometry, or null.
+const Float* getElementData(GeometryData *geometry, VertexAttributeArray type)
+{
+	VertexElement *element = geometry->getElement(type);
+	return element ? element->getData() : nullptr;
+}
+
+//! Get the local indices of a face array, 16 or 32 bits.
+void getFaces(FaceArray *faceArray, const UInt16 *&faces16, const UInt32 *&faces32, size_t &count)
+{
+	faces16 = nullptr;
+	faces32 = nullptr;
+	count = 0;
+
+	if (FaceArrayUInt16 *array16 = dynamic_cast<FaceArrayUInt16*>(faceArray))
+	{
+		faces16 = array16->getFaces().getData();
+		count = faces16 ? array16->getFaces().getNumElt() : 0;
+	}
+	else if (FaceArrayUInt32 *array32 = dynamic_cast<FaceArrayUInt32*>(faceArray))
+	{
+		faces32 = array32->getFaces().getData();
+		count = faces32 ? array32->getFaces().getNumElt() : 0;
+	}
+}
+
+//! Write a color element of an effect.
+void writeColor(XmlWriter &writer, const Char *name, const Color &color)
+{
+	writer.beginElement(name);
+	writer.beginElement("color");
+	writer.floats(color.getData(), 4);
+	writer.endElement();
+	writer.endElement();
+}
+
+//! Write a float element of an effect.
+void writeFloat(XmlWriter &writer, const Char *name, Float value)
+{
+	writer.beginElement(name);
+	writer.beginElement("float");
+	writer.floats(&value, 1);
+	writer.endElement();
+	writer.endElement();
+}
+
+} // anonymous namespace
+
+// Default ctor
+ColladaExporter::ColladaExporter(o3d::Scene *scene) :
+	m_scene(scene),
+	m_floatDigits(0),
+	m_numThreads(1),
+	m_numNodes(0),
+	m_numAnimations(0),
+	m_numBytes(0)
+{
+}
+
+// Bind the tracks of an animation node to a scene node
+void ColladaExporter::addAnimation(o3d::Node *node, o3d::AnimationNode *animNode, Float duration)
+{
+	if (!node || !animNode)
+		return;
+
+	AnimationEntry entry;
+	entry.animNode = animNode;
+	entry.duration = duration;
+
+	m_animations[node] = entry;
+}
+
+// Export the sons of the root node of the scene
+Bool ColladaExporter::exportScene(OutStream &os, const String &name)
+{
+	if (!m_scene)
+		return False;
+
+	std::vector<o3d::Node*> roots;
+
+	o3d::Node *root = m_scene->getHierarchyTree()->getRootNode();
+	for (auto *object : root->getSonList())
+	{
+		o3d::Node *node = dynamic_cast<o3d::Node*>(object);
+		if (node)
+			roots.push_back(node);
+	}
+
+	return exportNodes(os, roots, name);
+}
+
+// Export a node and its sub-tree
+Bool ColladaExporter::exportNode(OutStream &os, o3d::Node *root, const String &name)
+{
+	if (!root)
+		return False;
+
+	std::vector<o3d::Node*> roots(1, root);
+	return exportNodes(os, roots, name);
+}
+
+// Export nodes and their sub-trees
+Bool ColladaExporter::exportNodes(OutStream &os, const std::vector<o3d::Node*> &roots, const String &name)
+{
+	clear();
+
+	// ids and shared objects first, the libraries are written before the nodes
+	for (o3d::Node *root : roots)
+		collect(root);
+
+	Bool error = False;
+
+	{
+		XmlWriter writer(os);
+		writer.setFloatDigits(m_floatDigits);
+		writer.setNumThreads(m_numThreads);
+
+		writer.beginElement("COLLADA");
+		writer.attribute("xmlns", "http://www.collada.org/2005/11/COLLADASchema");
+		writer.attribute("version", "1.4.1");
+
+		writeAsset(writer);
+		writeImages(writer);
+		writeEffects(writer);
+		writeMaterials(writer);
+		writeGeometries(writer);
+		writeControllers(writer);
+		writeAnimations(writer);
+
+		const String sceneId = makeId(name.isValid() ? name : String("Scene"), "");
+
+		writer.beginElement("library_visual_scenes");
+		writer.beginElement("visual_scene");
+		writer.attribute("id", sceneId);
+		writer.attribute("name", name);
+
+		for (o3d::Node *root : roots)
+			writeNode(writer, root);
+
+		writer.endElement();
+		writer.endElement();
+
+		writer.beginElement("scene");
+		writer.beginElement("instance_visual_scene");
+		writer.reference("url", sceneId);
+		writer.endElement();
+		writer.endElement();
+
+		writer.endElement();
+		writer.flush();
+
+		m_numBytes = writer.getNumBytes();
+		error = writer.hasError();
+	}
+
+	if (error)
+		O3D_WARNING(String("Error while writing the COLLADA document ") + name);
+
+	return !error;
+}
+
+// Clear the state of the previous export
+void ColladaExporter::clear()
+{
+	m_nodeIds.clear();
+	m_nodeOrder.clear();
+	m_joints.clear();
+	m_ids.clear();
+
+	m_materials.clear();
+	m_images.clear();
+	m_geometries.clear();
+	m_controllers.clear();
+
+	m_geometryOrder.clear();
+	m_controllerOrder.clear();
+	m_materialOrder.clear();
+
+	m_numNodes = 0;
+	m_numAnimations = 0;
+	m_numBytes = 0;
+}
+
+// Get a unique and valid id from a name
+String ColladaExporter::makeId(const String &name, const Char *suffix)
+{
+	// a xs:ID is a NCName, restricted here to ASCII letters, digits, '_', '-' and '.'
+	std::string id;
+
+	const CString utf8 = name.toUtf8();
+	for (const Char *p = utf8.getData(); p && *p; ++p)
+	{
+		const Char c = *p;
+		const Bool valid = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+				(c >= '0' && c <= '9') || c == '_' || c == '-' || c == '.';
+
+		id += valid ? c : '_';
+	}
+
+	if (id.empty() || (id[0] >= '0' && id[0] <= '9') || id[0] == '-' || id[0] == '.')
+		id.insert(0, 1, '_');
+
+	id += suffix;
+
+	String result(id.c_str());
+	String unique = result;
+
+	for (UInt32 i = 1; m_ids.count(unique); ++i)
+		unique = result + "_" + String::print("%u", i);
+
+	m_ids.insert(unique);
+
+	return unique;
+}
+
+// Collect the ids and the shared objects of a node sub-tree
+void ColladaExporter::collect(o3d::Node *node)
+{
+	m_nodeIds[node] = makeId(node->getName(), "");
+	m_nodeOrder.push_back(node);
+
+	if (node->getType() == ENGINE_BONES)
+		m_joints.insert(node);
+
+	for (auto *object : node->getSonList())
+	{
+		o3d::Mesh *mesh = dynamic_cast<o3d::Mesh*>(object);
+
+		if (mesh)
+		{
+			o3d::MeshData *meshData = mesh->getMeshData();
+			if (!meshData || !meshData->getGeometry() || !getElementData(meshData->getGeometry(), V_VERTICES_ARRAY))
+			{
+				O3D_WARNING(String("Mesh without local geometry data is not exported: ") + mesh->getName());
+				continue;
+			}
+
+			if (m_geometries.find(meshData) == m_geometries.end())
+			{
+				GeometryEntry entry;
+				entry.id = makeId(meshData->getName(), "-mesh");
+				entry.meshData = meshData;
+				entry.numVertices = meshData->getGeometry()->getNumVertices();
+
+				m_geometries[meshData] = entry;
+				m_geometryOrder.push_back(meshData);
+			}
+
+			collectMaterials(mesh);
+
+			o3d::Skinning *skinning = dynamic_cast<o3d::Skinning*>(mesh);
+			if (skinning)
+			{
+				ControllerEntry entry;
+				entry.id = makeId(skinning->getName(), "-skin");
+				entry.skinning = skinning;
+				entry.geometryId = m_geometries[meshData].id;
+
+				// the bones are written as joints
+				for (UInt32 i = 0; i < skinning->getNumBones(); ++i)
+				{
+					if (skinning->getBone(i))
+						m_joints.insert(skinning->getBone(i));
+				}
+
+				m_controllers[skinning] = entry;
+				m_controllerOrder.push_back(skinning);
+			}
+
+			continue;
+		}
+
+		o3d::Node *son = dynamic_cast<o3d::Node*>(object);
+		if (son)
+			collect(son);
+	}
+}
+
+// Collect the materials of a mesh
+void ColladaExporter::collectMaterials(o3d::Mesh *mesh)
+{
+	for (UInt32 i = 0; i < mesh->getNumMaterialProfiles(); ++i)
+	{
+		const String name = getMaterialName(mesh, i);
+		if (m_materials.find(name) != m_materials.end())
+			continue;
+
+		MaterialProfile &profile = mesh->getMaterialProfile(i);
+
+		MaterialEntry entry;
+		entry.id = makeId(name, "-material");
+		entry.pass = nullptr;
+
+		if (profile.getNumTechniques() > 0 && profile.getTechnique(0).getNumPass() > 0)
+		{
+			entry.pass = &profile.getTechnique(0).getPass(0);
+
+			const Texture2D *texture = entry.pass->getDiffuseMap();
+			if (texture)
+			{
+				const String fileName = texture->getResourceName();
+
+				if (m_images.find(fileName) == m_images.end())
+					m_images[fileName] = makeId(fileName.sub(fileName.reverseFind('/') + 1), "-image");
+
+				entry.imageId = m_images[fileName];
+			}
+		}
+
+		m_materials[name] = entry;
+		m_materialOrder.push_back(name);
+	}
+}
+
+// Get the material name of a profile of a mesh
+String ColladaExporter::getMaterialName(o3d::Mesh *mesh, UInt32 profile) const
+{
+	MaterialProfile &materialProfile = mesh->getMaterialProfile(profile);
+
+	if (materialProfile.getNumTechniques() > 0 && materialProfile.getTechnique(0).getNumPass() > 0)
+	{
+		const Material *material = materialProfile.getTechnique(0).getPass(0).getMaterial(Material::AMBIENT);
+		if (material && material->getName().isValid())
+			return material->getName();
+	}
+
+	return mesh->getName() + "-material" + String::print("%u", profile);
+}
+
+// Write the asset
+void ColladaExporter::writeAsset(XmlWriter &writer)
+{
+	Char date[32] = "1970-01-01T00:00:00Z";
+
+	std::time_t now = std::time(nullptr);
+	std::tm utc;
+#ifdef _MSC_VER
+	if (gmtime_s(&utc, &now) == 0)
+#else
+	if (gmtime_r(&now, &utc))
+#endif
+		std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", &utc);
+
+	writer.beginElement("asset");
+
+	writer.beginElement("contributor");
+	writer.element("authoring_tool", "Objective-3D O3DCollada");
+	writer.endElement();
+
+	writer.element("created", date);
+	writer.element("modified", date);
+
+	writer.beginElement("unit");
+	writer.attribute("name", "meter");
+	writer.attribute("meter", "1");
+	writer.endElement();
+
+	writer.element("up_axis", "Y_UP");
+
+	writer.endElement();
+}
+
+// Write the images of the diffuse maps
+void ColladaExporter::writeImages(XmlWriter &writer)
+{
+	if (m_images.empty())
+		return;
+
+	writer.beginElement("library_images");
+
+	for (std::map<String, String>::const_iterator it = m_images.begin(); it != m_images.end(); ++it)
+	{
+		String uri = it->first;
+		uri.replace('\\', '/');
+		uri.replace(" ", "%20");
+
+		writer.beginElement("image");
+		writer.attribute("id", it->second);
+		writer.attribute("name", it->second);
+		writer.element("init_from", uri);
+		writer.endElement();
+	}
+
+	writer.endElement();
+}
+
+// Write an effect per material
+void ColladaExporter::writeEffects(XmlWriter &writer)
+{
+	if (m_materialOrder.empty())
+		return;
+
+	writer.beginElement("library_effects");
+
+	for (const String &name : m_materialOrder)
+	{
+		const MaterialEntry &entry = m_materials[name];
+
+		writer.beginElement("effect");
+		writer.attribute("id", entry.id + "-fx");
+		writer.attribute("name", name);
+		writer.beginElement("profile_COMMON");
+
+		if (entry.imageId.isValid())
+		{
+			writer.beginElement("newparam");
+			writer.attribute("sid", entry.id + "-surface");
+			writer.beginElement("surface");
+			writer.attribute("type", "2D");
+			writer.element("init_from", entry.imageId);
+			writer.endElement();
+			writer.endElement();
+
+			writer.beginElement("newparam");
+			writer.attribute("sid", entry.id + "-sampler");
+			writer.beginElement("sampler2D");
+			writer.element("source", entry.id + "-surface");
+			writer.endElement();
+			writer.endElement();
+		}
+
+		writer.beginElement("technique");
+		writer.attribute("sid", "common");
+		writer.beginElement("phong");
+
+		if (entry.pass)
+		{
+			writeColor(writer, "emission", entry.pass->getEmission());
+			writeColor(writer, "ambient", entry.pass->getAmbient());
+
+			if (entry.imageId.isValid())
+			{
+				writer.beginElement("diffuse");
+				writer.beginElement("texture");
+				writer.attribute("texture", entry.id + "-sampler");
+				writer.attribute("texcoord", "UVMap");
+				writer.endElement();
+				writer.endElement();
+			}
+			else
+			{
+				writeColor(writer, "diffuse", entry.pass->getDiffuse());
+			}
+
+			writeColor(writer, "specular", entry.pass->getSpecular());
+			writeFloat(writer, "shininess", entry.pass->getShine());
+			writeFloat(writer, "transparency", entry.pass->getTransparency());
+		}
+		else
+		{
+			writeColor(writer, "diffuse", Color(0.8f, 0.8f, 0.8f, 1.f));
+		}
+
+		writer.endElement();
+		writer.endElement();
+		writer.endElement();
+		writer.endElement();
+	}
+
+	writer.endElement();
+}
+
+// Write the materials
+void ColladaExporter::writeMaterials(XmlWriter &writer)
+{
+	if (m_materialOrder.empty())
+		return;
+
+	writer.beginElement("library_materials");
+
+	for (const String &name : m_materialOrder)
+	{
+		const MaterialEntry &entry = m_materials[name];
+
+		writer.beginElement("material");
+		writer.attribute("id", entry.id);
+		writer.attribute("name", name);
+		writer.beginElement("instance_effect");
+		writer.reference("url", entry.id + "-fx");
+		writer.endElement();
+		writer.endElement();
+	}
+
+	writer.endElement();
+}
+
+// Write the geometries
+void ColladaExporter::writeGeometries(XmlWriter &writer)
+{
+	if (m_geometryOrder.empty())
+		return;
+
+	writer.beginElement("library_geometries");
+
+	for (const o3d::MeshData *meshData : m_geometryOrder)
+	{
+		const GeometryEntry &entry = m_geometries[meshData];
+		GeometryData *geometry = entry.meshData->getGeometry();
+
+		const Float *positions = getElementData(geometry, V_VERTICES_ARRAY);
+		const Float *normals = getElementData(geometry, V_NORMALS_ARRAY);
+		const Float *texCoords = getElementData(geometry, V_UV_MAP_ARRAY);
+
+		writer.beginElement("geometry");
+		writer.attribute("id", entry.id);
+		writer.attribute("name", entry.meshData->getName());
+		writer.beginElement("mesh");
+
+		writeSource(writer, entry.id + "-positions", positions, entry.numVertices*3, 3, XYZ_PARAMS, 3);
+
+		if (normals)
+			writeSource(writer, entry.id + "-normals", normals, entry.numVertices*3, 3, XYZ_PARAMS, 3);
+
+		if (texCoords)
+			writeSource(writer, entry.id + "-uv", texCoords, entry.numVertices*2, 2, ST_PARAMS, 2);
+
+		writer.beginElement("vertices");
+		writer.attribute("id", entry.id + "-vertices");
+		writer.beginElement("input");
+		writer.attribute("semantic", "POSITION");
+		writer.reference("source", entry.id + "-positions");
+		writer.endElement();
+		writer.endElement();
+
+		// vertices are already welded, the inputs share a single index
+		for (UInt32 i = 0; i < geometry->getNumFaceArrays(); ++i)
+		{
+			const UInt16 *faces16;
+			const UInt32 *faces32;
+			size_t count;
+
+			getFaces(geometry->getFaceArray(i), faces16, faces32, count);
+			if (count < 3)
+				continue;
+
+			writer.beginElement("triangles");
+			writer.attribute("material", String::print("material%u", i));
+			writer.attribute("count", (UInt32)(count / 3));
+
+			writer.beginElement("input");
+			writer.attribute("semantic", "VERTEX");
+			writer.reference("source", entry.id + "-vertices");
+			writer.attribute("offset", 0u);
+			writer.endElement();
+
+			if (normals)
+			{
+				writer.beginElement("input");
+				writer.attribute("semantic", "NORMAL");
+				writer.reference("source", entry.id + "-normals");
+				writer.attribute("offset", 0u);
+				writer.endElement();
+			}
+
+			if (texCoords)
+			{
+				writer.beginElement("input");
+				writer.attribute("semantic", "TEXCOORD");
+				writer.reference("source", entry.id + "-uv");
+				writer.attribute("offset", 0u);
+				writer.attribute("set", 0u);
+				writer.endElement();
+			}
+
+			writer.beginElement("p");
+			if (faces16)
+				writer.uints(faces16, count - count % 3);
+			else
+				writer.uints(faces32, count - count % 3);
+			writer.endElement();
+
+			writer.endElement();
+		}
+
+		writer.endElement();
+		writer.endElement();
+	}
+
+	writer.endElement();
+}
+
+// Write the skin controllers
+void ColladaExporter::writeControllers(XmlWriter &writer)
+{
+	if (m_controllerOrder.empty())
+		return;
+
+	writer.beginElement("library_controllers");
+
+	for (const o3d::Skinning *key : m_controllerOrder)
+	{
+		ControllerEntry &entry = m_controllers[key];
+		o3d::Skinning *skinning = entry.skinning;
+
+		const GeometryEntry &geometryEntry = m_geometries[skinning->getMeshData()];
+		GeometryData *geometry = geometryEntry.meshData->getGeometry();
+
+		const UInt32 numBones = skinning->getNumBones();
+
+		// joints, by their id used as sid, and their inverse bind matrices
+		std::vector<String> joints(numBones);
+		std::vector<Float> invBindMatrices(numBones*16);
+
+		for (UInt32 i = 0; i < numBones; ++i)
+		{
+			o3d::Bones *bones = skinning->getBone(i);
+
+			std::map<const o3d::BaseNode*, String>::const_iterator it = m_nodeIds.find(bones);
+			if (it != m_nodeIds.end())
+			{
+				joints[i] = it->second;
+			}
+			else
+			{
+				joints[i] = String::print("joint%u", i);
+				O3D_WARNING(String("Bones of ") + skinning->getName() + " not found into the exported nodes");
+			}
+
+			AnimationSampler::toRowMajor(skinning->getRefMatrix(i).invertStd(), &invBindMatrices[i*16]);
+		}
+
+		// the skeleton starts at the root bones of the first joint
+		if (numBones && skinning->getBone(0))
+		{
+			o3d::BaseNode *root = skinning->getBone(0);
+			while (root->getNode() && root->getNode()->getType() == ENGINE_BONES)
+				root = root->getNode();
+
+			std::map<const o3d::BaseNode*, String>::const_iterator it = m_nodeIds.find(root);
+			if (it != m_nodeIds.end())
+				entry.skeletonId = it->second;
+		}
+
+		// up to 4 influences per vertex, unused ones have a negative bone index
+		const Float *bonesId = getElementData(geometry, V_SKINNING_ARRAY);
+		const Float *weighting = getElementData(geometry, V_WEIGHTING_ARRAY);
+
+		std::vector<Float> weights;
+		std::vector<UInt32> vcount(geometryEntry.numVertices, 0);
+		std::vector<UInt32> v;
+
+		if (bonesId && weighting)
+		{
+			weights.reserve(geometryEntry.numVertices);
+			v.reserve(geometryEntry.numVertices*2);
+
+			for (UInt32 i = 0; i < geometryEntry.numVertices; ++i)
+			{
+				for (UInt32 j = 0; j < 4; ++j)
+				{
+					const Float bone = bonesId[i*4+j];
+					const Float weight = weighting[i*4+j];
+
+					if (bone < 0.f || weight <= 0.f || (UInt32)bone >= numBones)
+						continue;
+
+					v.push_back((UInt32)bone);
+					v.push_back((UInt32)weights.size());
+					weights.push_back(weight);
+
+					++vcount[i];
+				}
+			}
+		}
+
+		writer.beginElement("controller");
+		writer.attribute("id", entry.id);
+		writer.attribute("name", skinning->getName());
+		writer.beginElement("skin");
+		writer.reference("source", entry.geometryId);
+
+		// the vertices are given in bind pose
+		writer.beginElement("bind_shape_matrix");
+		writer.floats(IDENTITY, 16);
+		writer.endElement();
+
+		writeNameSource(writer, entry.id + "-joints", joints, "JOINT");
+		writeSource(writer, entry.id + "-bind-poses", invBindMatrices.data(), invBindMatrices.size(), 16, TRANSFORM_PARAMS, 1, "float4x4");
+		writeSource(writer, entry.id + "-weights", weights.data(), weights.size(), 1, WEIGHT_PARAMS, 1);
+
+		writer.beginElement("joints");
+		writer.beginElement("input");
+		writer.attribute("semantic", "JOINT");
+		writer.reference("source", entry.id + "-joints");
+		writer.endElement();
+		writer.beginElement("input");
+		writer.attribute("semantic", "INV_BIND_MATRIX");
+		writer.reference("source", entry.id + "-bind-poses");
+		writer.endElement();
+		writer.endElement();
+
+		writer.beginElement("vertex_weights");
+		writer.attribute("count", geometryEntry.numVertices);
+		writer.beginElement("input");
+		writer.attribute("semantic", "JOINT");
+		writer.reference("source", entry.id + "-joints");
+		writer.attribute("offset", 0u);
+		writer.endElement();
+		writer.beginElement("input");
+		writer.attribute("semantic", "WEIGHT");
+		writer.reference("source", entry.id + "-weights");
+		writer.attribute("offset", 1u);
+		writer.endElement();
+
+		writer.beginElement("vcount");
+		writer.uints(vcount.data(), vcount.size());
+		writer.endElement();
+
+		writer.beginElement("v");
+		writer.uints(v.data(), v.size());
+		writer.endElement();
+
+		writer.endElement();
+
+		writer.endElement();
+		writer.endElement();
+	}
+
+	writer.endElement();
+}
+
+// Write the animations bound to the exported nodes
+void ColladaExporter::writeAnimations(XmlWriter &writer)
+{
+	Bool opened = False;
+
+	for (const o3d::Node *node : m_nodeOrder)
+	{
+		std::map<const o3d::Node*, AnimationEntry>::const_iterator it = m_animations.find(node);
+		if (it == m_animations.end())
+			continue;
+
+		if (!opened)
+		{
+			writer.beginElement("library_animations");
+			opened = True;
+		}
+
+		if (writeAnimation(writer, node, it->second))
+			++m_numAnimations;
+	}
+
+	if (opened)
+		writer.endElement();
+}
+
+// Bake and write the animation of a node
+Bool ColladaExporter::writeAnimation(XmlWriter &writer, const o3d::Node *node, const AnimationEntry &entry)
+{
+	// keys of any supported track, the times are relative to the duration
+	std::vector<Float> times;
+	AnimationSampler::getKeyTimes(entry.animNode, times);
+
+	if (times.empty())
+		return False;
+
+	Float base[16];
+	AnimationSampler::toRowMajor(node->getTransform() ? node->getTransform()->getMatrix() : Matrix4(), base);
+
+	std::vector<Float> matrices(times.size()*16);
+
+	for (size_t k = 0; k < times.size(); ++k)
+	{
+		Float trs[16];
+		if (!AnimationSampler::sample(entry.animNode, times[k], trs))
+			std::copy(IDENTITY, IDENTITY + 16, trs);
+
+		// the tracks are relative to the transform of the node
+		AnimationSampler::mulRowMajor(base, trs, &matrices[k*16]);
+
+		times[k] *= entry.duration;
+	}
+
+	const String id = m_nodeIds[node] + "-anim";
+
+	writer.beginElement("animation");
+	writer.attribute("id", id);
+
+	writeSource(writer, id + "-input", times.data(), times.size(), 1, TIME_PARAMS, 1);
+	writeSource(writer, id + "-output", matrices.data(), matrices.size(), 16, TRANSFORM_PARAMS, 1, "float4x4");
+	writeNameSource(writer, id + "-interpolation", std::vector<String>(times.size(), "LINEAR"), "INTERPOLATION");
+
+	writer.beginElement("sampler");
+	writer.attribute("id", id + "-sampler");
+
+	static const Char* const semantics[] = { "INPUT", "OUTPUT", "INTERPOLATION" };
+	static const Char* const sources[] = { "-input", "-output", "-interpolation" };
+
+	for (UInt32 i = 0; i < 3; ++i)
+	{
+		writer.beginElement("input");
+		writer.attribute("semantic", semantics[i]);
+		writer.reference("source", id + sources[i]);
+		writer.endElement();
+	}
+
+	writer.endElement();
+
+	writer.beginElement("channel");
+	writer.reference("source", id + "-sampler");
+	writer.attribute("target", m_nodeIds[node] + "/transform");
+	writer.endElement();
+
+	writer.endElement();
+
+	return True;
+}
+
+// Write a node and its sub-tree
+void ColladaExporter::writeNode(XmlWriter &writer, o3d::Node *node)
+{
+	const String &id = m_nodeIds[node];
+
+	writer.beginElement("node");
+	writer.attribute("id", id);
+	writer.attribute("name", node->getName());
+
+	if (m_joints.count(node))
+	{
+		writer.attribute("sid", id);
+		writer.attribute("type", "JOINT");
+	}
+	else
+	{
+		writer.attribute("type", "NODE");
+	}
+
+	++m_numNodes;
+
+	// an animated node targets its matrix
+	if (node->getTransform() || m_animations.count(node))
+	{
+		Float matrix[16];
+		AnimationSampler::toRowMajor(node->getTransform() ? node->getTransform()->getMatrix() : Matrix4(), matrix);
+
+		writer.beginElement("matrix");
+		writer.attribute("sid", "transform");
+		writer.floats(matrix, 16);
+		writer.endElement();
+	}
+
+	for (auto *object : node->getSonList())
+	{
+		o3d::Mesh *mesh = dynamic_cast<o3d::Mesh*>(object);
+		if (!mesh || m_geometries.find(mesh->getMeshData()) == m_geometries.end())
+			continue;
+
+		o3d::Skinning *skinning = dynamic_cast<o3d::Skinning*>(mesh);
+		if (skinning)
+		{
+			const ControllerEntry &entry = m_controllers[skinning];
+
+			writer.beginElement("instance_controller");
+			writer.reference("url", entry.id);
+
+			if (entry.skeletonId.isValid())
+				writer.element("skeleton", String("#") + entry.skeletonId);
+		}
+		else
+		{
+			writer.beginElement("instance_geometry");
+			writer.reference("url", m_geometries[mesh->getMeshData()].id);
+		}
+
+		writeBindMaterial(writer, mesh);
+		writer.endElement();
+	}
+
+	for (auto *object : node->getSonList())
+	{
+		o3d::Node *son = dynamic_cast<o3d::Node*>(object);
+		if (son)
+			writeNode(writer, son);
+	}
+
+	writer.endElement();
+}
+
+// Write the binding of the triangles groups of a mesh to its materials
+void ColladaExporter::writeBindMaterial(XmlWriter &writer, o3d::Mesh *mesh)
+{
+	const UInt32 numProfiles = mesh->getNumMaterialProfiles();
+	if (!numProfiles)
+		return;
+
+	const UInt32 numFaceArrays = mesh->getMeshData()->getGeometry()->getNumFaceArrays();
+
+	writer.beginElement("bind_material");
+	writer.beginElement("technique_common");
+
+	for (UInt32 i = 0; i < numFaceArrays; ++i)
+	{
+		// a face array per material profile, the last one being shared by the others
+		const String name = getMaterialName(mesh, o3d::min(i, numProfiles - 1));
+
+		writer.beginElement("instance_material");
+		writer.attribute("symbol", String::print("material%u", i));
+		writer.reference("target", m_materials[name].id);
+		writer.endElement();
+	}
+
+	writer.endElement();
+	writer.endElement();
+}
+
+// Write a source of floats with its accessor
+void ColladaExporter::writeSource(
+		XmlWriter &writer,
+		const String &id,
+		const Float *values,
+		size_t count,
+		UInt32 stride,
+		const Char *const *params,
+		UInt32 numParams,
+		const Char *type)
+{
+	writer.beginElement("source");
+	writer.attribute("id", id);
+
+	writer.beginElement("float_array");
+	writer.attribute("id", id + "-array");
+	writer.attribute("count", (UInt32)count);
+	writer.floats(values, count);
+	writer.endElement();
+
+	writer.beginElement("technique_common");
+	writer.beginElement("accessor");
+	writer.reference("source", id + "-array");
+	writer.attribute("count", (UInt32)(count / stride));
+	writer.attribute("stride", stride);
+
+	for (UInt32 i = 0; i < numParams; ++i)
+	{
+		writer.beginElement("param");
+		writer.attribute("name", params[i]);
+		writer.attribute("type", type);
+		writer.endElement();
+	}
+
+	writer.endElement();
+	writer.endElement();
+
+	writer.endElement();
+}
+
+// Write a source of names with its accessor
+void ColladaExporter::writeNameSource(
+		XmlWriter &writer,
+		const String &id,
+		const std::vector<String> &names,
+		const Char *param)
+{
+	writer.beginElement("source");
+	writer.attribute("id", id);
+
+	writer.beginElement("Name_array");
+	writer.attribute("id", id + "-array");
+	writer.attribute("count", (UInt32)names.size());
+
+	for (size_t i = 0; i < names.size(); ++i)
+		writer.text(i > 0 ? String(" ") + names[i] : names[i]);
+
+	writer.endElement();
+
+	writer.beginElement("technique_common");
+	writer.beginElement("accessor");
+	writer.reference("source", id + "-array");
+	writer.attribute("count", (UInt32)names.size());
+	writer.attribute("stride", 1u);
+	writer.beginElement("param");
+	writer.attribute("name", param);
+	writer.attribute("type", "Name");
+	writer.endElement();
+	writer.endElement();
+	writer.endElement();
+
+	writer.endElement();
+}
@@ -10,6 +10,9 @@
 #include "o3d/collada/precompiled.h"
 #include "o3d/collada/material.h"
 #include "o3d/collada/geometry.h"
+#include "o3d/collada/session.h"
+#include "o3d/collada/meshlets.h"
+#include "o3d/collada/bvh.h"
 
 #include <o3d/engine/scene/scene.h>
 #include <o3d/engine/object/mesh.h>
@@ -18,9 +21,193 @@
 #include <o3d/engine/scene/sceneobjectmanager.h>
 #include <o3d/engine/material/materialpass.h>
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <thread>
+
 using namespace o3d;
 using namespace o3d::collada;
 
+namespace {
+
+//! Maximum number of vertices addressable by a 16 bits face array.
+const UInt32 MAX_CHUNK_VERTICES = 65536;
+
+//! A triangle to partition, referenced by its face list and first index.
+struct ChunkTriangle
+{
+	UInt32 list;
+	UInt32 offset;
+	Float center[3];
+};
+
+struct ChunkCenterLess
+{
+	ChunkCenterLess(UInt32 _axis) : axis(_axis) {}
+
+	Bool operator() (const ChunkTriangle &a, const ChunkTriangle &b) const
+	{
+		return a.center[axis] < b.center[axis];
+	}
+
+	UInt32 axis;
+};
+
+//! Count the distinct vertices referenced by a range of triangles.
+UInt32 countChunkVertices(
+	const std::vector<const UInt32*> &faces,
+	const std::vector<ChunkTriangle> &tris,
+	size_t first,
+	size_t last,
+	std::vector<UInt32> &stamp,
+	UInt32 &stampId)
+{
+	UInt32 count = 0;
+	++stampId;
+
+	for (size_t t = first; t < last; ++t)
+	{
+		const UInt32 *indices = faces[tris[t].list] + tris[t].offset;
+		for (UInt32 k = 0; k < 3; ++k)
+		{
+			if (stamp[indices[k]] != stampId)
+			{
+				stamp[indices[k]] = stampId;
+				++count;
+			}
+		}
+	}
+
+	return count;
+}
+
+//! Recursively split a range of triangles at the median of the longest axis of
+//! their centers, until each range references less than MAX_CHUNK_VERTICES vertices.
+void splitChunkRanges(
+	const std::vector<const UInt32*> &faces,
+	std::vector<ChunkTriangle> &tris,
+	size_t first,
+	size_t last,
+	std::vector<UInt32> &stamp,
+	UInt32 &stampId,
+	std::vector<std::pair<size_t, size_t> > &ranges)
+{
+	if ((last - first <= 1) ||
+		(countChunkVertices(faces, tris, first, last, stamp, stampId) < MAX_CHUNK_VERTICES))
+	{
+		ranges.push_back(std::make_pair(first, last));
+		return;
+	}
+
+	Float bmin[3] = {
+		std::numeric_limits<Float>::max(),
+		std::numeric_limits<Float>::max(),
+		std::numeric_limits<Float>::max() };
+
+	Float bmax[3] = {
+		-std::numeric_limits<Float>::max(),
+		-std::numeric_limits<Float>::max(),
+		-std::numeric_limits<Float>::max() };
+
+	for (size_t t = first; t < last; ++t)
+	{
+		for (UInt32 k = 0; k < 3; ++k)
+		{
+			bmin[k] = o3d::min(bmin[k], tris[t].center[k]);
+			bmax[k] = o3d::max(bmax[k], tris[t].center[k]);
+		}
+	}
+
+	UInt32 axis = 0;
+	if ((bmax[1] - bmin[1]) > (bmax[axis] - bmin[axis]))
+		axis = 1;
+	if ((bmax[2] - bmin[2]) > (bmax[axis] - bmin[axis]))
+		axis = 2;
+
+	size_t middle = first + (last - first) / 2;
+	std::nth_element(tris.begin() + first, tris.begin() + middle, tris.begin() + last, ChunkCenterLess(axis));
+
+	splitChunkRanges(faces, tris, first, middle, stamp, stampId, ranges);
+	splitChunkRanges(faces, tris, middle, last, stamp, stampId, ranges);
+}
+
+//! Minimal number of items processed by a thread.
+const size_t MIN_ITEMS_PER_THREAD = 16384;
+
+//! Call func(begin, end) over contiguous ranges of [0, count), one per thread. The
+//! calling thread processes the first range.
+template <class F>
+void parallelRanges(size_t count, UInt32 numThreads, F func)
+{
+	const size_t maxThreads = (count + MIN_ITEMS_PER_THREAD - 1) / MIN_ITEMS_PER_THREAD;
+	numThreads = (UInt32)o3d::min<size_t>(numThreads, maxThreads);
+
+	if (numThreads <= 1)
+	{
+		func((size_t)0, count);
+		return;
+	}
+
+	const size_t step = (count + numThreads - 1) / numThreads;
+	std::vector<std::thread> threads;
+
+	for (size_t begin = step; begin < count; begin += step)
+		threads.push_back(std::thread(func, begin, o3d::min(count, begin + step)));
+
+	func((size_t)0, step);
+
+	for (std::thread &thread : threads)
+		thread.join();
+}
+
+//! Convert a direction or a position to the Y up axis.
+inline void toYUp(UInt32 upAxis, Float *v)
+{
+	if (upAxis == X)
+	{
+		Float tmp;
+		tmp = v[Y];
+		v[Y] = v[X];
+		v[X] = tmp;
+	}
+	else if (upAxis == Z)
+	{
+		Float tmp;
+		tmp = v[Z];
+		v[Z] = -v[Y];
+		v[Y] = tmp;
+	}
+}
+
+inline void crossProduct(const Float *a, const Float *b, Float *r)
+{
+	r[0] = a[1]*b[2] - a[2]*b[1];
+	r[1] = a[2]*b[0] - a[0]*b[2];
+	r[2] = a[0]*b[1] - a[1]*b[0];
+}
+
+inline Float dotProduct(const Float *a, const Float *b)
+{
+	return a[0]*b[0] + a[1]*b[1] + a[2]*b[2];
+}
+
+//! Normalize a vector, returns False if it is too small.
+inline Bool normalizeVector(Float *v)
+{
+	const Float len = std::sqrt(dotProduct(v, v));
+	if (len < 1e-12f)
+		return False;
+
+	v[0] /= len;
+	v[1] /= len;
+	v[2] /= len;
+
+	return True;
+}
+
+} // anonymous namespace
+
 // Default ctor.
 CGeometry::CGeometry(
 	o3d::Scene *scene,
@@ -30,10 +217,15 @@ CGeometry::CGeometry(
 	const domBind_materialRef mat) :
 		CBaseObject(scene,dom,infos),
 		m_asSkinning(False),
+		m_reusable(True),
         m_node(nullptr),
 		m_geometry(geo),
 		m_material(mat),
-		m_CMaterial(scene,dom,infos,mat->getTechnique_common()->getInstance_material_array())
+		m_CMaterial(scene,dom,infos,mat->getTechnique_common()->getInstance_material_array()),
+		m_numVertices(0),
+		m_indices16(True),
+		m_numCorners(0),
+		m_numToleranceMerges(0)
 {
 }
 
@@ -42,7 +234,7 @@ CGeometry::~CGeometry()
 {
 }
 
-void CGeometry::Offsets::setInputs(domInputLocalOffset_Array &inputs)
+void CGeometry::Offsets::setInputs(domInputLocalOffset_Array &inputs, const NumericArrays *arrays)
 {
 	// inputs with offsets
 	for (UInt32 i = 0; i < inputs.getCount(); i++)
@@ -62,14 +254,28 @@ void CGeometry::Offsets::setInputs(domInputLocalOffset_Array &inputs)
 		{
 			normalStride = (Int32)source->getTechnique_common()->getAccessor()->getStride();
 			normalOffset = thisoffset;
-			normalFloats = &source->getFloat_array()->getValue();
+			normalFloats = NumericArrays::getFloats(arrays, source->getFloat_array());
 		}
 		else if((texture1Offset == -1) && ((strcmp("TEXCOORD", inputs[i]->getSemantic()) == 0) ||
 				(strcmp("UV", inputs[i]->getSemantic()) == 0)))
 		{
 			texture1Stride = (Int32)source->getTechnique_common()->getAccessor()->getStride();
 			texture1Offset = thisoffset;
-			texture1Floats = &source->getFloat_array()->getValue();
+			texture1Floats = NumericArrays::getFloats(arrays, source->getFloat_array());
+		}
+		else if((tangentOffset == -1) && ((strcmp("TEXTANGENT", inputs[i]->getSemantic()) == 0) ||
+				(strcmp("TANGENT", inputs[i]->getSemantic()) == 0)))
+		{
+			tangentStride = (Int32)source->getTechnique_common()->getAccessor()->getStride();
+			tangentOffset = thisoffset;
+			tangentFloats = NumericArrays::getFloats(arrays, source->getFloat_array());
+		}
+		else if((bitangentOffset == -1) && ((strcmp("TEXBINORMAL", inputs[i]->getSemantic()) == 0) ||
+				(strcmp("BINORMAL", inputs[i]->getSemantic()) == 0)))
+		{
+			bitangentStride = (Int32)source->getTechnique_common()->getAccessor()->getStride();
+			bitangentOffset = thisoffset;
+			bitangentFloats = NumericArrays::getFloats(arrays, source->getFloat_array());
 		}
 	}
 	maxOffset++;
@@ -84,22 +290,36 @@ void CGeometry::Offsets::setInputs(domInputLocalOffset_Array &inputs)
 		if (strcmp("POSITION", vertices_inputs[i]->getSemantic()) == 0)
 		{
 			positionStride = (Int32)source->getTechnique_common()->getAccessor()->getStride();
-			positionFloats = &source->getFloat_array()->getValue();
+			positionFloats = NumericArrays::getFloats(arrays, source->getFloat_array());
 			positionNum = (Int32)source->getFloat_array()->getCount() / positionStride;
 		}
 		else if(strcmp("NORMAL", vertices_inputs[i]->getSemantic()) == 0)
 		{
-			normalFloats = &source->getFloat_array()->getValue();
+			normalFloats = NumericArrays::getFloats(arrays, source->getFloat_array());
 			normalOffset = positionOffset;
 			normalStride = (Int32)source->getTechnique_common()->getAccessor()->getStride();
 		}
 		else if((strcmp("TEXCOORD", vertices_inputs[i]->getSemantic()) == 0) ||
 				(strcmp("UV", vertices_inputs[i]->getSemantic()) == 0))
 		{
-			texture1Floats = &source->getFloat_array()->getValue();
+			texture1Floats = NumericArrays::getFloats(arrays, source->getFloat_array());
 			texture1Offset = positionOffset;
 			texture1Stride = (Int32)source->getTechnique_common()->getAccessor()->getStride();
 		}
+		else if((strcmp("TEXTANGENT", vertices_inputs[i]->getSemantic()) == 0) ||
+				(strcmp("TANGENT", vertices_inputs[i]->getSemantic()) == 0))
+		{
+			tangentFloats = NumericArrays::getFloats(arrays, source->getFloat_array());
+			tangentOffset = positionOffset;
+			tangentStride = (Int32)source->getTechnique_common()->getAccessor()->getStride();
+		}
+		else if((strcmp("TEXBINORMAL", vertices_inputs[i]->getSemantic()) == 0) ||
+				(strcmp("BINORMAL", vertices_inputs[i]->getSemantic()) == 0))
+		{
+			bitangentFloats = NumericArrays::getFloats(arrays, source->getFloat_array());
+			bitangentOffset = positionOffset;
+			bitangentStride = (Int32)source->getTechnique_common()->getAccessor()->getStride();
+		}
 	}
 }
 
@@ -109,12 +329,38 @@ Bool CGeometry::import()
 	m_StrId = m_geometry->getId() ? m_geometry->getId() : "";
 	m_name = m_geometry->getName();
 
+	ProfileScope scope(m_infos.getProfiler(), "geometry", m_name);
+
+	// already converted by a previous import of the session, and still in the scene
+	// (not known from a worker thread, that cannot access the scene). The meshlets are
+	// built from the converted arrays, so the geometry is converted again for them.
+	ColladaSession *session = m_infos.getSession();
+	if (session && m_reusable && !m_infos.isAsync() && !m_infos.getMeshletGeneration())
+	{
+		m_sessionKey = ColladaSession::getElementKey(m_geometry);
+
+		const ColladaSession::MeshDataEntry *entry = session->findMeshData(m_sessionKey);
+
+		// the mesh data is then found by name during toScene
+		if (entry && m_scene->getMeshDataManager()->isMeshData(entry->resourceName))
+		{
+			m_numVertices = entry->numVertices;
+
+			m_CMaterial.import();
+			m_CMaterial.setTangentSpace(entry->tangentSpace);
+			return True;
+		}
+	}
+
 	if (m_geometry->getSpline().cast())
 	{
 		O3D_ERROR(E_InvalidFormat("Unsupported spline feature"));
 		return False;
 	}
 
+	// the effects tell if the tangent frames are needed
+	m_CMaterial.import();
+
 	if (m_geometry->getMesh().cast())
 	{
 		// firstly process vertices
@@ -162,9 +408,31 @@ Bool CGeometry::import()
 			const domPolylist_Array &polysArray = mesh->getPolylist_array();
 			buildPolygonList(polysArray);
 		}
+
+		// the tangent frames of the document are not welded if no bump material uses them
+		if (!m_CMaterial.needTangentSpace())
+		{
+			for (FaceList &faceList : m_facesList)
+			{
+				faceList.offsets.tangentOffset = -1;
+				faceList.offsets.bitangentOffset = -1;
+			}
+		}
+
+		// the face lists only read the resolved arrays from now, so the conversion runs
+		// concurrently with the other imports
+		DaeUnlock unlock;
+
+		// normals and tangent frames are generated before the welding, to weld them too
+		generateNormals();
+		generateTangents();
+		weldVertices();
+
+		buildVertexArrays();
 	}
 
-	m_CMaterial.import();
+	buildTangentSpace();
+	m_CMaterial.setTangentSpace(m_tangents.isValid() && m_bitangents.isValid());
 
 	return True;
 }
@@ -180,14 +448,42 @@ Bool CGeometry::doExport()
 // Set post-import values to the scene
 Bool CGeometry::toScene()
 {
+	ProfileScope scope(m_infos.getProfiler(), "toScene", m_name);
+
 	m_infos.setCurrentName(m_name);
 
+	// large static geometry can be partitioned into 16 bits indexed chunks
+	if (!m_asSkinning && m_infos.getMeshSplitting() && (getNumVerticesDup() >= MAX_CHUNK_VERTICES))
+		return toSceneChunks();
+
     o3d::MeshData *meshData = nullptr;
 
+	// vertices
+	// transform by shape matrix
+	if (m_asSkinning && m_vertices.isValid())
+	{
+		for (UInt32 i = 0; i < m_numVertices*3; i += 3)
+		{
+			Vector3 vec(&m_vertices[i]);
+			vec = m_shapeMatrix * vec;
+
+			m_vertices[i] = vec[X];
+			m_vertices[i+1] = vec[Y];
+			m_vertices[i+2] = vec[Z];
+		}
+	}
+
 	// exists ?
 	if (m_scene->getMeshDataManager()->isMeshData(m_name + ".o3dms"))
 	{
 		meshData = m_scene->getMeshDataManager()->addMeshData(m_name + ".o3dms");
+
+		// created by a previous import, whose meshlets and bounds are not in the
+		// libraries of this one
+		if (m_vertices.isValid())
+			buildMeshletsAndBvh(meshData->getResourceName());
+
+		setBvhBounds(meshData);
 	}
 	// create
 	else
@@ -203,38 +499,26 @@ Bool CGeometry::toScene()
 		meshData->setGeometry(new o3d::GeometryData(meshData));
         //meshData->getGeometry()->setInterleave(True);
 
-		// vertices
-		// transform by shape matrix
-		if (m_asSkinning)
-		{
-			for (Int32 i = 0; i < m_vertices.getSize(); i += 3)
-			{
-				Vector3 vec(&m_vertices[i]);
-				vec = m_shapeMatrix * vec;
-
-				m_vertices[i] = vec[X];
-				m_vertices[i+1] = vec[Y];
-				m_vertices[i+2] = vec[Z];
-			}
-		}
-		meshData->getGeometry()->createElement(
-				V_VERTICES_ARRAY,
-				SmartArrayFloat(m_vertices.getData(),m_vertices.getSize()));
+		// arrays are built at their final size during import, so they are shared, not copied
+		meshData->getGeometry()->createElement(V_VERTICES_ARRAY, m_vertices);
 
 		// normals
         if (m_normals.isValid())
 		{
-			meshData->getGeometry()->createElement(
-					V_NORMALS_ARRAY,
-					SmartArrayFloat(m_normals.getData(),m_normals.getSize()));
+			meshData->getGeometry()->createElement(V_NORMALS_ARRAY, m_normals);
 		}
 
 		// texture coordinates
         if (m_texCoords.isValid())
 		{
-			meshData->getGeometry()->createElement(
-                        V_UV_MAP_ARRAY,
-                        SmartArrayFloat(m_texCoords.getData(),m_texCoords.getSize()));
+			meshData->getGeometry()->createElement(V_UV_MAP_ARRAY, m_texCoords);
+		}
+
+		// tangent space
+		if (m_tangents.isValid() && m_bitangents.isValid())
+		{
+			meshData->getGeometry()->createElement(V_TANGENT_ARRAY, m_tangents);
+			meshData->getGeometry()->createElement(V_BITANGENT_ARRAY, m_bitangents);
 		}
 
 		// texture coordinates
@@ -249,47 +533,45 @@ Bool CGeometry::toScene()
 			meshData->getGeometry()->createElement(V_WEIGHTING_ARRAY, m_weighting);
 		}
 
+		if (m_asSkinning && m_infos.getAnimatedBoundsGeneration())
+			computeBoneBounds();
+
 		for (size_t i = 0; i < m_facesList.size(); ++i)
 		{
             FaceArray *faceArray = nullptr;
-			ArrayUInt32 &faces = m_facesList[i].faces;
 
-			if (m_vertices.getSize()/3 < 65536)
+			if (m_indices16)
 			{
                 faceArray = new FaceArrayUInt16(meshData->getScene()->getContext(), P_TRIANGLES);//,m_infos.getFaceArrayMem());
-
-				if (faces.getSize() > 0)
-				{
-					SmartArrayUInt16 facesData(faces.getSize());
-					for (Int32 j = 0; j < faces.getSize(); ++j)
-					{
-						facesData[j] = (UInt16)faces[j];
-					}
-
-					reinterpret_cast<FaceArrayUInt16*>(faceArray)->setFaces(facesData);
-				}
-				else
-					reinterpret_cast<FaceArrayUInt16*>(faceArray)->setFaces(
-							SmartArrayUInt16());
+				reinterpret_cast<FaceArrayUInt16*>(faceArray)->setFaces(m_facesList[i].faces16);
 			}
 			else
 			{
                 faceArray = new FaceArrayUInt32(meshData->getScene()->getContext(), P_TRIANGLES);//,m_infos.getFaceArrayMem());
-				if (faces.getSize() > 0)
-					reinterpret_cast<FaceArrayUInt32*>(faceArray)->setFaces(
-							SmartArrayUInt32(faces.getData(), faces.getSize()));
-				else
-					reinterpret_cast<FaceArrayUInt32*>(faceArray)->setFaces(
-							SmartArrayUInt32());
+				reinterpret_cast<FaceArrayUInt32*>(faceArray)->setFaces(m_facesList[i].faces32);
 			}
 
 			meshData->getGeometry()->addFaceArray(i, faceArray);
 		}
 
+		buildMeshletsAndBvh(meshData->getResourceName());
+
 		meshData->computeBounding(m_infos.getBoundingMode());
-        meshData->createGeometry();
+
+		if (!m_infos.isHeadless())
+			meshData->createGeometry();
+
+		addToSession(meshData->getResourceName());
 	}
 
+	// the geometry data is now the only owner of the arrays
+	m_vertices = SmartArrayFloat();
+	m_normals = SmartArrayFloat();
+	m_texCoords = SmartArrayFloat();
+	m_tangents = SmartArrayFloat();
+	m_bitangents = SmartArrayFloat();
+	m_facesList.clear();
+
 	// material
 	m_CMaterial.toScene();
 
@@ -299,6 +581,7 @@ Bool CGeometry::toScene()
 		o3d::Skinning *skinning = new Skinning(m_node);
 		skinning->setName(m_name);
 		skinning->setMeshData(meshData);
+		// until the animated bounds, if generated, set a static bounding
 		skinning->setBoundingAutoRegen(True);
 
 		UInt32 numProfiles = m_CMaterial.getNumMaterials();
@@ -310,358 +593,1713 @@ Bool CGeometry::toScene()
 		skinning->initMaterialProfiles();
 
 		m_node->addSonLast(skinning);
+		addToBvh(skinning, meshData);
 	}
 	else
 	{
-		o3d::Mesh *mesh = new Mesh(m_node);
-		mesh->setName(m_name);
-		mesh->setMeshData(meshData);
-
-		UInt32 numProfiles = m_CMaterial.getNumMaterials();
-		mesh->setNumMaterialProfiles(numProfiles);
-
-		for (UInt32 i = 0; i < numProfiles; ++i)
-			m_CMaterial.getMaterial(mesh->getMaterialProfile(i), i);
-
-		mesh->initMaterialProfiles();
-
-		m_node->addSonLast(mesh);
+		createMesh(meshData, m_name);
 	}
 
 	return True;
 }
 
-// Set pre-export values from the scene
-Bool CGeometry::fromScene()
-{
-	O3D_ASSERT(0);
-
-	return True;
-}
-
-void CGeometry::buildLines(const domLines_Array &LinesArray)
+// Set post-import values to the scene, one mesh per chunk
+Bool CGeometry::toSceneChunks()
 {
-	O3D_ASSERT(0);
-}
+	std::vector<o3d::MeshData*> meshDatas;
 
-void CGeometry::buildLineStrip(const domLinestrips_Array &lineStripArray)
-{
-	O3D_ASSERT(0);
-}
+	String chunkName = m_name + "_chunk0";
 
-void CGeometry::buildTriangles(const domTriangles_Array &triangleArray)
-{
-	for (size_t i = 0; i < triangleArray.getCount(); ++i)
+	// exists ? (instanced geometry)
+	while (m_scene->getMeshDataManager()->isMeshData(chunkName + ".o3dms"))
 	{
-		String matName = triangleArray[i]->getMaterial();
-		domInputLocalOffset_Array &inputs = triangleArray[i]->getInput_array();
-		Offsets offsets(inputs);
-
-		m_lookupTable.resize(offsets.positionNum);
+		meshDatas.push_back(m_scene->getMeshDataManager()->addMeshData(chunkName + ".o3dms"));
 
-		UInt32 nbrTriangles = (UInt32)triangleArray[i]->getCount();
-		if (nbrTriangles == 0)
-			continue;
-
-		m_facesList.push_back(FaceList());
-		FaceList &faceList = m_facesList.back();
+		chunkName = m_name + "_chunk";
+		chunkName << (UInt32)meshDatas.size();
+	}
 
-		// set index, they all have the same index since we process deindexer conditioner
-		const domListOfUInts &P = triangleArray[i]->getP()->getValue();
+	// created by a previous import, whose meshlets and bounds are not in the libraries
+	// of this one, the same partition giving the same chunks
+	if (!meshDatas.empty() && m_vertices.isValid() &&
+		(m_infos.getMeshletGeneration() || m_infos.getSceneBvhGeneration()))
+	{
+		std::vector<Chunk> chunks;
+		splitFaces(chunks);
 
-		for (UInt32 ivertex = 0; ivertex < nbrTriangles * 3; ++ivertex)
+		for (size_t c = 0; c < chunks.size() && c < meshDatas.size(); ++c)
 		{
-			faceList.faces.push(setVertexData(offsets, P, ivertex));
+			SmartArrayFloat vertices;
+			gatherChunk(m_vertices, chunks[c], 3, vertices);
+
+			buildChunkMeshletsAndBvh(meshDatas[c]->getResourceName(), chunks[c], vertices);
 		}
 	}
-}
 
-void CGeometry::buildTriangleStrip(const domTristrips_Array &triangleArray)
-{
-	O3D_ASSERT(0);
-}
+	for (o3d::MeshData *meshData : meshDatas)
+		setBvhBounds(meshData);
 
-void CGeometry::buildPolygonList(const domPolylist_Array &polysArray)
-{
-	for (size_t i = 0; i < polysArray.getCount(); ++i)
+	// create
+	if (meshDatas.empty())
 	{
-		String matName = polysArray[i]->getMaterial();
-		domInputLocalOffset_Array &inputs = polysArray[i]->getInput_array();
-		Offsets offsets(inputs);
+		std::vector<Chunk> chunks;
+		splitFaces(chunks);
 
-		m_lookupTable.resize(offsets.positionNum);
+		String msg = String("Found geometry: ") + m_name + " split in ";
+		msg << (UInt32)chunks.size();
+		O3D_MESSAGE(msg + " chunks");
 
-		UInt32 nbrPolys = (UInt32)polysArray[i]->getCount();
-		m_facesList.push_back(FaceList());
-		FaceList &faceList = m_facesList.back();
+		for (size_t c = 0; c < chunks.size(); ++c)
+		{
+			const Chunk &chunk = chunks[c];
 
-		// set index, they all have the same index since we process deindexer conditioner
-		const domListOfUInts &P = polysArray[i]->getP()->getValue();
-		const domListOfUInts &Vcount = polysArray[i]->getVcount()->getValue();
+			chunkName = m_name + "_chunk";
+			chunkName << (UInt32)c;
 
-		UInt32 a,b,c,count;
-		UInt32 v = 0;
+			o3d::MeshData *meshData = new o3d::MeshData(m_scene);
+			meshData->setName(chunkName);
+			meshData->setResourceName(chunkName + ".o3dms");
 
-		for (UInt32 iface = 0; iface < nbrPolys; ++iface)
-		{
-			count = (UInt32)Vcount[iface] - 2;
+			m_scene->getMeshDataManager()->addMeshData(meshData);
+			meshData->setGeometry(new o3d::GeometryData(meshData));
 
-			a = v;
+			// vertices
+			SmartArrayFloat vertices;
+			gatherChunk(m_vertices, chunk, 3, vertices);
+			meshData->getGeometry()->createElement(V_VERTICES_ARRAY, vertices);
 
-			for (UInt32 ivertex = 0; ivertex < count; ++ivertex)
+			// normals
+			if (m_normals.isValid())
 			{
-				b = v+ivertex+1;
-				c = v+ivertex+2;
+				SmartArrayFloat normals;
+				gatherChunk(m_normals, chunk, 3, normals);
+				meshData->getGeometry()->createElement(V_NORMALS_ARRAY, normals);
+			}
 
-				faceList.faces.push(setVertexData(offsets, P, a));
-				faceList.faces.push(setVertexData(offsets, P, b));
-				faceList.faces.push(setVertexData(offsets, P, c));
+			// texture coordinates
+			if (m_texCoords.isValid())
+			{
+				SmartArrayFloat texCoords;
+				gatherChunk(m_texCoords, chunk, 2, texCoords);
+				meshData->getGeometry()->createElement(V_UV_MAP_ARRAY, texCoords);
 			}
 
-			v += count + 2;
+			// tangent space
+			if (m_tangents.isValid() && m_bitangents.isValid())
+			{
+				SmartArrayFloat tangents;
+				SmartArrayFloat bitangents;
+				gatherChunk(m_tangents, chunk, 3, tangents);
+				gatherChunk(m_bitangents, chunk, 3, bitangents);
+				meshData->getGeometry()->createElement(V_TANGENT_ARRAY, tangents);
+				meshData->getGeometry()->createElement(V_BITANGENT_ARRAY, bitangents);
+			}
+
+			// one face array per material, even empty, to keep the material profiles indices
+			for (size_t i = 0; i < chunk.faces.size(); ++i)
+			{
+				FaceArrayUInt16 *faceArray = new FaceArrayUInt16(meshData->getScene()->getContext(), P_TRIANGLES);
+				faceArray->setFaces(chunk.faces[i]);
+
+				meshData->getGeometry()->addFaceArray(i, faceArray);
+			}
+
+			buildChunkMeshletsAndBvh(meshData->getResourceName(), chunk, vertices);
+
+			meshData->computeBounding(m_infos.getBoundingMode());
+
+			if (!m_infos.isHeadless())
+				meshData->createGeometry();
+
+			meshDatas.push_back(meshData);
 		}
+
+		if (!meshDatas.empty())
+			addToSession(meshDatas[0]->getResourceName());
+	}
+
+	m_vertices = SmartArrayFloat();
+	m_normals = SmartArrayFloat();
+	m_texCoords = SmartArrayFloat();
+	m_tangents = SmartArrayFloat();
+	m_bitangents = SmartArrayFloat();
+	m_facesList.clear();
+
+	// material
+	m_CMaterial.toScene();
+
+	for (size_t c = 0; c < meshDatas.size(); ++c)
+	{
+		chunkName = m_name + "_chunk";
+		chunkName << (UInt32)c;
+
+		createMesh(meshDatas[c], chunkName);
 	}
+
+	return True;
 }
 
-UInt32 CGeometry::getTriIndexList(UInt32 *indices, domTriangles *tris, UInt32 triNum)
+// Build the meshlets of the face arrays of a mesh data
+void CGeometry::buildMeshlets(
+	const String &resourceName,
+	const Float *vertices,
+	UInt32 numVertices,
+	const std::vector<const UInt16*> &faces16,
+	const std::vector<const UInt32*> &faces32,
+	const std::vector<UInt32> &numIndices)
 {
-	// All the triangles are in a single P now
-	// The number of indices in a triangle is the number of inputs times 3
-	UInt32 idxCount = 3 * ((UInt32)tris->getInput_array().getCount());
-	// The first index of this triangle is triNum * the number of indices per triangle
-	UInt32 triStart = triNum * idxCount;
-	// Since this is a triangle, we just do a straight copy of the indices into the output array
-	for (UInt32 i = 0; i < idxCount; i++)
+	MeshletLibrary *library = m_infos.getMeshletLibrary();
+	if (!library || !m_infos.getMeshletGeneration() || library->find(resourceName))
+		return;
+
+	ProfileScope scope(m_infos.getProfiler(), "meshlets", resourceName);
+
+	MeshletBuilder builder(m_infos.getMeshletMaxVertices(), m_infos.getMeshletMaxTriangles());
+	MeshletData meshlets;
+
+	for (size_t i = 0; i < numIndices.size(); ++i)
 	{
-		indices[i] = (UInt32)tris->getP()->getValue()[triStart+i];
+		if (numIndices[i] == 0)
+			continue;
+
+		if (faces16[i])
+			builder.build(vertices, numVertices, faces16[i], numIndices[i], (UInt32)i, meshlets);
+		else if (faces32[i])
+			builder.build(vertices, numVertices, faces32[i], numIndices[i], (UInt32)i, meshlets);
 	}
-	return idxCount;
+
+	library->add(resourceName, meshlets);
 }
 
-UInt32 CGeometry::countPotentialTris(domPolygons *polygons)
+// Set the local bounds of a mesh data and build the hierarchy over its triangles
+void CGeometry::buildBvh(
+	const String &resourceName,
+	const Float *vertices,
+	UInt32 numVertices,
+	const std::vector<const UInt16*> &faces16,
+	const std::vector<const UInt32*> &faces32,
+	const std::vector<UInt32> &numIndices)
 {
-	UInt32 numTris = 0;
-	UInt32 numInputs = (UInt32)polygons->getInput_array().getCount();
-	UInt32 count = (UInt32)polygons->getP_array().getCount();
-	for (UInt32 i = 0; i < count; i++)
+	SceneBvh *sceneBvh = m_infos.getSceneBvh();
+	if (!sceneBvh || !m_infos.getSceneBvhGeneration() || numVertices == 0 || sceneBvh->hasMeshBounds(resourceName))
+		return;
+
+	ProfileScope scope(m_infos.getProfiler(), "bvh", resourceName);
+
+	Float bmin[3] = { vertices[0], vertices[1], vertices[2] };
+	Float bmax[3] = { vertices[0], vertices[1], vertices[2] };
+
+	for (UInt32 v = 1; v < numVertices; ++v)
 	{
-		// number of indexes / number of inputs - 2
-		numTris += (UInt32)(polygons->getP_array()[i]->getValue().getCount()/numInputs) - 2;
+		const Float *p = vertices + v*3;
+		for (UInt32 k = 0; k < 3; ++k)
+		{
+			bmin[k] = o3d::min(bmin[k], p[k]);
+			bmax[k] = o3d::max(bmax[k], p[k]);
+		}
 	}
-	return numTris;
+
+	sceneBvh->setMeshBounds(resourceName, bmin, bmax);
+
+	if (m_infos.getMeshBvhGeneration())
+		sceneBvh->buildMeshBvh(resourceName, vertices, faces16, faces32, numIndices, m_infos.getParseThreads());
 }
 
-UInt32 CGeometry::countPotentialTris(domPolylist *pPolylist)
+// Gather the attributes of the vertices of a chunk
+void CGeometry::gatherChunk(const SmartArrayFloat &array, const Chunk &chunk, UInt32 size, SmartArrayFloat &out)
 {
-	UInt32 numTris = 0;
-	UInt32 count = (UInt32)pPolylist->getVcount()->getValue().getCount();
-	for (UInt32 i = 0; i < count; i++)
+	const UInt32 numVertices = (UInt32)chunk.vertices.size();
+	out = SmartArrayFloat(numVertices*size);
+
+	for (UInt32 j = 0; j < numVertices; ++j)
 	{
-		// number of indexes / number of inputs - 2
-		numTris += (UInt32)pPolylist->getVcount()->getValue()[i] - 2;
+		const UInt32 i = chunk.vertices[j] * size;
+
+		for (UInt32 k = 0; k < size; ++k)
+			out[j*size+k] = array[i+k];
 	}
-	return numTris;
 }
 
-UInt32 CGeometry::getMaxOffsetFromInputs(domInputLocalOffset_Array &inputs)
+// Build the meshlets and the hierarchy of a mesh data from the imported arrays
+void CGeometry::buildMeshletsAndBvh(const String &resourceName)
 {
-	UInt32 maxoffset = 0;
-	UInt32 count = (UInt32)inputs.getCount();
-	for (UInt32 i = 0; i < count; i++)
+	if (!m_infos.getMeshletGeneration() && !m_infos.getSceneBvhGeneration())
+		return;
+
+	std::vector<const UInt16*> faces16(m_facesList.size(), nullptr);
+	std::vector<const UInt32*> faces32(m_facesList.size(), nullptr);
+	std::vector<UInt32> numIndices(m_facesList.size(), 0);
+
+	for (size_t i = 0; i < m_facesList.size(); ++i)
+	{
+		faces16[i] = m_indices16 ? m_facesList[i].faces16.getData() : nullptr;
+		faces32[i] = m_indices16 ? nullptr : m_facesList[i].faces32.getData();
+		numIndices[i] = m_facesList[i].numIndices;
+	}
+
+	buildMeshlets(resourceName, m_vertices.getData(), m_numVertices, faces16, faces32, numIndices);
+	buildBvh(resourceName, m_vertices.getData(), m_numVertices, faces16, faces32, numIndices);
+}
+
+// Build the meshlets and the hierarchy of the mesh data of a chunk
+void CGeometry::buildChunkMeshletsAndBvh(const String &resourceName, const Chunk &chunk, const SmartArrayFloat &vertices)
+{
+	if (!m_infos.getMeshletGeneration() && !m_infos.getSceneBvhGeneration())
+		return;
+
+	const UInt32 numVertices = (UInt32)chunk.vertices.size();
+
+	std::vector<const UInt16*> faces16(chunk.faces.size(), nullptr);
+	std::vector<const UInt32*> faces32(chunk.faces.size(), nullptr);
+
+	for (size_t i = 0; i < chunk.faces.size(); ++i)
+		faces16[i] = chunk.numIndices[i] > 0 ? chunk.faces[i].getData() : nullptr;
+
+	buildMeshlets(resourceName, vertices.getData(), numVertices, faces16, faces32, chunk.numIndices);
+	buildBvh(resourceName, vertices.getData(), numVertices, faces16, faces32, chunk.numIndices);
+}
+
+// Set the local bounds of a mesh data from its bounding box if they are not built
+void CGeometry::setBvhBounds(o3d::MeshData *meshData)
+{
+	SceneBvh *sceneBvh = m_infos.getSceneBvh();
+	if (!sceneBvh || !m_infos.getSceneBvhGeneration() || sceneBvh->hasMeshBounds(meshData->getResourceName()))
+		return;
+
+	const AABBox &box = meshData->getGeometry()->getBoundingBox();
+	const Vector3 bmin = box.getMin();
+	const Vector3 bmax = box.getMax();
+
+	sceneBvh->setMeshBounds(meshData->getResourceName(), bmin.getData(), bmax.getData());
+}
+
+// Add a mesh or skinning object into the scene hierarchy
+void CGeometry::addToBvh(o3d::BaseNode *object, o3d::MeshData *meshData)
+{
+	SceneBvh *sceneBvh = m_infos.getSceneBvh();
+	if (!sceneBvh || !m_infos.getSceneBvhGeneration())
+		return;
+
+	sceneBvh->addInstance(object, m_node, meshData->getResourceName());
+}
+
+// Compute the bounds of the vertices influenced by each bone
+void CGeometry::computeBoneBounds()
+{
+	m_boneBounds.clear();
+
+	if (!m_skinning.isValid() || !m_weighting.isValid())
+		return;
+
+	for (UInt32 v = 0; v < m_numVertices; ++v)
+	{
+		const Float *p = &m_vertices[v*3];
+
+		for (UInt32 j = 0; j < 4; ++j)
+		{
+			const Float bone = m_skinning[v*4+j];
+			if (bone < 0.f || m_weighting[v*4+j] <= 0.f)
+				continue;
+
+			const size_t b = (size_t)bone;
+
+			// the bones without any influence have empty bounds
+			while (m_boneBounds.size() < (b+1)*6)
+			{
+				for (UInt32 k = 0; k < 3; ++k)
+					m_boneBounds.push_back(std::numeric_limits<Float>::max());
+				for (UInt32 k = 0; k < 3; ++k)
+					m_boneBounds.push_back(-std::numeric_limits<Float>::max());
+			}
+
+			Float *box = &m_boneBounds[b*6];
+			for (UInt32 k = 0; k < 3; ++k)
+			{
+				box[k] = o3d::min(box[k], p[k]);
+				box[k+3] = o3d::max(box[k+3], p[k]);
+			}
+		}
+	}
+}
+
+// Register the built mesh data into the session
+void CGeometry::addToSession(const String &resourceName)
+{
+	if (!m_infos.getSession() || m_asSkinning || m_sessionKey.isEmpty())
+		return;
+
+	ColladaSession::MeshDataEntry entry;
+	entry.resourceName = resourceName;
+	entry.numVertices = m_numVertices;
+	entry.tangentSpace = m_tangents.isValid() && m_bitangents.isValid();
+
+	m_infos.getSession()->addMeshData(m_sessionKey, entry);
+}
+
+// Create a mesh object into the node and set its material profiles
+o3d::Mesh* CGeometry::createMesh(o3d::MeshData *meshData, const String &name)
+{
+	o3d::Mesh *mesh = new Mesh(m_node);
+	mesh->setName(name);
+	mesh->setMeshData(meshData);
+
+	UInt32 numProfiles = m_CMaterial.getNumMaterials();
+	mesh->setNumMaterialProfiles(numProfiles);
+
+	for (UInt32 i = 0; i < numProfiles; ++i)
+		m_CMaterial.getMaterial(mesh->getMaterialProfile(i), i);
+
+	mesh->initMaterialProfiles();
+
+	m_node->addSonLast(mesh);
+	addToBvh(mesh, meshData);
+
+	return mesh;
+}
+
+// Partition the faces into chunks of less than 65536 vertices
+void CGeometry::splitFaces(std::vector<Chunk> &chunks)
+{
+	const UInt32 numVertices = getNumVerticesDup();
+
+	std::vector<const UInt32*> faces(m_facesList.size());
+	std::vector<ChunkTriangle> tris;
+
+	// more than 65535 vertices means 32 bits indices
+	O3D_ASSERT(!m_indices16);
+
+	for (size_t i = 0; i < m_facesList.size(); ++i)
+	{
+		const UInt32 *listFaces = m_facesList[i].faces32.getData();
+		faces[i] = listFaces;
+
+		for (UInt32 j = 0; j + 2 < m_facesList[i].numIndices; j += 3)
+		{
+			ChunkTriangle tri;
+			tri.list = (UInt32)i;
+			tri.offset = (UInt32)j;
+
+			for (UInt32 k = 0; k < 3; ++k)
+			{
+				tri.center[k] = (
+					m_vertices[listFaces[j+0]*3+k] +
+					m_vertices[listFaces[j+1]*3+k] +
+					m_vertices[listFaces[j+2]*3+k]) * (1.f/3.f);
+			}
+
+			tris.push_back(tri);
+		}
+	}
+
+	std::vector<UInt32> stamp(numVertices, 0);
+	UInt32 stampId = 0;
+
+	std::vector<std::pair<size_t, size_t> > ranges;
+	splitChunkRanges(faces, tris, 0, tris.size(), stamp, stampId, ranges);
+
+	// local index of a global vertex, valid when stamped with the current chunk
+	std::vector<UInt32> local(numVertices, 0);
+
+	chunks.resize(ranges.size());
+
+	for (size_t c = 0; c < ranges.size(); ++c)
+	{
+		Chunk &chunk = chunks[c];
+		++stampId;
+
+		std::vector<UInt32> numIndices(m_facesList.size(), 0);
+		for (size_t t = ranges[c].first; t < ranges[c].second; ++t)
+			numIndices[tris[t].list] += 3;
+
+		chunk.numIndices = numIndices;
+		chunk.faces.resize(m_facesList.size());
+		for (size_t i = 0; i < m_facesList.size(); ++i)
+		{
+			if (numIndices[i] > 0)
+				chunk.faces[i] = SmartArrayUInt16(numIndices[i]);
+		}
+
+		std::vector<UInt32> cursor(m_facesList.size(), 0);
+
+		for (size_t t = ranges[c].first; t < ranges[c].second; ++t)
+		{
+			const UInt32 list = tris[t].list;
+			const UInt32 *indices = faces[list] + tris[t].offset;
+
+			for (UInt32 k = 0; k < 3; ++k)
+			{
+				const UInt32 v = indices[k];
+				if (stamp[v] != stampId)
+				{
+					stamp[v] = stampId;
+					local[v] = (UInt32)chunk.vertices.size();
+					chunk.vertices.push_back(v);
+				}
+
+				chunk.faces[list][cursor[list]++] = (UInt16)local[v];
+			}
+		}
+	}
+}
+
+// Set pre-export values from the scene
+Bool CGeometry::fromScene()
+{
+	O3D_ASSERT(0);
+
+	return True;
+}
+
+// Release any reference to the COLLADA-DOM
+void CGeometry::releaseDom()
+{
+	m_geometry = domGeometryRef();
+	m_material = domBind_materialRef();
+
+	m_CMaterial.releaseDom();
+
+	CBaseObject::releaseDom();
+}
+
+void CGeometry::buildLines(const domLines_Array &LinesArray)
+{
+	O3D_ASSERT(0);
+}
+
+void CGeometry::buildLineStrip(const domLinestrips_Array &lineStripArray)
+{
+	O3D_ASSERT(0);
+}
+
+void CGeometry::buildTriangles(const domTriangles_Array &triangleArray)
+{
+	// estimate the index width before building, the faces are then directly written at their final size
+	UInt32 numIndices = 0;
+	for (size_t i = 0; i < triangleArray.getCount(); ++i)
+		numIndices += (UInt32)triangleArray[i]->getCount() * 3;
+
+	if (triangleArray.getCount())
+		chooseIndexWidth(numIndices, Offsets(triangleArray[0]->getInput_array(), m_infos.getNumericArrays()).positionNum);
+
+	for (size_t i = 0; i < triangleArray.getCount(); ++i)
+	{
+		String matName = triangleArray[i]->getMaterial();
+		domInputLocalOffset_Array &inputs = triangleArray[i]->getInput_array();
+		Offsets offsets(inputs, m_infos.getNumericArrays());
+
+		m_lookupTable.resize(offsets.positionNum);
+
+		UInt32 nbrTriangles = (UInt32)triangleArray[i]->getCount();
+		if (nbrTriangles == 0)
+			continue;
+
+		// set index, they all have the same index since we process deindexer conditioner
+		const domListOfUInts &P = triangleArray[i]->getP()->getValue();
+
+		FaceList &faceList = addFaceList(matName, offsets, &P, nbrTriangles * 3);
+
+		faceList.corners.resize(nbrTriangles * 3);
+		for (UInt32 ivertex = 0; ivertex < nbrTriangles * 3; ++ivertex)
+		{
+			faceList.corners[ivertex] = ivertex;
+		}
+	}
+}
+
+void CGeometry::buildTriangleStrip(const domTristrips_Array &triangleArray)
+{
+	O3D_ASSERT(0);
+}
+
+void CGeometry::buildPolygonList(const domPolylist_Array &polysArray)
+{
+	// estimate the index width before building, the faces are then directly written at their final size
+	UInt32 numIndices = 0;
+	for (size_t i = 0; i < polysArray.getCount(); ++i)
+		numIndices += countPotentialTris(polysArray[i]) * 3;
+
+	if (polysArray.getCount())
+		chooseIndexWidth(numIndices, Offsets(polysArray[0]->getInput_array(), m_infos.getNumericArrays()).positionNum);
+
+	for (size_t i = 0; i < polysArray.getCount(); ++i)
+	{
+		String matName = polysArray[i]->getMaterial();
+		domInputLocalOffset_Array &inputs = polysArray[i]->getInput_array();
+		Offsets offsets(inputs, m_infos.getNumericArrays());
+
+		m_lookupTable.resize(offsets.positionNum);
+
+		UInt32 nbrPolys = (UInt32)polysArray[i]->getCount();
+
+		// set index, they all have the same index since we process deindexer conditioner
+		const domListOfUInts &P = polysArray[i]->getP()->getValue();
+		const domListOfUInts &Vcount = polysArray[i]->getVcount()->getValue();
+
+		FaceList &faceList = addFaceList(matName, offsets, &P, countPotentialTris(polysArray[i]) * 3);
+		faceList.corners.reserve(faceList.maxIndices);
+
+		UInt32 a,b,c,count;
+		UInt32 v = 0;
+
+		for (UInt32 iface = 0; iface < nbrPolys; ++iface)
+		{
+			count = (UInt32)Vcount[iface] - 2;
+
+			a = v;
+
+			for (UInt32 ivertex = 0; ivertex < count; ++ivertex)
+			{
+				b = v+ivertex+1;
+				c = v+ivertex+2;
+
+				faceList.corners.push_back(a);
+				faceList.corners.push_back(b);
+				faceList.corners.push_back(c);
+			}
+
+			v += count + 2;
+		}
+	}
+}
+
+UInt32 CGeometry::getTriIndexList(UInt32 *indices, domTriangles *tris, UInt32 triNum)
+{
+	// All the triangles are in a single P now
+	// The number of indices in a triangle is the number of inputs times 3
+	UInt32 idxCount = 3 * ((UInt32)tris->getInput_array().getCount());
+	// The first index of this triangle is triNum * the number of indices per triangle
+	UInt32 triStart = triNum * idxCount;
+	// Since this is a triangle, we just do a straight copy of the indices into the output array
+	for (UInt32 i = 0; i < idxCount; i++)
+	{
+		indices[i] = (UInt32)tris->getP()->getValue()[triStart+i];
+	}
+	return idxCount;
+}
+
+UInt32 CGeometry::countPotentialTris(domPolygons *polygons)
+{
+	UInt32 numTris = 0;
+	UInt32 numInputs = (UInt32)polygons->getInput_array().getCount();
+	UInt32 count = (UInt32)polygons->getP_array().getCount();
+	for (UInt32 i = 0; i < count; i++)
+	{
+		// number of indexes / number of inputs - 2
+		numTris += (UInt32)(polygons->getP_array()[i]->getValue().getCount()/numInputs) - 2;
+	}
+	return numTris;
+}
+
+UInt32 CGeometry::countPotentialTris(domPolylist *pPolylist)
+{
+	UInt32 numTris = 0;
+	UInt32 count = (UInt32)pPolylist->getVcount()->getValue().getCount();
+	for (UInt32 i = 0; i < count; i++)
+	{
+		// number of indexes / number of inputs - 2
+		numTris += (UInt32)pPolylist->getVcount()->getValue()[i] - 2;
+	}
+	return numTris;
+}
+
+UInt32 CGeometry::getMaxOffsetFromInputs(domInputLocalOffset_Array &inputs)
+{
+	UInt32 maxoffset = 0;
+	UInt32 count = (UInt32)inputs.getCount();
+	for (UInt32 i = 0; i < count; i++)
+	{
+		UInt32 thisoffset  = (UInt32)inputs[i]->getOffset();
+		if (maxoffset < thisoffset) maxoffset++;
+	}
+	return maxoffset + 1;
+}
+
+// Choose the face index width from an estimation of the number of vertices
+void CGeometry::chooseIndexWidth(UInt32 numIndices, UInt32 numPositions)
+{
+	// there cannot be more welded vertices than indices, and there are rarely much more
+	// welded vertices than positions. if the guess is wrong indices are widened once.
+	m_indices16 = (numIndices <= MAX_CHUNK_VERTICES) || (numPositions < MAX_CHUNK_VERTICES);
+}
+
+// Add a face list and allocate its exact number of indices
+CGeometry::FaceList& CGeometry::addFaceList(
+	const String &material,
+	const Offsets &offsets,
+	const domListOfUInts *values,
+	UInt32 numIndices)
+{
+	m_facesList.push_back(FaceList(material, offsets, values));
+	FaceList &faceList = m_facesList.back();
+	faceList.maxIndices = numIndices;
+
+	if (numIndices > 0)
+	{
+		if (m_indices16)
+			faceList.faces16 = SmartArrayUInt16(numIndices);
+		else
+			faceList.faces32 = SmartArrayUInt32(numIndices);
+	}
+
+	return faceList;
+}
+
+// Convert the faces to 32 bits indices, when the estimation was too low
+void CGeometry::widenIndices()
+{
+	for (size_t i = 0; i < m_facesList.size(); ++i)
+	{
+		FaceList &faceList = m_facesList[i];
+		if (!faceList.faces16.isValid())
+			continue;
+
+		SmartArrayUInt32 faces32(faceList.maxIndices);
+		for (UInt32 j = 0; j < faceList.numIndices; ++j)
+			faces32[j] = faceList.faces16[j];
+
+		faceList.faces32 = faces32;
+		faceList.faces16 = SmartArrayUInt16();
+	}
+
+	m_indices16 = False;
+}
+
+// Read the position of the i-th vertex of a face list
+void CGeometry::readPosition(const FaceList &faceList, UInt32 i, Float *vertex) const
+{
+	const Offsets &offset = faceList.offsets;
+
+	if (offset.positionOffset != -1)
+	{
+		const UInt32 i3 = (UInt32)(*faceList.values)[i*offset.maxOffset + offset.positionOffset] * offset.positionStride;
+		vertex[0] = (Float)offset.positionFloats[(size_t)i3+0];
+		vertex[1] = (Float)offset.positionFloats[(size_t)i3+1];
+		vertex[2] = (Float)offset.positionFloats[(size_t)i3+2];
+
+		toYUp(m_infos.getUpAxis(), vertex);
+	}
+}
+
+// Read the attributes of the i-th vertex of a face list
+void CGeometry::readVertex(
+	const FaceList &faceList,
+	UInt32 i,
+	Float *vertex,
+	Float *normal,
+	Float *texCoord,
+	Float *tangent,
+	Float *bitangent) const
+{
+	const Offsets &offset = faceList.offsets;
+	const domListOfUInts &values = *faceList.values;
+
+	UInt32 i2, i3;
+
+	readPosition(faceList, i, vertex);
+
+	if (offset.normalOffset != -1)
+	{
+		i3 = (UInt32)values[i*offset.maxOffset + offset.normalOffset] * offset.normalStride;
+		normal[0] = (Float)offset.normalFloats[(size_t)i3+0];
+		normal[1] = (Float)offset.normalFloats[(size_t)i3+1];
+		normal[2] = (Float)offset.normalFloats[(size_t)i3+2];
+
+		toYUp(m_infos.getUpAxis(), normal);
+	}
+	else if (!faceList.normals.empty())
+	{
+		normal[0] = faceList.normals[(size_t)i*3+0];
+		normal[1] = faceList.normals[(size_t)i*3+1];
+		normal[2] = faceList.normals[(size_t)i*3+2];
+	}
+
+	if (offset.tangentOffset != -1)
+	{
+		i3 = (UInt32)values[i*offset.maxOffset + offset.tangentOffset] * offset.tangentStride;
+		tangent[0] = (Float)offset.tangentFloats[(size_t)i3+0];
+		tangent[1] = (Float)offset.tangentFloats[(size_t)i3+1];
+		tangent[2] = (Float)offset.tangentFloats[(size_t)i3+2];
+
+		toYUp(m_infos.getUpAxis(), tangent);
+	}
+	else if (!faceList.tangents.empty())
+	{
+		tangent[0] = faceList.tangents[(size_t)i*3+0];
+		tangent[1] = faceList.tangents[(size_t)i*3+1];
+		tangent[2] = faceList.tangents[(size_t)i*3+2];
+	}
+
+	if (offset.bitangentOffset != -1)
+	{
+		i3 = (UInt32)values[i*offset.maxOffset + offset.bitangentOffset] * offset.bitangentStride;
+		bitangent[0] = (Float)offset.bitangentFloats[(size_t)i3+0];
+		bitangent[1] = (Float)offset.bitangentFloats[(size_t)i3+1];
+		bitangent[2] = (Float)offset.bitangentFloats[(size_t)i3+2];
+
+		toYUp(m_infos.getUpAxis(), bitangent);
+	}
+	else if (!faceList.bitangents.empty())
+	{
+		bitangent[0] = faceList.bitangents[(size_t)i*3+0];
+		bitangent[1] = faceList.bitangents[(size_t)i*3+1];
+		bitangent[2] = faceList.bitangents[(size_t)i*3+2];
+	}
+
+	if (offset.texture1Offset != -1)
+	{
+		i2 = (UInt32)values[i*offset.maxOffset + offset.texture1Offset] * offset.texture1Stride;
+		texCoord[0] = (Float)offset.texture1Floats[(size_t)i2+0];
+		texCoord[1] = (Float)offset.texture1Floats[(size_t)i2+1];
+
+		if (m_infos.getUpAxis() == X)
+		{
+			texCoord[0] = 1.f - texCoord[0];
+		}
+		else if (m_infos.getUpAxis() == Y)
+		{
+			texCoord[1] = 1.f - texCoord[1];
+		}
+		else if (m_infos.getUpAxis() == Z)
+		{
+			texCoord[1] = 1.f - texCoord[1];
+		}
+	}
+}
+
+namespace {
+
+//! Layout of the attributes of a vertex to weld.
+const UInt32 WELD_POSITION = 0;
+const UInt32 WELD_NORMAL = 3;
+const UInt32 WELD_TEXCOORD = 6;
+const UInt32 WELD_TANGENT = 8;
+const UInt32 WELD_BITANGENT = 11;
+const UInt32 NUM_WELD_COMPONENTS = 14;
+
+//! FNV-1a hash of vertex attributes, with -0 and +0 hashed the same way
+//! since they compare equal.
+inline UInt32 hashFloats(UInt32 hash, const Float *data, UInt32 count)
+{
+	for (UInt32 k = 0; k < count; ++k)
+	{
+		Float f = data[k] == 0.f ? 0.f : data[k];
+		const UInt8 *bytes = reinterpret_cast<const UInt8*>(&f);
+
+		for (UInt32 b = 0; b < sizeof(Float); ++b)
+		{
+			hash ^= bytes[b];
+			hash *= 16777619u;
+		}
+	}
+
+	return hash;
+}
+
+inline Bool equalFloats(const Float *a, const Float *b, UInt32 count)
+{
+	for (UInt32 k = 0; k < count; ++k)
+	{
+		if (a[k] != b[k])
+			return False;
+	}
+
+	return True;
+}
+
+//! Group the items equal to each other, given their hashes and an equality of two
+//! items. Equal items having the same hash, the items are grouped per bucket of
+//! hashes, one bucket per thread. Return the number of groups.
+template <class E>
+UInt32 groupByHash(const std::vector<UInt32> &hashes, UInt32 numThreads, E equal, std::vector<UInt32> &groups)
+{
+	const size_t count = hashes.size();
+	const UInt32 numBuckets = (UInt32)o3d::max<size_t>(1, o3d::min<size_t>(numThreads, count / MIN_ITEMS_PER_THREAD));
+
+	groups.assign(count, 0);
+	std::vector<UInt32> bucketGroups(numBuckets, 0);
+
+	auto groupBucket = [&] (UInt32 bucket)
+	{
+		typedef std::unordered_multimap<UInt32, UInt32>::const_iterator CIT_Hash;
+
+		// first item of each group of the bucket
+		std::vector<UInt32> firstItems;
+		std::unordered_multimap<UInt32, UInt32> hashGroups;
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			const UInt32 hash = hashes[i];
+			if (hash % numBuckets != bucket)
+				continue;
+
+			UInt32 group = (UInt32)firstItems.size();
+
+			std::pair<CIT_Hash, CIT_Hash> range = hashGroups.equal_range(hash);
+			for (CIT_Hash it = range.first; it != range.second; ++it)
+			{
+				if (equal(firstItems[it->second], (UInt32)i))
+				{
+					group = it->second;
+					break;
+				}
+			}
+
+			if (group == firstItems.size())
+			{
+				firstItems.push_back((UInt32)i);
+				hashGroups.insert(std::make_pair(hash, group));
+			}
+
+			groups[i] = group;
+		}
+
+		bucketGroups[bucket] = (UInt32)firstItems.size();
+	};
+
+	std::vector<std::thread> threads;
+	for (UInt32 b = 1; b < numBuckets; ++b)
+		threads.push_back(std::thread(groupBucket, b));
+
+	groupBucket(0);
+
+	for (std::thread &thread : threads)
+		thread.join();
+
+	// the groups of a bucket follow the ones of the previous buckets
+	std::vector<UInt32> bucketOffsets(numBuckets, 0);
+	for (UInt32 b = 1; b < numBuckets; ++b)
+		bucketOffsets[b] = bucketOffsets[b-1] + bucketGroups[b-1];
+
+	if (numBuckets > 1)
+	{
+		parallelRanges(count, numThreads, [&] (size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; ++i)
+				groups[i] += bucketOffsets[hashes[i] % numBuckets];
+		});
+	}
+
+	return bucketOffsets[numBuckets-1] + bucketGroups[numBuckets-1];
+}
+
+//! Items of each group, those of the group g being sharing[first[g]..first[g+1]).
+inline void groupMembers(
+		const std::vector<UInt32> &groups,
+		UInt32 numGroups,
+		std::vector<UInt32> &first,
+		std::vector<UInt32> &sharing)
+{
+	first.assign((size_t)numGroups + 1, 0);
+	for (size_t i = 0; i < groups.size(); ++i)
+		++first[groups[i] + 1];
+
+	for (UInt32 g = 0; g < numGroups; ++g)
+		first[g + 1] += first[g];
+
+	std::vector<UInt32> cursor(first.begin(), first.end() - 1);
+	sharing.resize(groups.size());
+
+	for (size_t i = 0; i < groups.size(); ++i)
+		sharing[cursor[groups[i]]++] = (UInt32)i;
+}
+
+//! FNV-1a hash of the cell containing a position, for a given cell size.
+inline UInt32 hashCell(UInt32 flags, const Float *position, Float cellSize)
+{
+	UInt32 hash = 2166136261u ^ flags;
+
+	for (UInt32 k = 0; k < 3; ++k)
 	{
-		UInt32 thisoffset  = (UInt32)inputs[i]->getOffset();
-		if (maxoffset < thisoffset) maxoffset++;
+		const Int64 cell = (Int64)std::floor((Double)position[k] / cellSize);
+		const UInt8 *bytes = reinterpret_cast<const UInt8*>(&cell);
+
+		for (UInt32 b = 0; b < sizeof(Int64); ++b)
+		{
+			hash ^= bytes[b];
+			hash *= 16777619u;
+		}
 	}
-	return maxoffset + 1;
+
+	return hash;
 }
 
-UInt32 CGeometry::setVertexData(Offsets &offset, const domListOfUInts &values, UInt32 i)
+} // anonymous namespace
+
+// Generate smooth normals for the face lists without a normal input
+void CGeometry::generateNormals()
 {
-	Float vertex[3];
-	Float normal[3];
-	Float texCoord[2];
+	if (!m_infos.getNormalGeneration())
+		return;
 
-	UInt32 count = m_vertices.getSize() / 3;
-	UInt32 i2, i3;
+	// triangle corners of the face lists without normals, as primitive vertices
+	std::vector<UInt32> triangleLists;
+	std::vector<UInt32> cornerVertices;
 
-	if (offset.positionOffset != -1)
+	for (size_t i = 0; i < m_facesList.size(); ++i)
 	{
-		i3 = (UInt32)values[i*offset.maxOffset + offset.positionOffset] * offset.positionStride;
-		vertex[0] = (Float)(*offset.positionFloats)[(size_t)i3+0];
-		vertex[1] = (Float)(*offset.positionFloats)[(size_t)i3+1];
-		vertex[2] = (Float)(*offset.positionFloats)[(size_t)i3+2];
+		const FaceList &faceList = m_facesList[i];
+		if (faceList.offsets.normalOffset != -1 || faceList.offsets.positionOffset == -1)
+			continue;
 
-		if (m_infos.getUpAxis() == X)
+		triangleLists.insert(triangleLists.end(), faceList.corners.size() / 3, (UInt32)i);
+		cornerVertices.insert(cornerVertices.end(), faceList.corners.begin(), faceList.corners.begin() + faceList.corners.size() / 3 * 3);
+	}
+
+	const size_t numTriangles = triangleLists.size();
+	const size_t numCorners = cornerVertices.size();
+
+	if (numTriangles == 0)
+		return;
+
+	ProfileScope scope(m_infos.getProfiler(), "normals", m_name);
+
+	const UInt32 numThreads = o3d::max<UInt32>(1, m_infos.getParseThreads());
+
+	// position of each corner, in separate x, y and z arrays so that the loops over
+	// the triangles and the corners below access them contiguously and vectorize
+	std::vector<Float> px(numCorners), py(numCorners), pz(numCorners);
+	std::vector<UInt32> hashes(numCorners);
+
+	parallelRanges(numCorners, numThreads, [&] (size_t begin, size_t end)
+	{
+		for (size_t c = begin; c < end; ++c)
 		{
-			Float tmp;
-			tmp = vertex[Y];
-			vertex[Y] = vertex[X];
-			vertex[X] = tmp;
+			Float position[3];
+			readPosition(m_facesList[triangleLists[c/3]], cornerVertices[c], position);
+
+			px[c] = position[0];
+			py[c] = position[1];
+			pz[c] = position[2];
+
+			hashes[c] = hashFloats(2166136261u, position, 3);
 		}
-		else if (m_infos.getUpAxis() == Z)
+	});
+
+	// positions welded by value, the faces are smoothed across the seams of the
+	// other attributes and the duplicated positions
+	std::vector<UInt32> groups;
+	const UInt32 numGroups = groupByHash(hashes, numThreads, [&] (UInt32 a, UInt32 b)
+	{
+		return px[a] == px[b] && py[a] == py[b] && pz[a] == pz[b];
+	}, groups);
+
+	std::vector<UInt32>().swap(hashes);
+
+	// unit normal of each triangle, and weighted normal of each corner (area times
+	// angle). The loops have no branch, except the calls to acos.
+	std::vector<Float> nx(numTriangles), ny(numTriangles), nz(numTriangles);
+	std::vector<Float> wx(numCorners), wy(numCorners), wz(numCorners);
+
+	parallelRanges(numTriangles, numThreads, [&] (size_t begin, size_t end)
+	{
+		std::vector<Float> areas(end - begin);
+		std::vector<Float> cosines((end - begin) * 3);
+		std::vector<Float> valid((end - begin) * 3);
+
+		for (size_t t = begin; t < end; ++t)
+		{
+			const size_t c = t*3;
+
+			const Float e1x = px[c+1] - px[c], e1y = py[c+1] - py[c], e1z = pz[c+1] - pz[c];
+			const Float e2x = px[c+2] - px[c], e2y = py[c+2] - py[c], e2z = pz[c+2] - pz[c];
+			const Float e3x = px[c+2] - px[c+1], e3y = py[c+2] - py[c+1], e3z = pz[c+2] - pz[c+1];
+
+			const Float cx = e1y*e2z - e1z*e2y;
+			const Float cy = e1z*e2x - e1x*e2z;
+			const Float cz = e1x*e2y - e1y*e2x;
+
+			const Float len = std::sqrt(cx*cx + cy*cy + cz*cz);
+			const Float divisor = len < 1e-12f ? std::numeric_limits<Float>::infinity() : len;
+
+			nx[t] = cx / divisor;
+			ny[t] = cy / divisor;
+			nz[t] = cz / divisor;
+			areas[t - begin] = len * 0.5f;
+
+			// cosine of the angle at each corner, between its two edges
+			const Float l1 = std::sqrt(e1x*e1x + e1y*e1y + e1z*e1z);
+			const Float l2 = std::sqrt(e2x*e2x + e2y*e2y + e2z*e2z);
+			const Float l3 = std::sqrt(e3x*e3x + e3y*e3y + e3z*e3z);
+
+			const Float i1 = l1 < 1e-12f ? 0.f : 1.f / l1;
+			const Float i2 = l2 < 1e-12f ? 0.f : 1.f / l2;
+			const Float i3 = l3 < 1e-12f ? 0.f : 1.f / l3;
+
+			const size_t k = (t - begin) * 3;
+
+			cosines[k] = (e1x*e2x + e1y*e2y + e1z*e2z) * i1 * i2;
+			cosines[k+1] = -(e1x*e3x + e1y*e3y + e1z*e3z) * i1 * i3;
+			cosines[k+2] = (e2x*e3x + e2y*e3y + e2z*e3z) * i2 * i3;
+
+			valid[k] = (l1 < 1e-12f || l2 < 1e-12f) ? 0.f : 1.f;
+			valid[k+1] = (l1 < 1e-12f || l3 < 1e-12f) ? 0.f : 1.f;
+			valid[k+2] = (l2 < 1e-12f || l3 < 1e-12f) ? 0.f : 1.f;
+		}
+
+		for (size_t k = 0; k < cosines.size(); ++k)
+			cosines[k] = std::acos(o3d::max(-1.f, o3d::min(1.f, cosines[k])));
+
+		for (size_t t = begin; t < end; ++t)
+		{
+			const size_t k = (t - begin) * 3;
+
+			for (UInt32 j = 0; j < 3; ++j)
+			{
+				const Float weight = areas[t - begin] * cosines[k+j] * valid[k+j];
+
+				wx[t*3+j] = nx[t] * weight;
+				wy[t*3+j] = ny[t] * weight;
+				wz[t*3+j] = nz[t] * weight;
+			}
+		}
+	});
+
+	// corners sharing each position
+	std::vector<UInt32> first, sharing;
+	groupMembers(groups, numGroups, first, sharing);
+
+	// normal of each corner, from the faces within the smoothing angle of its own
+	// face. The faces out of the angle are masked rather than branched over.
+	const Float angle = m_infos.getSmoothingAngle();
+	const Float cosLimit = angle >= 180.f ? -2.f : std::cos(o3d::toRadian(o3d::max(angle, 0.f)));
+
+	std::vector<Float> cornerNormals(numCorners*3);
+
+	parallelRanges(numTriangles, numThreads, [&] (size_t begin, size_t end)
+	{
+		for (size_t t = begin; t < end; ++t)
 		{
-			Float tmp;
-			tmp = vertex[Z];
-			vertex[Z] = -vertex[Y];
-			vertex[Y] = tmp;
+			for (UInt32 k = 0; k < 3; ++k)
+			{
+				const UInt32 group = groups[t*3+k];
+
+				Float sx = 0.f, sy = 0.f, sz = 0.f;
+
+				for (UInt32 i = first[group]; i < first[group + 1]; ++i)
+				{
+					const UInt32 other = sharing[i];
+					const UInt32 o = other / 3;
+
+					const Float dot = nx[t]*nx[o] + ny[t]*ny[o] + nz[t]*nz[o];
+					const Float mask = (o == t || dot >= cosLimit) ? 1.f : 0.f;
+
+					sx += wx[other] * mask;
+					sy += wy[other] * mask;
+					sz += wz[other] * mask;
+				}
+
+				Float *normal = &cornerNormals[(t*3+k)*3];
+				normal[0] = sx;
+				normal[1] = sy;
+				normal[2] = sz;
+
+				// degenerated neighbourhood, the face normal or any unit vector
+				if (!normalizeVector(normal))
+				{
+					normal[0] = nx[t];
+					normal[1] = ny[t];
+					normal[2] = nz[t];
+
+					if (!normalizeVector(normal))
+						normal[1] = 1.f;
+				}
+			}
 		}
+	});
+
+	// normal per primitive vertex, the vertex shared by the triangles of a polygon
+	// fan takes the normal of its last triangle
+	for (size_t c = 0; c < numCorners; ++c)
+	{
+		FaceList &faceList = m_facesList[triangleLists[c/3]];
+
+		if (faceList.normals.empty())
+			faceList.normals.resize((size_t)faceList.values->getCount() / faceList.offsets.maxOffset * 3, 0.f);
+
+		Float *normal = &faceList.normals[(size_t)cornerVertices[c]*3];
+		normal[0] = cornerNormals[c*3+0];
+		normal[1] = cornerNormals[c*3+1];
+		normal[2] = cornerNormals[c*3+2];
 	}
+}
 
-	if (offset.normalOffset != -1)
+// Generate the tangent frames of the face lists without a tangent input
+void CGeometry::generateTangents()
+{
+	if (!m_infos.getTangentSpace() || !m_CMaterial.needTangentSpace())
+		return;
+
+	// triangle corners of the face lists without tangents, as primitive vertices
+	std::vector<UInt32> triangleLists;
+	std::vector<UInt32> cornerVertices;
+	Bool hasTexCoords = False;
+
+	for (size_t i = 0; i < m_facesList.size(); ++i)
 	{
-		i3 = (UInt32)values[i*offset.maxOffset + offset.normalOffset] * offset.normalStride;
-		normal[0] = (Float)(*offset.normalFloats)[(size_t)i3+0];
-		normal[1] = (Float)(*offset.normalFloats)[(size_t)i3+1];
-		normal[2] = (Float)(*offset.normalFloats)[(size_t)i3+2];
+		const FaceList &faceList = m_facesList[i];
+		hasTexCoords |= faceList.offsets.texture1Offset != -1;
 
- 		if (m_infos.getUpAxis() == X)
+		if (faceList.offsets.tangentOffset != -1 || !faceList.hasNormals())
+			continue;
+
+		triangleLists.insert(triangleLists.end(), faceList.corners.size() / 3, (UInt32)i);
+		cornerVertices.insert(cornerVertices.end(), faceList.corners.begin(), faceList.corners.begin() + faceList.corners.size() / 3 * 3);
+	}
+
+	const size_t numTriangles = triangleLists.size();
+	const size_t numCorners = cornerVertices.size();
+
+	if (numTriangles == 0 || !hasTexCoords)
+		return;
+
+	ProfileScope scope(m_infos.getProfiler(), "tangentSpace", m_name);
+
+	const UInt32 numThreads = o3d::max<UInt32>(1, m_infos.getParseThreads());
+
+	// position, normal, texture coordinate and handedness of each corner
+	const UInt32 CORNER_POSITION = 0;
+	const UInt32 CORNER_NORMAL = 3;
+	const UInt32 CORNER_TEXCOORD = 6;
+	const UInt32 CORNER_HANDEDNESS = 8;
+	const UInt32 NUM_CORNER_COMPONENTS = 9;
+
+	std::vector<Float> corners(numCorners * NUM_CORNER_COMPONENTS, 0.f);
+
+	parallelRanges(numCorners, numThreads, [&] (size_t begin, size_t end)
+	{
+		Float tangent[3], bitangent[3];
+
+		for (size_t c = begin; c < end; ++c)
 		{
-			Float tmp;
-			tmp = normal[Y];
-			normal[Y] = normal[X];
-			normal[X] = tmp;
+			Float *corner = &corners[c * NUM_CORNER_COMPONENTS];
+
+			readVertex(
+				m_facesList[triangleLists[c/3]],
+				cornerVertices[c],
+				corner + CORNER_POSITION,
+				corner + CORNER_NORMAL,
+				corner + CORNER_TEXCOORD,
+				tangent,
+				bitangent);
+
+			corner[CORNER_HANDEDNESS] = 1.f;
 		}
-		else if (m_infos.getUpAxis() == Z)
+	});
+
+	// tangent direction of each triangle weighted by its area, and handedness of its
+	// mapping given to its corners
+	std::vector<Float> frames(numTriangles * 3, 0.f);
+
+	parallelRanges(numTriangles, numThreads, [&] (size_t begin, size_t end)
+	{
+		for (size_t t = begin; t < end; ++t)
 		{
-			Float tmp;
-			tmp = normal[Z];
-			normal[Z] = -normal[Y];
-			normal[Y] = tmp;
+			Float *c0 = &corners[(t*3+0) * NUM_CORNER_COMPONENTS];
+			Float *c1 = &corners[(t*3+1) * NUM_CORNER_COMPONENTS];
+			Float *c2 = &corners[(t*3+2) * NUM_CORNER_COMPONENTS];
+
+			const Float *p0 = c0 + CORNER_POSITION, *p1 = c1 + CORNER_POSITION, *p2 = c2 + CORNER_POSITION;
+			const Float *uv0 = c0 + CORNER_TEXCOORD, *uv1 = c1 + CORNER_TEXCOORD, *uv2 = c2 + CORNER_TEXCOORD;
+
+			const Float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+			const Float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+
+			const Float du1 = uv1[0] - uv0[0], dv1 = uv1[1] - uv0[1];
+			const Float du2 = uv2[0] - uv0[0], dv2 = uv2[1] - uv0[1];
+			const Float det = du1 * dv2 - du2 * dv1;
+
+			// degenerated mapping, the triangle does not contribute
+			if (std::fabs(det) < 1e-20f)
+				continue;
+
+			// the sign of the uv area gives the handedness, the direction is the one of u
+			const Float sign = det < 0.f ? -1.f : 1.f;
+			c0[CORNER_HANDEDNESS] = c1[CORNER_HANDEDNESS] = c2[CORNER_HANDEDNESS] = sign;
+
+			Float *tangent = &frames[t*3];
+			for (UInt32 k = 0; k < 3; ++k)
+				tangent[k] = (e1[k] * dv2 - e2[k] * dv1) * sign;
+
+			Float n[3];
+			crossProduct(e1, e2, n);
+			const Float area = std::sqrt(dotProduct(n, n));
+
+			if (!normalizeVector(tangent))
+			{
+				tangent[0] = tangent[1] = tangent[2] = 0.f;
+				continue;
+			}
+
+			for (UInt32 k = 0; k < 3; ++k)
+				tangent[k] *= area;
 		}
-	}
+	});
 
-	if (offset.texture1Offset != -1)
+	// corners sharing their position, normal, texture coordinate and handedness
+	std::vector<UInt32> hashes(numCorners);
+
+	parallelRanges(numCorners, numThreads, [&] (size_t begin, size_t end)
 	{
-		i2 = (UInt32)values[i*offset.maxOffset + offset.texture1Offset] * offset.texture1Stride;
-		texCoord[0] = (Float)(*offset.texture1Floats)[(size_t)i2+0];
-		texCoord[1] = (Float)(*offset.texture1Floats)[(size_t)i2+1];
+		for (size_t c = begin; c < end; ++c)
+			hashes[c] = hashFloats(2166136261u, &corners[c * NUM_CORNER_COMPONENTS], NUM_CORNER_COMPONENTS);
+	});
 
-		if (m_infos.getUpAxis() == X)
+	std::vector<UInt32> groups;
+	const UInt32 numGroups = groupByHash(hashes, numThreads, [&] (UInt32 a, UInt32 b)
+	{
+		return equalFloats(
+				&corners[(size_t)a * NUM_CORNER_COMPONENTS],
+				&corners[(size_t)b * NUM_CORNER_COMPONENTS],
+				NUM_CORNER_COMPONENTS);
+	}, groups);
+
+	std::vector<UInt32>().swap(hashes);
+
+	std::vector<UInt32> first, sharing;
+	groupMembers(groups, numGroups, first, sharing);
+
+	// sum the frames of the triangles of each corner, and orthonormalize them with
+	// its normal, the bitangent following the handedness
+	std::vector<Float> cornerFrames(numCorners*6);
+
+	parallelRanges(numCorners, numThreads, [&] (size_t begin, size_t end)
+	{
+		for (size_t c = begin; c < end; ++c)
 		{
-			texCoord[0] = 1.f - texCoord[0];
+			const Float *corner = &corners[c * NUM_CORNER_COMPONENTS];
+			const UInt32 group = groups[c];
+
+			Float t[3] = { 0.f, 0.f, 0.f };
+
+			for (UInt32 i = first[group]; i < first[group + 1]; ++i)
+			{
+				const Float *frame = &frames[(sharing[i]/3)*3];
+				t[0] += frame[0];
+				t[1] += frame[1];
+				t[2] += frame[2];
+			}
+
+			Float n[3] = { corner[CORNER_NORMAL+0], corner[CORNER_NORMAL+1], corner[CORNER_NORMAL+2] };
+			if (!normalizeVector(n))
+			{
+				n[0] = 0.f;
+				n[1] = 1.f;
+				n[2] = 0.f;
+			}
+
+			// Gram-Schmidt
+			const Float d = dotProduct(n, t);
+			for (UInt32 k = 0; k < 3; ++k)
+				t[k] -= n[k] * d;
+
+			// no mapping around the corner, any direction orthogonal to the normal
+			if (!normalizeVector(t))
+			{
+				const Float axis[3] = {
+					std::fabs(n[0]) < 0.9f ? 1.f : 0.f,
+					std::fabs(n[0]) < 0.9f ? 0.f : 1.f,
+					0.f };
+
+				crossProduct(axis, n, t);
+				normalizeVector(t);
+			}
+
+			Float *tangent = &cornerFrames[c*6];
+			Float *bitangent = &cornerFrames[c*6+3];
+
+			crossProduct(n, t, bitangent);
+
+			for (UInt32 k = 0; k < 3; ++k)
+			{
+				tangent[k] = t[k];
+				bitangent[k] *= corner[CORNER_HANDEDNESS];
+			}
 		}
-		else if (m_infos.getUpAxis() == Y)
+	});
+
+	// frame per primitive vertex, as the generated normals
+	for (size_t c = 0; c < numCorners; ++c)
+	{
+		FaceList &faceList = m_facesList[triangleLists[c/3]];
+
+		if (faceList.tangents.empty())
 		{
-			texCoord[1] = 1.f - texCoord[1];
+			const size_t numPrimitiveVertices = (size_t)faceList.values->getCount() / faceList.offsets.maxOffset;
+
+			faceList.tangents.resize(numPrimitiveVertices * 3, 0.f);
+			faceList.bitangents.resize(numPrimitiveVertices * 3, 0.f);
 		}
-		else if (m_infos.getUpAxis() == Z)
+
+		for (UInt32 k = 0; k < 3; ++k)
 		{
-			texCoord[1] = 1.f - texCoord[1];
+			faceList.tangents[(size_t)cornerVertices[c]*3+k] = cornerFrames[c*6+k];
+			faceList.bitangents[(size_t)cornerVertices[c]*3+k] = cornerFrames[c*6+3+k];
 		}
 	}
+}
+
+// Weld the triangulated vertices of every face list
+void CGeometry::weldVertices()
+{
+	for (size_t i = 0; i < m_facesList.size(); ++i)
+	{
+		// the face lists are not reallocated while welding
+		FaceList &faceList = m_facesList[i];
+
+		for (UInt32 corner : faceList.corners)
+			setVertexData(faceList, corner);
+
+		std::vector<UInt32>().swap(faceList.corners);
+	}
+
+	// reduction achieved by the tolerances
+	if (!m_infos.getWeldTolerances().isExact() && m_numCorners > 0)
+	{
+		const UInt32 numVertices = (UInt32)m_vertexRefs.size();
+
+		O3D_MESSAGE(String("Welded geometry: ") + m_name + String::print(
+			" %u corners to %u vertices (%u%% fewer), %u merged within the tolerances",
+			m_numCorners,
+			numVertices,
+			(UInt32)(100 - (UInt64)numVertices * 100 / m_numCorners),
+			m_numToleranceMerges));
+	}
+}
+
+// Weld the i-th vertex of a face list and store its index as the next face index
+UInt32 CGeometry::setVertexData(FaceList &faceList, UInt32 i)
+{
+	const Offsets &offset = faceList.offsets;
+
+	// position, normal, texture coordinate, tangent and bitangent
+	Float attributes[NUM_WELD_COMPONENTS] = { 0.f };
+
+	Float *vertex = attributes + WELD_POSITION;
+	Float *normal = attributes + WELD_NORMAL;
+	Float *texCoord = attributes + WELD_TEXCOORD;
+	Float *tangent = attributes + WELD_TANGENT;
+	Float *bitangent = attributes + WELD_BITANGENT;
 
-	// is existing vertex
-	if ((offset.positionOffset != -1) &&
-		(offset.normalOffset != -1) &&
-		(offset.texture1Offset != -1))
+	readVertex(faceList, i, vertex, normal, texCoord, tangent, bitangent);
+
+	const UInt32 flags = faceList.attributeFlags();
+	const WeldTolerances &tolerances = m_infos.getWeldTolerances();
+	const Bool exact = tolerances.isExact();
+
+	UInt32 hash = 0;
+	UInt32 index = 0;
+	Bool found = False;
+
+	++m_numCorners;
+
+	if (exact)
+	{
+		// vertices are only welded with vertices having the same attributes
+		hash = hashFloats(2166136261u ^ flags, attributes, NUM_WELD_COMPONENTS);
+
+		// is existing vertex
+		typedef std::unordered_multimap<UInt32, UInt32>::const_iterator CIT_VertexHash;
+		std::pair<CIT_VertexHash, CIT_VertexHash> range = m_vertexHash.equal_range(hash);
+
+		for (CIT_VertexHash it = range.first; it != range.second; ++it)
+		{
+			const VertexRef &ref = m_vertexRefs[it->second];
+			const FaceList &refList = m_facesList[ref.list];
+
+			if (refList.attributeFlags() != flags)
+				continue;
+
+			Float refAttributes[NUM_WELD_COMPONENTS] = { 0.f };
+			readVertex(
+				refList,
+				ref.index,
+				refAttributes + WELD_POSITION,
+				refAttributes + WELD_NORMAL,
+				refAttributes + WELD_TEXCOORD,
+				refAttributes + WELD_TANGENT,
+				refAttributes + WELD_BITANGENT);
+
+			if (equalFloats(attributes, refAttributes, NUM_WELD_COMPONENTS))
+			{
+				index = it->second;
+				found = True;
+				break;
+			}
+		}
+	}
+	else
 	{
-		for (UInt32 k = 0; k < count; ++k)
+		found = findWithinTolerances(faceList, attributes, flags, index);
+
+		// the group is extended to the vertex
+		if (found)
 		{
-			i2 = k << 1;
-			i3 = k * 3;
+			Float *bounds = &m_weldBounds[(size_t)index * NUM_WELD_COMPONENTS * 2];
+			Bool equal = True;
 
-			if ((m_vertices[i3+0] == vertex[0]) &&
-				(m_vertices[i3+1] == vertex[1]) &&
-				(m_vertices[i3+2] == vertex[2]) &&
-				(m_normals[i3+0] == normal[0]) &&
-				(m_normals[i3+1] == normal[1]) &&
-				(m_normals[i3+2] == normal[2]) &&
-				(m_texCoords[i2+0] == texCoord[0]) &&
-				(m_texCoords[i2+1] == texCoord[1]))
+			for (UInt32 k = 0; k < NUM_WELD_COMPONENTS; ++k)
 			{
-				// commented, to avoid duplication of indices, but maybe some vertices will
-				// miss skinning, so check before add, or uncomment it and let the duplication (no danger only slower).
-//				Int32 index = (UInt32)values[i*offset.maxOffset + offset.positionOffset];
-//				m_lookupTable[index].push_back(k);
+				equal &= (bounds[k] == attributes[k]) && (bounds[NUM_WELD_COMPONENTS+k] == attributes[k]);
 
-				return k;
+				bounds[k] = o3d::min(bounds[k], attributes[k]);
+				bounds[NUM_WELD_COMPONENTS+k] = o3d::max(bounds[NUM_WELD_COMPONENTS+k], attributes[k]);
 			}
+
+			if (!equal)
+				++m_numToleranceMerges;
+		}
+		else
+		{
+			hash = tolerances.position > 0.f ?
+				hashCell(flags, vertex, tolerances.position * 2.f) :
+				hashFloats(2166136261u ^ flags, vertex, 3);
+		}
+	}
+
+	// not exist so add it
+	if (!found)
+	{
+		index = (UInt32)m_vertexRefs.size();
+
+		VertexRef ref;
+		ref.list = (UInt32)(&faceList - &m_facesList[0]);
+		ref.index = i;
+
+		m_vertexRefs.push_back(ref);
+		m_vertexHash.insert(std::make_pair(hash, index));
+
+		if (!exact)
+		{
+			m_weldBounds.insert(m_weldBounds.end(), attributes, attributes + NUM_WELD_COMPONENTS);
+			m_weldBounds.insert(m_weldBounds.end(), attributes, attributes + NUM_WELD_COMPONENTS);
 		}
 
-		// not exist so add it
-		m_vertices.pushArray(vertex,3);
-		m_normals.pushArray(normal,3);
-		m_texCoords.pushArray(texCoord,2);
+		Int32 position = (UInt32)(*faceList.values)[i*offset.maxOffset + offset.positionOffset];
+		m_lookupTable[position].push_back(index);
+
+		if (m_indices16 && (index >= MAX_CHUNK_VERTICES))
+			widenIndices();
+	}
+
+	if (m_indices16)
+		faceList.faces16[faceList.numIndices++] = (UInt16)index;
+	else
+		faceList.faces32[faceList.numIndices++] = index;
+
+	return index;
+}
+
+// Find a welded vertex within the tolerances
+Bool CGeometry::findWithinTolerances(
+	const FaceList &faceList,
+	const Float *attributes,
+	UInt32 flags,
+	UInt32 &index) const
+{
+	const WeldTolerances &tolerances = m_infos.getWeldTolerances();
+
+	Float limits[NUM_WELD_COMPONENTS];
+	for (UInt32 k = 0; k < NUM_WELD_COMPONENTS; ++k)
+	{
+		if (k < WELD_NORMAL)
+			limits[k] = tolerances.position;
+		else if (k >= WELD_TEXCOORD && k < WELD_TANGENT)
+			limits[k] = tolerances.texCoord;
+		else
+			limits[k] = tolerances.normal;
+	}
+
+	// the welded vertices are hashed by the cell of their position, cells being twice
+	// the tolerance wide a position within the tolerance is in at most 2 cells per axis
+	UInt32 hashes[8];
+	UInt32 numHashes = 0;
+
+	if (tolerances.position > 0.f)
+	{
+		const Float cellSize = tolerances.position * 2.f;
+
+		for (UInt32 c = 0; c < 8; ++c)
+		{
+			Float corner[3];
+			for (UInt32 k = 0; k < 3; ++k)
+				corner[k] = attributes[WELD_POSITION+k] + ((c >> k) & 1 ? tolerances.position : -tolerances.position);
+
+			const UInt32 hash = hashCell(flags, corner, cellSize);
+			if (std::find(hashes, hashes + numHashes, hash) == hashes + numHashes)
+				hashes[numHashes++] = hash;
+		}
+	}
+	else
+	{
+		hashes[numHashes++] = hashFloats(2166136261u ^ flags, attributes + WELD_POSITION, 3);
 	}
-	else if ((offset.positionOffset != -1) &&
-			 (offset.normalOffset != -1) &&
-			 (offset.texture1Offset == -1))
+
+	typedef std::unordered_multimap<UInt32, UInt32>::const_iterator CIT_VertexHash;
+
+	for (UInt32 h = 0; h < numHashes; ++h)
 	{
-		for (UInt32 k = 0; k < count; ++k)
+		std::pair<CIT_VertexHash, CIT_VertexHash> range = m_vertexHash.equal_range(hashes[h]);
+
+		for (CIT_VertexHash it = range.first; it != range.second; ++it)
 		{
-			i2 = k << 1;
-			i3 = k * 3;
+			const VertexRef &ref = m_vertexRefs[it->second];
+			if (m_facesList[ref.list].attributeFlags() != flags)
+				continue;
+
+			// the whole group must stay within the tolerances, not only its first vertex
+			const Float *bounds = &m_weldBounds[(size_t)it->second * NUM_WELD_COMPONENTS * 2];
+			Bool within = True;
 
-			if ((m_vertices[i3+0] == vertex[0]) &&
-				(m_vertices[i3+1] == vertex[1]) &&
-				(m_vertices[i3+2] == vertex[2]) &&
-				(m_normals[i3+0] == normal[0]) &&
-				(m_normals[i3+1] == normal[1]) &&
-				(m_normals[i3+2] == normal[2]))
+			for (UInt32 k = 0; within && (k < NUM_WELD_COMPONENTS); ++k)
 			{
-				Int32 index = (UInt32)values[i*offset.maxOffset + offset.positionOffset];
-				m_lookupTable[index].push_back(k);
+				const Float low = o3d::min(bounds[k], attributes[k]);
+				const Float high = o3d::max(bounds[NUM_WELD_COMPONENTS+k], attributes[k]);
+
+				within = (high - low) <= limits[k];
+			}
 
-				return k;
+			if (within)
+			{
+				index = it->second;
+				return True;
 			}
 		}
+	}
+
+	return False;
+}
+
+// Allocate the final vertex arrays and fill them from the welded vertices
+void CGeometry::buildVertexArrays()
+{
+	m_numVertices = (UInt32)m_vertexRefs.size();
+
+	Bool hasNormals = False;
+	Bool hasTexCoords = False;
+	Bool hasTangents = False;
+	Bool hasBitangents = False;
+
+	for (size_t i = 0; i < m_facesList.size(); ++i)
+	{
+		hasNormals |= m_facesList[i].hasNormals();
+		hasTexCoords |= m_facesList[i].offsets.texture1Offset != -1;
+		hasTangents |= m_facesList[i].hasTangents();
+		hasBitangents |= m_facesList[i].hasBitangents();
+	}
+
+	if (m_numVertices > 0)
+	{
+		m_vertices = SmartArrayFloat(m_numVertices*3);
 
-		// not exist so add it
-		m_vertices.pushArray(vertex,3);
-		m_normals.pushArray(normal,3);
+		if (hasNormals)
+			m_normals = SmartArrayFloat(m_numVertices*3);
+
+		if (hasTexCoords)
+			m_texCoords = SmartArrayFloat(m_numVertices*2);
+
+		if (hasTangents)
+			m_tangents = SmartArrayFloat(m_numVertices*3);
+
+		if (hasBitangents)
+			m_bitangents = SmartArrayFloat(m_numVertices*3);
 	}
-	else if ((offset.positionOffset != -1) &&
-			 (offset.normalOffset == -1) &&
-			 (offset.texture1Offset != -1))
+
+	Float normal[3], texCoord[2], tangent[3], bitangent[3];
+
+	for (UInt32 v = 0; v < m_numVertices; ++v)
 	{
-		for (UInt32 k = 0; k < count; ++k)
+		const VertexRef &ref = m_vertexRefs[v];
+
+		normal[0] = normal[1] = normal[2] = 0.f;
+		texCoord[0] = texCoord[1] = 0.f;
+		tangent[0] = tangent[1] = tangent[2] = 0.f;
+		bitangent[0] = bitangent[1] = bitangent[2] = 0.f;
+
+		readVertex(m_facesList[ref.list], ref.index, &m_vertices[v*3], normal, texCoord, tangent, bitangent);
+
+		if (hasNormals)
 		{
-			i2 = k << 1;
-			i3 = k * 3;
+			m_normals[v*3+0] = normal[0];
+			m_normals[v*3+1] = normal[1];
+			m_normals[v*3+2] = normal[2];
+		}
 
-			if ((m_vertices[i3+0] == vertex[0]) &&
-				(m_vertices[i3+1] == vertex[1]) &&
-				(m_vertices[i3+2] == vertex[2]) &&
-				(m_texCoords[i2+0] == texCoord[0]) &&
-				(m_texCoords[i2+1] == texCoord[1]))
-			{
-				Int32 index = (UInt32)values[i*offset.maxOffset + offset.positionOffset];
-				m_lookupTable[index].push_back(k);
+		if (hasTexCoords)
+		{
+			m_texCoords[v*2+0] = texCoord[0];
+			m_texCoords[v*2+1] = texCoord[1];
+		}
 
-				return k;
-			}
+		if (hasTangents)
+		{
+			m_tangents[v*3+0] = tangent[0];
+			m_tangents[v*3+1] = tangent[1];
+			m_tangents[v*3+2] = tangent[2];
 		}
 
-		// not exist so add it
-		m_vertices.pushArray(vertex,3);
-		m_texCoords.pushArray(texCoord,2);
+		if (hasBitangents)
+		{
+			m_bitangents[v*3+0] = bitangent[0];
+			m_bitangents[v*3+1] = bitangent[1];
+			m_bitangents[v*3+2] = bitangent[2];
+		}
 	}
-	else if ((offset.positionOffset != -1) &&
-			 (offset.normalOffset == -1) &&
-			 (offset.texture1Offset == -1))
+
+	// the estimation was too high, 16 bits indices are enough
+	if (!m_indices16 && (m_numVertices < MAX_CHUNK_VERTICES))
 	{
-		for (UInt32 k = 0; k < count; ++k)
+		for (size_t i = 0; i < m_facesList.size(); ++i)
 		{
-			i3 = k * 3;
+			FaceList &faceList = m_facesList[i];
+			if (!faceList.faces32.isValid())
+				continue;
 
-			if ((m_vertices[i3+0] == vertex[0]) &&
-				(m_vertices[i3+1] == vertex[1]) &&
-				(m_vertices[i3+2] == vertex[2]))
-			{
-				Int32 index = (UInt32)values[i*offset.maxOffset + offset.positionOffset];
-				m_lookupTable[index].push_back(k);
+			SmartArrayUInt16 faces16(faceList.numIndices);
+			for (UInt32 j = 0; j < faceList.numIndices; ++j)
+				faces16[j] = (UInt16)faceList.faces32[j];
 
-				return k;
-			}
+			faceList.faces16 = faces16;
+			faceList.faces32 = SmartArrayUInt32();
 		}
 
-		// not exist so add it
-		m_vertices.pushArray(vertex,3);
+		m_indices16 = True;
 	}
 
-	Int32 index = (UInt32)values[i*offset.maxOffset + offset.positionOffset];
-	count = (m_vertices.getSize()-3) / 3;
+	// the welding data and the primitives inputs are no longer needed
+	std::vector<VertexRef>().swap(m_vertexRefs);
+	std::unordered_multimap<UInt32, UInt32>().swap(m_vertexHash);
+	std::vector<Float>().swap(m_weldBounds);
 
-	m_lookupTable[index].push_back(count);
-	return count;
+	for (size_t i = 0; i < m_facesList.size(); ++i)
+	{
+		m_facesList[i].values = nullptr;
+		std::vector<Float>().swap(m_facesList[i].normals);
+		std::vector<Float>().swap(m_facesList[i].tangents);
+		std::vector<Float>().swap(m_facesList[i].bitangents);
+	}
+}
+
+// Complete the tangent frames
+void CGeometry::buildTangentSpace()
+{
+	// useless without a bump material, even given by the document
+	if (m_numVertices == 0 || !m_normals.isValid() || !m_tangents.isValid() || !m_CMaterial.needTangentSpace())
+	{
+		m_tangents = SmartArrayFloat();
+		m_bitangents = SmartArrayFloat();
+		return;
+	}
+
+	// the tangents given by the document without their bitangents, for every vertex
+	// or only for the vertices of some face lists
+	const Bool missing = !m_bitangents.isValid();
+	if (missing)
+		m_bitangents = SmartArrayFloat(m_numVertices*3);
+
+	for (UInt32 v = 0; v < m_numVertices; ++v)
+	{
+		Float *bitangent = &m_bitangents[v*3];
+		if (missing || (bitangent[0] == 0.f && bitangent[1] == 0.f && bitangent[2] == 0.f))
+			crossProduct(&m_normals[v*3], &m_tangents[v*3], bitangent);
+	}
 }
@@ -12,9 +12,173 @@
 
 #include <o3d/engine/scene/scene.h>
 
+#include <mutex>
+
+#if defined(__linux__)
+	#include <unistd.h>
+	#include <stdio.h>
+#elif defined(__APPLE__)
+	#include <mach/mach.h>
+#endif
+
 using namespace o3d;
 using namespace o3d::collada;
 
+// Get the resident memory size of the process in bytes
+UInt64 o3d::collada::getResidentMemory()
+{
+#if defined(__linux__)
+	FILE *file = fopen("/proc/self/statm", "r");
+	if (!file)
+		return 0;
+
+	unsigned long size = 0, resident = 0;
+	Int32 n = fscanf(file, "%lu %lu", &size, &resident);
+	fclose(file);
+
+	if (n != 2)
+		return 0;
+
+	return (UInt64)resident * (UInt64)sysconf(_SC_PAGESIZE);
+#elif defined(__APPLE__)
+	mach_task_basic_info info;
+	mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+
+	if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&info, &count) != KERN_SUCCESS)
+		return 0;
+
+	return (UInt64)info.resident_size;
+#else
+	return 0;
+#endif
+}
+
+namespace {
+
+//! Guard the COLLADA-DOM global states, shared by all the databases.
+std::recursive_mutex gDaeMutex;
+
+//! Number of times the current thread holds the lock.
+thread_local UInt32 gDaeLockDepth = 0;
+
+} // anonymous namespace
+
+// Lock the COLLADA-DOM global states
+DaeLock::DaeLock(Bool lock) :
+	m_locked(lock)
+{
+	if (m_locked)
+	{
+		gDaeMutex.lock();
+		++gDaeLockDepth;
+	}
+}
+
+DaeLock::~DaeLock()
+{
+	if (m_locked)
+	{
+		--gDaeLockDepth;
+		gDaeMutex.unlock();
+	}
+}
+
+// Release the lock held by the current thread
+DaeUnlock::DaeUnlock() :
+	m_depth(gDaeLockDepth)
+{
+	gDaeLockDepth = 0;
+
+	for (UInt32 i = 0; i < m_depth; ++i)
+		gDaeMutex.unlock();
+}
+
+DaeUnlock::~DaeUnlock()
+{
+	for (UInt32 i = 0; i < m_depth; ++i)
+		gDaeMutex.lock();
+
+	gDaeLockDepth = m_depth;
+}
+
+// Create a COLLADA-DOM database
+DAE* o3d::collada::createDAE()
+{
+	DaeLock lock;
+	return new DAE();
+}
+
+// Delete a database created by createDAE()
+void o3d::collada::deleteDAE(DAE *&dae)
+{
+	DaeLock lock;
+	deletePtr(dae);
+}
+
+// Import only the static geometry
+ImportOptions ImportOptions::staticGeometry()
+{
+	ImportOptions options;
+	options.animations = False;
+	options.skins = False;
+	options.materials = False;
+	options.textures = False;
+
+	return options;
+}
+
+// Does a node match one of the filters
+Bool ImportOptions::matchNode(const String &id, const String &name) const
+{
+	if (nodeFilters.empty())
+		return True;
+
+	for (const String &filter : nodeFilters)
+	{
+		if ((id.isValid() && matchPattern(filter, id)) || (name.isValid() && matchPattern(filter, name)))
+			return True;
+	}
+
+	return False;
+}
+
+// Match a string against a pattern with wildcards
+Bool ImportOptions::matchPattern(const String &pattern, const String &str)
+{
+	const Int32 patternLen = pattern.length();
+	const Int32 strLen = str.length();
+
+	Int32 p = 0, s = 0;
+	Int32 star = -1, mark = 0;
+
+	// greedy matching, backtracking to the last '*' on a mismatch
+	while (s < strLen)
+	{
+		if (p < patternLen && (pattern[p] == '?' || pattern[p] == str[s]))
+		{
+			++p;
+			++s;
+		}
+		else if (p < patternLen && pattern[p] == '*')
+		{
+			star = p++;
+			mark = s;
+		}
+		else if (star >= 0)
+		{
+			p = star + 1;
+			s = ++mark;
+		}
+		else
+			return False;
+	}
+
+	while (p < patternLen && pattern[p] == '*')
+		++p;
+
+	return p == patternLen;
+}
+
 // Find a node using its name
 CBaseObject* ColladaInfo::findNodeUsingName(const String &name) const
 {
@@ -54,7 +218,7 @@ CBaseObject* ColladaInfo::findNodeUsingId(const String &id) const
 //! Default ctor
 CBaseObject::CBaseObject(o3d::Scene *pScene, domCOLLADA *pDom, ColladaInfo &infos) :
 	m_scene(pScene),
-	m_dom(*pDom),
+	m_dom(pDom),
 	m_infos(infos)
 {
 }
@@ -80,7 +244,7 @@ CGlobal::~CGlobal()
 // Import method
 Bool CGlobal::import()
 {
-	const domAssetRef asset = m_dom.getAsset();
+	const domAssetRef asset = m_dom->getAsset();
 	if (!asset.cast())
 		return True;
 
@@ -0,0 +1,128 @@
+/**
+ * @file importqueue.cpp
+ * @brief Implementation of importqueue.h
+ * @author Frederic SCHERMA (frederic.scherma@dreamoverflow.org)
+ * @date 2026-10-18
+ * @copyright Copyright (c) 2001-2026 Dream Overflow. All rights reserved.
+ * @details
+ */
+
+#include "o3d/collada/precompiled.h"
+#include "o3d/collada/importqueue.h"
+
+using namespace o3d;
+using namespace o3d::collada;
+
+// Default ctor
+ImportQueue::ImportQueue(o3d::Scene *scene) :
+	m_scene(scene),
+	m_numFailed(0),
+	m_keepFinished(False)
+{
+	O3D_ASSERT(m_scene);
+}
+
+// Destructor
+ImportQueue::~ImportQueue()
+{
+	// each importer waits for its worker thread
+	for (std::deque<Collada*>::iterator it = m_pending.begin(); it != m_pending.end(); ++it)
+		deletePtr(*it);
+
+	for (std::vector<Collada*>::iterator it = m_finished.begin(); it != m_finished.end(); ++it)
+		deletePtr(*it);
+}
+
+// Start to import a file on a worker thread
+Bool ImportQueue::push(const String &filename)
+{
+	Collada *collada = new Collada;
+	collada->setScene(m_scene);
+	collada->getInfo() = m_info;
+	collada->getInfo().setSession(nullptr);
+
+	if (!collada->processImportAsync(filename))
+	{
+		deletePtr(collada);
+		++m_numFailed;
+
+		return False;
+	}
+
+	m_pending.push_back(collada);
+
+	return True;
+}
+
+// Commit the loaded imports to the scene
+UInt32 ImportQueue::commit(UInt32 budgetMs)
+{
+	const Int64 start = System::getTime();
+	const Int64 budget = (Int64)budgetMs * System::getTimeFrequency() / 1000;
+
+	UInt32 numFinished = 0;
+
+	// in order, a still loading import delays the following ones
+	while (!m_pending.empty() && m_pending.front()->isReadyToCommit())
+	{
+		Collada *collada = m_pending.front();
+
+		UInt32 remaining = 0;
+		if (budget > 0)
+		{
+			Int64 elapsed = System::getTime() - start;
+			if (elapsed >= budget)
+				break;
+
+			remaining = o3d::max<UInt32>(1, (UInt32)((budget - elapsed) * 1000 / System::getTimeFrequency()));
+		}
+
+		Collada::ImportStage stage = collada->commit(remaining);
+		if ((stage != Collada::IMPORT_DONE) && (stage != Collada::IMPORT_FAILED))
+			break;
+
+		release(collada, stage);
+		m_pending.pop_front();
+
+		++numFinished;
+	}
+
+	return numFinished;
+}
+
+// Wait for all the worker threads and commit all the imports
+UInt32 ImportQueue::flush()
+{
+	UInt32 numFinished = 0;
+
+	while (!m_pending.empty())
+	{
+		Collada *collada = m_pending.front();
+
+		release(collada, collada->commit(0));
+		m_pending.pop_front();
+
+		++numFinished;
+	}
+
+	return numFinished;
+}
+
+// Move the kept importers to a list
+void ImportQueue::takeFinished(std::vector<Collada*> &finished)
+{
+	finished.insert(finished.end(), m_finished.begin(), m_finished.end());
+	m_finished.clear();
+}
+
+// Delete or keep a committed importer
+void ImportQueue::release(Collada *collada, Collada::ImportStage stage)
+{
+	if (stage == Collada::IMPORT_FAILED)
+		++m_numFailed;
+
+	if (m_keepFinished && (stage == Collada::IMPORT_DONE))
+		m_finished.push_back(collada);
+	else
+		deletePtr(collada);
+}
@@ -0,0 +1,134 @@
+/**
+ * @file mappedfile.cpp
+ * @brief Implementation of mappedfile.h
+ * @author Frederic SCHERMA (frederic.scherma@dreamoverflow.org)
+ * @date 2026-10-18
+ * @copyright Copyright (c) 2001-2026 Dream Overflow. All rights reserved.
+ * @details
+ */
+
+#include "o3d/collada/precompiled.h"
+#include "o3d/collada/mappedfile.h"
+
+#ifdef _WIN32
+	#include <windows.h>
+#else
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+using namespace o3d;
+using namespace o3d::collada;
+
+// Default ctor
+MappedFile::MappedFile() :
+	m_data(nullptr),
+	m_size(0)
+#ifdef _WIN32
+	,m_file(INVALID_HANDLE_VALUE),
+	m_mapping(nullptr)
+#endif
+{
+}
+
+// Destructor
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+// Map a file
+Bool MappedFile::open(const String &filename)
+{
+	close();
+
+#ifdef _WIN32
+	m_file = CreateFileW(
+		filename.getData(),
+		GENERIC_READ,
+		FILE_SHARE_READ,
+		nullptr,
+		OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+		nullptr);
+
+	if (m_file == INVALID_HANDLE_VALUE)
+		return False;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(m_file, &size) || size.QuadPart == 0)
+	{
+		close();
+		return False;
+	}
+
+	m_mapping = CreateFileMappingW(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!m_mapping)
+	{
+		close();
+		return False;
+	}
+
+	m_data = (const Char*)MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!m_data)
+	{
+		close();
+		return False;
+	}
+
+	m_size = (UInt64)size.QuadPart;
+#else
+	int fd = ::open(filename.toUtf8().getData(), O_RDONLY);
+	if (fd < 0)
+		return False;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0)
+	{
+		::close(fd);
+		return False;
+	}
+
+	void *data = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+	// the mapping keeps its own reference onto the file
+	::close(fd);
+
+	if (data == MAP_FAILED)
+		return False;
+
+	// the content is read once from the begin to the end
+	madvise(data, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+	m_data = (const Char*)data;
+	m_size = (UInt64)st.st_size;
+#endif
+
+	return True;
+}
+
+// Unmap the file
+void MappedFile::close()
+{
+#ifdef _WIN32
+	if (m_data)
+		UnmapViewOfFile(m_data);
+
+	if (m_mapping)
+		CloseHandle(m_mapping);
+
+	if (m_file != INVALID_HANDLE_VALUE)
+		CloseHandle(m_file);
+
+	m_mapping = nullptr;
+	m_file = INVALID_HANDLE_VALUE;
+#else
+	if (m_data)
+		munmap((void*)m_data, (size_t)m_size);
+#endif
+
+	m_data = nullptr;
+	m_size = 0;
+}
@@ -10,6 +10,8 @@
 #include "o3d/collada/precompiled.h"
 #include <o3d/engine/material/materialpass.h>
 #include "o3d/collada/material.h"
+#include "o3d/collada/session.h"
+#include "o3d/collada/uriresolver.h"
 
 #include <o3d/core/filemanager.h>
 
@@ -37,7 +39,8 @@ CMaterial::CMaterial(
 	ColladaInfo &infos,
 	const domInstance_material_Array mat) :
 		CBaseObject(pScene,pDom,infos),
-		m_materialArray(mat)
+		m_materialArray(mat),
+		m_tangentSpace(False)
 {
 }
 
@@ -129,8 +132,8 @@ void CMaterial::getMaterial(o3d::MaterialProfile &profile, UInt32 id) const
 		materialPass.setMaterial(Material::AMBIENT, new o3d::AmbientMaterial(profile.getParent()));
 		materialPass.setMaterial(Material::PICKING, new o3d::PickingMaterial(profile.getParent()));
 
-        // first material (nearest) and if bump map, use it
-        if (0)//effect.normalMap.map && (i == 0))
+        // first material (nearest) and if bump map, use it, when the geometry has tangents
+        if (m_tangentSpace && effect.normalMap.map && (i == 0))
 		{
             materialPass.setMaterial(Material::LIGHTING, new o3d::BumpMaterial(profile.getParent()));
             materialPass.setMaterial(Material::DEFERRED, new o3d::BumpMaterial(profile.getParent()));
@@ -148,17 +151,63 @@ void CMaterial::getMaterial(o3d::MaterialProfile &profile, UInt32 id) const
 	}
 }
 
+// Is one of the effects normal mapped, and then uses a bump material
+Bool CMaterial::needTangentSpace() const
+{
+	// the maps, and so the bump material, are only loaded with the textures
+	if (m_infos.isHeadless() || !m_infos.getOptions().textures)
+		return False;
+
+	for (const Effect &effect : m_effectList)
+	{
+		if (effect.normalMap.texture.isValid())
+			return True;
+	}
+
+	return False;
+}
+
 // Import method
 Bool CMaterial::import()
 {
+	const ImportOptions &options = m_infos.getOptions();
+
+	// the effects cache of the session only contains fully imported effects
+	ColladaSession *session = options.materials && options.textures ? m_infos.getSession() : nullptr;
+
 	for (size_t i = 0; i < m_materialArray.getCount(); ++i)
 	{
+		// a default effect keeps the material slot of the geometry
+		if (!options.materials)
+		{
+			m_effectList.push_back(Effect());
+			continue;
+		}
+
 		domMaterialRef materialRef((domMaterial*)m_materialArray[i]->getTarget().getElement().cast());
 		domInstance_effectRef effectRef = materialRef->getInstance_effect();
+
+		// an effect shared by many documents is parsed only once per session
+		String key;
+		if (session)
+		{
+			key = ColladaSession::getElementKey(effectRef->getUrl().getElement());
+
+			const Effect *cached = session->findEffect(key);
+			if (cached)
+			{
+				m_effectList.push_back(*cached);
+				continue;
+			}
+		}
+
 		m_effectList.push_back(Effect());
 
 		Effect &effect = m_effectList.back();
 		setEffect(effect,effectRef);
+
+		if (session)
+			session->addEffect(key, effect);
 	}
 
 	return True;
@@ -174,6 +223,10 @@ Bool CMaterial::doExport()
 
 void CMaterial::loadSamplers(Effect &effect)
 {
+	// only the textures names are kept
+	if (m_infos.isHeadless() || !m_infos.getOptions().textures)
+		return;
+
 	if (effect.ambiantMap.texture.isValid() && !effect.ambiantMap.map)
 		effect.ambiantMap.map = m_scene->getTextureManager()->addTexture2D(
 			effect.ambiantMap.texture,
@@ -223,6 +276,8 @@ void CMaterial::loadSamplers(Effect &effect)
 // Set post-import values to the scene
 Bool CMaterial::toScene()
 {
+	ProfileScope scope(m_infos.getProfiler(), "textures");
+
 	// load textures map
 	for (size_t i = 0; i < m_effectList.size(); ++i)
 		loadSamplers(m_effectList[i]);
@@ -238,6 +293,15 @@ Bool CMaterial::fromScene()
 	return True;
 }
 
+// Release any reference to the COLLADA-DOM
+void CMaterial::releaseDom()
+{
+	// effects and textures names are already copied
+	m_materialArray.clear();
+
+	CBaseObject::releaseDom();
+}
+
 void readFloatOrParamType(
 	domCommon_float_or_param_typeRef float_or_param,
 	Float &_float)
@@ -417,7 +481,7 @@ void retrieveTexture(
 		std::map<String,domCommon_newparam_type*> &newParam,
         const String &sid,
         CMaterial::Sampler2d &texture,
-		const String &basePath)
+		const ColladaInfo &infos)
 {
     String surface_SID = newParam[sid]->getSampler2D()->getSource()->getValue();
 
@@ -430,19 +494,41 @@ void retrieveTexture(
 	idRef.resolveElement();
 	domImage* image_element = (domImage*)(domElement*)idRef.getElement();
 
+	ColladaSession *session = infos.getSession();
+	const String basePath = infos.getFilePath();
+
+	static UriResolver defaultResolver;
+	const UriResolver *resolver = infos.getUriResolver() ? infos.getUriResolver() : &defaultResolver;
+
+	String key;
+
 	if (image_element && image_element->getInit_from().cast())
 	{
-        texture.texture = cdom::uriToNativePath(image_element->getInit_from()->getValue().str().c_str()).c_str();
-        texture.texture.replace('\\','/');
-	}
+		const String uri = image_element->getInit_from()->getValue().str().c_str();
 
-	// make absolute path file name
-    if (FileManager::instance()->isRelativePath(texture.texture))
+		// many documents of a session share the same textures
+		if (session)
+		{
+			key = basePath + '|' + uri;
+			if (session->findTexturePath(key, texture.texture))
+				return;
+		}
+
+		texture.texture = resolver->resolveTexture(uri, basePath);
+	}
+	else
 	{
-        texture.texture = basePath + '/' + texture.texture;
-        FileManager::adaptPath(texture.texture);
+		// make absolute path file name
+		if (FileManager::instance()->isRelativePath(texture.texture))
+		{
+			texture.texture = basePath + '/' + texture.texture;
+			FileManager::adaptPath(texture.texture);
+		}
 	}
 
+	if (session && key.isValid())
+		session->addTexturePath(key, texture.texture);
+
     O3D_MESSAGE(String("Found texture: ") + texture.texture);
 }
 
@@ -503,30 +589,32 @@ void CMaterial::setEffect(CMaterial::Effect &effect, domInstance_effectRef insta
 			}
 
 			// retrieve textures's file name
-			if (effect.ambiantMap.texture.length())
-                retrieveTexture(newParams, effect.ambiantMap.texture, effect.ambiantMap, m_infos.getFilePath());
+			const Bool textures = m_infos.getOptions().textures;
+
+			if (textures && effect.ambiantMap.texture.length())
+                retrieveTexture(newParams, effect.ambiantMap.texture, effect.ambiantMap, m_infos);
 
-			if (effect.diffuseMap.texture.length())
-                retrieveTexture(newParams, effect.diffuseMap.texture, effect.diffuseMap,m_infos.getFilePath());
+			if (textures && effect.diffuseMap.texture.length())
+                retrieveTexture(newParams, effect.diffuseMap.texture, effect.diffuseMap, m_infos);
 
-			if (effect.specularMap.texture.length())
-                retrieveTexture(newParams, effect.specularMap.texture, effect.specularMap, m_infos.getFilePath());
+			if (textures && effect.specularMap.texture.length())
+                retrieveTexture(newParams, effect.specularMap.texture, effect.specularMap, m_infos);
 
-			if (effect.emissionMap.texture.length())
-                retrieveTexture(newParams, effect.emissionMap.texture, effect.emissionMap, m_infos.getFilePath());
+			if (textures && effect.emissionMap.texture.length())
+                retrieveTexture(newParams, effect.emissionMap.texture, effect.emissionMap, m_infos);
 
-			if (effect.reflectiveMap.texture.length())
-                retrieveTexture(newParams, effect.reflectiveMap.texture, effect.reflectiveMap, m_infos.getFilePath());
+			if (textures && effect.reflectiveMap.texture.length())
+                retrieveTexture(newParams, effect.reflectiveMap.texture, effect.reflectiveMap, m_infos);
 
-			if (effect.transparentMap.texture.length())
-                retrieveTexture(newParams, effect.transparentMap.texture, effect.transparentMap, m_infos.getFilePath());
+			if (textures && effect.transparentMap.texture.length())
+                retrieveTexture(newParams, effect.transparentMap.texture, effect.transparentMap, m_infos);
 
-            if (effect.bumpMap.texture.length())
-                retrieveTexture(newParams, effect.bumpMap.texture, effect.bumpMap, m_infos.getFilePath());
+            if (textures && effect.bumpMap.texture.length())
+                retrieveTexture(newParams, effect.bumpMap.texture, effect.bumpMap, m_infos);
 
 			// extra, MAYA give us the normal map here...
 			domExtra_Array extraArray = technique->getExtra_array();
-			if (extraArray.getCount() >= 1)
+			if (textures && extraArray.getCount() >= 1)
 			{
 				daeElement *techniqueElt = extraArray[0]->getChild("technique");
 				if (techniqueElt)
@@ -538,7 +626,7 @@ void CMaterial::setEffect(CMaterial::Effect &effect, domInstance_effectRef insta
 						if (textureElement)
 						{
                             String sid = textureElement->getAttribute("texture").c_str();
-                            retrieveTexture(newParams, sid, effect.normalMap, m_infos.getFilePath());
+                            retrieveTexture(newParams, sid, effect.normalMap, m_infos);
 						}
 					}
 				}
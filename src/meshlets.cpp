@@ -0,0 +1,439 @@
+/**
+ * @file meshlets.cpp
+ * @brief Implementation of meshlets.h
+ * @author Frederic SCHERMA (frederic.scherma@dreamoverflow.org)
+ * @date 2026-10-18
+ * @copyright Copyright (c) 2001-2026 Dream Overflow. All rights reserved.
+ * @details
+ */
+
+#include "o3d/collada/precompiled.h"
+#include "o3d/collada/meshlets.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace o3d;
+using namespace o3d::collada;
+
+namespace {
+
+//! Maximal number of vertices of a meshlet, addressable by 8 bits local indices.
+const UInt32 MAX_MESHLET_VERTICES = 256;
+
+//! Spread the 10 lower bits of a value to every third bit.
+inline UInt32 spreadBits(UInt32 v)
+{
+	v &= 0x3ff;
+	v = (v | (v << 16)) & 0x030000ff;
+	v = (v | (v << 8)) & 0x0300f00f;
+	v = (v | (v << 4)) & 0x030c30c3;
+	v = (v | (v << 2)) & 0x09249249;
+
+	return v;
+}
+
+//! Build the meshlets of a face array of any index type.
+template <class T>
+void buildMeshlets(
+	const Float *positions,
+	UInt32 numVertices,
+	const T *indices,
+	UInt32 numIndices,
+	UInt32 faceArray,
+	UInt32 maxVertices,
+	UInt32 maxTriangles,
+	MeshletData &meshlets,
+	void (*computeBounds)(const Float*, MeshletData&, Meshlet&))
+{
+	const UInt32 numTriangles = numIndices / 3;
+	if (numTriangles == 0)
+		return;
+
+	// center of each triangle and their bounds
+	std::vector<Float> centers(numTriangles * 3);
+
+	Float bmin[3] = {
+		std::numeric_limits<Float>::max(),
+		std::numeric_limits<Float>::max(),
+		std::numeric_limits<Float>::max() };
+
+	Float bmax[3] = {
+		-std::numeric_limits<Float>::max(),
+		-std::numeric_limits<Float>::max(),
+		-std::numeric_limits<Float>::max() };
+
+	for (UInt32 t = 0; t < numTriangles; ++t)
+	{
+		for (UInt32 k = 0; k < 3; ++k)
+		{
+			centers[t*3+k] = (
+				positions[indices[t*3+0]*3+k] +
+				positions[indices[t*3+1]*3+k] +
+				positions[indices[t*3+2]*3+k]) * (1.f/3.f);
+
+			bmin[k] = o3d::min(bmin[k], centers[t*3+k]);
+			bmax[k] = o3d::max(bmax[k], centers[t*3+k]);
+		}
+	}
+
+	// Morton order of the triangles, to seed the meshlets in a spatially coherent order
+	std::vector<std::pair<UInt32, UInt32> > order(numTriangles);
+
+	for (UInt32 t = 0; t < numTriangles; ++t)
+	{
+		UInt32 code = 0;
+		for (UInt32 k = 0; k < 3; ++k)
+		{
+			const Float extent = bmax[k] - bmin[k];
+			const UInt32 q = extent > 0.f ? (UInt32)((centers[t*3+k] - bmin[k]) / extent * 1023.f) : 0;
+
+			code |= spreadBits(q) << k;
+		}
+
+		order[t] = std::make_pair(code, t);
+	}
+
+	std::sort(order.begin(), order.end());
+
+	// triangles around each vertex
+	std::vector<UInt32> first(numVertices + 1, 0);
+	for (UInt32 i = 0; i < numTriangles * 3; ++i)
+		++first[indices[i] + 1];
+
+	for (UInt32 v = 0; v < numVertices; ++v)
+		first[v + 1] += first[v];
+
+	std::vector<UInt32> cursor(first.begin(), first.end() - 1);
+	std::vector<UInt32> adjacency(numTriangles * 3);
+
+	for (UInt32 i = 0; i < numTriangles * 3; ++i)
+		adjacency[cursor[indices[i]]++] = i / 3;
+
+	std::vector<UInt8> used(numTriangles, 0);
+	std::vector<Int32> local(numVertices, -1);      //!< local index into the current meshlet
+	std::vector<UInt32> stamp(numTriangles, 0);     //!< meshlet having the triangle as candidate
+	std::vector<UInt32> candidates;
+
+	UInt32 seed = 0;
+	UInt32 meshletId = 0;
+
+	auto newVertices = [&] (UInt32 t)
+	{
+		return (UInt32)(local[indices[t*3+0]] < 0) +
+				(UInt32)(local[indices[t*3+1]] < 0) +
+				(UInt32)(local[indices[t*3+2]] < 0);
+	};
+
+	while (True)
+	{
+		while ((seed < numTriangles) && used[order[seed].second])
+			++seed;
+
+		if (seed >= numTriangles)
+			break;
+
+		Meshlet meshlet;
+		meshlet.faceArray = faceArray;
+		meshlet.vertexOffset = (UInt32)meshlets.vertices.size();
+		meshlet.triangleOffset = (UInt32)(meshlets.triangles.size() / 3);
+		meshlet.vertexCount = 0;
+		meshlet.triangleCount = 0;
+
+		Float centroid[3] = { 0.f, 0.f, 0.f };
+
+		candidates.clear();
+		++meshletId;
+
+		UInt32 next = order[seed].second;
+
+		while (True)
+		{
+			// add the triangle
+			for (UInt32 k = 0; k < 3; ++k)
+			{
+				const UInt32 v = indices[next*3+k];
+				if (local[v] < 0)
+				{
+					local[v] = (Int32)meshlet.vertexCount++;
+					meshlets.vertices.push_back(v);
+				}
+
+				meshlets.triangles.push_back((UInt8)local[v]);
+				centroid[k] += centers[next*3+k];
+			}
+
+			used[next] = 1;
+			++meshlet.triangleCount;
+
+			if (meshlet.triangleCount >= maxTriangles)
+				break;
+
+			// its unused neighbours are candidates
+			for (UInt32 k = 0; k < 3; ++k)
+			{
+				const UInt32 v = indices[next*3+k];
+				for (UInt32 i = first[v]; i < first[v + 1]; ++i)
+				{
+					const UInt32 t = adjacency[i];
+					if (!used[t] && (stamp[t] != meshletId))
+					{
+						stamp[t] = meshletId;
+						candidates.push_back(t);
+					}
+				}
+			}
+
+			// the candidate adding the fewest vertices, then the nearest of the centroid
+			const Float inv = 1.f / meshlet.triangleCount;
+			const Float center[3] = { centroid[0] * inv, centroid[1] * inv, centroid[2] * inv };
+
+			UInt32 best = numTriangles;
+			UInt32 bestNew = 4;
+			Float bestDistance = std::numeric_limits<Float>::max();
+
+			for (size_t i = 0; i < candidates.size();)
+			{
+				const UInt32 t = candidates[i];
+				const UInt32 added = used[t] ? 4 : newVertices(t);
+
+				// used, or can no longer fit into this meshlet
+				if ((added == 4) || (meshlet.vertexCount + added > maxVertices))
+				{
+					candidates[i] = candidates.back();
+					candidates.pop_back();
+					continue;
+				}
+
+				const Float dx = centers[t*3+0] - center[0];
+				const Float dy = centers[t*3+1] - center[1];
+				const Float dz = centers[t*3+2] - center[2];
+				const Float distance = dx*dx + dy*dy + dz*dz;
+
+				if ((added < bestNew) || ((added == bestNew) && (distance < bestDistance)))
+				{
+					best = t;
+					bestNew = added;
+					bestDistance = distance;
+				}
+
+				++i;
+			}
+
+			// no adjacent triangle, the next one in Morton order if it fits
+			if (best == numTriangles)
+			{
+				while ((seed < numTriangles) && used[order[seed].second])
+					++seed;
+
+				if ((seed >= numTriangles) ||
+					(meshlet.vertexCount + newVertices(order[seed].second) > maxVertices))
+					break;
+
+				best = order[seed].second;
+			}
+
+			next = best;
+		}
+
+		// the local indices are reset for the next meshlet
+		for (UInt32 i = 0; i < meshlet.vertexCount; ++i)
+			local[meshlets.vertices[meshlet.vertexOffset + i]] = -1;
+
+		computeBounds(positions, meshlets, meshlet);
+		meshlets.meshlets.push_back(meshlet);
+	}
+}
+
+} // anonymous namespace
+
+// Clear the meshlets
+void MeshletData::clear()
+{
+	meshlets.clear();
+	vertices.clear();
+	triangles.clear();
+}
+
+// Default ctor
+MeshletBuilder::MeshletBuilder(UInt32 maxVertices, UInt32 maxTriangles) :
+	m_maxVertices(o3d::max<UInt32>(3, o3d::min(maxVertices, MAX_MESHLET_VERTICES))),
+	m_maxTriangles(o3d::max<UInt32>(1, maxTriangles))
+{
+}
+
+// Build the meshlets of a face array
+void MeshletBuilder::build(
+	const Float *positions,
+	UInt32 numVertices,
+	const UInt32 *indices,
+	UInt32 numIndices,
+	UInt32 faceArray,
+	MeshletData &meshlets) const
+{
+	buildMeshlets(
+		positions, numVertices, indices, numIndices, faceArray,
+		m_maxVertices, m_maxTriangles, meshlets, &MeshletBuilder::computeBounds);
+}
+
+// Build the meshlets of a face array of 16 bits indices
+void MeshletBuilder::build(
+	const Float *positions,
+	UInt32 numVertices,
+	const UInt16 *indices,
+	UInt32 numIndices,
+	UInt32 faceArray,
+	MeshletData &meshlets) const
+{
+	buildMeshlets(
+		positions, numVertices, indices, numIndices, faceArray,
+		m_maxVertices, m_maxTriangles, meshlets, &MeshletBuilder::computeBounds);
+}
+
+// Compute the bounding sphere and the normal cone of a built meshlet
+void MeshletBuilder::computeBounds(const Float *positions, MeshletData &meshlets, Meshlet &meshlet)
+{
+	const UInt32 *vertices = &meshlets.vertices[meshlet.vertexOffset];
+	const UInt8 *triangles = &meshlets.triangles[meshlet.triangleOffset * 3];
+
+	// sphere centered on the bounding box
+	Float bmin[3] = {
+		std::numeric_limits<Float>::max(),
+		std::numeric_limits<Float>::max(),
+		std::numeric_limits<Float>::max() };
+
+	Float bmax[3] = {
+		-std::numeric_limits<Float>::max(),
+		-std::numeric_limits<Float>::max(),
+		-std::numeric_limits<Float>::max() };
+
+	for (UInt32 i = 0; i < meshlet.vertexCount; ++i)
+	{
+		const Float *p = &positions[vertices[i]*3];
+		for (UInt32 k = 0; k < 3; ++k)
+		{
+			bmin[k] = o3d::min(bmin[k], p[k]);
+			bmax[k] = o3d::max(bmax[k], p[k]);
+		}
+	}
+
+	Float radius2 = 0.f;
+	for (UInt32 k = 0; k < 3; ++k)
+		meshlet.center[k] = (bmin[k] + bmax[k]) * 0.5f;
+
+	for (UInt32 i = 0; i < meshlet.vertexCount; ++i)
+	{
+		const Float *p = &positions[vertices[i]*3];
+
+		const Float dx = p[0] - meshlet.center[0];
+		const Float dy = p[1] - meshlet.center[1];
+		const Float dz = p[2] - meshlet.center[2];
+
+		radius2 = o3d::max(radius2, dx*dx + dy*dy + dz*dz);
+	}
+
+	meshlet.radius = std::sqrt(radius2);
+
+	// unit normal of each triangle
+	std::vector<Float> normals(meshlet.triangleCount * 3, 0.f);
+	Float axis[3] = { 0.f, 0.f, 0.f };
+
+	for (UInt32 t = 0; t < meshlet.triangleCount; ++t)
+	{
+		const Float *p0 = &positions[vertices[triangles[t*3+0]]*3];
+		const Float *p1 = &positions[vertices[triangles[t*3+1]]*3];
+		const Float *p2 = &positions[vertices[triangles[t*3+2]]*3];
+
+		const Float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+		const Float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+
+		Float *n = &normals[t*3];
+		n[0] = e1[1]*e2[2] - e1[2]*e2[1];
+		n[1] = e1[2]*e2[0] - e1[0]*e2[2];
+		n[2] = e1[0]*e2[1] - e1[1]*e2[0];
+
+		const Float len = std::sqrt(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+		if (len < 1e-20f)
+		{
+			n[0] = n[1] = n[2] = 0.f;
+			continue;
+		}
+
+		for (UInt32 k = 0; k < 3; ++k)
+		{
+			n[k] /= len;
+			axis[k] += n[k];
+		}
+	}
+
+	meshlet.coneApex[0] = meshlet.center[0];
+	meshlet.coneApex[1] = meshlet.center[1];
+	meshlet.coneApex[2] = meshlet.center[2];
+	meshlet.coneCutoff = 1.f;
+
+	const Float axisLen = std::sqrt(axis[0]*axis[0] + axis[1]*axis[1] + axis[2]*axis[2]);
+	for (UInt32 k = 0; k < 3; ++k)
+		meshlet.coneAxis[k] = axisLen > 0.f ? axis[k] / axisLen : 0.f;
+
+	if (axisLen <= 0.f)
+		return;
+
+	// the cone contains the normals of every triangle
+	Float minDot = 1.f;
+	for (UInt32 t = 0; t < meshlet.triangleCount; ++t)
+	{
+		const Float *n = &normals[t*3];
+		if (n[0] == 0.f && n[1] == 0.f && n[2] == 0.f)
+			continue;
+
+		minDot = o3d::min(minDot, n[0]*meshlet.coneAxis[0] + n[1]*meshlet.coneAxis[1] + n[2]*meshlet.coneAxis[2]);
+	}
+
+	// too wide, the meshlet is never back facing
+	if (minDot <= 0.1f)
+		return;
+
+	// apex behind every triangle plane along the axis
+	Float maxT = 0.f;
+	for (UInt32 t = 0; t < meshlet.triangleCount; ++t)
+	{
+		const Float *n = &normals[t*3];
+		const Float dn = n[0]*meshlet.coneAxis[0] + n[1]*meshlet.coneAxis[1] + n[2]*meshlet.coneAxis[2];
+		if (dn <= 0.f)
+			continue;
+
+		const Float *p0 = &positions[vertices[triangles[t*3]]*3];
+		const Float dc =
+			(meshlet.center[0] - p0[0]) * n[0] +
+			(meshlet.center[1] - p0[1]) * n[1] +
+			(meshlet.center[2] - p0[2]) * n[2];
+
+		maxT = o3d::max(maxT, dc / dn);
+	}
+
+	for (UInt32 k = 0; k < 3; ++k)
+		meshlet.coneApex[k] = meshlet.center[k] - meshlet.coneAxis[k] * maxT;
+
+	// the normal cone widened by 90 degrees on both sides, and inverted
+	meshlet.coneCutoff = std::sqrt(1.f - minDot * minDot);
+}
+
+// Add or replace the meshlets of a mesh data
+void MeshletLibrary::add(const String &resourceName, MeshletData &meshlets)
+{
+	MeshletData &data = m_meshlets[resourceName];
+
+	data.meshlets.swap(meshlets.meshlets);
+	data.vertices.swap(meshlets.vertices);
+	data.triangles.swap(meshlets.triangles);
+
+	meshlets.clear();
+}
+
+// Get the meshlets of a mesh data
+const MeshletData* MeshletLibrary::find(const String &resourceName) const
+{
+	std::map<String, MeshletData>::const_iterator it = m_meshlets.find(resourceName);
+	return it != m_meshlets.end() ? &it->second : nullptr;
+}
@@ -39,6 +39,9 @@ CNode::CNode(
         m_node(nullptr),
         m_join(nullptr),
 		m_domNode(node),
+		m_isJoin(False),
+		m_hasTransform(False),
+		m_selected(True),
         m_father(nullptr),
         m_animNode(nullptr)
 {
@@ -58,6 +61,14 @@ Bool CNode::import()
 	m_name = m_domNode->getName() ? m_domNode->getName() : "";
 	m_id = m_domNode->getId() ? m_domNode->getId() : "";
 
+	m_isJoin = m_domNode->getType() == NODETYPE_JOINT;
+	m_hasTransform = m_domNode->getContents().getCount() > 0;
+
+	const ImportOptions &options = m_infos.getOptions();
+
+	// a son of a selected node is selected, any other node must match itself
+	m_selected = (m_father && m_father->m_selected) || options.matchNode(m_id, m_name);
+
 	// for each content
 	daeElementRefArray &contentArray = m_domNode->getContents();
 	for (size_t i = 0; i < contentArray.getCount(); ++i)
@@ -184,7 +195,7 @@ Bool CNode::import()
 	/*const domInstance_camera_Array &cameraArray = m_Node->getInstance_camera_array();
 	for (size_t i = 0; i < cameraArray.getCount(); ++i)
 	{
-        CCamera *pCamera = new CCamera(m_scene, &m_dom, cameraArray[i]);
+        CCamera *pCamera = new CCamera(m_scene, m_dom, cameraArray[i]);
 		if (pCamera->import())
 			m_CameraList.push_back(pCamera);
 		else
@@ -210,14 +221,14 @@ Bool CNode::import()
 
 	// import geometry instance
 	const domInstance_geometry_Array &geoArray = m_domNode->getInstance_geometry_array();
-	for (size_t i = 0; i < geoArray.getCount(); ++i)
+	for (size_t i = 0; m_selected && i < geoArray.getCount(); ++i)
 	{
 		const domBind_materialRef material = geoArray[i]->getBind_material();
 		daeElement *geoElt = geoArray[i]->getUrl().getElement();
 
 		CGeometry *geometry = new CGeometry(
 			m_scene,
-			&m_dom,
+			m_dom,
 			m_infos,
 			domGeometryRef((domGeometry*)geoElt),
 			material);
@@ -233,14 +244,14 @@ Bool CNode::import()
 
 	// import controller instance
 	const domInstance_controller_Array &ctrlArray = m_domNode->getInstance_controller_array();
-	for (size_t i = 0; i < ctrlArray.getCount(); ++i)
+	for (size_t i = 0; m_selected && options.skins && i < ctrlArray.getCount(); ++i)
 	{
 		const domBind_materialRef material = ctrlArray[i]->getBind_material();
 		daeElement *ctrlElt = ctrlArray[i]->getUrl().getElement();
 
 		CController *controller = new CController(
 			m_scene,
-			&m_dom,
+			m_dom,
 			m_infos,
 			domControllerRef((domController*)ctrlElt),
 			material);
@@ -271,7 +282,11 @@ Bool CNode::import()
 	domNode_Array &nodeArray = m_domNode->getNode_array();
 	for (size_t i = 0; i < nodeArray.getCount(); ++i)
 	{
-		CNode *node = new CNode(m_scene, &m_dom, m_infos, nodeArray.get(i));
+		// skip the sub-trees without any selected node
+		if (!m_selected && !hasSelectedNode(options, nodeArray.get(i)))
+			continue;
+
+		CNode *node = new CNode(m_scene, m_dom, m_infos, nodeArray.get(i));
 		node->m_father = this;
 
 		if (node->import())
@@ -290,6 +305,25 @@ Bool CNode::import()
 	return True;
 }
 
+// Does a node or one of its sons match the node filters
+Bool CNode::hasSelectedNode(const ImportOptions &options, domNode *node)
+{
+	if (!options.hasNodeFilters())
+		return True;
+
+	if (options.matchNode(node->getId() ? node->getId() : "", node->getName() ? node->getName() : ""))
+		return True;
+
+	domNode_Array &nodeArray = node->getNode_array();
+	for (size_t i = 0; i < nodeArray.getCount(); ++i)
+	{
+		if (hasSelectedNode(options, nodeArray.get(i)))
+			return True;
+	}
+
+	return False;
+}
+
 // Export method
 Bool CNode::doExport()
 {
@@ -301,7 +335,7 @@ Bool CNode::doExport()
 // Set post-import values to the scene
 Bool CNode::toScene()
 {
-	if (m_domNode->getType() == NODETYPE_JOINT)
+	if (m_isJoin)
         if (m_parentNode)
             m_node = new Bones(m_parentNode);
         else
@@ -309,7 +343,7 @@ Bool CNode::toScene()
 	else
         m_node = new Node(m_parentNode);
 
-	if (m_domNode->getContents().getCount())
+	if (m_hasTransform)
 	{
 		MTransform *transform = new MTransform;
 		m_node->addTransform(transform);
@@ -452,6 +486,23 @@ Bool CNode::fromScene()
 	return True;
 }
 
+// Release any reference to the COLLADA-DOM, recursively
+void CNode::releaseDom()
+{
+	m_domNode = domNodeRef();
+
+	for (IT_GeometryList it = m_geometryList.begin(); it != m_geometryList.end(); ++it)
+		(*it)->releaseDom();
+
+	for (IT_ControllerList it = m_controllerList.begin(); it != m_controllerList.end(); ++it)
+		(*it)->releaseDom();
+
+	for (IT_ChildNodeList it = m_childNodes.begin(); it != m_childNodes.end(); ++it)
+		(*it)->releaseDom();
+
+	CBaseObject::releaseDom();
+}
+
 // Set the animation object if it exists
 void CNode::addAnimation(CAnimation *pAnim)
 {
@@ -465,6 +516,6 @@ Bool CNode::isAnimationRoot() const
 
 Bool CNode::isJoin() const
 {
-    return m_domNode->getType() == NODETYPE_JOINT;
+    return m_isJoin;
 }
 
@@ -0,0 +1,543 @@
+/**
+ * @file numericarrays.cpp
+ * @brief Implementation of numericarrays.h
+ * @author Frederic SCHERMA (frederic.scherma@dreamoverflow.org)
+ * @date 2026-10-18
+ * @copyright Copyright (c) 2001-2026 Dream Overflow. All rights reserved.
+ * @details
+ */
+
+#include "o3d/collada/precompiled.h"
+#include "o3d/collada/numericarrays.h"
+
+#include <atomic>
+#include <clocale>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <thread>
+
+using namespace o3d;
+using namespace o3d::collada;
+
+namespace {
+
+//! Powers of ten exactly representable as double.
+const Double POW10[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+//! Largest mantissa exactly representable as double, 2^53.
+const UInt64 MAX_EXACT_MANTISSA = UInt64(1) << 53;
+
+//! Size of the text parsed by a single task.
+const size_t CHUNK_SIZE = 1 << 20;
+
+inline Bool isSpace(Char c)
+{
+	return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+inline Bool isDigit(Char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+//! Find a string into [p, end).
+const Char* findString(const Char *p, const Char *end, const Char *str, size_t len)
+{
+	while (p + len <= end)
+	{
+		p = (const Char*)memchr(p, str[0], (size_t)(end - p) - len + 1);
+		if (!p)
+			return nullptr;
+
+		if (memcmp(p, str, len) == 0)
+			return p;
+
+		++p;
+	}
+
+	return nullptr;
+}
+
+//! Get the value of an attribute of the opening tag [tag, tagEnd).
+Bool getAttribute(const Char *tag, const Char *tagEnd, const Char *name, std::string &value)
+{
+	const size_t len = strlen(name);
+
+	for (const Char *p = tag; (p = findString(p, tagEnd, name, len)) != nullptr; p += len)
+	{
+		// a whole attribute name, followed by ="value" or ='value'
+		if (!isSpace(p[-1]))
+			continue;
+
+		const Char *v = p + len;
+		while (v < tagEnd && isSpace(*v))
+			++v;
+
+		if (v >= tagEnd || *v != '=')
+			continue;
+
+		++v;
+		while (v < tagEnd && isSpace(*v))
+			++v;
+
+		if (v >= tagEnd || (*v != '"' && *v != '\''))
+			continue;
+
+		const Char *valueEnd = (const Char*)memchr(v + 1, *v, (size_t)(tagEnd - v - 1));
+		if (!valueEnd)
+			return False;
+
+		value.assign(v + 1, valueEnd);
+		return True;
+	}
+
+	return False;
+}
+
+//! Find the next opening tag into [p, end), skipping the comments and the CDATA
+//! sections, whose content is not markup.
+const Char* findTag(const Char *p, const Char *end, const Char *tag, size_t len)
+{
+	while ((p = (const Char*)memchr(p, '<', (size_t)(end - p))) != nullptr)
+	{
+		const size_t left = (size_t)(end - p);
+
+		if (left >= 4 && memcmp(p, "<!--", 4) == 0)
+		{
+			p = findString(p + 4, end, "-->", 3);
+			if (!p)
+				return nullptr;
+
+			p += 3;
+		}
+		else if (left >= 9 && memcmp(p, "<![CDATA[", 9) == 0)
+		{
+			p = findString(p + 9, end, "]]>", 3);
+			if (!p)
+				return nullptr;
+
+			p += 3;
+		}
+		else if (left >= len && memcmp(p, tag, len) == 0)
+		{
+			return p;
+		}
+		else
+		{
+			++p;
+		}
+	}
+
+	return nullptr;
+}
+
+//! Parse a number with strtod, independently of the locale.
+Double parseDouble(const Char *str, const Char *end)
+{
+	const size_t len = (size_t)(end - str);
+
+	Char local[64];
+	std::string buffer;
+	Char *text = local;
+
+	if (len >= sizeof(local))
+	{
+		buffer.resize(len + 1);
+		text = &buffer[0];
+	}
+
+	memcpy(text, str, len);
+	text[len] = '\0';
+
+	// strtod uses the decimal point of the current locale
+	const Char point = *localeconv()->decimal_point;
+	if (point != '.')
+	{
+		Char *dot = (Char*)memchr(text, '.', len);
+		if (dot)
+			*dot = point;
+	}
+
+	return strtod(text, nullptr);
+}
+
+//! A float_array found into the text.
+struct ArrayText
+{
+	std::string id;
+	const Char *begin;       //!< content begin
+	const Char *end;         //!< content end
+	size_t count;            //!< count attribute
+	Bool valid;
+
+	std::vector<Float> values;
+};
+
+//! A part of the content of an array, parsed by a single task.
+struct Chunk
+{
+	size_t array;
+	const Char *begin;
+	const Char *end;
+	Bool valid;
+
+	std::vector<Float> values;
+};
+
+} // anonymous namespace
+
+// Parse a xs:double
+const Char* o3d::collada::parseFloat(const Char *str, const Char *end, Float &value)
+{
+	const Char *p = str;
+	Bool negative = False;
+
+	if (p < end && (*p == '-' || *p == '+'))
+	{
+		negative = *p == '-';
+		++p;
+	}
+
+	// special values of xs:double
+	if (end - p >= 3)
+	{
+		if (p[0] == 'I' && p[1] == 'N' && p[2] == 'F')
+		{
+			value = negative ? -std::numeric_limits<Float>::infinity() : std::numeric_limits<Float>::infinity();
+			return p + 3;
+		}
+		else if (p[0] == 'N' && p[1] == 'a' && p[2] == 'N')
+		{
+			value = std::numeric_limits<Float>::quiet_NaN();
+			return p + 3;
+		}
+	}
+
+	// at most 19 significant digits fit into the mantissa, the others only scale it
+	UInt64 mantissa = 0;
+	Int32 exponent = 0;
+	Int32 numDigits = 0;
+	Bool hasDigits = False;
+	Bool truncated = False;   // a non zero digit is dropped
+
+	while (p < end && isDigit(*p))
+	{
+		if (numDigits < 19)
+		{
+			mantissa = mantissa * 10 + (UInt64)(*p - '0');
+			if (mantissa)
+				++numDigits;
+		}
+		else
+		{
+			truncated |= *p != '0';
+			++exponent;
+		}
+
+		hasDigits = True;
+		++p;
+	}
+
+	if (p < end && *p == '.')
+	{
+		++p;
+
+		while (p < end && isDigit(*p))
+		{
+			if (numDigits < 19)
+			{
+				mantissa = mantissa * 10 + (UInt64)(*p - '0');
+				if (mantissa)
+					++numDigits;
+
+				--exponent;
+			}
+			else
+				truncated |= *p != '0';
+
+			hasDigits = True;
+			++p;
+		}
+	}
+
+	if (!hasDigits)
+		return nullptr;
+
+	if (p < end && (*p == 'e' || *p == 'E'))
+	{
+		++p;
+
+		Bool negativeExp = False;
+		if (p < end && (*p == '-' || *p == '+'))
+		{
+			negativeExp = *p == '-';
+			++p;
+		}
+
+		if (p >= end || !isDigit(*p))
+			return nullptr;
+
+		Int32 exp = 0;
+		while (p < end && isDigit(*p))
+		{
+			if (exp < 10000)
+				exp = exp * 10 + (*p - '0');
+
+			++p;
+		}
+
+		exponent += negativeExp ? -exp : exp;
+	}
+
+	// an exact mantissa scaled once by an exact power of ten is correctly rounded, as
+	// by strtod, so the float is the same as converted from the COLLADA-DOM double
+	Double d = (Double)mantissa;
+
+	if (mantissa != 0)
+	{
+		if (truncated || mantissa > MAX_EXACT_MANTISSA || exponent > 22 || exponent < -22)
+		{
+			value = (Float)parseDouble(str, p);
+			return p;
+		}
+
+		if (exponent >= 0)
+			d *= POW10[exponent];
+		else
+			d /= POW10[-exponent];
+	}
+
+	value = (Float)(negative ? -d : d);
+
+	return p;
+}
+
+// Parse a list of whitespace separated xs:double
+Bool o3d::collada::parseFloats(const Char *begin, const Char *end, std::vector<Float> &values)
+{
+	const Char *p = begin;
+	Float value;
+
+	for (;;)
+	{
+		while (p < end && isSpace(*p))
+			++p;
+
+		if (p >= end)
+			return True;
+
+		const Char *next = parseFloat(p, end, value);
+		if (!next || (next < end && !isSpace(*next)))
+			return False;
+
+		values.push_back(value);
+		p = next;
+	}
+}
+
+// Default ctor
+NumericArrays::NumericArrays() :
+	m_document(nullptr),
+	m_numValues(0)
+{
+}
+
+// Extract and parse the float_array of a document text
+Bool NumericArrays::extract(const Char *data, UInt64 size, UInt32 numThreads, std::string &document)
+{
+	static const Char openTag[] = "<float_array";
+	static const Char closeTag[] = "</float_array>";
+
+	const size_t openLen = sizeof(openTag) - 1;
+	const size_t closeLen = sizeof(closeTag) - 1;
+
+	const Char *end = data + size;
+
+	std::vector<ArrayText> arrays;
+	std::vector<Chunk> chunks;
+
+	// find the arrays and split their content into chunks ending on a whitespace. An
+	// array whose content is not only numbers (a comment, a CDATA section, an entity)
+	// fails to parse, and is left to the COLLADA-DOM.
+	for (const Char *p = data; (p = findTag(p, end, openTag, openLen)) != nullptr;)
+	{
+		const Char *tag = p + openLen;
+		if (tag >= end || !(isSpace(*tag) || *tag == '>'))
+		{
+			p = tag;
+			continue;
+		}
+
+		const Char *tagEnd = (const Char*)memchr(tag, '>', (size_t)(end - tag));
+		if (!tagEnd)
+			break;
+
+		// an empty element
+		if (tagEnd[-1] == '/')
+		{
+			p = tagEnd;
+			continue;
+		}
+
+		const Char *close = findString(tagEnd + 1, end, closeTag, closeLen);
+		if (!close)
+			break;
+
+		p = close + closeLen;
+
+		ArrayText array;
+		std::string count;
+
+		if (!getAttribute(tag, tagEnd, "id", array.id) || array.id.empty() ||
+			!getAttribute(tag, tagEnd, "count", count) || count.empty())
+			continue;
+
+		array.begin = tagEnd + 1;
+		array.end = close;
+		array.count = (size_t)strtoull(count.c_str(), nullptr, 10);
+		array.valid = True;
+
+		arrays.push_back(array);
+
+		for (const Char *c = array.begin; c < array.end;)
+		{
+			const Char *cEnd = (size_t)(array.end - c) > CHUNK_SIZE ? c + CHUNK_SIZE : array.end;
+			while (cEnd < array.end && !isSpace(*cEnd))
+				++cEnd;
+
+			Chunk chunk;
+			chunk.array = arrays.size() - 1;
+			chunk.begin = c;
+			chunk.end = cEnd;
+			chunk.valid = True;
+
+			chunks.push_back(chunk);
+
+			c = cEnd;
+		}
+	}
+
+	if (arrays.empty())
+		return False;
+
+	// parse the chunks
+	auto parseChunk = [] (Chunk &chunk)
+	{
+		chunk.values.reserve((size_t)(chunk.end - chunk.begin) / 8);
+		chunk.valid = parseFloats(chunk.begin, chunk.end, chunk.values);
+	};
+
+	numThreads = o3d::min<UInt32>(numThreads, (UInt32)chunks.size());
+
+	if (numThreads > 1)
+	{
+		std::atomic<size_t> next(0);
+		std::vector<std::thread> threads;
+
+		for (UInt32 i = 0; i < numThreads; ++i)
+		{
+			threads.push_back(std::thread([&chunks, &next, &parseChunk] ()
+			{
+				size_t c;
+				while ((c = next++) < chunks.size())
+					parseChunk(chunks[c]);
+			}));
+		}
+
+		for (std::thread &thread : threads)
+			thread.join();
+	}
+	else
+	{
+		for (Chunk &chunk : chunks)
+			parseChunk(chunk);
+	}
+
+	// gather the chunks into their array
+	for (Chunk &chunk : chunks)
+	{
+		ArrayText &array = arrays[chunk.array];
+		array.valid &= chunk.valid;
+
+		if (!array.valid)
+			continue;
+
+		if (array.values.empty())
+			array.values.swap(chunk.values);
+		else
+			array.values.insert(array.values.end(), chunk.values.begin(), chunk.values.end());
+	}
+
+	// the extracted arrays content is removed from the text
+	size_t removed = 0;
+
+	for (ArrayText &array : arrays)
+	{
+		if (!array.valid || array.values.size() != array.count || m_arrays.count(array.id))
+		{
+			array.valid = False;
+			continue;
+		}
+
+		m_numValues += array.values.size();
+		removed += (size_t)(array.end - array.begin);
+
+		m_arrays[array.id].swap(array.values);
+	}
+
+	if (removed == 0)
+		return False;
+
+	document.clear();
+	document.reserve((size_t)size - removed);
+
+	const Char *copied = data;
+	for (const ArrayText &array : arrays)
+	{
+		if (!array.valid)
+			continue;
+
+		document.append(copied, array.begin);
+		copied = array.end;
+	}
+
+	document.append(copied, end);
+
+	return True;
+}
+
+// Get the values of a float_array
+FloatArrayView NumericArrays::getFloats(domFloat_array *array) const
+{
+	if (array->getId() && array->getDocument() == m_document)
+	{
+		CIT_FloatArrayMap it = m_arrays.find(array->getId());
+		if (it != m_arrays.end())
+			return FloatArrayView(it->second);
+	}
+
+	return FloatArrayView(array->getValue());
+}
+
+// Get the values of a float_array, using the extracted arrays if not null
+FloatArrayView NumericArrays::getFloats(const NumericArrays *arrays, domFloat_array *array)
+{
+	if (!array)
+		return FloatArrayView();
+
+	if (arrays)
+		return arrays->getFloats(array);
+
+	return FloatArrayView(array->getValue());
+}
+
+// Release the extracted arrays
+void NumericArrays::clear()
+{
+	m_arrays.clear();
+	m_numValues = 0;
+	m_document = nullptr;
+}
@@ -11,11 +11,25 @@
 
 #include "o3d/collada/collada.h"
 #include "o3d/collada/global.h"
+#include "o3d/collada/importqueue.h"
+#include "o3d/collada/animatedbounds.h"
 #include "o3d/collada/animation.h"
+#include "o3d/collada/animationsampler.h"
+#include "o3d/collada/archive.h"
+#include "o3d/collada/bonetexture.h"
+#include "o3d/collada/bvh.h"
 #include "o3d/collada/camera.h"
 #include "o3d/collada/light.h"
 #include "o3d/collada/geometry.h"
 #include "o3d/collada/node.h"
+#include "o3d/collada/numericarrays.h"
+#include "o3d/collada/mappedfile.h"
 #include "o3d/collada/material.h"
+#include "o3d/collada/meshlets.h"
 #include "o3d/collada/controller.h"
+#include "o3d/collada/exporter.h"
+#include "o3d/collada/profiler.h"
+#include "o3d/collada/session.h"
+#include "o3d/collada/uriresolver.h"
+#include "o3d/collada/xmlwriter.h"
 
@@ -0,0 +1,225 @@
+/**
+ * @file profiler.cpp
+ * @brief Implementation of profiler.h
+ * @author Frederic SCHERMA (frederic.scherma@dreamoverflow.org)
+ * @date 2026-10-18
+ * @copyright Copyright (c) 2001-2026 Dream Overflow. All rights reserved.
+ * @details
+ */
+
+#include "o3d/collada/precompiled.h"
+#include "o3d/collada/profiler.h"
+
+#include <o3d/core/debug.h>
+
+#include <stdio.h>
+
+using namespace o3d;
+using namespace o3d::collada;
+
+// Write a JSON string, escaping quotes, backslashes and control characters
+static void writeJsonString(FILE *file, const String &str)
+{
+	CString utf8 = str.toUtf8();
+	const char *c = utf8.getData();
+
+	fputc('"', file);
+
+	while (c && *c)
+	{
+		if (*c == '"' || *c == '\\')
+		{
+			fputc('\\', file);
+			fputc(*c, file);
+		}
+		else if ((unsigned char)*c < 0x20)
+			fprintf(file, "\\u%04x", (unsigned char)*c);
+		else
+			fputc(*c, file);
+
+		++c;
+	}
+
+	fputc('"', file);
+}
+
+// Default ctor
+ImportProfiler::ImportProfiler() :
+	m_origin(0),
+	m_counter(nullptr)
+{
+	m_origin = now();
+}
+
+// Current time in microseconds
+Int64 ImportProfiler::now() const
+{
+	return (Int64)((Double)System::getTime() * 1000000.0 / (Double)System::getTimeFrequency());
+}
+
+// Open a scope and returns its entry index
+UInt32 ImportProfiler::begin(const String &category, const String &name)
+{
+	Int64 start = now() - m_origin;
+	UInt64 counter = m_counter ? m_counter() : 0;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	std::map<std::thread::id, ThreadState>::iterator it = m_threads.find(std::this_thread::get_id());
+	if (it == m_threads.end())
+	{
+		ThreadState state;
+		state.index = (UInt32)m_threads.size();
+		state.depth = 0;
+
+		it = m_threads.insert(std::make_pair(std::this_thread::get_id(), state)).first;
+	}
+
+	Entry entry;
+	entry.category = category;
+	entry.name = name;
+	entry.start = start;
+	entry.duration = 0;
+	entry.depth = it->second.depth++;
+	entry.thread = it->second.index;
+	entry.counter = counter;
+
+	m_entries.push_back(entry);
+
+	return (UInt32)m_entries.size() - 1;
+}
+
+// Close a scope given its entry index
+void ImportProfiler::end(UInt32 index)
+{
+	Int64 stop = now() - m_origin;
+	UInt64 counter = m_counter ? m_counter() : 0;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (index >= m_entries.size())
+		return;
+
+	Entry &entry = m_entries[index];
+	entry.duration = stop - entry.start;
+	entry.counter = counter - entry.counter;
+
+	std::map<std::thread::id, ThreadState>::iterator it = m_threads.find(std::this_thread::get_id());
+	if (it != m_threads.end() && it->second.depth > 0)
+		--it->second.depth;
+}
+
+// Get the total duration per phase
+ImportProfiler::T_PhaseMap ImportProfiler::getPhases() const
+{
+	T_PhaseMap phases;
+	accumulate(&phases, nullptr);
+
+	return phases;
+}
+
+// Get the counter delta per phase
+ImportProfiler::T_PhaseCounterMap ImportProfiler::getPhaseCounters() const
+{
+	T_PhaseCounterMap counters;
+	accumulate(nullptr, &counters);
+
+	return counters;
+}
+
+// Accumulate durations and counters per category
+void ImportProfiler::accumulate(T_PhaseMap *durations, T_PhaseCounterMap *counters) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	// an entry is not counted if an enclosing entry of the same thread has the same category
+	std::map<UInt32, std::vector<const Entry*> > stacks;
+
+	for (CIT_EntryVector it = m_entries.begin(); it != m_entries.end(); ++it)
+	{
+		std::vector<const Entry*> &stack = stacks[it->thread];
+		stack.resize(it->depth);
+
+		Bool nested = False;
+		for (size_t i = 0; i < stack.size(); ++i)
+		{
+			if (stack[i] && stack[i]->category == it->category)
+			{
+				nested = True;
+				break;
+			}
+		}
+
+		if (!nested)
+		{
+			if (durations)
+				(*durations)[it->category] += (Double)it->duration / 1000000.0;
+
+			if (counters)
+				(*counters)[it->category] += it->counter;
+		}
+
+		stack.push_back(&(*it));
+	}
+}
+
+// Clear any recorded entries
+void ImportProfiler::clear()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_entries.clear();
+	m_threads.clear();
+
+	m_origin = now();
+}
+
+// Log the time spent per phase
+void ImportProfiler::log() const
+{
+	T_PhaseMap phases = getPhases();
+
+	for (CIT_PhaseMap it = phases.begin(); it != phases.end(); ++it)
+		O3D_MESSAGE(it->first + String::print(" %f s", it->second));
+}
+
+// Write the entries as Chrome trace-event JSON
+Bool ImportProfiler::exportChromeTrace(const String &filename) const
+{
+	FILE *file = fopen(filename.toUtf8().getData(), "wb");
+	if (!file)
+	{
+		O3D_WARNING(String("Unable to open the trace file ") + filename);
+		return False;
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	fputs("{\"traceEvents\":[\n", file);
+
+	for (CIT_EntryVector it = m_entries.begin(); it != m_entries.end(); ++it)
+	{
+		if (it != m_entries.begin())
+			fputs(",\n", file);
+
+		fputs("{\"name\":", file);
+		writeJsonString(file, it->name.isValid() ? it->name : it->category);
+		fputs(",\"cat\":", file);
+		writeJsonString(file, it->category);
+
+		fprintf(file, ",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,\"pid\":1,\"tid\":%u",
+			(long long)it->start,
+			(long long)it->duration,
+			it->thread);
+
+		if (m_counter)
+			fprintf(file, ",\"args\":{\"counter\":%llu}", (unsigned long long)it->counter);
+
+		fputc('}', file);
+	}
+
+	fputs("\n],\"displayTimeUnit\":\"ms\"}\n", file);
+	fclose(file);
+
+	return True;
+}
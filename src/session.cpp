@@ -0,0 +1,128 @@
+/**
+ * @file session.cpp
+ * @brief Implementation of session.h
+ * @author Frederic SCHERMA (frederic.scherma@dreamoverflow.org)
+ * @date 2026-10-18
+ * @copyright Copyright (c) 2001-2026 Dream Overflow. All rights reserved.
+ * @details
+ */
+
+#include "o3d/collada/precompiled.h"
+#include "o3d/collada/session.h"
+
+using namespace o3d;
+using namespace o3d::collada;
+
+// Default ctor
+ColladaSession::ColladaSession(o3d::Scene *scene) :
+	m_scene(scene),
+	m_dae(nullptr)
+{
+	O3D_ASSERT(m_scene);
+}
+
+// Destructor
+ColladaSession::~ColladaSession()
+{
+	deleteDAE(m_dae);
+}
+
+// Get the COLLADA-DOM database
+DAE* ColladaSession::getDAE()
+{
+	if (!m_dae)
+		m_dae = createDAE();
+
+	return m_dae;
+}
+
+// Get a key unique for an element of the database
+String ColladaSession::getElementKey(daeElement *element)
+{
+	if (!element || !element->getID())
+		return String();
+
+	String key;
+
+	daeURI *uri = element->getDocumentURI();
+	if (uri)
+		key = uri->str().c_str();
+
+	return key + '#' + element->getID();
+}
+
+// Find an already resolved texture path
+Bool ColladaSession::findTexturePath(const String &key, String &path)
+{
+	IT_TexturePathMap it = m_texturePaths.find(key);
+	if (it == m_texturePaths.end())
+		return False;
+
+	path = it->second;
+	++m_statistics.textureHits;
+
+	return True;
+}
+
+// Add a resolved texture path
+void ColladaSession::addTexturePath(const String &key, const String &path)
+{
+	m_texturePaths[key] = path;
+}
+
+// Find an already parsed effect
+const CMaterial::Effect* ColladaSession::findEffect(const String &key)
+{
+	if (key.isEmpty())
+		return nullptr;
+
+	IT_EffectMap it = m_effects.find(key);
+	if (it == m_effects.end())
+		return nullptr;
+
+	++m_statistics.effectHits;
+
+	return &it->second;
+}
+
+// Add a parsed effect
+void ColladaSession::addEffect(const String &key, const CMaterial::Effect &effect)
+{
+	if (key.isValid())
+		m_effects[key] = effect;
+}
+
+// Find a geometry already converted to a mesh data
+const ColladaSession::MeshDataEntry* ColladaSession::findMeshData(const String &key)
+{
+	if (key.isEmpty())
+		return nullptr;
+
+	IT_MeshDataMap it = m_meshDatas.find(key);
+	if (it == m_meshDatas.end())
+		return nullptr;
+
+	++m_statistics.meshDataHits;
+
+	return &it->second;
+}
+
+// Add a geometry converted to a mesh data
+void ColladaSession::addMeshData(const String &key, const MeshDataEntry &entry)
+{
+	if (key.isValid())
+		m_meshDatas[key] = entry;
+}
+
+// Clear the caches and unload any document of the database
+void ColladaSession::clear()
+{
+	m_texturePaths.clear();
+	m_effects.clear();
+	m_meshDatas.clear();
+
+	if (m_dae)
+		m_dae->clear();
+
+	m_statistics = Statistics();
+}
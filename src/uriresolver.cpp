@@ -0,0 +1,33 @@
+/**
+ * @file uriresolver.cpp
+ * @brief Implementation of uriresolver.h
+ * @author Frederic SCHERMA (frederic.scherma@dreamoverflow.org)
+ * @date 2026-10-18
+ * @copyright Copyright (c) 2001-2026 Dream Overflow. All rights reserved.
+ * @details
+ */
+
+#include "o3d/collada/precompiled.h"
+#include "o3d/collada/uriresolver.h"
+#include "o3d/collada/global.h"
+
+#include <o3d/core/filemanager.h>
+
+using namespace o3d;
+using namespace o3d::collada;
+
+// Resolve the file name of a texture
+String UriResolver::resolveTexture(const String &uri, const String &basePath) const
+{
+	String path = cdom::uriToNativePath(uri.toUtf8().getData()).c_str();
+	path.replace('\\','/');
+
+	// make absolute path file name
+	if (FileManager::instance()->isRelativePath(path))
+	{
+		path = basePath + '/' + path;
+		FileManager::adaptPath(path);
+	}
+
+	return path;
+}
@@ -0,0 +1,586 @@
+/**
+ * @file xmlwriter.cpp
+ * @brief Implementation of xmlwriter.h
+ * @author Frederic SCHERMA (frederic.scherma@dreamoverflow.org)
+ * @date 2026-10-18
+ * @copyright Copyright (c) 2001-2026 Dream Overflow. All rights reserved.
+ * @details
+ */
+
+#include "o3d/collada/precompiled.h"
+#include "o3d/collada/xmlwriter.h"
+
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <thread>
+
+using namespace o3d;
+using namespace o3d::collada;
+
+namespace {
+
+//! Size of the local block the lists of numbers are formatted into.
+const size_t LIST_BLOCK_SIZE = 4096;
+
+//! Number of values of a list formatted by a single task.
+const size_t CHUNK_VALUES = 1 << 16;
+
+//! Minimal number of values of a list formatted in parallel.
+const size_t PARALLEL_MIN_VALUES = 2 * CHUNK_VALUES;
+
+//! Number of chunks per thread formatted before being written, it bounds the memory.
+const size_t CHUNKS_PER_THREAD = 4;
+
+//! Powers of ten exactly representable as double.
+const Double POW10[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+//! Powers of ten of the significant digits.
+const UInt64 POW10_INT[] = {
+	1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL,
+	10000000ULL, 100000000ULL, 1000000000ULL };
+
+//! Scale a double by a power of ten, by steps of exact powers.
+Double scalePow10(Double d, Int32 n)
+{
+	while (n > 22)
+	{
+		d *= POW10[22];
+		n -= 22;
+	}
+
+	while (n < -22)
+	{
+		d /= POW10[22];
+		n += 22;
+	}
+
+	return n >= 0 ? d * POW10[n] : d / POW10[-n];
+}
+
+//! Exponent of the first significant digit of a positive value.
+Int32 firstDigitExponent(Double value)
+{
+	// log10 can be wrong by one near the powers of ten
+	Int32 exponent = (Int32)std::floor(std::log10(value));
+	const Double scaled = scalePow10(value, -exponent);
+
+	if (scaled >= 10.0)
+		++exponent;
+	else if (scaled < 1.0)
+		--exponent;
+
+	return exponent;
+}
+
+//! Round a positive value to a number of significant digits. The exponent of the first
+//! digit is incremented if the rounding carries to a new digit.
+UInt64 roundDigits(Double value, Int32 numDigits, Int32 &exponent)
+{
+	UInt64 mantissa = (UInt64)(scalePow10(value, numDigits - 1 - exponent) + 0.5);
+
+	if (mantissa >= POW10_INT[numDigits])
+	{
+		mantissa /= 10;
+		++exponent;
+	}
+
+	return mantissa;
+}
+
+//! Write a mantissa of numDigits significant digits, the first one of the given
+//! exponent, in fixed notation for the common magnitudes, else in scientific notation.
+Char* writeDecimal(UInt64 mantissa, Int32 numDigits, Int32 exponent, Char *out)
+{
+	Char digits[9];
+	for (Int32 i = numDigits - 1; i >= 0; --i)
+	{
+		digits[i] = (Char)('0' + mantissa % 10);
+		mantissa /= 10;
+	}
+
+	while (numDigits > 1 && digits[numDigits-1] == '0')
+		--numDigits;
+
+	if (exponent >= 0 && exponent < 9)
+	{
+		// integer part, padded with zeros
+		for (Int32 i = 0; i <= exponent; ++i)
+			*out++ = i < numDigits ? digits[i] : '0';
+
+		if (numDigits > exponent + 1)
+		{
+			*out++ = '.';
+			for (Int32 i = exponent + 1; i < numDigits; ++i)
+				*out++ = digits[i];
+		}
+	}
+	else if (exponent < 0 && exponent >= -5)
+	{
+		*out++ = '0';
+		*out++ = '.';
+
+		for (Int32 i = exponent + 1; i < 0; ++i)
+			*out++ = '0';
+
+		for (Int32 i = 0; i < numDigits; ++i)
+			*out++ = digits[i];
+	}
+	else
+	{
+		*out++ = digits[0];
+
+		if (numDigits > 1)
+		{
+			*out++ = '.';
+			for (Int32 i = 1; i < numDigits; ++i)
+				*out++ = digits[i];
+		}
+
+		*out++ = 'E';
+
+		if (exponent < 0)
+		{
+			*out++ = '-';
+			exponent = -exponent;
+		}
+
+		out = formatUInt((UInt32)exponent, out);
+	}
+
+	return out;
+}
+
+//! Write the sign and the special values. Returns null if the value is finite and
+//! not zero, value being then made positive.
+Char* writeSpecial(Float &value, Char *&out)
+{
+	if (value != value)
+	{
+		memcpy(out, "NaN", 3);
+		return out + 3;
+	}
+
+	if (std::signbit(value))
+	{
+		*out++ = '-';
+		value = -value;
+	}
+
+	if (value == std::numeric_limits<Float>::infinity())
+	{
+		memcpy(out, "INF", 3);
+		return out + 3;
+	}
+
+	if (value == 0.f)
+	{
+		*out++ = '0';
+		return out;
+	}
+
+	return nullptr;
+}
+
+//! Format the values [begin, end) of a list, separated by a space, the first one
+//! being preceded by a space if it is not the first of the list.
+template <class T, class F>
+Char* formatRange(const T *values, size_t begin, size_t end, F format, Char *out)
+{
+	for (size_t i = begin; i < end; ++i)
+	{
+		if (i > 0)
+			*out++ = ' ';
+
+		out = format(values[i], out);
+	}
+
+	return out;
+}
+
+//! Format a list of numbers by blocks, appended to the writer.
+template <class T, class F>
+void formatList(XmlWriter &writer, const T *values, size_t count, F format)
+{
+	Char block[LIST_BLOCK_SIZE];
+
+	const size_t perBlock = LIST_BLOCK_SIZE / (FLOAT_TEXT_SIZE + 1);
+
+	for (size_t i = 0; i < count; i += perBlock)
+	{
+		Char *end = formatRange(values, i, o3d::min(count, i + perBlock), format, block);
+		writer.raw(block, (size_t)(end - block));
+	}
+}
+
+//! Format a large list of numbers by chunks on many threads, the chunks being appended
+//! to the writer in order. Only a window of chunks per thread is kept in memory.
+template <class T, class F>
+void formatListParallel(XmlWriter &writer, const T *values, size_t count, UInt32 numThreads, F format)
+{
+	const size_t numChunks = (count + CHUNK_VALUES - 1) / CHUNK_VALUES;
+	const size_t window = numThreads * CHUNKS_PER_THREAD;
+
+	std::vector<std::string> texts(o3d::min(window, numChunks));
+
+	for (size_t first = 0; first < numChunks; first += window)
+	{
+		const size_t last = o3d::min(numChunks, first + window);
+		std::atomic<size_t> next(first);
+
+		auto formatChunks = [&] ()
+		{
+			size_t c;
+			while ((c = next++) < last)
+			{
+				const size_t begin = c * CHUNK_VALUES;
+				const size_t end = o3d::min(count, begin + CHUNK_VALUES);
+
+				std::string &text = texts[c - first];
+				text.resize((end - begin) * (FLOAT_TEXT_SIZE + 1));
+
+				Char *p = &text[0];
+				text.resize((size_t)(formatRange(values, begin, end, format, p) - p));
+			}
+		};
+
+		std::vector<std::thread> threads;
+		for (UInt32 i = 1; i < numThreads && first + i < last; ++i)
+			threads.push_back(std::thread(formatChunks));
+
+		// the calling thread takes its share
+		formatChunks();
+
+		for (std::thread &thread : threads)
+			thread.join();
+
+		for (size_t c = first; c < last; ++c)
+			writer.raw(texts[c - first].data(), texts[c - first].size());
+	}
+}
+
+} // anonymous namespace
+
+// Format a float as the shortest xs:double reading back to the same float
+Char* o3d::collada::formatFloat(Float value, Char *out)
+{
+	if (Char *end = writeSpecial(value, out))
+		return end;
+
+	// rounding interval of the float, asymmetric at the powers of two. Above the
+	// largest float the readers round to infinity, so its interval is symmetric
+	const Double v = value;
+	const Double down = v - (Double)std::nextafter(value, 0.f);
+	const Double up = value < std::numeric_limits<Float>::max() ?
+			(Double)std::nextafter(value, std::numeric_limits<Float>::infinity()) - v : down;
+
+	const Int32 exponent = firstDigitExponent(v);
+
+	// the decimal must be far enough of the interval bounds to read back to the same
+	// float even if the reader rounds twice, through a double (as strtod then a cast)
+	for (Int32 numDigits = 1; numDigits < 9; ++numDigits)
+	{
+		Int32 e = exponent;
+		const UInt64 mantissa = roundDigits(v, numDigits, e);
+
+		const Double decimal = scalePow10((Double)mantissa, e - numDigits + 1);
+		const Double diff = decimal - v;
+		const Double half = (diff >= 0 ? up : down) * (0.5 * (1.0 - 1e-6));
+
+		if (std::fabs(diff) < half)
+			return writeDecimal(mantissa, numDigits, e, out);
+	}
+
+	// 9 significant digits always read back to the same float
+	Int32 e = exponent;
+	const UInt64 mantissa = roundDigits(v, 9, e);
+
+	return writeDecimal(mantissa, 9, e, out);
+}
+
+// Format a float with at most a number of significant digits
+Char* o3d::collada::formatFloat(Float value, UInt32 numDigits, Char *out)
+{
+	if (Char *end = writeSpecial(value, out))
+		return end;
+
+	numDigits = o3d::max<UInt32>(1, o3d::min<UInt32>(numDigits, 9));
+
+	Int32 e = firstDigitExponent(value);
+	const UInt64 mantissa = roundDigits(value, (Int32)numDigits, e);
+
+	return writeDecimal(mantissa, (Int32)numDigits, e, out);
+}
+
+// Format an unsigned integer
+Char* o3d::collada::formatUInt(UInt32 value, Char *out)
+{
+	Char digits[10];
+	Int32 n = 0;
+
+	do {
+		digits[n++] = (Char)('0' + value % 10);
+		value /= 10;
+	} while (value);
+
+	while (n > 0)
+		*out++ = digits[--n];
+
+	return out;
+}
+
+// Default ctor
+XmlWriter::XmlWriter(OutStream &os, UInt32 bufferSize) :
+	m_os(os),
+	m_bufferSize(bufferSize),
+	m_numBytes(0),
+	m_error(False),
+	m_floatDigits(0),
+	m_numThreads(1),
+	m_tagOpened(False),
+	m_hasText(False)
+{
+	m_buffer.reserve(m_bufferSize + LIST_BLOCK_SIZE);
+
+	static const Char declaration[] = "<?xml version=\"1.0\" encoding=\"utf-8\"?>";
+	append(declaration, sizeof(declaration) - 1);
+}
+
+// Destructor
+XmlWriter::~XmlWriter()
+{
+	while (!m_elements.empty())
+		endElement();
+
+	flush();
+}
+
+// Open an element
+void XmlWriter::beginElement(const Char *name)
+{
+	closeTag();
+	indent();
+
+	append("<", 1);
+	append(name, strlen(name));
+
+	m_elements.push_back(name);
+	m_tagOpened = True;
+	m_hasText = False;
+}
+
+// Close the last opened element
+void XmlWriter::endElement()
+{
+	O3D_ASSERT(!m_elements.empty());
+
+	const Char *name = m_elements.back();
+	m_elements.pop_back();
+
+	if (m_tagOpened)
+	{
+		append("/>", 2);
+		m_tagOpened = False;
+	}
+	else
+	{
+		// a text is closed on its line
+		if (!m_hasText)
+			indent();
+
+		append("</", 2);
+		append(name, strlen(name));
+		append(">", 1);
+	}
+
+	// end of the document
+	if (m_elements.empty())
+		append("\n", 1);
+
+	m_hasText = False;
+}
+
+// Write an element containing only a text
+void XmlWriter::element(const Char *name, const String &str)
+{
+	beginElement(name);
+	text(str);
+	endElement();
+}
+
+// Add an attribute
+void XmlWriter::attribute(const Char *name, const String &value)
+{
+	O3D_ASSERT(m_tagOpened);
+
+	append(" ", 1);
+	append(name, strlen(name));
+	append("=\"", 2);
+	appendEscaped(value, True);
+	append("\"", 1);
+}
+
+// Add an attribute
+void XmlWriter::attribute(const Char *name, const Char *value)
+{
+	attribute(name, String(value));
+}
+
+// Add an unsigned integer attribute
+void XmlWriter::attribute(const Char *name, UInt32 value)
+{
+	O3D_ASSERT(m_tagOpened);
+
+	Char number[16];
+	Char *end = formatUInt(value, number);
+
+	append(" ", 1);
+	append(name, strlen(name));
+	append("=\"", 2);
+	append(number, (size_t)(end - number));
+	append("\"", 1);
+}
+
+// Add an URI fragment attribute
+void XmlWriter::reference(const Char *name, const String &id)
+{
+	attribute(name, String("#") + id);
+}
+
+// Write an escaped text
+void XmlWriter::text(const String &str)
+{
+	closeTag();
+	appendEscaped(str, False);
+
+	m_hasText = True;
+}
+
+// Write a list of floats
+void XmlWriter::floats(const Float *values, size_t count)
+{
+	closeTag();
+
+	const UInt32 digits = m_floatDigits;
+	auto format = [digits] (Float value, Char *out)
+	{
+		return digits ? formatFloat(value, digits, out) : formatFloat(value, out);
+	};
+
+	if (m_numThreads > 1 && count >= PARALLEL_MIN_VALUES)
+		formatListParallel(*this, values, count, m_numThreads, format);
+	else
+		formatList(*this, values, count, format);
+
+	m_hasText = True;
+}
+
+// Write a list of unsigned integers
+void XmlWriter::uints(const UInt32 *values, size_t count)
+{
+	closeTag();
+
+	auto format = [] (UInt32 value, Char *out) { return formatUInt(value, out); };
+
+	if (m_numThreads > 1 && count >= PARALLEL_MIN_VALUES)
+		formatListParallel(*this, values, count, m_numThreads, format);
+	else
+		formatList(*this, values, count, format);
+
+	m_hasText = True;
+}
+
+// Write a list of unsigned short integers
+void XmlWriter::uints(const UInt16 *values, size_t count)
+{
+	closeTag();
+
+	auto format = [] (UInt16 value, Char *out) { return formatUInt(value, out); };
+
+	if (m_numThreads > 1 && count >= PARALLEL_MIN_VALUES)
+		formatListParallel(*this, values, count, m_numThreads, format);
+	else
+		formatList(*this, values, count, format);
+
+	m_hasText = True;
+}
+
+// Write a raw text
+void XmlWriter::raw(const Char *data, size_t size)
+{
+	closeTag();
+	append(data, size);
+
+	m_hasText = True;
+}
+
+// Flush the buffer to the stream
+void XmlWriter::flush()
+{
+	if (m_buffer.empty())
+		return;
+
+	const UInt32 written = m_os.writer(m_buffer.data(), 1, (UInt32)m_buffer.size());
+	if (written != m_buffer.size())
+		m_error = True;
+
+	m_numBytes += m_buffer.size();
+	m_buffer.clear();
+}
+
+// Close the tag of the last opened element
+void XmlWriter::closeTag()
+{
+	if (m_tagOpened)
+	{
+		append(">", 1);
+		m_tagOpened = False;
+	}
+}
+
+// Write a new line and the indentation
+void XmlWriter::indent()
+{
+	static const Char tabs[] = "\n\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t";
+
+	const size_t depth = o3d::min<size_t>(m_elements.size(), sizeof(tabs) - 2);
+	append(tabs, depth + 1);
+}
+
+// Append an escaped string
+void XmlWriter::appendEscaped(const String &str, Bool attribute)
+{
+	const CString utf8 = str.toUtf8();
+	const Char *p = utf8.getData();
+
+	if (!p)
+		return;
+
+	const Char *begin = p;
+
+	for (; *p; ++p)
+	{
+		const Char *entity = nullptr;
+
+		switch (*p)
+		{
+			case '&': entity = "&amp;"; break;
+			case '<': entity = "&lt;"; break;
+			case '>': entity = "&gt;"; break;
+			case '"': entity = attribute ? "&quot;" : nullptr; break;
+			default: break;
+		}
+
+		if (entity)
+		{
+			append(begin, (size_t)(p - begin));
+			append(entity, strlen(entity));
+			begin = p + 1;
+		}
+	}
+
+	append(begin, (size_t)(p - begin));
+}
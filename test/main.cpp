@@ -45,6 +45,10 @@
 #include <o3d/core/application.h>
 
 #include "o3d/collada/collada.h"
+#include "o3d/collada/importqueue.h"
+
+#include <cstdlib>
+#include <list>
 
 using namespace o3d;
 using namespace o3d::collada;
@@ -155,7 +159,10 @@ public:
         m_font(nullptr),
 		m_rotateCam(False),
         m_nodeObject(nullptr),
-        m_picked(nullptr)
+        m_picked(nullptr),
+        m_import(nullptr),
+        m_importQueue(nullptr),
+        m_importBudget(0)
     {
         m_keys = new KeyMapAzerty;
 
@@ -248,6 +255,28 @@ public:
 	// Method called on main window update
 	void onSceneUpdate()
 	{
+		// commit the imports loaded by worker threads, a time slice per update
+		if (m_importQueue && m_importQueue->getNumPending())
+			m_importQueue->commit(m_importBudget);
+
+		// stream the pending imports, a time slice per update
+		if (m_import)
+		{
+			Collada::ImportStage stage = m_import->step(m_importBudget);
+			if ((stage == Collada::IMPORT_DONE) || (stage == Collada::IMPORT_FAILED))
+			{
+				if (m_pendingImports.empty())
+				{
+					m_import = nullptr;
+				}
+				else
+				{
+					m_import->beginImport(m_pendingImports.front());
+					m_pendingImports.pop_front();
+				}
+			}
+		}
+
 		// Get the keyboard object from the input manager of the main window
 		Keyboard * lpKeyboard = getWindow()->getInput().getKeyboard();
 
@@ -315,6 +344,12 @@ public:
         m_font->write(Vector2i(5, 32), String("Tris/lines: ") << getScene()->getFrameManager()->getNumTriangles() << "/" << getScene()->getFrameManager()->getNumLines());
         m_font->write(Vector2i(5, 48), String("Speed: ") << m_speed);
 
+		if (m_importQueue && m_importQueue->getNumPending())
+			m_font->write(Vector2i(5, 64), String("Import: ") << (UInt32)m_importQueue->getNumPending() << " pending");
+		else if (m_import)
+			m_font->write(Vector2i(5, 64), String("Import: ") + Collada::getStageName(m_import->getImportStage()) +
+				String::print(" %i%%", (Int32)(m_import->getStageProgress() * 100.f)));
+
 		// Check for a hit
 		if (getScene()->getPicking()->getSingleHit())
 		{
@@ -533,6 +568,21 @@ public:
 		m_lightObject = light;
 	}
 
+	//! Stream a started import and the pending files, with a time budget per update.
+	void streamImport(Collada *collada, const std::list<String> &pendingFiles, UInt32 budgetMs)
+	{
+		m_import = collada;
+		m_pendingImports = pendingFiles;
+		m_importBudget = budgetMs;
+	}
+
+	//! Commit the imports of a queue as they are loaded, with a time budget per update.
+	void streamImport(ImportQueue *queue, UInt32 budgetMs)
+	{
+		m_importQueue = queue;
+		m_importBudget = budgetMs;
+	}
+
 private:
 
 	Float m_speed;
@@ -546,6 +596,11 @@ private:
 	SceneObject *m_picked;
 	Matrix4 m_pickedMat;
 
+	Collada *m_import;                   //!< streamed import, not owned
+	ImportQueue *m_importQueue;          //!< asynchronous imports, not owned
+	std::list<String> m_pendingImports;  //!< files to stream after the current one
+	UInt32 m_importBudget;               //!< milliseconds of import per update
+
 public:
 
 	static Int32 main()
@@ -561,13 +616,20 @@ public:
 		Application::getCommandLine()->registerArgument("input");
 		Application::getCommandLine()->addOption('r',"root");
 		Application::getCommandLine()->addOption('o',"output");
+		Application::getCommandLine()->addOption('p',"profile");
+		Application::getCommandLine()->addOption('b',"budget");
+		Application::getCommandLine()->addOption('a',"async");
 
 		if (!Application::getCommandLine()->parse())
 		{
 			System::print("--- O3DCollada lib test ---", "collada");
-			System::print("Usage: run.sh <--dir=workingdir> <-root=datadir> <--output=filename> filename.dae", "collada");
+			System::print("Usage: run.sh <--dir=workingdir> <-root=datadir> <--output=filename> filename.dae[;filename2.dae...]", "collada");
+			System::print("Many ';' separated files are imported into the same scene, sharing an import session", "collada");
 			System::print("Use --root option to specifiy where the scene data are located", "collada");
 			System::print("If the --output option is present an O3D scene is exported in the scene root directory", "collada");
+			System::print("If the --profile option is present the import phases timings are written as a Chrome trace JSON file", "collada");
+			System::print("If the --budget=ms option is present the files are imported in the background, a time slice per frame", "collada");
+			System::print("If the --async=1 option is present the files are loaded by worker threads, and committed to the scene per frame", "collada");
 			System::print("Check for some samples into the test/ directory", "collada");
 			return 0;
 		}
@@ -575,6 +637,10 @@ public:
 		String daeFile = Application::getCommandLine()->getArgumentValue("input");
 		String outputFilename = Application::getCommandLine()->getOptionValue("output");
 		String sceneRoot = Application::getCommandLine()->getOptionValue("root");
+		String profileFilename = Application::getCommandLine()->getOptionValue("profile");
+		String budget = Application::getCommandLine()->getOptionValue("budget");
+		String asyncValue = Application::getCommandLine()->getOptionValue("async");
+		Bool async = asyncValue.isValid() && atoi(asyncValue.toUtf8().getData()) != 0;
 
 		if (sceneRoot.isEmpty())
 			sceneRoot = FileManager::instance()->getWorkingDirectory();
@@ -599,15 +665,78 @@ public:
         ColladaTest *myApp = new ColladaTest(sceneRoot);
 
 		// Import the COLLADA scene
+		ImportProfiler profiler;
+
+		ColladaSession session(myApp->getScene());
+
 		Int64 t = System::getTime();
 		Collada collada;
-        collada.setScene(myApp->getScene());
-        collada.processImport(daeFile);
+		collada.setSession(&session);
+		collada.getInfo().setProfiler(&profiler);
+
+		std::string inputs = daeFile.toUtf8().getData();
+		std::list<String> files;
+
+		size_t pos = 0;
+		while (pos <= inputs.size())
+		{
+			size_t end = inputs.find(';', pos);
+			if (end == std::string::npos)
+				end = inputs.size();
+
+			std::string input = inputs.substr(pos, end - pos);
+			if (!input.empty())
+				files.push_back(input.c_str());
+
+			pos = end + 1;
+		}
+
+		UInt32 budgetMs = budget.isValid() ? (UInt32)atoi(budget.toUtf8().getData()) : 0;
+
+		ImportQueue queue(myApp->getScene());
+		queue.getInfo().setProfiler(&profiler);
+
+		// load on worker threads and commit in the event loop
+		if (async)
+		{
+			for (std::list<String>::iterator it = files.begin(); it != files.end(); ++it)
+				queue.push(*it);
+
+			myApp->streamImport(&queue, budgetMs);
+			files.clear();
+		}
+		// import in the background of the event loop
+		else if (budget.isValid() && !files.empty())
+		{
+			collada.beginImport(files.front());
+			files.pop_front();
+
+			myApp->streamImport(&collada, files, budgetMs);
+			files.clear();
+		}
+
+		for (std::list<String>::iterator it = files.begin(); it != files.end(); ++it)
+			collada.processImport(*it);
+
 		t = System::getTime() - t;
 		System::print(String::print("%f s", Float(t) / System::getTimeFrequency()), "collada");
 
-		// Export before to add the camera and lights
-		if (outputFilename.isValid())
+		const ColladaSession::Statistics &stats = session.getStatistics();
+		System::print(String::print("%u imports, cache hits: %u textures, %u effects, %u geometries",
+			stats.numImports,
+			stats.textureHits,
+			stats.effectHits,
+			stats.meshDataHits), "collada");
+
+		const ImportProfiler::T_PhaseMap phases = profiler.getPhases();
+		for (ImportProfiler::CIT_PhaseMap it = phases.begin(); it != phases.end(); ++it)
+			System::print(it->first + String::print(" %f s", it->second), "collada");
+
+		if (profileFilename.isValid())
+			profiler.exportChromeTrace(profileFilename);
+
+		// Export before to add the camera and lights (not possible while streaming)
+		if (outputFilename.isValid() && !collada.isImporting() && !queue.getNumPending())
 		{
 			System::print(String("Export O3D scene into ") + outputFilename + "...", "collada");
             myApp->getScene()->exportScene(outputFilename, SceneIO());
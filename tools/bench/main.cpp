@@ -0,0 +1,721 @@
+/**
+ * @file main.cpp
+ * @brief Benchmark of the importer hot paths.
+ * @author Frederic SCHERMA (frederic.scherma@dreamoverflow.org)
+ * @date 2026-10-18
+ * @copyright Copyright (c) 2001-2026 Dream Overflow. All rights reserved.
+ * @details Import the bundled samples and synthetic documents of growing sizes a few
+ * times each, and report the timings and the allocations per phase, from the import
+ * profiler entries. Results are written as CSV and can be compared to a previous run.
+ * Beforehand, check that the exported floats read back to the same values, and that
+ * synthetic documents imported from many threads at once give the same results than
+ * imported alone.
+ */
+
+#include <o3d/core/main.h>
+#include <o3d/core/commandline.h>
+#include <o3d/core/filemanager.h>
+#include <o3d/core/application.h>
+#include <o3d/core/fileoutstream.h>
+#include <o3d/engine/scene/scene.h>
+
+#include "o3d/collada/collada.h"
+#include "o3d/collada/numericarrays.h"
+#include "o3d/collada/xmlwriter.h"
+#include "../common/syntheticdae.h"
+
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <limits>
+#include <mutex>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace o3d;
+using namespace o3d::collada;
+
+namespace fs = boost::filesystem;
+
+//---------------------------------------------------------------------------------------
+// Allocation counting, every allocation of the process goes through these operators
+//---------------------------------------------------------------------------------------
+
+static std::atomic<UInt64> gNumAllocs(0);
+
+void* operator new(size_t size)
+{
+	++gNumAllocs;
+
+	void *ptr = malloc(size ? size : 1);
+	if (!ptr)
+		throw std::bad_alloc();
+
+	return ptr;
+}
+
+void* operator new[](size_t size)
+{
+	++gNumAllocs;
+
+	void *ptr = malloc(size ? size : 1);
+	if (!ptr)
+		throw std::bad_alloc();
+
+	return ptr;
+}
+
+void operator delete(void *ptr) noexcept
+{
+	free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+	free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+	free(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept
+{
+	free(ptr);
+}
+
+static UInt64 getNumAllocs()
+{
+	return gNumAllocs.load(std::memory_order_relaxed);
+}
+
+//---------------------------------------------------------------------------------------
+// Round trip of the exported floats
+//---------------------------------------------------------------------------------------
+
+//! Does a float formatted by the exporter read back to the same bits, through strtof,
+//! through strtod then a cast, and through the importer parser.
+static Bool checkFloat(Float value)
+{
+	Char text[FLOAT_TEXT_SIZE + 1];
+	Char *end = formatFloat(value, text);
+	*end = 0;
+
+	Float read[3];
+	read[0] = strtof(text, nullptr);
+	read[1] = (Float)strtod(text, nullptr);
+
+	if (!parseFloat(text, end, read[2]))
+		return False;
+
+	for (Int32 i = 0; i < 3; ++i)
+	{
+		if (std::memcmp(&read[i], &value, sizeof(Float)) != 0)
+			return False;
+	}
+
+	return True;
+}
+
+//! Check the round trip of the bounds of the float range, of the powers of two and
+//! their neighbours, and of random bit patterns. Returns the number of failures.
+static UInt32 checkFloatRoundTrip(UInt32 numRandom)
+{
+	std::vector<Float> values = {
+		std::numeric_limits<Float>::max(),
+		std::numeric_limits<Float>::min(),
+		std::numeric_limits<Float>::denorm_min() };
+
+	for (Int32 e = -149; e <= 127; ++e)
+	{
+		const Float p = std::ldexp(1.f, e);
+		values.push_back(p);
+		values.push_back(std::nextafter(p, 0.f));
+		values.push_back(std::nextafter(p, std::numeric_limits<Float>::infinity()));
+	}
+
+	std::mt19937 random(1);
+	for (UInt32 i = 0; i < numRandom; ++i)
+	{
+		UInt32 bits = random();
+		Float value;
+		std::memcpy(&value, &bits, sizeof(Float));
+
+		values.push_back(value);
+	}
+
+	UInt32 failures = 0;
+
+	for (Float value : values)
+	{
+		if (!std::isfinite(value))
+			continue;
+
+		for (Float signedValue : { value, -value })
+		{
+			if (!checkFloat(signedValue))
+			{
+				if (++failures <= 10)
+					System::print(String::print("Float %a does not read back to the same value", signedValue), "bench");
+			}
+		}
+	}
+
+	return failures;
+}
+
+//---------------------------------------------------------------------------------------
+// Concurrent imports
+//---------------------------------------------------------------------------------------
+
+//! Import a document into its own headless scene and export it back to tmpFilename.
+//! Returns the exported document without its dates, as the signature of the import
+//! result, or an empty string on failure.
+static std::string importSignature(const String &sceneRoot, const fs::path &filename, const fs::path &tmpFilename)
+{
+	Scene *scene = new Scene(nullptr, sceneRoot, nullptr);
+
+	Collada collada;
+	collada.getInfo().setHeadless(True);
+	collada.setScene(scene);
+
+	Bool result = False;
+
+	// an exception must not escape a worker thread, it only fails its import
+	try
+	{
+		if (collada.processImport(filename.string().c_str()))
+		{
+			// the same name for every import, the file name is not part of the signature
+			FileOutStream os(tmpFilename.string().c_str(), FileOutStream::CREATE);
+			result = collada.processExport(os, "signature");
+		}
+	}
+	catch (...)
+	{
+		result = False;
+	}
+
+	deletePtr(scene);
+
+	std::string signature;
+
+	if (result)
+	{
+		std::ifstream file(tmpFilename.string().c_str());
+		std::string line;
+
+		while (std::getline(file, line))
+		{
+			if (line.find("<created>") == std::string::npos && line.find("<modified>") == std::string::npos)
+				signature += line + '\n';
+		}
+	}
+
+	boost::system::error_code ec;
+	fs::remove(tmpFilename, ec);
+
+	return signature;
+}
+
+//! Import synthetic documents once each, then from numThreads threads at once, each
+//! importing every document a few times in a different order, and check that each
+//! concurrent import exports the same document than the single one. Returns the number
+//! of failures.
+static UInt32 checkConcurrentImports(const String &sceneRoot, const fs::path &workDir, UInt32 numThreads)
+{
+	// large enough for the geometries to be converted by several threads too
+	std::vector<SyntheticDae::Settings> documents(3);
+
+	documents[0].numTriangles = 20000;
+	documents[0].numGeometries = 3;
+	documents[0].numInstances = 6;
+
+	documents[1].numTriangles = 20000;
+	documents[1].polylist = True;
+
+	documents[2].numTriangles = 20000;
+	documents[2].numBones = 16;
+	documents[2].influences = 4;
+	documents[2].numKeys = 24;
+
+	std::vector<fs::path> filenames;
+	std::vector<std::string> signatures;
+
+	UInt32 failures = 0;
+
+	for (size_t d = 0; d < documents.size(); ++d)
+	{
+		std::ostringstream name;
+		name << "concurrent-" << d;
+
+		filenames.push_back(workDir / (name.str() + ".dae"));
+
+		SyntheticDae generator(documents[d]);
+		if (!generator.write(filenames.back().string().c_str()))
+		{
+			System::print(String("Unable to write ") + filenames.back().string().c_str(), "bench");
+			++failures;
+		}
+
+		signatures.push_back(importSignature(sceneRoot, filenames.back(), workDir / (name.str() + "-ref.dae")));
+		if (signatures.back().empty())
+		{
+			System::print(String("Unable to import ") + filenames.back().string().c_str(), "bench");
+			++failures;
+		}
+	}
+
+	if (failures == 0)
+	{
+		static const UInt32 NUM_ROUNDS = 2;
+
+		std::atomic<UInt32> mismatches(0);
+		std::mutex printMutex;
+		std::vector<std::thread> workers;
+
+		for (UInt32 t = 0; t < numThreads; ++t)
+		{
+			workers.push_back(std::thread([&, t]()
+			{
+				for (UInt32 i = 0; i < NUM_ROUNDS * documents.size(); ++i)
+				{
+					const size_t d = (t + i) % documents.size();
+
+					std::ostringstream name;
+					name << "concurrent-" << d << "-" << t << ".dae";
+
+					if (importSignature(sceneRoot, filenames[d], workDir / name.str()) != signatures[d])
+					{
+						++mismatches;
+
+						std::lock_guard<std::mutex> lock(printMutex);
+						System::print(String::print("Thread %u imported %s differently", t, filenames[d].string().c_str()), "bench");
+					}
+				}
+			}));
+		}
+
+		for (std::thread &worker : workers)
+			worker.join();
+
+		failures = mismatches;
+	}
+
+	boost::system::error_code ec;
+	for (const fs::path &filename : filenames)
+		fs::remove(filename, ec);
+
+	return failures;
+}
+
+//---------------------------------------------------------------------------------------
+//! @class ColladaBench
+//-------------------------------------------------------------------------------------
+//! Importer benchmark application.
+//---------------------------------------------------------------------------------------
+class ColladaBench
+{
+public:
+
+	//! Measures of a phase for an input.
+	struct Result
+	{
+		std::string input;
+		std::string phase;
+		UInt32 iterations;
+		Double minMs;
+		Double medianMs;
+		UInt64 allocations;   //!< median of the allocations count
+	};
+
+	typedef std::vector<Result> T_ResultVector;
+
+	ColladaBench(const String &sceneRoot, UInt32 iterations) :
+		m_sceneRoot(sceneRoot),
+		m_iterations(iterations)
+	{
+	}
+
+	//! Benchmark an input file.
+	void run(const std::string &input, const std::string &filename)
+	{
+		// the phases of the import, as named by the profiler, plus the whole import
+		static const char* phases[] = {
+			"open",
+			"inflate",
+			"numbers",
+			"global",
+			"triangulate",
+			"nodes",
+			"geometry",
+			"controller",
+			"animations",
+			"release",
+			"toScene",
+			"controller.toScene",
+			"animation.keys",
+			"textures",
+			"postImportPass",
+			"total"
+		};
+
+		static const size_t numPhases = sizeof(phases) / sizeof(const char*);
+
+		std::vector<std::vector<Double> > durations(numPhases);
+		std::vector<std::vector<UInt64> > allocations(numPhases);
+
+		for (UInt32 i = 0; i < m_iterations; ++i)
+		{
+			ImportProfiler profiler;
+			profiler.setCounter(getNumAllocs);
+
+			Scene *scene = new Scene(nullptr, m_sceneRoot, nullptr);
+
+			Collada *collada = new Collada;
+			collada->getInfo().setHeadless(True);
+			collada->getInfo().setProfiler(&profiler);
+			collada->setScene(scene);
+
+			Bool result = collada->processImport(filename.c_str());
+
+			deletePtr(collada);
+			deletePtr(scene);
+
+			if (!result)
+			{
+				System::print(String("Unable to import ") + filename.c_str(), "bench");
+				return;
+			}
+
+			ImportProfiler::T_PhaseMap times = profiler.getPhases();
+			ImportProfiler::T_PhaseCounterMap counters = profiler.getPhaseCounters();
+
+			for (size_t p = 0; p < numPhases; ++p)
+			{
+				ImportProfiler::CIT_PhaseMap it = times.find(phases[p]);
+				if (it == times.end())
+					continue;
+
+				durations[p].push_back(it->second * 1000.0);
+				allocations[p].push_back(counters[phases[p]]);
+			}
+		}
+
+		for (size_t p = 0; p < numPhases; ++p)
+		{
+			if (durations[p].empty())
+				continue;
+
+			std::sort(durations[p].begin(), durations[p].end());
+			std::sort(allocations[p].begin(), allocations[p].end());
+
+			Result res;
+			res.input = input;
+			res.phase = phases[p];
+			res.iterations = (UInt32)durations[p].size();
+			res.minMs = durations[p].front();
+			res.medianMs = durations[p][durations[p].size() / 2];
+			res.allocations = allocations[p][allocations[p].size() / 2];
+
+			m_results.push_back(res);
+
+			System::print(String::print("%-24s %-20s min %10.3f ms  median %10.3f ms  %10llu allocs",
+				input.c_str(),
+				phases[p],
+				res.minMs,
+				res.medianMs,
+				(unsigned long long)res.allocations), "bench");
+		}
+	}
+
+	//! Get the results.
+	inline const T_ResultVector& getResults() const { return m_results; }
+
+	//! Write the results as CSV.
+	static Bool writeResults(const std::string &filename, const T_ResultVector &results)
+	{
+		std::ofstream file(filename.c_str());
+		if (!file)
+			return False;
+
+		file << "input,phase,iterations,min_ms,median_ms,allocations\n";
+
+		for (const Result &res : results)
+		{
+			file << res.input << ',' << res.phase << ',' << res.iterations << ','
+				 << res.minMs << ',' << res.medianMs << ',' << res.allocations << '\n';
+		}
+
+		return file.good();
+	}
+
+	//! Read results previously written as CSV.
+	static Bool readResults(const std::string &filename, T_ResultVector &results)
+	{
+		std::ifstream file(filename.c_str());
+		if (!file)
+			return False;
+
+		std::string line;
+		std::getline(file, line);  // header
+
+		while (std::getline(file, line))
+		{
+			std::istringstream iss(line);
+			std::string field;
+			std::vector<std::string> fields;
+
+			while (std::getline(iss, field, ','))
+				fields.push_back(field);
+
+			if (fields.size() < 6)
+				continue;
+
+			Result res;
+			res.input = fields[0];
+			res.phase = fields[1];
+			res.iterations = (UInt32)strtoul(fields[2].c_str(), nullptr, 10);
+			res.minMs = strtod(fields[3].c_str(), nullptr);
+			res.medianMs = strtod(fields[4].c_str(), nullptr);
+			res.allocations = strtoull(fields[5].c_str(), nullptr, 10);
+
+			results.push_back(res);
+		}
+
+		return True;
+	}
+
+	//! Compare to a baseline, and returns the number of regressions. A phase regresses
+	//! if its median time grows by more than threshold percents (and of more than 0.5 ms
+	//! to ignore the noise on very short phases), or if it allocates more.
+	UInt32 compare(const T_ResultVector &baseline, Double threshold) const
+	{
+		std::map<std::string, const Result*> base;
+		for (const Result &res : baseline)
+			base[res.input + "/" + res.phase] = &res;
+
+		UInt32 regressions = 0;
+
+		System::print("--- comparison to the baseline ---", "bench");
+
+		for (const Result &res : m_results)
+		{
+			std::map<std::string, const Result*>::const_iterator it = base.find(res.input + "/" + res.phase);
+			if (it == base.end())
+				continue;
+
+			const Result &ref = *it->second;
+
+			Double delta = ref.medianMs > 0.0 ? (res.medianMs - ref.medianMs) * 100.0 / ref.medianMs : 0.0;
+
+			Bool slower = delta > threshold && (res.medianMs - ref.medianMs) > 0.5;
+			Bool moreAllocs = res.allocations > ref.allocations;
+
+			if (slower || moreAllocs)
+				++regressions;
+
+			System::print(String::print("%-24s %-20s %10.3f -> %10.3f ms (%+6.1f%%)  %10llu -> %10llu allocs %s",
+				res.input.c_str(),
+				res.phase.c_str(),
+				ref.medianMs,
+				res.medianMs,
+				delta,
+				(unsigned long long)ref.allocations,
+				(unsigned long long)res.allocations,
+				(slower || moreAllocs) ? "REGRESSION" : ""), "bench");
+		}
+
+		return regressions;
+	}
+
+private:
+
+	String m_sceneRoot;
+	UInt32 m_iterations;
+
+	T_ResultVector m_results;
+
+public:
+
+	static Int32 main()
+	{
+		Debug::instance()->setDefaultLog("bench.log");
+		Debug::instance()->getDefaultLog().clearLog();
+
+		Application::getCommandLine()->addOption('d',"data");
+		Application::getCommandLine()->addOption('s',"synthetic");
+		Application::getCommandLine()->addOption('i',"iterations");
+		Application::getCommandLine()->addOption('o',"output");
+		Application::getCommandLine()->addOption('c',"compare");
+		Application::getCommandLine()->addOption('t',"threshold");
+		Application::getCommandLine()->addOption('w',"work");
+		Application::getCommandLine()->addOption('j',"jobs");
+
+		if (!Application::getCommandLine()->parse())
+		{
+			System::print("--- O3DCollada importer benchmark ---", "bench");
+			System::print("Usage: o3dcollada-bench <--data=dir> <--synthetic=N[;N...]> <--iterations=N> <--output=results.csv> <--compare=baseline.csv> <--threshold=percent> <--work=dir> <--jobs=N>", "bench");
+			System::print("--data: directory of the .dae samples, default to test/data/dae", "bench");
+			System::print("--synthetic: triangle counts of the generated grids, default to 100000;1000000, 0 to disable", "bench");
+			System::print("--compare: compare to a previous output, exit with 1 on regression beyond the threshold (default 10%)", "bench");
+			System::print("--work: directory where synthetic documents are written, default to the working directory", "bench");
+			System::print("--jobs: threads importing synthetic documents at once, checked against a single import, default to the number of cores, 0 to disable", "bench");
+			return 0;
+		}
+
+		String dataDir = Application::getCommandLine()->getOptionValue("data");
+		String synthetic = Application::getCommandLine()->getOptionValue("synthetic");
+		String iterations = Application::getCommandLine()->getOptionValue("iterations");
+		String output = Application::getCommandLine()->getOptionValue("output");
+		String compare = Application::getCommandLine()->getOptionValue("compare");
+		String threshold = Application::getCommandLine()->getOptionValue("threshold");
+		String workDir = Application::getCommandLine()->getOptionValue("work");
+		String jobs = Application::getCommandLine()->getOptionValue("jobs");
+
+		if (dataDir.isEmpty())
+			dataDir = "test/data/dae";
+
+		if (synthetic.isEmpty())
+			synthetic = "100000;1000000";
+
+		if (workDir.isEmpty())
+			workDir = FileManager::instance()->getWorkingDirectory();
+
+		UInt32 numIterations = iterations.isValid() ? (UInt32)atoi(iterations.toUtf8().getData()) : 5;
+		if (numIterations == 0)
+			numIterations = 1;
+
+		// the exported floats must be imported back to the same values
+		UInt32 floatFailures = checkFloatRoundTrip(1000000);
+		if (floatFailures > 0)
+		{
+			System::print(String::print("%u floats do not read back to the same value", floatFailures), "bench");
+			return 1;
+		}
+
+		// the concurrent imports must give the same results than a single one
+		UInt32 numThreads = jobs.isValid() ? (UInt32)atoi(jobs.toUtf8().getData()) : o3d::max<UInt32>(2, std::thread::hardware_concurrency());
+		if (numThreads > 0)
+		{
+			UInt32 importFailures = checkConcurrentImports(
+				FileManager::instance()->getWorkingDirectory(),
+				fs::path(workDir.toUtf8().getData()),
+				numThreads);
+
+			if (importFailures > 0)
+			{
+				System::print(String::print("%u concurrent imports differ from a single one", importFailures), "bench");
+				return 1;
+			}
+		}
+
+		ColladaBench bench(FileManager::instance()->getWorkingDirectory(), numIterations);
+
+		// bundled samples, sorted for stable outputs
+		std::vector<fs::path> samples;
+		boost::system::error_code ec;
+
+		for (fs::directory_iterator it(dataDir.toUtf8().getData(), ec), end; it != end; it.increment(ec))
+		{
+			if (ec)
+				break;
+
+			if (it->path().extension() == ".dae")
+				samples.push_back(it->path());
+		}
+
+		std::sort(samples.begin(), samples.end());
+
+		for (const fs::path &sample : samples)
+			bench.run(sample.filename().string(), sample.string());
+
+		// synthetic grids of growing sizes, as triangles, as quads polylist, and skinned
+		// onto an animated chain of bones
+		std::string sizes = synthetic.toUtf8().getData();
+		size_t pos = 0;
+
+		while (pos <= sizes.size())
+		{
+			size_t end = sizes.find(';', pos);
+			if (end == std::string::npos)
+				end = sizes.size();
+
+			UInt32 numTriangles = (UInt32)strtoul(sizes.substr(pos, end - pos).c_str(), nullptr, 10);
+			pos = end + 1;
+
+			if (numTriangles == 0)
+				continue;
+
+			static const char* variants[] = { "synthetic-tri-", "synthetic-poly-", "synthetic-skin-" };
+
+			for (Int32 variant = 0; variant < 3; ++variant)
+			{
+				SyntheticDae::Settings settings;
+				settings.numTriangles = numTriangles;
+				settings.polylist = variant == 1;
+
+				if (variant == 2)
+				{
+					settings.numBones = 32;
+					settings.influences = 4;
+					settings.numKeys = 48;
+				}
+
+				std::ostringstream name;
+				name << variants[variant] << numTriangles;
+
+				fs::path filename = fs::path(workDir.toUtf8().getData()) / (name.str() + ".dae");
+
+				SyntheticDae generator(settings);
+				if (!generator.write(filename.string().c_str()))
+				{
+					System::print(String("Unable to write ") + filename.string().c_str(), "bench");
+					continue;
+				}
+
+				bench.run(name.str(), filename.string());
+
+				fs::remove(filename, ec);
+			}
+		}
+
+		if (output.isValid())
+		{
+			if (!writeResults(output.toUtf8().getData(), bench.getResults()))
+				System::print(String("Unable to write ") + output, "bench");
+		}
+
+		if (compare.isValid())
+		{
+			T_ResultVector baseline;
+			if (!readResults(compare.toUtf8().getData(), baseline))
+			{
+				System::print(String("Unable to read ") + compare, "bench");
+				return 1;
+			}
+
+			Double percent = threshold.isValid() ? strtod(threshold.toUtf8().getData(), nullptr) : 10.0;
+
+			UInt32 regressions = bench.compare(baseline, percent);
+			System::print(String::print("%u regressions", regressions), "bench");
+
+			return regressions > 0 ? 1 : 0;
+		}
+
+		return 0;
+	}
+};
+
+O3D_CONSOLE_MAIN(ColladaBench, O3D_DEFAULT_CLASS_SETTINGS)
@@ -0,0 +1,618 @@
+/**
+ * @file syntheticdae.cpp
+ * @brief Implementation of syntheticdae.h
+ * @author Frederic SCHERMA (frederic.scherma@dreamoverflow.org)
+ * @date 2026-10-18
+ * @copyright Copyright (c) 2001-2026 Dream Overflow. All rights reserved.
+ * @details
+ */
+
+#include "syntheticdae.h"
+
+#include <math.h>
+
+using namespace o3d;
+using namespace o3d::collada;
+
+static const UInt32 MAX_INFLUENCES = 8;
+
+// Height of the waved grid, the phase makes each geometry different
+static inline Float waveHeight(Float x, Float z, Float phase)
+{
+	return sinf(x * 0.37f + phase) * cosf(z * 0.23f + phase) * 2.f;
+}
+
+// Write a float source with its accessor
+static void beginFloatSource(FILE *file, const char *id, UInt32 numValues)
+{
+	fprintf(file, "        <source id=\"%s\">\n"
+				  "          <float_array id=\"%s-array\" count=\"%u\">", id, id, numValues);
+}
+
+static void endFloatSource(FILE *file, const char *id, UInt32 count, const char *params)
+{
+	UInt32 stride = 0;
+	for (const char *c = params; *c; ++c)
+		++stride;
+
+	fprintf(file, "</float_array>\n"
+				  "          <technique_common>\n"
+				  "            <accessor source=\"#%s-array\" count=\"%u\" stride=\"%u\">\n", id, count, stride);
+
+	for (const char *c = params; *c; ++c)
+		fprintf(file, "              <param name=\"%c\" type=\"float\"/>\n", *c);
+
+	fputs("            </accessor>\n"
+		  "          </technique_common>\n"
+		  "        </source>\n", file);
+}
+
+// ctor
+SyntheticDae::SyntheticDae(const Settings &settings) :
+	m_settings(settings),
+	m_gridSize(1),
+	m_numMaterials(1),
+	m_boneStep(1.f),
+	m_file(nullptr),
+	m_size(0)
+{
+	// two triangles per quad
+	m_gridSize = (UInt32)ceil(sqrt((Double)(m_settings.numTriangles > 2 ? m_settings.numTriangles : 2) * 0.5));
+
+	if (m_settings.numGeometries == 0)
+		m_settings.numGeometries = 1;
+
+	if (m_settings.depth == 0)
+		m_settings.depth = 1;
+
+	if (m_settings.numTextures > 0)
+		m_numMaterials = m_settings.numTextures;
+
+	if (m_settings.numBones > 0)
+	{
+		if (m_settings.influences == 0)
+			m_settings.influences = 1;
+
+		if (m_settings.influences > m_settings.numBones)
+			m_settings.influences = m_settings.numBones;
+
+		if (m_settings.influences > MAX_INFLUENCES)
+			m_settings.influences = MAX_INFLUENCES;
+
+		// bones are spread along the X axis of the grid
+		m_boneStep = m_settings.numBones > 1 ? (Float)m_gridSize / (m_settings.numBones - 1) : 0.f;
+	}
+}
+
+// Write the document
+Bool SyntheticDae::write(const String &filename)
+{
+	m_file = fopen(filename.toUtf8().getData(), "wb");
+	if (!m_file)
+		return False;
+
+	// large buffer, the file is written sequentially
+	setvbuf(m_file, nullptr, _IOFBF, 1 << 20);
+
+	fputs("<?xml version=\"1.0\" encoding=\"utf-8\"?>\n", m_file);
+	fputs("<COLLADA xmlns=\"http://www.collada.org/2005/11/COLLADASchema\" version=\"1.4.1\">\n", m_file);
+
+	writeAsset();
+
+	if (m_settings.numBones > 0 && m_settings.numKeys > 0)
+		writeAnimations();
+
+	if (m_settings.numTextures > 0)
+		writeImages();
+
+	writeMaterials();
+
+	fputs("  <library_geometries>\n", m_file);
+	for (UInt32 i = 0; i < m_settings.numGeometries; ++i)
+		writeGeometry(i);
+	fputs("  </library_geometries>\n", m_file);
+
+	if (m_settings.numBones > 0)
+	{
+		fputs("  <library_controllers>\n", m_file);
+		for (UInt32 i = 0; i < m_settings.numGeometries; ++i)
+			writeController(i);
+		fputs("  </library_controllers>\n", m_file);
+	}
+
+	writeScene();
+
+	fputs("</COLLADA>\n", m_file);
+
+	fflush(m_file);
+
+#ifdef _MSC_VER
+	m_size = (UInt64)_ftelli64(m_file);
+#else
+	m_size = (UInt64)ftello(m_file);
+#endif
+
+	Bool result = ferror(m_file) == 0;
+
+	fclose(m_file);
+	m_file = nullptr;
+
+	return result;
+}
+
+void SyntheticDae::writeAsset()
+{
+	fputs("  <asset>\n"
+		  "    <contributor><authoring_tool>o3dcollada synthetic</authoring_tool></contributor>\n"
+		  "    <created>2017-01-01T00:00:00Z</created>\n"
+		  "    <modified>2017-01-01T00:00:00Z</modified>\n"
+		  "    <unit meter=\"1\" name=\"meter\"/>\n"
+		  "    <up_axis>Y_UP</up_axis>\n"
+		  "  </asset>\n", m_file);
+}
+
+void SyntheticDae::writeImages()
+{
+	fputs("  <library_images>\n", m_file);
+
+	for (UInt32 i = 0; i < m_settings.numTextures; ++i)
+	{
+		fprintf(m_file, "    <image id=\"img%u\" name=\"img%u\">\n"
+						"      <init_from>textures/synthetic%u.png</init_from>\n"
+						"    </image>\n", i, i, i);
+	}
+
+	fputs("  </library_images>\n", m_file);
+}
+
+void SyntheticDae::writeMaterials()
+{
+	fputs("  <library_effects>\n", m_file);
+
+	for (UInt32 i = 0; i < m_numMaterials; ++i)
+	{
+		fprintf(m_file, "    <effect id=\"fx%u\">\n"
+						"      <profile_COMMON>\n", i);
+
+		if (m_settings.numTextures > 0)
+		{
+			fprintf(m_file, "        <newparam sid=\"img%u-surface\">\n"
+							"          <surface type=\"2D\"><init_from>img%u</init_from></surface>\n"
+							"        </newparam>\n"
+							"        <newparam sid=\"img%u-sampler\">\n"
+							"          <sampler2D><source>img%u-surface</source></sampler2D>\n"
+							"        </newparam>\n", i, i, i, i);
+		}
+
+		fputs("        <technique sid=\"common\">\n"
+			  "          <lambert>\n", m_file);
+
+		if (m_settings.numTextures > 0)
+			fprintf(m_file, "            <diffuse><texture texture=\"img%u-sampler\" texcoord=\"TEX0\"/></diffuse>\n", i);
+		else
+			fputs("            <diffuse><color>0.8 0.8 0.8 1</color></diffuse>\n", m_file);
+
+		fputs("          </lambert>\n"
+			  "        </technique>\n"
+			  "      </profile_COMMON>\n"
+			  "    </effect>\n", m_file);
+	}
+
+	fputs("  </library_effects>\n", m_file);
+
+	fputs("  <library_materials>\n", m_file);
+
+	for (UInt32 i = 0; i < m_numMaterials; ++i)
+	{
+		fprintf(m_file, "    <material id=\"mat%u\" name=\"mat%u\">\n"
+						"      <instance_effect url=\"#fx%u\"/>\n"
+						"    </material>\n", i, i, i);
+	}
+
+	fputs("  </library_materials>\n", m_file);
+}
+
+void SyntheticDae::writeGeometry(UInt32 id)
+{
+	const UInt32 side = m_gridSize + 1;
+	const UInt32 numVertices = side * side;
+	const Float phase = id * 0.7f;
+
+	char name[64];
+
+	fprintf(m_file, "    <geometry id=\"grid%u\" name=\"grid%u\">\n"
+					"      <mesh>\n", id, id);
+
+	// positions
+	sprintf(name, "grid%u-positions", id);
+	beginFloatSource(m_file, name, numVertices * 3);
+
+	for (UInt32 z = 0; z < side; ++z)
+	{
+		for (UInt32 x = 0; x < side; ++x)
+			fprintf(m_file, "%g %g %g ", (Float)x, waveHeight((Float)x, (Float)z, phase), (Float)z);
+
+		fputc('\n', m_file);
+	}
+
+	endFloatSource(m_file, name, numVertices, "XYZ");
+
+	// normals, from the central differences of the height
+	sprintf(name, "grid%u-normals", id);
+	beginFloatSource(m_file, name, numVertices * 3);
+
+	for (UInt32 z = 0; z < side; ++z)
+	{
+		for (UInt32 x = 0; x < side; ++x)
+		{
+			Float dx = waveHeight(x + 0.5f, (Float)z, phase) - waveHeight(x - 0.5f, (Float)z, phase);
+			Float dz = waveHeight((Float)x, z + 0.5f, phase) - waveHeight((Float)x, z - 0.5f, phase);
+			Float len = sqrtf(dx*dx + 1.f + dz*dz);
+
+			fprintf(m_file, "%g %g %g ", -dx / len, 1.f / len, -dz / len);
+		}
+
+		fputc('\n', m_file);
+	}
+
+	endFloatSource(m_file, name, numVertices, "XYZ");
+
+	// texture coordinates
+	sprintf(name, "grid%u-uvs", id);
+	beginFloatSource(m_file, name, numVertices * 2);
+
+	const Float invSize = 1.f / m_gridSize;
+
+	for (UInt32 z = 0; z < side; ++z)
+	{
+		for (UInt32 x = 0; x < side; ++x)
+			fprintf(m_file, "%g %g ", x * invSize, z * invSize);
+
+		fputc('\n', m_file);
+	}
+
+	endFloatSource(m_file, name, numVertices, "ST");
+
+	fprintf(m_file, "        <vertices id=\"grid%u-vertices\">\n"
+					"          <input semantic=\"POSITION\" source=\"#grid%u-positions\"/>\n"
+					"        </vertices>\n", id, id);
+
+	// primitives, each vertex references the same index for its three inputs
+	const UInt32 numQuads = m_gridSize * m_gridSize;
+	const UInt32 material = id % m_numMaterials;
+
+	if (m_settings.polylist)
+		fprintf(m_file, "        <polylist count=\"%u\" material=\"mat%u\">\n", numQuads, material);
+	else
+		fprintf(m_file, "        <triangles count=\"%u\" material=\"mat%u\">\n", numQuads * 2, material);
+
+	fprintf(m_file, "          <input offset=\"0\" semantic=\"VERTEX\" source=\"#grid%u-vertices\"/>\n"
+					"          <input offset=\"1\" semantic=\"NORMAL\" source=\"#grid%u-normals\"/>\n"
+					"          <input offset=\"2\" semantic=\"TEXCOORD\" source=\"#grid%u-uvs\" set=\"0\"/>\n", id, id, id);
+
+	if (m_settings.polylist)
+	{
+		fputs("          <vcount>", m_file);
+		for (UInt32 i = 0; i < numQuads; ++i)
+		{
+			fputs("4 ", m_file);
+
+			if ((i & 63) == 63)
+				fputc('\n', m_file);
+		}
+		fputs("</vcount>\n", m_file);
+	}
+
+	fputs("          <p>", m_file);
+
+	for (UInt32 z = 0; z < m_gridSize; ++z)
+	{
+		for (UInt32 x = 0; x < m_gridSize; ++x)
+		{
+			UInt32 a = z * side + x;
+			UInt32 b = a + 1;
+			UInt32 c = a + side + 1;
+			UInt32 d = a + side;
+
+			if (m_settings.polylist)
+				fprintf(m_file, "%u %u %u %u %u %u %u %u %u %u %u %u ", a, a, a, d, d, d, c, c, c, b, b, b);
+			else
+				fprintf(m_file, "%u %u %u %u %u %u %u %u %u %u %u %u %u %u %u %u %u %u ",
+					a, a, a, d, d, d, c, c, c,
+					a, a, a, c, c, c, b, b, b);
+		}
+
+		fputc('\n', m_file);
+	}
+
+	fputs("</p>\n", m_file);
+	fputs(m_settings.polylist ? "        </polylist>\n" : "        </triangles>\n", m_file);
+
+	fputs("      </mesh>\n"
+		  "    </geometry>\n", m_file);
+}
+
+// Get the bones influencing a vertex at x, and their weights
+UInt32 SyntheticDae::getInfluences(Float x, UInt32 *bones, Float *weights) const
+{
+	const UInt32 numBones = m_settings.numBones;
+	const UInt32 count = m_settings.influences;
+
+	// nearest bone, then a window of bones around it
+	Int32 nearest = m_boneStep > 0.f ? (Int32)floorf(x / m_boneStep + 0.5f) : 0;
+	Int32 first = nearest - (Int32)(count - 1) / 2;
+
+	if (first < 0)
+		first = 0;
+	if (first + count > numBones)
+		first = (Int32)(numBones - count);
+
+	Float sum = 0.f;
+	for (UInt32 i = 0; i < count; ++i)
+	{
+		bones[i] = first + i;
+		weights[i] = 1.f / (1.f + fabsf(x - bones[i] * m_boneStep));
+		sum += weights[i];
+	}
+
+	for (UInt32 i = 0; i < count; ++i)
+		weights[i] /= sum;
+
+	return count;
+}
+
+void SyntheticDae::writeController(UInt32 id)
+{
+	const UInt32 side = m_gridSize + 1;
+	const UInt32 numVertices = side * side;
+	const UInt32 numBones = m_settings.numBones;
+	const UInt32 count = m_settings.influences;
+
+	UInt32 bones[MAX_INFLUENCES];
+	Float weights[MAX_INFLUENCES];
+
+	fprintf(m_file, "    <controller id=\"grid%u-skin\" name=\"grid%u-skin\">\n"
+					"      <skin source=\"#grid%u\">\n"
+					"        <bind_shape_matrix>1 0 0 0 0 1 0 0 0 0 1 0 0 0 0 1</bind_shape_matrix>\n", id, id, id);
+
+	// joints names are the bones sid
+	fprintf(m_file, "        <source id=\"grid%u-skin-joints\">\n"
+					"          <Name_array id=\"grid%u-skin-joints-array\" count=\"%u\">", id, id, numBones);
+
+	for (UInt32 i = 0; i < numBones; ++i)
+		fprintf(m_file, "bone%u ", i);
+
+	fprintf(m_file, "</Name_array>\n"
+					"          <technique_common>\n"
+					"            <accessor source=\"#grid%u-skin-joints-array\" count=\"%u\">\n"
+					"              <param name=\"JOINT\" type=\"Name\"/>\n"
+					"            </accessor>\n"
+					"          </technique_common>\n"
+					"        </source>\n", id, numBones);
+
+	// bones are translated along X, the inverse bind matrices translate them back
+	fprintf(m_file, "        <source id=\"grid%u-skin-bind_poses\">\n"
+					"          <float_array id=\"grid%u-skin-bind_poses-array\" count=\"%u\">", id, id, numBones * 16);
+
+	for (UInt32 i = 0; i < numBones; ++i)
+		fprintf(m_file, "1 0 0 %g 0 1 0 0 0 0 1 0 0 0 0 1\n", -(i * m_boneStep));
+
+	fprintf(m_file, "</float_array>\n"
+					"          <technique_common>\n"
+					"            <accessor source=\"#grid%u-skin-bind_poses-array\" count=\"%u\" stride=\"16\">\n"
+					"              <param name=\"TRANSFORM\" type=\"float4x4\"/>\n"
+					"            </accessor>\n"
+					"          </technique_common>\n"
+					"        </source>\n", id, numBones);
+
+	// weights, per vertex in order
+	fprintf(m_file, "        <source id=\"grid%u-skin-weights\">\n"
+					"          <float_array id=\"grid%u-skin-weights-array\" count=\"%u\">", id, id, numVertices * count);
+
+	for (UInt32 z = 0; z < side; ++z)
+	{
+		for (UInt32 x = 0; x < side; ++x)
+		{
+			getInfluences((Float)x, bones, weights);
+
+			for (UInt32 i = 0; i < count; ++i)
+				fprintf(m_file, "%g ", weights[i]);
+		}
+
+		fputc('\n', m_file);
+	}
+
+	fprintf(m_file, "</float_array>\n"
+					"          <technique_common>\n"
+					"            <accessor source=\"#grid%u-skin-weights-array\" count=\"%u\">\n"
+					"              <param name=\"WEIGHT\" type=\"float\"/>\n"
+					"            </accessor>\n"
+					"          </technique_common>\n"
+					"        </source>\n", id, numVertices * count);
+
+	fprintf(m_file, "        <joints>\n"
+					"          <input semantic=\"JOINT\" source=\"#grid%u-skin-joints\"/>\n"
+					"          <input semantic=\"INV_BIND_MATRIX\" source=\"#grid%u-skin-bind_poses\"/>\n"
+					"        </joints>\n", id, id);
+
+	fprintf(m_file, "        <vertex_weights count=\"%u\">\n"
+					"          <input offset=\"0\" semantic=\"JOINT\" source=\"#grid%u-skin-joints\"/>\n"
+					"          <input offset=\"1\" semantic=\"WEIGHT\" source=\"#grid%u-skin-weights\"/>\n", numVertices, id, id);
+
+	fputs("          <vcount>", m_file);
+	for (UInt32 i = 0; i < numVertices; ++i)
+	{
+		fprintf(m_file, "%u ", count);
+
+		if ((i & 63) == 63)
+			fputc('\n', m_file);
+	}
+	fputs("</vcount>\n", m_file);
+
+	fputs("          <v>", m_file);
+
+	UInt32 weightIndex = 0;
+	for (UInt32 z = 0; z < side; ++z)
+	{
+		for (UInt32 x = 0; x < side; ++x)
+		{
+			getInfluences((Float)x, bones, weights);
+
+			for (UInt32 i = 0; i < count; ++i)
+				fprintf(m_file, "%u %u ", bones[i], weightIndex++);
+		}
+
+		fputc('\n', m_file);
+	}
+
+	fputs("</v>\n"
+		  "        </vertex_weights>\n"
+		  "      </skin>\n"
+		  "    </controller>\n", m_file);
+}
+
+void SyntheticDae::writeAnimations()
+{
+	const UInt32 numKeys = m_settings.numKeys;
+
+	fputs("  <library_animations>\n", m_file);
+
+	for (UInt32 b = 0; b < m_settings.numBones; ++b)
+	{
+		fprintf(m_file, "    <animation id=\"bone%u-anim\">\n", b);
+
+		// time, 24 keys per second
+		fprintf(m_file, "      <source id=\"bone%u-anim-input\">\n"
+						"        <float_array id=\"bone%u-anim-input-array\" count=\"%u\">", b, b, numKeys);
+
+		for (UInt32 k = 0; k < numKeys; ++k)
+			fprintf(m_file, "%g ", (k + 1) / 24.f);
+
+		fprintf(m_file, "</float_array>\n"
+						"        <technique_common>\n"
+						"          <accessor source=\"#bone%u-anim-input-array\" count=\"%u\">\n"
+						"            <param name=\"TIME\" type=\"float\"/>\n"
+						"          </accessor>\n"
+						"        </technique_common>\n"
+						"      </source>\n", b, numKeys);
+
+		// angle, a sine wave shifted along the chain
+		fprintf(m_file, "      <source id=\"bone%u-anim-output\">\n"
+						"        <float_array id=\"bone%u-anim-output-array\" count=\"%u\">", b, b, numKeys);
+
+		for (UInt32 k = 0; k < numKeys; ++k)
+			fprintf(m_file, "%g ", 20.f * sinf(6.2831853f * k / numKeys + b * 0.5f));
+
+		fprintf(m_file, "</float_array>\n"
+						"        <technique_common>\n"
+						"          <accessor source=\"#bone%u-anim-output-array\" count=\"%u\">\n"
+						"            <param name=\"ANGLE\" type=\"float\"/>\n"
+						"          </accessor>\n"
+						"        </technique_common>\n"
+						"      </source>\n", b, numKeys);
+
+		fprintf(m_file, "      <source id=\"bone%u-anim-interpolations\">\n"
+						"        <Name_array id=\"bone%u-anim-interpolations-array\" count=\"%u\">", b, b, numKeys);
+
+		for (UInt32 k = 0; k < numKeys; ++k)
+			fputs("LINEAR ", m_file);
+
+		fprintf(m_file, "</Name_array>\n"
+						"        <technique_common>\n"
+						"          <accessor source=\"#bone%u-anim-interpolations-array\" count=\"%u\">\n"
+						"            <param name=\"INTERPOLATION\" type=\"Name\"/>\n"
+						"          </accessor>\n"
+						"        </technique_common>\n"
+						"      </source>\n", b, numKeys);
+
+		fprintf(m_file, "      <sampler id=\"bone%u-anim-sampler\">\n"
+						"        <input semantic=\"INPUT\" source=\"#bone%u-anim-input\"/>\n"
+						"        <input semantic=\"OUTPUT\" source=\"#bone%u-anim-output\"/>\n"
+						"        <input semantic=\"INTERPOLATION\" source=\"#bone%u-anim-interpolations\"/>\n"
+						"      </sampler>\n"
+						"      <channel source=\"#bone%u-anim-sampler\" target=\"bone%u/rotateZ.ANGLE\"/>\n"
+						"    </animation>\n", b, b, b, b, b, b);
+	}
+
+	fputs("  </library_animations>\n", m_file);
+}
+
+void SyntheticDae::writeSkeleton()
+{
+	// a chain of joints, written iteratively because it can be very long
+	for (UInt32 b = 0; b < m_settings.numBones; ++b)
+	{
+		fprintf(m_file, "      <node id=\"bone%u\" name=\"bone%u\" sid=\"bone%u\" type=\"JOINT\">\n"
+						"        <translate sid=\"translate\">%g 0 0</translate>\n"
+						"        <rotate sid=\"rotateZ\">0 0 1 0</rotate>\n", b, b, b, b > 0 ? m_boneStep : 0.f);
+	}
+
+	for (UInt32 b = 0; b < m_settings.numBones; ++b)
+		fputs("      </node>\n", m_file);
+}
+
+void SyntheticDae::writeInstance(UInt32 id)
+{
+	const UInt32 geometry = id % m_settings.numGeometries;
+	const UInt32 material = geometry % m_numMaterials;
+
+	// instances on a square lattice
+	UInt32 row = (UInt32)ceil(sqrt((Double)m_settings.numInstances));
+	Float spacing = (Float)(m_gridSize + 2);
+
+	// the group nodes above the instance
+	for (UInt32 d = 1; d < m_settings.depth; ++d)
+	{
+		fprintf(m_file, "      <node id=\"inst%u-g%u\" name=\"inst%u-g%u\">\n", id, d, id, d);
+
+		if (d == 1)
+			fprintf(m_file, "        <translate sid=\"translate\">%g 0 %g</translate>\n",
+				(id % row) * spacing, (id / row) * spacing);
+		else
+			fputs("        <translate sid=\"translate\">0 0 0</translate>\n", m_file);
+	}
+
+	fprintf(m_file, "      <node id=\"inst%u\" name=\"inst%u\">\n", id, id);
+
+	if (m_settings.depth <= 1)
+		fprintf(m_file, "        <translate sid=\"translate\">%g 0 %g</translate>\n",
+			(id % row) * spacing, (id / row) * spacing);
+
+	if (m_settings.numBones > 0)
+		fprintf(m_file, "        <instance_controller url=\"#grid%u-skin\">\n"
+						"          <skeleton>#bone0</skeleton>\n", geometry);
+	else
+		fprintf(m_file, "        <instance_geometry url=\"#grid%u\">\n", geometry);
+
+	fprintf(m_file, "          <bind_material>\n"
+					"            <technique_common>\n"
+					"              <instance_material symbol=\"mat%u\" target=\"#mat%u\">\n"
+					"                <bind_vertex_input semantic=\"TEX0\" input_semantic=\"TEXCOORD\" input_set=\"0\"/>\n"
+					"              </instance_material>\n"
+					"            </technique_common>\n"
+					"          </bind_material>\n", material, material);
+
+	fputs(m_settings.numBones > 0 ? "        </instance_controller>\n" : "        </instance_geometry>\n", m_file);
+	fputs("      </node>\n", m_file);
+
+	for (UInt32 d = 1; d < m_settings.depth; ++d)
+		fputs("      </node>\n", m_file);
+}
+
+void SyntheticDae::writeScene()
+{
+	fputs("  <library_visual_scenes>\n"
+		  "    <visual_scene id=\"synthetic\" name=\"synthetic\">\n", m_file);
+
+	for (UInt32 i = 0; i < m_settings.numInstances; ++i)
+		writeInstance(i);
+
+	if (m_settings.numBones > 0)
+		writeSkeleton();
+
+	fputs("    </visual_scene>\n"
+		  "  </library_visual_scenes>\n"
+		  "  <scene>\n"
+		  "    <instance_visual_scene url=\"#synthetic\"/>\n"
+		  "  </scene>\n", m_file);
+}
@@ -0,0 +1,99 @@
+/**
+ * @file syntheticdae.h
+ * @brief Synthetic COLLADA document writer, for benchmarks and scale testing.
+ * @author Frederic SCHERMA (frederic.scherma@dreamoverflow.org)
+ * @date 2026-10-18
+ * @copyright Copyright (c) 2001-2026 Dream Overflow. All rights reserved.
+ * @details
+ */
+
+#ifndef _O3D_COLLADA_SYNTHETICDAE_H
+#define _O3D_COLLADA_SYNTHETICDAE_H
+
+#include <o3d/core/string.h>
+
+#include <stdio.h>
+
+namespace o3d {
+namespace collada {
+
+//---------------------------------------------------------------------------------------
+//! @class SyntheticDae
+//-------------------------------------------------------------------------------------
+//! Write a deterministic COLLADA 1.4.1 document made of waved grid meshes, optionally
+//! instanced into a hierarchy, skinned onto an animated chain of bones and textured.
+//! The document is streamed to the file, so its size is not bounded by the memory.
+//---------------------------------------------------------------------------------------
+class SyntheticDae
+{
+public:
+
+	struct Settings
+	{
+		UInt32 numTriangles;   //!< approximative number of triangles per geometry
+		Bool polylist;         //!< write quads into a <polylist> rather than <triangles>
+
+		UInt32 numGeometries;  //!< number of distinct geometries
+		UInt32 numInstances;   //!< number of nodes instancing the geometries (round robin)
+		UInt32 depth;          //!< depth of the nodes hierarchy above each instance
+
+		UInt32 numBones;       //!< length of the bones chain, 0 for static geometries
+		UInt32 influences;     //!< number of bones influencing each vertex
+		UInt32 numKeys;        //!< number of animation keys per bone, 0 for no animation
+
+		UInt32 numTextures;    //!< number of textured materials, 0 for a single color one
+
+		Settings() :
+			numTriangles(2),
+			polylist(False),
+			numGeometries(1),
+			numInstances(1),
+			depth(1),
+			numBones(0),
+			influences(2),
+			numKeys(0),
+			numTextures(0) {}
+	};
+
+	SyntheticDae(const Settings &settings);
+
+	//! Write the document, returns False if the file cannot be written.
+	Bool write(const String &filename);
+
+	//! Get the number of quads per side of the grids.
+	inline UInt32 getGridSize() const { return m_gridSize; }
+
+	//! Get the number of triangles really written per geometry.
+	inline UInt32 getNumTriangles() const { return m_gridSize * m_gridSize * 2; }
+
+	//! Get the number of written bytes.
+	inline UInt64 getSize() const { return m_size; }
+
+private:
+
+	Settings m_settings;
+	UInt32 m_gridSize;
+	UInt32 m_numMaterials;
+	Float m_boneStep;
+
+	FILE *m_file;
+	UInt64 m_size;
+
+	void writeAsset();
+	void writeImages();
+	void writeMaterials();
+	void writeGeometry(UInt32 id);
+	void writeController(UInt32 id);
+	void writeAnimations();
+	void writeSkeleton();
+	void writeInstance(UInt32 id);
+	void writeScene();
+
+	//! Get the bones influencing a vertex at x, and their weights.
+	UInt32 getInfluences(Float x, UInt32 *bones, Float *weights) const;
+};
+
+} // namespace collada
+} // namespace o3d
+
+#endif // _O3D_COLLADA_SYNTHETICDAE_H
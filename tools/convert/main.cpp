@@ -0,0 +1,514 @@
+/**
+ * @file main.cpp
+ * @brief Headless batch converter from COLLADA to O3D scenes.
+ * @author Frederic SCHERMA (frederic.scherma@dreamoverflow.org)
+ * @date 2026-10-18
+ * @copyright Copyright (c) 2001-2026 Dream Overflow. All rights reserved.
+ * @details Convert a set of directories or globs of .dae files on a pool of worker
+ * threads, with one Collada instance and one scene per file, and without any window
+ * or rendering context. The --repeat option imports each file many times at once,
+ * as a stress test of the concurrent imports.
+ */
+
+#include <o3d/core/main.h>
+#include <o3d/core/error.h>
+#include <o3d/core/commandline.h>
+#include <o3d/core/filemanager.h>
+#include <o3d/core/application.h>
+#include <o3d/core/fileoutstream.h>
+#include <o3d/engine/scene/scene.h>
+
+#include "o3d/collada/collada.h"
+
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace o3d;
+using namespace o3d::collada;
+
+namespace fs = boost::filesystem;
+
+//! Case insensitive .dae extension test.
+static Bool isDaeFile(const fs::path &path)
+{
+	std::string ext = path.extension().string();
+	std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+
+	// gzip compressed documents are named .dae.gz
+	if (ext == ".gz")
+		return isDaeFile(path.stem());
+
+	return ext == ".dae" || ext == ".zae";
+}
+
+//! Get the path of a document without its extensions (.dae, .zae or .dae.gz).
+static fs::path withoutExtension(fs::path path)
+{
+	if (path.extension() == ".gz" || path.extension() == ".GZ")
+		path.replace_extension();
+
+	return path.replace_extension();
+}
+
+//---------------------------------------------------------------------------------------
+//! @class ColladaConvert
+//-------------------------------------------------------------------------------------
+//! Headless batch converter application.
+//---------------------------------------------------------------------------------------
+class ColladaConvert
+{
+public:
+
+	//! A file to convert.
+	struct Job
+	{
+		fs::path input;     //!< source .dae file
+		fs::path relative;  //!< path relative to the input root, for the output
+		UInt32 repeat;      //!< index of the repetition of the same file, only 0 is exported
+
+		Bool success;
+		Float duration;     //!< in seconds
+		UInt32 numNodes;    //!< number of imported nodes, must be the same for each repetition
+
+		Job(const fs::path &_input, const fs::path &_relative, UInt32 _repeat) :
+			input(_input),
+			relative(_relative),
+			repeat(_repeat),
+			success(False),
+			duration(0.f),
+			numNodes(0) {}
+	};
+
+	ColladaConvert(const String &sceneRoot, const String &outputDir, ImportProfiler *profiler, UInt32 repeat) :
+		m_sceneRoot(sceneRoot),
+		m_outputDir(outputDir.isValid() ? outputDir.toUtf8().getData() : ""),
+		m_profiler(profiler),
+		m_repeat(o3d::max<UInt32>(1, repeat)),
+		m_exportDae(False),
+		m_floatDigits(0),
+		m_bakeRate(0.f),
+		m_bakeDualQuaternions(False),
+		m_next(0),
+		m_done(0)
+	{
+	}
+
+	//! Set the import options of every file.
+	void setImportOptions(const ImportOptions &options) { m_options = options; }
+
+	//! Write the output scenes back as COLLADA documents rather than O3D scenes.
+	void setExportDae(Bool exportDae) { m_exportDae = exportDae; }
+
+	//! Set the maximal number of significant digits of the exported floats (0 for exact).
+	void setFloatDigits(UInt32 digits) { m_floatDigits = digits; }
+
+	//! Set the tolerances of the vertex welding of every file.
+	void setWeldTolerances(const WeldTolerances &tolerances) { m_weldTolerances = tolerances; }
+
+	//! Bake the skinning matrices of the animations into bone textures, written next to
+	//! the output scenes (0 to disable).
+	void setBoneTextures(Float sampleRate, Bool dualQuaternions)
+	{
+		m_bakeRate = sampleRate;
+		m_bakeDualQuaternions = dualQuaternions;
+	}
+
+	//! Add an input, a directory (recursive) or a glob of files.
+	Bool addInput(const std::string &input)
+	{
+		fs::path path(input);
+		boost::system::error_code ec;
+
+		if (fs::is_directory(path, ec))
+		{
+			for (fs::recursive_directory_iterator it(path, ec), end; it != end; it.increment(ec))
+			{
+				if (ec)
+					break;
+
+				if (fs::is_regular_file(it->path(), ec) && isDaeFile(it->path()))
+					addJobs(it->path(), relativeTo(it->path(), path));
+			}
+
+			return True;
+		}
+
+		if (fs::is_regular_file(path, ec))
+		{
+			addJobs(path, path.filename());
+			return True;
+		}
+
+		// glob on the file name part only
+		fs::path parent = path.parent_path();
+		std::string pattern = path.filename().string();
+
+		if (parent.empty())
+			parent = ".";
+
+		if (!fs::is_directory(parent, ec))
+			return False;
+
+		size_t count = m_jobs.size();
+
+		for (fs::directory_iterator it(parent, ec), end; it != end; it.increment(ec))
+		{
+			if (ec)
+				break;
+
+			if (fs::is_regular_file(it->path(), ec) &&
+				ImportOptions::matchPattern(String(pattern.c_str()), String(it->path().filename().string().c_str())))
+			{
+				addJobs(it->path(), it->path().filename());
+			}
+		}
+
+		return m_jobs.size() > count;
+	}
+
+	//! Get the number of files to convert.
+	inline size_t getNumJobs() const { return m_jobs.size(); }
+
+	//! Convert all the files using numThreads workers, and returns the number of failures.
+	UInt32 run(UInt32 numThreads)
+	{
+		numThreads = o3d::max<UInt32>(1, o3d::min<UInt32>(numThreads, (UInt32)m_jobs.size()));
+
+		Int64 t = System::getTime();
+
+		std::vector<std::thread> workers;
+		for (UInt32 i = 0; i < numThreads; ++i)
+			workers.push_back(std::thread(&ColladaConvert::worker, this));
+
+		for (std::thread &worker : workers)
+			worker.join();
+
+		t = System::getTime() - t;
+
+		// summary
+		UInt32 failed = 0;
+		Float total = 0.f;
+		const Job *slowest = nullptr;
+
+		for (size_t i = 0; i < m_jobs.size(); ++i)
+		{
+			Job &job = m_jobs[i];
+
+			// repetitions follow their first import, they must give the same result
+			if (job.success && job.repeat > 0)
+			{
+				const Job &first = m_jobs[i - job.repeat];
+				if (!first.success || first.numNodes != job.numNodes)
+				{
+					job.success = False;
+					System::print(String::print("Inconsistent repetition %u (%u nodes, %u expected): ",
+						job.repeat, job.numNodes, first.numNodes) + job.input.string().c_str(), "convert");
+				}
+			}
+
+			if (!job.success)
+			{
+				++failed;
+				System::print(String("Failed: ") + job.input.string().c_str(), "convert");
+			}
+
+			total += job.duration;
+
+			if (!slowest || job.duration > slowest->duration)
+				slowest = &job;
+		}
+
+		System::print(String::print("%u files, %u converted, %u failed, %u threads",
+			(UInt32)m_jobs.size(), (UInt32)m_jobs.size() - failed, failed, numThreads), "convert");
+
+		System::print(String::print("wall time %f s, cumulated %f s, average %f s",
+			Float(t) / System::getTimeFrequency(),
+			total,
+			m_jobs.empty() ? 0.f : total / m_jobs.size()), "convert");
+
+		if (slowest)
+			System::print(String::print("slowest %f s ", slowest->duration) + slowest->input.string().c_str(), "convert");
+
+		return failed;
+	}
+
+private:
+
+	String m_sceneRoot;
+	fs::path m_outputDir;
+
+	ImportProfiler *m_profiler;
+	UInt32 m_repeat;
+
+	ImportOptions m_options;
+	Bool m_exportDae;
+	UInt32 m_floatDigits;
+	WeldTolerances m_weldTolerances;
+	Float m_bakeRate;
+	Bool m_bakeDualQuaternions;
+
+	std::vector<Job> m_jobs;
+
+	//! Add the jobs of a file, once per repetition.
+	void addJobs(const fs::path &input, const fs::path &relative)
+	{
+		for (UInt32 i = 0; i < m_repeat; ++i)
+			m_jobs.push_back(Job(input, relative, i));
+	}
+
+	std::atomic<size_t> m_next;
+	std::atomic<size_t> m_done;
+
+	std::mutex m_printMutex;
+
+	static fs::path relativeTo(const fs::path &path, const fs::path &base)
+	{
+		fs::path result;
+
+		fs::path::const_iterator pit = path.begin();
+		for (fs::path::const_iterator bit = base.begin(); bit != base.end() && pit != path.end(); ++bit, ++pit)
+		{
+			if (*bit != *pit)
+				return path.filename();
+		}
+
+		for (; pit != path.end(); ++pit)
+			result /= *pit;
+
+		return result;
+	}
+
+	void worker()
+	{
+		size_t i;
+		while ((i = m_next++) < m_jobs.size())
+		{
+			Job &job = m_jobs[i];
+
+			Int64 t = System::getTime();
+			job.success = convert(job);
+			job.duration = Float(System::getTime() - t) / System::getTimeFrequency();
+
+			size_t done = ++m_done;
+
+			std::lock_guard<std::mutex> lock(m_printMutex);
+			System::print(String::print("[%u/%u] %s %f s ",
+				(UInt32)done,
+				(UInt32)m_jobs.size(),
+				job.success ? "ok" : "FAILED",
+				job.duration) + job.input.string().c_str(), "convert");
+		}
+	}
+
+	Bool convert(Job &job)
+	{
+		// a scene without renderer, nothing is uploaded to a GPU
+		Scene *scene = new Scene(nullptr, m_sceneRoot, nullptr);
+		scene->setSceneName(withoutExtension(job.relative).filename().string().c_str());
+
+		Collada collada;
+		collada.getInfo().setHeadless(True);
+		collada.getInfo().setWeldTolerances(m_weldTolerances);
+		collada.getInfo().setBoneTextureGeneration(m_bakeRate, m_bakeDualQuaternions);
+		collada.getInfo().setProfiler(m_profiler);
+		collada.setImportOptions(m_options);
+		collada.setScene(scene);
+
+		Bool result = False;
+
+		// an exception must not escape a worker thread, it only fails its file
+		try
+		{
+			result = collada.processImport(job.input.string().c_str());
+			job.numNodes = collada.getInfo().getNumNodes();
+
+			if (result && !m_outputDir.empty() && job.repeat == 0)
+			{
+				fs::path output = m_outputDir / withoutExtension(job.relative);
+				output += m_exportDae ? ".dae" : ".o3dsc";
+
+				boost::system::error_code ec;
+				fs::create_directories(output.parent_path(), ec);
+
+				if (m_exportDae)
+				{
+					// the files are already converted in parallel, one thread per document
+					collada.getExporter().setFloatDigits(m_floatDigits);
+					result = collada.processExport(output.string().c_str());
+				}
+				else
+					result = scene->exportScene(output.string().c_str(), SceneIO());
+
+				if (result && collada.getBoneTextures().getNumTextures() > 0)
+				{
+					fs::path textures = output;
+					textures.replace_extension(".o3dbt");
+
+					FileOutStream os(textures.string().c_str(), FileOutStream::CREATE);
+					result = collada.getBoneTextures().writeToStream(os);
+				}
+			}
+		}
+		catch (E_BaseException &)
+		{
+			result = False;
+		}
+		catch (std::exception &)
+		{
+			// std::bad_alloc on a too large document
+			result = False;
+		}
+		catch (...)
+		{
+			result = False;
+		}
+
+		deletePtr(scene);
+
+		return result;
+	}
+
+public:
+
+	static Int32 main()
+	{
+		Debug::instance()->setDefaultLog("convert.log");
+		Debug::instance()->getDefaultLog().clearLog();
+
+		// parse command line
+		Application::getCommandLine()->registerArgument("input");
+		Application::getCommandLine()->addOption('r',"root");
+		Application::getCommandLine()->addOption('o',"output");
+		Application::getCommandLine()->addOption('j',"jobs");
+		Application::getCommandLine()->addOption('t',"trace");
+		Application::getCommandLine()->addOption('n',"repeat");
+		Application::getCommandLine()->addOption('s',"static");
+		Application::getCommandLine()->addOption('f',"filter");
+		Application::getCommandLine()->addOption('d',"dae");
+		Application::getCommandLine()->addOption('g',"digits");
+		Application::getCommandLine()->addOption('w',"weld");
+		Application::getCommandLine()->addOption('b',"bake");
+
+		if (!Application::getCommandLine()->parse())
+		{
+			System::print("--- O3DCollada batch converter ---", "convert");
+			System::print("Usage: o3dcollada-convert <--root=datadir> <--output=dir> <--jobs=N> input[;input...]", "convert");
+			System::print("Each input is a directory (recursively scanned for .dae, .dae.gz and .zae files), a file or a glob like models/*.dae", "convert");
+			System::print("Use --root option to specifiy where the scene data are located", "convert");
+			System::print("If the --output option is present the O3D scenes are exported into this directory, else they are only imported", "convert");
+			System::print("Use --jobs option to define the number of worker threads, default to the number of cores", "convert");
+			System::print("Use --trace option to write the import phases of every file as a Chrome trace JSON file", "convert");
+			System::print("Use --repeat=N option to import each file N times concurrently and check they give the same result", "convert");
+			System::print("Use --static=1 option to import only the static geometry, without animations, skins, materials and textures", "convert");
+			System::print("Use --filter=pattern[,pattern...] option to import only the nodes sub-trees whose id or name match ('*' and '?' wildcards)", "convert");
+			System::print("Use --dae=1 option to export the imported scenes back as COLLADA 1.4.1 documents into the output directory", "convert");
+			System::print("Use --digits=N option to write the exported floats with at most N significant digits, default to the shortest exact text", "convert");
+			System::print("Use --weld=position[,normal[,uv]] option to weld the vertices whose attributes differ by less than these tolerances", "convert");
+			System::print("Use --bake=rate[,dq] option to bake the skinning matrices of the animations at rate frames per second into .o3dbt bone textures, as dual quaternions with dq", "convert");
+			return 0;
+		}
+
+		std::string inputs = Application::getCommandLine()->getArgumentValue("input").toUtf8().getData();
+		String outputDir = Application::getCommandLine()->getOptionValue("output");
+		String sceneRoot = Application::getCommandLine()->getOptionValue("root");
+		String jobs = Application::getCommandLine()->getOptionValue("jobs");
+		String traceFilename = Application::getCommandLine()->getOptionValue("trace");
+		String repeat = Application::getCommandLine()->getOptionValue("repeat");
+		String staticOnly = Application::getCommandLine()->getOptionValue("static");
+		std::string filters = Application::getCommandLine()->getOptionValue("filter").toUtf8().getData();
+		String exportDae = Application::getCommandLine()->getOptionValue("dae");
+		String digits = Application::getCommandLine()->getOptionValue("digits");
+		String weld = Application::getCommandLine()->getOptionValue("weld");
+		String bake = Application::getCommandLine()->getOptionValue("bake");
+
+		if (sceneRoot.isEmpty())
+			sceneRoot = FileManager::instance()->getWorkingDirectory();
+
+		UInt32 numThreads = jobs.isValid() ? (UInt32)atoi(jobs.toUtf8().getData()) : std::thread::hardware_concurrency();
+		if (numThreads == 0)
+			numThreads = 1;
+
+		ImportProfiler profiler;
+		ColladaConvert convert(
+			sceneRoot,
+			outputDir,
+			traceFilename.isValid() ? &profiler : nullptr,
+			repeat.isValid() ? (UInt32)atoi(repeat.toUtf8().getData()) : 1);
+
+		ImportOptions options;
+		if (staticOnly.isValid() && atoi(staticOnly.toUtf8().getData()) != 0)
+			options = ImportOptions::staticGeometry();
+
+		size_t pos = 0;
+		while (pos < filters.size())
+		{
+			size_t end = filters.find(',', pos);
+			if (end == std::string::npos)
+				end = filters.size();
+
+			if (end > pos)
+				options.nodeFilters.push_back(filters.substr(pos, end - pos).c_str());
+
+			pos = end + 1;
+		}
+
+		convert.setImportOptions(options);
+		convert.setExportDae(exportDae.isValid() && atoi(exportDae.toUtf8().getData()) != 0);
+		convert.setFloatDigits(digits.isValid() ? (UInt32)atoi(digits.toUtf8().getData()) : 0);
+
+		if (weld.isValid())
+		{
+			WeldTolerances tolerances;
+			sscanf(weld.toUtf8().getData(), "%f,%f,%f", &tolerances.position, &tolerances.normal, &tolerances.texCoord);
+
+			convert.setWeldTolerances(tolerances);
+		}
+
+		if (bake.isValid())
+		{
+			Float rate = 0.f;
+			char format[8] = "";
+			sscanf(bake.toUtf8().getData(), "%f,%7s", &rate, format);
+
+			convert.setBoneTextures(rate, std::string(format) == "dq");
+		}
+
+		pos = 0;
+		while (pos <= inputs.size())
+		{
+			size_t end = inputs.find(';', pos);
+			if (end == std::string::npos)
+				end = inputs.size();
+
+			std::string input = inputs.substr(pos, end - pos);
+			if (!input.empty() && !convert.addInput(input))
+				System::print(String("No COLLADA file found for ") + input.c_str(), "convert");
+
+			pos = end + 1;
+		}
+
+		if (convert.getNumJobs() == 0)
+		{
+			System::print("Nothing to convert", "convert");
+			return 1;
+		}
+
+		UInt32 failed = convert.run(numThreads);
+
+		if (traceFilename.isValid())
+			profiler.exportChromeTrace(traceFilename);
+
+		return failed > 0 ? 1 : 0;
+	}
+};
+
+O3D_CONSOLE_MAIN(ColladaConvert, O3D_DEFAULT_CLASS_SETTINGS)
@@ -0,0 +1,126 @@
+/**
+ * @file main.cpp
+ * @brief Synthetic COLLADA documents generator, for scale testing.
+ * @author Frederic SCHERMA (frederic.scherma@dreamoverflow.org)
+ * @date 2026-10-18
+ * @copyright Copyright (c) 2001-2026 Dream Overflow. All rights reserved.
+ * @details
+ */
+
+#include <o3d/core/main.h>
+#include <o3d/core/commandline.h>
+#include <o3d/core/application.h>
+
+#include "../common/syntheticdae.h"
+
+#include <cstdlib>
+
+using namespace o3d;
+using namespace o3d::collada;
+
+//---------------------------------------------------------------------------------------
+//! @class ColladaGenerate
+//-------------------------------------------------------------------------------------
+//! Synthetic COLLADA generator application.
+//---------------------------------------------------------------------------------------
+class ColladaGenerate
+{
+public:
+
+	static UInt32 toUInt32(const String &value, UInt32 def)
+	{
+		return value.isValid() ? (UInt32)strtoul(value.toUtf8().getData(), nullptr, 10) : def;
+	}
+
+	static Int32 main()
+	{
+		Application::getCommandLine()->registerArgument("output");
+		Application::getCommandLine()->addOption('t',"triangles");
+		Application::getCommandLine()->addOption('s',"size");
+		Application::getCommandLine()->addOption('p',"polylist");
+		Application::getCommandLine()->addOption('g',"geometries");
+		Application::getCommandLine()->addOption('i',"instances");
+		Application::getCommandLine()->addOption('d',"depth");
+		Application::getCommandLine()->addOption('b',"bones");
+		Application::getCommandLine()->addOption('w',"influences");
+		Application::getCommandLine()->addOption('k',"keys");
+		Application::getCommandLine()->addOption('x',"textures");
+
+		if (!Application::getCommandLine()->parse())
+		{
+			System::print("--- O3DCollada synthetic documents generator ---", "generate");
+			System::print("Usage: o3dcollada-generate [options] output.dae", "generate");
+			System::print("--triangles=N   triangles per geometry (default 100000)", "generate");
+			System::print("--size=MB       approximative size of the document, overrides --triangles", "generate");
+			System::print("--polylist=1    write quads polylist rather than triangles", "generate");
+			System::print("--geometries=N  number of distinct geometries (default 1)", "generate");
+			System::print("--instances=N   number of nodes instancing the geometries (default 1)", "generate");
+			System::print("--depth=N       depth of the nodes hierarchy above each instance (default 1)", "generate");
+			System::print("--bones=N       length of the skinning bones chain (default 0, static)", "generate");
+			System::print("--influences=N  bones per vertex (default 2, at most 8)", "generate");
+			System::print("--keys=N        animation keys per bone (default 0)", "generate");
+			System::print("--textures=N    number of textured materials (default 0)", "generate");
+			return 0;
+		}
+
+		CommandLine *cmd = Application::getCommandLine();
+
+		String output = cmd->getArgumentValue("output");
+
+		SyntheticDae::Settings settings;
+		settings.numTriangles = toUInt32(cmd->getOptionValue("triangles"), 100000);
+		settings.polylist = toUInt32(cmd->getOptionValue("polylist"), 0) != 0;
+		settings.numGeometries = toUInt32(cmd->getOptionValue("geometries"), 1);
+		settings.numInstances = toUInt32(cmd->getOptionValue("instances"), 1);
+		settings.depth = toUInt32(cmd->getOptionValue("depth"), 1);
+		settings.numBones = toUInt32(cmd->getOptionValue("bones"), 0);
+		settings.influences = toUInt32(cmd->getOptionValue("influences"), 2);
+		settings.numKeys = toUInt32(cmd->getOptionValue("keys"), 0);
+		settings.numTextures = toUInt32(cmd->getOptionValue("textures"), 0);
+
+		UInt64 targetSize = (UInt64)toUInt32(cmd->getOptionValue("size"), 0) << 20;
+
+		// calibrate the number of triangles on a small document of the same features
+		if (targetSize > 0)
+		{
+			const UInt32 probeTriangles = 20000;
+
+			SyntheticDae::Settings probeSettings = settings;
+			probeSettings.numTriangles = probeTriangles;
+
+			SyntheticDae probe(probeSettings);
+			if (!probe.write(output) || probe.getSize() == 0)
+			{
+				System::print(String("Unable to write ") + output, "generate");
+				return 1;
+			}
+
+			Double ratio = (Double)targetSize / probe.getSize();
+			Double triangles = ratio * probe.getNumTriangles();
+
+			settings.numTriangles = triangles > 4e9 ? 4000000000u : (UInt32)(triangles < 2.0 ? 2.0 : triangles);
+		}
+
+		Int64 t = System::getTime();
+
+		SyntheticDae generator(settings);
+		if (!generator.write(output))
+		{
+			System::print(String("Unable to write ") + output, "generate");
+			return 1;
+		}
+
+		t = System::getTime() - t;
+
+		System::print(String::print("%u triangles per geometry, %u geometries, %u instances, %llu bytes in %f s",
+			generator.getNumTriangles(),
+			settings.numGeometries,
+			settings.numInstances,
+			(unsigned long long)generator.getSize(),
+			Float(t) / System::getTimeFrequency()), "generate");
+
+		return 0;
+	}
+};
+
+O3D_CONSOLE_MAIN(ColladaGenerate, O3D_DEFAULT_CLASS_SETTINGS)